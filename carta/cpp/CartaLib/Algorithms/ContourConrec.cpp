@@ -2,287 +2,151 @@
  *
  **/
 
-#include <cmath>
 #include "ContourConrec.h"
 #include "IImage.h"
-#include "LineCombiner.h"
+#include "MarchingSquares.h"
 
 #include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <QMutex>
 #include <QString>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
 #include <QDebug>
 
-typedef std::vector < double > VD;
-
 /*
- * The code below is modified version of Paul Bourke's algorithm:
+ * The contours used to be traced by a modified version of Paul Bourke's algorithm:
  *
  * http://paulbourke.net/papers/conrec/
  *
- * The original is included at the bottom for reference, in case the web page
- * disappears.
+ * They are now traced with marching squares, which resolves saddles by the cell
+ * average just as CONREC does, but yields connected polylines directly. The
+ * original is still included at the bottom for reference.
  */
 
-/*
-   Derivation from the fortran version of CONREC by Paul Bourke
-   view            ! view of the data
-   ilb,iub         ! bounds for first coordinate (column), inclusive
-   jlb,jub         ! bounds for second coordinate (row), inclusive
-   xCoords         ! column coordinates (first index)
-   yCoords         ! row coordinates (second index)
-   nc              ! number of contour levels
-   z               ! contour levels in increasing order
-*/
-static Carta::Lib::Algorithms::ContourConrec::Result
-conrecFaster(
-    Carta::Lib::NdArray::RawViewInterface * view,
-    int ilb,
-    int iub,
-    int jlb,
-    int jub,
-    const VD & xCoords,
-    const VD & yCoords,
-    int nc,
-    double * z
-    )
+namespace
 {
-    // we will only need two rows in memory at any given time
-//    int nRows = jub - jlb + 1;
-    int nCols = iub - ilb + 1;
-    double * rows[2] {
-        nullptr, nullptr
-    };
-    std::vector < double > row1( nCols ), row2( nCols );
-    rows[0] = & row1[0];
-    rows[1] = & row2[0];
-    int nextRowToReadIn = 0;
-
-    auto updateRows = [&] () -> void {
-        CARTA_ASSERT( nextRowToReadIn < view-> dims()[1] );
-
-        // make a row view into the view
-        SliceND rowSlice;
-        rowSlice.next().start( nextRowToReadIn ).end( nextRowToReadIn + 1 );
-        auto rawRowView = view-> getView( rowSlice );
-        nextRowToReadIn++;
-
-        // make a double view of this raw row view
-        Carta::Lib::NdArray::Double dview( rawRowView, true );
-
-        // shift the row up
-        // note: we could avoid this memory copy if we swapped row[] pointers instead,
-        // and alternately read in the data into row1,row2..., for a miniscule performance
-        // gain and lot more complicated algorithm
-        row1 = row2;
-
-        // read in the data into row2
-        int i = 0;
-        dview.forEach([&] ( const double & val ) {
-                          row2[i++] = val;
-                      }
-                      );
-        CARTA_ASSERT( i == nCols );
+/// fewest rows of cells worth contouring as a separate band
+const int MIN_BAND_ROWS = 32;
+
+/// bands handed to each thread of the pool, to even out bands with more contours
+const int BANDS_PER_THREAD = 4;
+
+/// read consecutive rows of a 2d view into memory, converted to double
+void
+readRows( Carta::Lib::NdArray::RawViewInterface * view, int firstRow, int rowCount,
+          std::vector < double > & rows )
+{
+    SliceND rowSlice;
+    rowSlice.next().start( firstRow ).end( firstRow + rowCount );
+    std::unique_ptr < Carta::Lib::NdArray::RawViewInterface > rowView( view-> getView( rowSlice ) );
+    int64_t nCols = view-> dims()[0];
+    rows.resize( nCols * rowCount );
+    auto pixelType = rowView-> pixelType();
+    size_t pixelSize = Carta::Lib::Image::pixelType2size( pixelType );
+    auto cvt = Carta::Lib::getConverter < double > ( pixelType );
+    int64_t filled = 0;
+    rowView-> forEach( nCols * pixelSize, [&] ( const char * data, int64_t count ) {
+        CARTA_ASSERT( filled + count <= int64_t( rows.size() ) );
+        for ( int64_t i = 0 ; i < count ; i++ ) {
+            rows[filled++] = cvt( data + i * pixelSize );
+        }
+    });
+    CARTA_ASSERT( filled == int64_t( rows.size() ) );
+}
+
+/// join the polylines of neighbouring bands that meet on the row the bands share
+///
+/// Both bands compute a crossing on their shared row from the same two pixels, so the
+/// ends that should meet are identical and are matched exactly. Polylines are visited
+/// in band order, which keeps the result independent of how the bands were scheduled.
+std::vector < QPolygonF >
+stitchBands( const std::vector < std::vector < QPolygonF > > & bands )
+{
+    std::vector < const QPolygonF * > polys;
+    for ( const std::vector < QPolygonF > & band : bands ) {
+        for ( const QPolygonF & poly : band ) {
+            polys.push_back( & poly );
+        }
+    }
+    int nPolys = polys.size();
+    auto isOpen = [&] ( int p ) {
+        return polys[p]-> size() > 1 && polys[p]-> first() != polys[p]-> last();
     };
-    updateRows();
-
-//    NdArray::Double doubleView( view, false );
-//    auto acc = [& doubleView] ( int col, int row ) {
-//        return doubleView.get( { col, row }
-//                               );
-//    };
-
-    // to keep the data accessor easy, we use this lambda, and hope the compiler
-    // optimizes it into an inline expression... :)
-    auto acc = [&] ( int col, int row ) {
-        row -= nextRowToReadIn - 2;
-        return rows[row][col];
+    auto endPoint = [&] ( int p, int end ) {
+        return end == 0 ? polys[p]-> first() : polys[p]-> last();
     };
 
-    Carta::Lib::Algorithms::ContourConrec::Result result;
-    if ( nc < 1 ) {
-        return result;
+    // pair up the ends of open polylines that lie on the same point; an end is
+    // identified by polyline * 2 + (0 for the first point, 1 for the last)
+    std::map < std::pair < double, double >, std::vector < int > > ends;
+    for ( int p = 0 ; p < nPolys ; ++p ) {
+        if ( ! isOpen( p ) ) {
+            continue;
+        }
+        for ( int end = 0 ; end < 2 ; ++end ) {
+            QPointF pt = endPoint( p, end );
+            ends[std::make_pair( pt.x(), pt.y() )].push_back( p * 2 + end );
+        }
+    }
+    std::vector < int > partner( nPolys * 2, - 1 );
+    for ( auto & entry : ends ) {
+        const std::vector < int > & ids = entry.second;
+        for ( size_t i = 0 ; i + 1 < ids.size() ; i += 2 ) {
+            partner[ids[i]] = ids[i + 1];
+            partner[ids[i + 1]] = ids[i];
+        }
     }
-    result.resize( nc );
 
-#define xsect( p1, p2 ) ( h[p2] * xh[p1] - h[p1] * xh[p2] ) / ( h[p2] - h[p1] )
-#define ysect( p1, p2 ) ( h[p2] * yh[p1] - h[p1] * yh[p2] ) / ( h[p2] - h[p1] )
+    std::vector < QPolygonF > result;
+    std::vector < bool > used( nPolys, false );
+    for ( int p = 0 ; p < nPolys ; ++p ) {
+        if ( used[p] ) {
+            continue;
+        }
+        if ( partner[p * 2] < 0 && partner[p * 2 + 1] < 0 ) {
+            used[p] = true;
+            result.push_back( * polys[p] );
+            continue;
+        }
 
-    int m1, m2, m3, case_value;
-    double dmin, dmax, x1 = 0, x2 = 0, y1 = 0, y2 = 0;
-    int i, j, k, m;
-    double h[5];
-    int sh[5];
-    double xh[5], yh[5];
-    int im[4] = {
-        0, 1, 1, 0
-    }, jm[4] = {
-        0, 0, 1, 1
-    };
-    int castab[3][3][3] = {
-        { { 0, 0, 8 }, { 0, 2, 5 }, { 7, 6, 9 } },
-        { { 0, 3, 4 }, { 1, 3, 1 }, { 4, 3, 0 } },
-        { { 9, 6, 7 }, { 5, 2, 0 }, { 8, 0, 0 } }
-    };
-    double temp1, temp2;
+        // walk backwards to the start of the chain, or all the way round a loop
+        int start = p;
+        int startEnd = 0;
+        for ( int steps = 0 ; steps < nPolys ; ++steps ) {
+            int prev = partner[start * 2 + startEnd];
+            if ( prev < 0 || prev / 2 == p ) {
+                break;
+            }
+            start = prev / 2;
+            startEnd = 1 - prev % 2;
+        }
 
-    // original code went from bottom to top, not sure why
-    //    for ( j = ( jub - 1 ) ; j >= jlb ; j-- ) {
-    for ( j = jlb ; j < jub ; j++ ) {
-        updateRows();
-        for ( i = ilb ; i < iub ; i++ ) {
-            temp1 = std::min( acc( i, j ), acc( i, j + 1 ) );
-            temp2 = std::min( acc( i + 1, j ), acc( i + 1, j + 1 ) );
-            dmin = std::min( temp1, temp2 );
-
-            // early abort if one of the values is not finite
-            if ( ! std::isfinite( dmin ) ) {
-                continue;
+        // then forwards, appending each polyline without repeating the shared point
+        QPolygonF joined;
+        int current = start;
+        int entry = startEnd;
+        while ( true ) {
+            used[current] = true;
+            const QPolygonF & poly = * polys[current];
+            int first = joined.isEmpty() ? 0 : 1;
+            for ( int i = first ; i < poly.size() ; ++i ) {
+                joined.append( entry == 0 ? poly[i] : poly[poly.size() - 1 - i] );
             }
-            temp1 = std::max( acc( i, j ), acc( i, j + 1 ) );
-            temp2 = std::max( acc( i + 1, j ), acc( i + 1, j + 1 ) );
-            dmax = std::max( temp1, temp2 );
-            if ( dmax < z[0] || dmin > z[nc - 1] ) {
-                continue;
+            int next = partner[current * 2 + 1 - entry];
+            if ( next < 0 || used[next / 2] ) {
+                break;
             }
-            for ( k = 0 ; k < nc ; k++ ) {
-                if ( z[k] < dmin || z[k] > dmax ) {
-                    continue;
-                }
-                for ( m = 4 ; m >= 0 ; m-- ) {
-                    if ( m > 0 ) {
-                        h[m] = acc( i + im[m - 1], j + jm[m - 1] ) - z[k];
-                        xh[m] = xCoords[i + im[m - 1]];
-                        yh[m] = yCoords[j + jm[m - 1]];
-                    }
-                    else {
-                        h[0] = 0.25 * ( h[1] + h[2] + h[3] + h[4] );
-                        xh[0] = 0.50 * ( xCoords[i] + xCoords[i + 1] );
-                        yh[0] = 0.50 * ( yCoords[j] + yCoords[j + 1] );
-                    }
-                    if ( h[m] > 0.0 ) {
-                        sh[m] = 1;
-                    }
-                    else if ( h[m] < 0.0 ) {
-                        sh[m] = - 1;
-                    }
-                    else {
-                        sh[m] = 0;
-                    }
-                }
-
-                /*
-                   Note: at this stage the relative heights of the corners and the
-                   centre are in the h array, and the corresponding coordinates are
-                   in the xh and yh arrays. The centre of the box is indexed by 0
-                   and the 4 corners by 1 to 4 as shown below.
-                   Each triangle is then indexed by the parameter m, and the 3
-                   vertices of each triangle are indexed by parameters m1,m2,and m3.
-                   It is assumed that the centre of the box is always vertex 2
-                   though this isimportant only when all 3 vertices lie exactly on
-                   the same contour level, in which case only the side of the box
-                   is drawn.
-                      vertex 4 +-------------------+ vertex 3
-                               | \               / |
-                               |   \    m-3    /   |
-                               |     \       /     |
-                               |       \   /       |
-                               |  m=2    X   m=2   |       the centre is vertex 0
-                               |       /   \       |
-                               |     /       \     |
-                               |   /    m=1    \   |
-                               | /               \ |
-                      vertex 1 +-------------------+ vertex 2
-                */
-                /* Scan each triangle in the box */
-                for ( m = 1 ; m <= 4 ; m++ ) {
-                    m1 = m;
-                    m2 = 0;
-                    if ( m != 4 ) {
-                        m3 = m + 1;
-                    }
-                    else {
-                        m3 = 1;
-                    }
-                    if ( ( case_value = castab[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1] ) == 0 ) {
-                        continue;
-                    }
-                    switch ( case_value )
-                    {
-                    case 1 : /* Line between vertices 1 and 2 */
-                        x1 = xh[m1];
-                        y1 = yh[m1];
-                        x2 = xh[m2];
-                        y2 = yh[m2];
-                        break;
-                    case 2 : /* Line between vertices 2 and 3 */
-                        x1 = xh[m2];
-                        y1 = yh[m2];
-                        x2 = xh[m3];
-                        y2 = yh[m3];
-                        break;
-                    case 3 : /* Line between vertices 3 and 1 */
-                        x1 = xh[m3];
-                        y1 = yh[m3];
-                        x2 = xh[m1];
-                        y2 = yh[m1];
-                        break;
-                    case 4 : /* Line between vertex 1 and side 2-3 */
-                        x1 = xh[m1];
-                        y1 = yh[m1];
-                        x2 = xsect( m2, m3 );
-                        y2 = ysect( m2, m3 );
-                        break;
-                    case 5 : /* Line between vertex 2 and side 3-1 */
-                        x1 = xh[m2];
-                        y1 = yh[m2];
-                        x2 = xsect( m3, m1 );
-                        y2 = ysect( m3, m1 );
-                        break;
-                    case 6 : /* Line between vertex 3 and side 1-2 */
-                        x1 = xh[m3];
-                        y1 = yh[m3];
-                        x2 = xsect( m1, m2 );
-                        y2 = ysect( m1, m2 );
-                        break;
-                    case 7 : /* Line between sides 1-2 and 2-3 */
-                        x1 = xsect( m1, m2 );
-                        y1 = ysect( m1, m2 );
-                        x2 = xsect( m2, m3 );
-                        y2 = ysect( m2, m3 );
-                        break;
-                    case 8 : /* Line between sides 2-3 and 3-1 */
-                        x1 = xsect( m2, m3 );
-                        y1 = ysect( m2, m3 );
-                        x2 = xsect( m3, m1 );
-                        y2 = ysect( m3, m1 );
-                        break;
-                    case 9 : /* Line between sides 3-1 and 1-2 */
-                        x1 = xsect( m3, m1 );
-                        y1 = ysect( m3, m1 );
-                        x2 = xsect( m1, m2 );
-                        y2 = ysect( m1, m2 );
-                        break;
-                    default :
-                        break;
-                    } // switch
-
-                    // add the line segment to the result
-                    // ConrecLine( x1, y1, x2, y2, k );
-                    if ( std::isfinite( x1 ) && std::isfinite( y1 ) && std::isfinite( x2 ) &&
-                         std::isfinite( y2 ) ) {
-                        QPolygonF poly;
-                        poly.append( QPointF( x1, y1 ) );
-                        poly.append( QPointF( x2, y2 ) );
-                        result[k].push_back( poly );
-                    }
-                } /* m */
-            } /* k - contour */
-        } /* i */
-    } /* j */
+            current = next / 2;
+            entry = next % 2;
+        }
+        result.push_back( joined );
+    }
     return result;
-
-#undef xsect
-#undef ysect
-} // conrecFaster
+} // stitchBands
+}
 
 namespace Carta
 {
@@ -299,96 +163,135 @@ ContourConrec::setLevels( const std::vector < double > & levels )
     m_levels = levels;
 }
 
+void
+ContourConrec::setMonitor( const std::function < bool () > & isCancelled )
+{
+    m_isCancelled = isCancelled;
+}
+
+void
+ContourConrec::setParallel( bool parallel )
+{
+    m_parallel = parallel;
+}
+
+void
+ContourConrec::setSampling( int factor )
+{
+    m_sampling = std::max( factor, 1 );
+}
+
 ContourConrec::Result
 ContourConrec::compute( NdArray::RawViewInterface * view )
 {
+    int nLevels = m_levels.size();
+
     // if no input view was set, we are done
-    if ( ! view || m_levels.size() == 0 ) {
-        Result result( m_levels.size() );
+    if ( ! view || nLevels == 0 ) {
+        Result result( nLevels );
         return result;
     }
 
-    // the c-algorithm conrec() needs the levels in sorted order (to make things little
-    // bit faster), but we would like to report the results in the same order that the
-    // levels were requested. So we need to sort the levels, call the conrec(), and
-    // then we need to 'unsort' the results...
-    typedef std::pair < double, size_t > DI;
-    std::vector < DI > tmpLevels( m_levels.size() );
-    for ( size_t i = 0 ; i < m_levels.size() ; ++i ) {
-        tmpLevels[i].first = m_levels[i];
-        tmpLevels[i].second = i;
+    // contour the grid of blocks, leaving out any partial blocks at the top and right,
+    // which are less than a block wide
+    int factor = m_sampling;
+    int nPixelRows = view-> dims()[1];
+    int nPixelCols = view-> dims()[0];
+    while ( factor > 1 && ( nPixelRows / factor < 2 || nPixelCols / factor < 2 ) ) {
+        factor /= 2;
     }
-    auto sort1 = [] ( const DI & a, const DI & b ) {
-        return a.first < b.first;
-    };
-    std::sort( tmpLevels.begin(), tmpLevels.end(), sort1 );
-    std::vector < double > sortedRawLevels( m_levels.size() );
-    for ( size_t i = 0 ; i < m_levels.size() ; ++i ) {
-        sortedRawLevels[i] = tmpLevels[i].first;
+    auto m_nRows = nPixelRows / factor;
+    auto m_nCols = nPixelCols / factor;
+    if ( m_nRows < 2 || m_nCols < 2 ) {
+        Result result( nLevels );
+        return result;
     }
 
-    auto m_nRows = view-> dims()[1];
-    auto m_nCols = view-> dims()[0];
-
-    // make x coordinates
-    VD xcoords( m_nCols );
-    for ( int col = 0 ; col < m_nCols ; ++col ) {
-        xcoords[col] = col;
+    // split the rows of cells into horizontal bands that are contoured on the thread
+    // pool, each band sharing its last row of pixels with the next band
+    int cellRows = m_nRows - 1;
+    int idealBands = std::max( 1, QThread::idealThreadCount() ) * BANDS_PER_THREAD;
+    int bandRows = std::max( MIN_BAND_ROWS, ( cellRows + idealBands - 1 ) / idealBands );
+    int nBands = ( cellRows + bandRows - 1 ) / bandRows;
+    std::vector < int > bands( nBands );
+    for ( int band = 0 ; band < nBands ; ++band ) {
+        bands[band] = band;
     }
 
-    // make y coordinates
-    VD ycoords( m_nRows );
-    for ( int row = 0 ; row < m_nRows ; ++row ) {
-        ycoords[row] = row;
+    // views are not required to be thread safe, so the bands take turns reading
+    QMutex readMutex;
+    std::vector < std::vector < std::vector < QPolygonF > > > bandPolygons(
+        nLevels, std::vector < std::vector < QPolygonF > > ( nBands ) );
+    auto contourBand = [&] ( int & band ) {
+        if ( m_isCancelled && m_isCancelled() ) {
+            return;
+        }
+        int jlb = band * bandRows;
+        int jub = std::min( jlb + bandRows, cellRows );
+        std::vector < double > rows;
+        {
+            QMutexLocker locker( & readMutex );
+            readRows( view, jlb * factor, ( jub - jlb + 1 ) * factor, rows );
+        }
+        if ( factor > 1 ) {
+            rows = averageBlocks( rows, nPixelCols, factor, jub - jlb + 1, m_nCols );
+        }
+        MarchingSquares marchingSquares( rows.data(), m_nCols, jub - jlb + 1, jlb );
+        std::vector < std::vector < QPolygonF > > polygons = marchingSquares.compute( m_levels );
+        for ( int k = 0 ; k < nLevels ; ++k ) {
+            bandPolygons[k][band].swap( polygons[k] );
+        }
+    };
+    if ( m_parallel ) {
+        QtConcurrent::blockingMap( bands, contourBand );
+    }
+    else {
+        for ( int & band : bands ) {
+            contourBand( band );
+        }
     }
-
-    Result result1 =
-        conrecFaster(
-            view,
-            0,
-            m_nCols - 1,
-            0,
-            m_nRows - 1,
-            xcoords,
-            ycoords,
-            m_levels.size(),
-            & sortedRawLevels[0] );
 
     Result result;
-    QRectF rect( 0, 0, m_nCols, m_nRows);
-    for( size_t i = 0 ; i < m_levels.size() ; ++ i ) {
-        Carta::Lib::Algorithms::LineCombiner lc( rect, m_nRows+1, m_nCols + 1, 1e-9);
-        std::vector < QPolygonF > & v = result1[i];
-        for( QPolygonF & poly : v) {
-            for( int i = 0 ; i < poly.size() - 1 ; ++ i ) {
-                lc.add( poly[i], poly[i+1]);
+    for ( int k = 0 ; k < nLevels ; ++k ) {
+        result.push_back( stitchBands( bandPolygons[k] ) );
+    }
+
+    // each block stands at the centre of the pixels it averages
+    if ( factor > 1 ) {
+        double offset = 0.5 * ( factor - 1 );
+        for ( std::vector < QPolygonF > & polys : result ) {
+            for ( QPolygonF & poly : polys ) {
+                for ( QPointF & pt : poly ) {
+                    pt = QPointF( pt.x() * factor + offset, pt.y() * factor + offset );
+                }
             }
         }
-        result.push_back( lc.getPolygons());
-        qDebug() << "compress" << v.size() << "-->" << result.back().size();
     }
+    return result;
+} // compute
 
-//    Result result =
-//        conrecFaster(
-//            view,
-//            0,
-//            m_nCols - 1,
-//            0,
-//            m_nRows - 1,
-//            xcoords,
-//            ycoords,
-//            m_levels.size(),
-//            & sortedRawLevels[0] );
-
-
-    // now we 'unsort' the contours based on the requested order
-    Result unsortedResult( m_levels.size() );
-    for ( size_t i = 0 ; i < m_levels.size() ; ++i ) {
-        unsortedResult[tmpLevels[i].second] = result[i];
+std::vector < double >
+ContourConrec::averageBlocks( const std::vector < double > & rows, int nCols, int factor,
+                              int nRowsOut, int nColsOut )
+{
+    std::vector < double > sums( int64_t( nRowsOut ) * nColsOut, 0.0 );
+    std::vector < int > counts( sums.size(), 0 );
+    for ( int row = 0 ; row < nRowsOut * factor ; ++row ) {
+        const double * rowData = & rows[int64_t( row ) * nCols];
+        int64_t outRow = int64_t( row / factor ) * nColsOut;
+        for ( int col = 0 ; col < nColsOut * factor ; ++col ) {
+            double val = rowData[col];
+            if ( std::isfinite( val ) ) {
+                sums[outRow + col / factor] += val;
+                counts[outRow + col / factor]++;
+            }
+        }
     }
-
-    return unsortedResult;
-} // compute
+    for ( size_t i = 0 ; i < sums.size() ; ++i ) {
+        sums[i] = counts[i] > 0 ? sums[i] / counts[i] : std::numeric_limits < double >::quiet_NaN();
+    }
+    return sums;
+} // averageBlocks
 }
 }
 }
@@ -1,7 +1,8 @@
 /**
  * Calculate contours in 2d array
  *
- * see http://paulbourke.net/papers/conrec/
+ * see http://paulbourke.net/papers/conrec/ for the algorithm this started with;
+ * contours are now traced with MarchingSquares
  *
  **/
 
@@ -34,13 +35,49 @@ public:
     void
     setLevels( const std::vector < double > & levels );
 
+    /// contour a plane reduced by averaging blocks of pixels, for display at low zoom
+    /// \param factor the width and height of a block in pixels; 1 for the full plane
+    ///
+    /// the contours are still returned in the pixel coordinates of the full plane
+    void
+    setSampling( int factor );
+
+    /// set a callback for stopping a computation that is no longer needed
+    /// \param isCancelled polled before each band; once it returns true the remaining
+    /// bands are skipped and the result is incomplete
+    void
+    setMonitor( const std::function < bool () > & isCancelled );
+
+    /// choose whether the bands are contoured on the global thread pool or one after
+    /// another on the calling thread, e.g. for background work that should not
+    /// compete with interactive requests
+    void
+    setParallel( bool parallel );
+
     /// compute and return the sorted vertices
+    ///
+    /// the rows of the view are contoured in bands on the global thread pool, and
+    /// polylines crossing from one band into the next are joined afterwards
     Result
     compute( NdArray::RawViewInterface * );
 
+    /// average blocks of factor x factor pixels, leaving out those that are not finite
+    /// \param rows the rows to reduce, nCols values each
+    /// \param nCols number of columns in rows
+    /// \param factor the width and height of a block
+    /// \param nRowsOut number of rows of blocks to produce
+    /// \param nColsOut number of columns of blocks to produce
+    /// \return the block averages row after row, NaN for blocks with no finite pixels
+    static std::vector < double >
+    averageBlocks( const std::vector < double > & rows, int nCols, int factor,
+                   int nRowsOut, int nColsOut );
+
 private:
 
     std::vector < double > m_levels;
+    int m_sampling = 1;
+    bool m_parallel = true;
+    std::function < bool () > m_isCancelled;
 };
 
 }
@@ -0,0 +1,221 @@
+/**
+ *
+ **/
+
+#include "MarchingSquares.h"
+#include "CartaLib/CartaLib.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Algorithms
+{
+MarchingSquares::MarchingSquares( const double * data, int nCols, int nRows, int firstRow )
+{
+    m_data = data;
+    m_nCols = nCols;
+    m_nRows = nRows;
+    m_firstRow = firstRow;
+}
+
+std::vector < std::vector < QPolygonF > >
+MarchingSquares::compute( const std::vector < double > & levels ) const
+{
+    int nLevels = levels.size();
+    std::vector < std::vector < QPolygonF > > result( nLevels );
+    if ( m_nRows < 2 || m_nCols < 2 || nLevels == 0 ) {
+        return result;
+    }
+
+    // an edge is identified by its first pixel, times two, plus one for edges
+    // running up from the pixel rather than across
+    auto hEdge = [this] ( int col, int row ) {
+        return ( int64_t( row ) * m_nCols + col ) * 2;
+    };
+    auto vEdge = [this] ( int col, int row ) {
+        return ( int64_t( row ) * m_nCols + col ) * 2 + 1;
+    };
+
+    // each segment joins the two edges its level crosses in a cell
+    std::vector < std::vector < std::pair < int64_t, int64_t > > > segments( nLevels );
+    for ( int row = 0 ; row < m_nRows - 1 ; ++row ) {
+        for ( int col = 0 ; col < m_nCols - 1 ; ++col ) {
+            // corners counter-clockwise from the bottom left
+            double v0 = at( col, row );
+            double v1 = at( col + 1, row );
+            double v2 = at( col + 1, row + 1 );
+            double v3 = at( col, row + 1 );
+            if ( ! std::isfinite( v0 ) || ! std::isfinite( v1 ) ||
+                 ! std::isfinite( v2 ) || ! std::isfinite( v3 ) ) {
+                continue;
+            }
+            double dmin = std::min( std::min( v0, v1 ), std::min( v2, v3 ) );
+            double dmax = std::max( std::max( v0, v1 ), std::max( v2, v3 ) );
+
+            // edges counter-clockwise from the bottom
+            int64_t e0 = hEdge( col, row );
+            int64_t e1 = vEdge( col + 1, row );
+            int64_t e2 = hEdge( col, row + 1 );
+            int64_t e3 = vEdge( col, row );
+            for ( int k = 0 ; k < nLevels ; ++k ) {
+                double level = levels[k];
+                if ( level < dmin || level > dmax ) {
+                    continue;
+                }
+                int caseValue = ( v0 >= level ? 1 : 0 ) | ( v1 >= level ? 2 : 0 ) |
+                                ( v2 >= level ? 4 : 0 ) | ( v3 >= level ? 8 : 0 );
+                std::vector < std::pair < int64_t, int64_t > > & segs = segments[k];
+                switch ( caseValue )
+                {
+                case 1 :
+                case 14 :
+                    segs.push_back( { e3, e0 } );
+                    break;
+                case 2 :
+                case 13 :
+                    segs.push_back( { e0, e1 } );
+                    break;
+                case 3 :
+                case 12 :
+                    segs.push_back( { e3, e1 } );
+                    break;
+                case 4 :
+                case 11 :
+                    segs.push_back( { e1, e2 } );
+                    break;
+                case 6 :
+                case 9 :
+                    segs.push_back( { e0, e2 } );
+                    break;
+                case 7 :
+                case 8 :
+                    segs.push_back( { e2, e3 } );
+                    break;
+                case 5 :
+                case 10 : {
+                    // a saddle; the corners on the same side as the centre are joined
+                    bool centreAbove = 0.25 * ( v0 + v1 + v2 + v3 ) >= level;
+                    if ( centreAbove == ( caseValue == 5 ) ) {
+                        segs.push_back( { e0, e1 } );
+                        segs.push_back( { e2, e3 } );
+                    }
+                    else {
+                        segs.push_back( { e3, e0 } );
+                        segs.push_back( { e1, e2 } );
+                    }
+                    break;
+                }
+                default :
+                    break;
+                } // switch
+            }
+        }
+    }
+
+    for ( int k = 0 ; k < nLevels ; ++k ) {
+        result[k] = join( segments[k], levels[k] );
+    }
+    return result;
+} // compute
+
+QPointF
+MarchingSquares::crossing( int64_t edge, double level ) const
+{
+    int64_t pixel = edge / 2;
+    int col = pixel % m_nCols;
+    int row = pixel / m_nCols;
+    bool across = edge % 2 == 0;
+    double va = at( col, row );
+    double vb = across ? at( col + 1, row ) : at( col, row + 1 );
+    double t = ( level - va ) / ( vb - va );
+    if ( across ) {
+        return QPointF( col + t, m_firstRow + row );
+    }
+    else {
+        return QPointF( col, m_firstRow + row + t );
+    }
+}
+
+std::vector < QPolygonF >
+MarchingSquares::join( const std::vector < std::pair < int64_t, int64_t > > & segments,
+                       double level ) const
+{
+    // an edge is crossed by at most two segments, one from each cell beside it
+    int nSegments = segments.size();
+    std::unordered_map < int64_t, std::array < int, 2 > > edgeSegments;
+    edgeSegments.reserve( nSegments * 2 );
+    for ( int s = 0 ; s < nSegments ; ++s ) {
+        for ( int64_t edge : { segments[s].first, segments[s].second } ) {
+            std::array < int, 2 > pair { { s, - 1 } };
+            auto inserted = edgeSegments.insert( std::make_pair( edge, pair ) );
+            if ( ! inserted.second ) {
+                CARTA_ASSERT( inserted.first-> second[1] < 0 );
+                inserted.first-> second[1] = s;
+            }
+        }
+    }
+    auto edgeAt = [&segments] ( int s, int end ) {
+        return end == 0 ? segments[s].first : segments[s].second;
+    };
+
+    // the segment across the given end of a segment, and the end of it on that edge
+    auto neighbour = [&] ( int s, int end, int & nextEnd ) {
+        int64_t edge = edgeAt( s, end );
+        const std::array < int, 2 > & pair = edgeSegments.at( edge );
+        int next = pair[0] == s ? pair[1] : pair[0];
+        if ( next >= 0 ) {
+            nextEnd = segments[next].first == edge ? 0 : 1;
+        }
+        return next;
+    };
+
+    // segments are visited in the order they were found, which is row by row
+    std::vector < QPolygonF > result;
+    std::vector < bool > used( nSegments, false );
+    for ( int s = 0 ; s < nSegments ; ++s ) {
+        if ( used[s] ) {
+            continue;
+        }
+
+        // walk backwards to the start of the polyline, or all the way round a loop
+        int start = s;
+        int startEnd = 0;
+        for ( int steps = 0 ; steps < nSegments ; ++steps ) {
+            int prevEnd = 0;
+            int prev = neighbour( start, startEnd, prevEnd );
+            if ( prev < 0 || prev == s ) {
+                break;
+            }
+            start = prev;
+            startEnd = 1 - prevEnd;
+        }
+
+        // then forwards, adding the far end of each segment
+        QPolygonF poly;
+        poly.append( crossing( edgeAt( start, startEnd ), level ) );
+        int current = start;
+        int entry = startEnd;
+        while ( true ) {
+            used[current] = true;
+            poly.append( crossing( edgeAt( current, 1 - entry ), level ) );
+            int nextEnd = 0;
+            int next = neighbour( current, 1 - entry, nextEnd );
+            if ( next < 0 || used[next] ) {
+                break;
+            }
+            current = next;
+            entry = nextEnd;
+        }
+        result.push_back( poly );
+    }
+    return result;
+} // join
+}
+}
+}
@@ -0,0 +1,66 @@
+/**
+ * Trace contours of a 2d array of doubles with marching squares.
+ *
+ * Segments are joined through the cell edges they cross, which are looked up in a
+ * hash table, so the polylines come out connected without any search for nearby
+ * end points.
+ **/
+
+#pragma once
+
+#include <QPolygonF>
+#include <cstdint>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Algorithms
+{
+class MarchingSquares
+{
+public:
+
+    /// \param data the values, nCols per row, row after row
+    /// \param nCols number of columns
+    /// \param nRows number of rows
+    /// \param firstRow row coordinate of the first row of data, so that the
+    /// contours of a band of rows come out in the coordinates of the whole image
+    MarchingSquares( const double * data, int nCols, int nRows, int firstRow = 0 );
+
+    /// compute the contours for the given levels
+    /// \param levels contour levels, in any order
+    /// \return for each level the polylines, in the order of the levels; closed
+    /// polylines repeat their first point at the end
+    ///
+    /// pixels that are not finite are left out, along with the cells they touch;
+    /// saddle cells are resolved by the average of their corners
+    std::vector < std::vector < QPolygonF > >
+    compute( const std::vector < double > & levels ) const;
+
+private:
+
+    /// value at column, row
+    double
+    at( int col, int row ) const
+    {
+        return m_data[int64_t( row ) * m_nCols + col];
+    }
+
+    /// position where a level crosses a cell edge
+    QPointF
+    crossing( int64_t edge, double level ) const;
+
+    /// join segments that share an edge into polylines
+    std::vector < QPolygonF >
+    join( const std::vector < std::pair < int64_t, int64_t > > & segments, double level ) const;
+
+    const double * m_data;
+    int m_nCols;
+    int m_nRows;
+    int m_firstRow;
+};
+}
+}
+}
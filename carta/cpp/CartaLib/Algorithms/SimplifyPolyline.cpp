@@ -0,0 +1,103 @@
+/**
+ *
+ **/
+
+#include "SimplifyPolyline.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Algorithms
+{
+namespace
+{
+/// squared distance from p to the segment a-b
+double
+distanceSq( const QPointF & p, const QPointF & a, const QPointF & b )
+{
+    double dx = b.x() - a.x();
+    double dy = b.y() - a.y();
+    double lengthSq = dx * dx + dy * dy;
+    double t = 0;
+    if ( lengthSq > 0 ) {
+        t = ( ( p.x() - a.x() ) * dx + ( p.y() - a.y() ) * dy ) / lengthSq;
+        t = std::max( 0.0, std::min( 1.0, t ) );
+    }
+    double ex = a.x() + t * dx - p.x();
+    double ey = a.y() + t * dy - p.y();
+    return ex * ex + ey * ey;
+}
+}
+
+QPolygonF
+simplifyPolyline( const QPolygonF & poly, double tolerance )
+{
+    int n = poly.size();
+    if ( n < 3 || ! ( tolerance > 0 ) ) {
+        return poly;
+    }
+    double toleranceSq = tolerance * tolerance;
+    std::vector < bool > keep( n, false );
+    keep[0] = true;
+    keep[n - 1] = true;
+
+    // a closed polyline starts and ends on the same point, so it is split at the
+    // vertex furthest from that point first
+    std::vector < std::pair < int, int > > ranges;
+    if ( poly.first() == poly.last() ) {
+        int furthest = 0;
+        double furthestSq = 0;
+        for ( int i = 1 ; i < n - 1 ; ++i ) {
+            double dSq = distanceSq( poly[i], poly[0], poly[0] );
+            if ( dSq > furthestSq ) {
+                furthestSq = dSq;
+                furthest = i;
+            }
+        }
+        if ( furthest == 0 ) {
+            return poly;
+        }
+        keep[furthest] = true;
+        ranges.push_back( { 0, furthest } );
+        ranges.push_back( { furthest, n - 1 } );
+    }
+    else {
+        ranges.push_back( { 0, n - 1 } );
+    }
+
+    // an explicit stack rather than recursion, since contours can be very long
+    while ( ! ranges.empty() ) {
+        std::pair < int, int > range = ranges.back();
+        ranges.pop_back();
+        int furthest = - 1;
+        double furthestSq = toleranceSq;
+        for ( int i = range.first + 1 ; i < range.second ; ++i ) {
+            double dSq = distanceSq( poly[i], poly[range.first], poly[range.second] );
+            if ( dSq > furthestSq ) {
+                furthestSq = dSq;
+                furthest = i;
+            }
+        }
+        if ( furthest >= 0 ) {
+            keep[furthest] = true;
+            ranges.push_back( { range.first, furthest } );
+            ranges.push_back( { furthest, range.second } );
+        }
+    }
+
+    QPolygonF result;
+    for ( int i = 0 ; i < n ; ++i ) {
+        if ( keep[i] ) {
+            result.append( poly[i] );
+        }
+    }
+    return result;
+} // simplifyPolyline
+}
+}
+}
@@ -0,0 +1,27 @@
+/**
+ * Reduce the number of vertices of a polyline with the Douglas-Peucker algorithm.
+ *
+ * see https://en.wikipedia.org/wiki/Ramer%E2%80%93Douglas%E2%80%93Peucker_algorithm
+ *
+ **/
+
+#pragma once
+
+#include <QPolygonF>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace Algorithms
+{
+/// simplify a polyline so that no removed vertex lies further than the tolerance
+/// from the simplified polyline
+/// \param poly the polyline; a closed polyline stays closed
+/// \param tolerance the largest distance allowed, in the units of the vertices
+/// \return the vertices of the polyline that were kept, in the original order
+QPolygonF
+simplifyPolyline( const QPolygonF & poly, double tolerance );
+}
+}
+}
@@ -2,7 +2,7 @@
   error( "Could not find the common.pri file!" )
 }
 
-QT       += network xml
+QT       += network xml concurrent
 
 TARGET = CartaLib
 TEMPLATE = lib
@@ -13,6 +13,7 @@ SOURCES += \
     CartaLib.cpp \
     HtmlString.cpp \
     LinearMap.cpp \
+    CoordinateMesh.cpp \
     Hooks/ColormapsScalar.cpp \
     Hooks/ConversionIntensityHook.cpp \
     Hooks/ConversionSpectralHook.cpp \
@@ -42,6 +43,8 @@ SOURCES += \
     IWcsGridRenderService.cpp \
     ContourSet.cpp \
     Algorithms/LineCombiner.cpp \
+    Algorithms/MarchingSquares.cpp \
+    Algorithms/SimplifyPolyline.cpp \
     IImageRenderService.cpp \
     IRemoteVGView.cpp \
     RegionInfo.cpp
@@ -51,6 +54,7 @@ HEADERS += \
     cartalib_global.h \
     HtmlString.h \
     LinearMap.h \
+    CoordinateMesh.h \
     Hooks/ColormapsScalar.h \
     Hooks/ConversionIntensityHook.h \
     Hooks/ConversionSpectralHook.h \
@@ -88,6 +92,8 @@ HEADERS += \
     IContourGeneratorService.h \
     ContourSet.h \
     Algorithms/LineCombiner.h \
+    Algorithms/MarchingSquares.h \
+    Algorithms/SimplifyPolyline.h \
     Hooks/GetInitialFileList.h \
     Hooks/Initialize.h \
     IImageRenderService.h \
@@ -0,0 +1,316 @@
+/**
+ *
+ **/
+
+#include "CoordinateMesh.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Carta
+{
+namespace Lib
+{
+namespace
+{
+/// coarsest mesh tried, in pixels
+const int START_STEP = 64;
+
+/// finest mesh tried, below this the mesh would cost about as much as exact conversions
+const int MIN_STEP = 4;
+
+/// most points of a mesh
+const int MAX_MESH_POINTS = 256 * 256;
+
+/// Newton's method stops once a step is smaller than this fraction of the tolerance
+const double CONVERGENCE = 0.01;
+
+const int MAX_ITERATIONS = 20;
+}
+
+CoordinateMesh::CoordinateMesh( const CoordinateFormatterInterface & cf, const VD & pixel,
+                                int axisX, int axisY, int width, int height,
+                                double tolerance )
+    : m_cf( cf.clone() ),
+      m_axisX( axisX ),
+      m_axisY( axisY ),
+      m_width( width ),
+      m_height( height ),
+      m_tolerance( tolerance ),
+      m_pixel( pixel )
+{
+    m_pixel.resize( m_cf-> nAxes(), 0.0 );
+    if ( ! m_cf-> toWorld( m_pixel, m_world ) ) {
+        m_world.clear();
+    }
+    if ( width < 2 || height < 2 || ! ( tolerance > 0 ) ) {
+        return;
+    }
+    for ( int step = START_STEP ; step >= MIN_STEP ; step /= 2 ) {
+        if ( _build( step ) ) {
+            return;
+        }
+    }
+    m_step = 0;
+    m_mesh.clear();
+}
+
+bool
+CoordinateMesh::_build( int step )
+{
+    m_step = 0;
+    int nx = ( m_width - 2 ) / step + 2;
+    int ny = ( m_height - 2 ) / step + 2;
+    if ( nx * ny > MAX_MESH_POINTS ) {
+        return false;
+    }
+
+    // the mesh points, then the centre and the midpoints of the top and left
+    // edges of every cell, where the interpolation is checked
+    VD pixels;
+    size_t axisCount = m_pixel.size();
+    size_t pointCount = nx * ny + 3 * ( nx - 1 ) * ( ny - 1 );
+    pixels.reserve( pointCount * axisCount );
+    auto addPixel = [&] ( double x, double y ) {
+        size_t at = pixels.size();
+        pixels.insert( pixels.end(), m_pixel.begin(), m_pixel.end() );
+        pixels[at + m_axisX] = x;
+        pixels[at + m_axisY] = y;
+    };
+    for ( int j = 0 ; j < ny ; ++j ) {
+        for ( int i = 0 ; i < nx ; ++i ) {
+            addPixel( i * step, j * step );
+        }
+    }
+    for ( int j = 0 ; j < ny - 1 ; ++j ) {
+        for ( int i = 0 ; i < nx - 1 ; ++i ) {
+            addPixel( ( i + 0.5 ) * step, ( j + 0.5 ) * step );
+            addPixel( ( i + 0.5 ) * step, j * step );
+            addPixel( i * step, ( j + 0.5 ) * step );
+        }
+    }
+
+    // one call for all of them
+    VD worlds;
+    if ( ! m_cf-> toWorldMany( pixels, worlds ) ) {
+        return false;
+    }
+    size_t stride = worlds.size() / pointCount;
+    if ( stride <= size_t( std::max( m_axisX, m_axisY ) ) ) {
+        return false;
+    }
+    m_mesh.resize( 2 * nx * ny );
+    for ( int k = 0 ; k < nx * ny ; ++k ) {
+        m_mesh[2 * k] = worlds[k * stride + m_axisX];
+        m_mesh[2 * k + 1] = worlds[k * stride + m_axisY];
+    }
+    m_step = step;
+    m_nx = nx;
+    m_ny = ny;
+
+    // the error of the interpolated world coordinates, turned into pixels with the
+    // local derivatives, must leave room for the error of inverting the mesh
+    for ( size_t k = nx * ny ; k < pointCount ; ++k ) {
+        double x = pixels[k * axisCount + m_axisX];
+        double y = pixels[k * axisCount + m_axisY];
+        double wx, wy;
+        _interpolate( x, y, wx, wy );
+        double jac[4];
+        _jacobian( x, y, jac );
+        double det = jac[0] * jac[3] - jac[1] * jac[2];
+        double dwx = wx - worlds[k * stride + m_axisX];
+        double dwy = wy - worlds[k * stride + m_axisY];
+        double ex = ( jac[3] * dwx - jac[1] * dwy ) / det;
+        double ey = ( - jac[2] * dwx + jac[0] * dwy ) / det;
+        if ( ! ( std::hypot( ex, ey ) <= m_tolerance / 2 ) ) {
+            m_step = 0;
+            return false;
+        }
+    }
+    return true;
+} // _build
+
+bool
+CoordinateMesh::_onMesh( double x, double y ) const
+{
+    return x >= 0 && y >= 0 && x <= ( m_nx - 1 ) * m_step && y <= ( m_ny - 1 ) * m_step;
+}
+
+void
+CoordinateMesh::_interpolate( double x, double y, double & wx, double & wy ) const
+{
+    int i = std::max( 0, std::min( int ( x / m_step ), m_nx - 2 ) );
+    int j = std::max( 0, std::min( int ( y / m_step ), m_ny - 2 ) );
+    double u = x / m_step - i;
+    double v = y / m_step - j;
+    const double * w00 = & m_mesh[2 * ( j * m_nx + i )];
+    const double * w10 = w00 + 2;
+    const double * w01 = w00 + 2 * m_nx;
+    const double * w11 = w01 + 2;
+    auto blend = [&] ( int c ) {
+        return ( 1 - u ) * ( 1 - v ) * w00[c] + u * ( 1 - v ) * w10[c] +
+               ( 1 - u ) * v * w01[c] + u * v * w11[c];
+    };
+    wx = blend( 0 );
+    wy = blend( 1 );
+}
+
+void
+CoordinateMesh::_jacobian( double x, double y, double jac[4] ) const
+{
+    // jac holds d(wx)/dx, d(wx)/dy, d(wy)/dx, d(wy)/dy
+    int i = std::max( 0, std::min( int ( x / m_step ), m_nx - 2 ) );
+    int j = std::max( 0, std::min( int ( y / m_step ), m_ny - 2 ) );
+    double u = x / m_step - i;
+    double v = y / m_step - j;
+    const double * w00 = & m_mesh[2 * ( j * m_nx + i )];
+    const double * w10 = w00 + 2;
+    const double * w01 = w00 + 2 * m_nx;
+    const double * w11 = w01 + 2;
+    for ( int c = 0 ; c < 2 ; ++c ) {
+        jac[2 * c] = ( ( 1 - v ) * ( w10[c] - w00[c] ) + v * ( w11[c] - w01[c] ) ) / m_step;
+        jac[2 * c + 1] = ( ( 1 - u ) * ( w01[c] - w00[c] ) + u * ( w11[c] - w10[c] ) ) / m_step;
+    }
+}
+
+bool
+CoordinateMesh::_invert( double wx, double wy, double & x, double & y ) const
+{
+    double maxX = ( m_nx - 1 ) * m_step;
+    double maxY = ( m_ny - 1 ) * m_step;
+    for ( int iter = 0 ; iter < MAX_ITERATIONS ; ++iter ) {
+        double mx, my;
+        _interpolate( x, y, mx, my );
+        double jac[4];
+        _jacobian( x, y, jac );
+        double det = jac[0] * jac[3] - jac[1] * jac[2];
+        double dwx = wx - mx;
+        double dwy = wy - my;
+        double dx = ( jac[3] * dwx - jac[1] * dwy ) / det;
+        double dy = ( - jac[2] * dwx + jac[0] * dwy ) / det;
+        if ( ! std::isfinite( dx ) || ! std::isfinite( dy ) ) {
+            return false;
+        }
+        if ( std::hypot( dx, dy ) < m_tolerance * CONVERGENCE ) {
+            x += dx;
+            y += dy;
+            return _onMesh( x, y );
+        }
+
+        // the mesh ends at the edges, so steps are kept on it
+        x = std::max( 0.0, std::min( x + dx, maxX ) );
+        y = std::max( 0.0, std::min( y + dy, maxY ) );
+    }
+    return false;
+} // _invert
+
+bool
+CoordinateMesh::_exact( bool pixelToWorld, const VD & input, const std::vector < size_t > & which,
+                        VD & output, std::vector < bool > * valid ) const
+{
+    if ( which.empty() ) {
+        return true;
+    }
+    const VD & base = pixelToWorld ? m_pixel : m_world;
+    bool allValid = base.size() > size_t( std::max( m_axisX, m_axisY ) );
+    VD full;
+    VD result;
+    std::vector < bool > converted;
+    if ( allValid ) {
+        full.reserve( which.size() * base.size() );
+        for ( size_t index : which ) {
+            size_t at = full.size();
+            full.insert( full.end(), base.begin(), base.end() );
+            full[at + m_axisX] = input[2 * index];
+            full[at + m_axisY] = input[2 * index + 1];
+        }
+        if ( pixelToWorld ) {
+            m_cf-> toWorldMany( full, result, & converted );
+        }
+        else {
+            m_cf-> toPixelMany( full, result, & converted );
+        }
+    }
+    size_t stride = result.size() / which.size();
+    for ( size_t k = 0 ; k < which.size() ; ++k ) {
+        size_t index = which[k];
+        bool ok = k < converted.size() && converted[k] &&
+                  stride > size_t( std::max( m_axisX, m_axisY ) );
+        if ( ok ) {
+            output[2 * index] = result[k * stride + m_axisX];
+            output[2 * index + 1] = result[k * stride + m_axisY];
+        }
+        if ( valid ) {
+            ( * valid )[index] = ok;
+        }
+        allValid = allValid && ok;
+    }
+    return allValid;
+} // _exact
+
+bool
+CoordinateMesh::toWorldMany( const VD & pixels, VD & worlds, std::vector < bool > * valid ) const
+{
+    size_t count = pixels.size() / 2;
+    worlds.assign( 2 * count, 0.0 );
+    if ( valid ) {
+        valid-> assign( count, true );
+    }
+    std::vector < size_t > exact;
+    for ( size_t i = 0 ; i < count ; ++i ) {
+        double x = pixels[2 * i];
+        double y = pixels[2 * i + 1];
+        if ( isApproximate() && _onMesh( x, y ) ) {
+            _interpolate( x, y, worlds[2 * i], worlds[2 * i + 1] );
+        }
+        else {
+            exact.push_back( i );
+        }
+    }
+    return _exact( true, pixels, exact, worlds, valid );
+}
+
+bool
+CoordinateMesh::toPixelMany( const VD & worlds, VD & pixels, std::vector < bool > * valid ) const
+{
+    size_t count = worlds.size() / 2;
+    pixels.assign( 2 * count, 0.0 );
+    if ( valid ) {
+        valid-> assign( count, true );
+    }
+    std::vector < size_t > exact;
+
+    // neighbouring points (vertices of a region, stars of a field) tend to be close,
+    // so the search starts from the last pixel found
+    double centreX = ( m_width - 1 ) / 2.0;
+    double centreY = ( m_height - 1 ) / 2.0;
+    double lastX = centreX;
+    double lastY = centreY;
+    for ( size_t i = 0 ; i < count ; ++i ) {
+        if ( ! isApproximate() ) {
+            exact.push_back( i );
+            continue;
+        }
+        double wx = worlds[2 * i];
+        double wy = worlds[2 * i + 1];
+        double x = lastX;
+        double y = lastY;
+        bool found = _invert( wx, wy, x, y );
+        if ( ! found && ( lastX != centreX || lastY != centreY ) ) {
+            x = centreX;
+            y = centreY;
+            found = _invert( wx, wy, x, y );
+        }
+        if ( found ) {
+            pixels[2 * i] = x;
+            pixels[2 * i + 1] = y;
+            lastX = x;
+            lastY = y;
+        }
+        else {
+            exact.push_back( i );
+        }
+    }
+    return _exact( false, worlds, exact, pixels, valid );
+} // toPixelMany
+}
+}
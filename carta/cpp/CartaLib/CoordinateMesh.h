@@ -0,0 +1,119 @@
+/**
+ * Approximate pixel/world conversions of an image plane by interpolating over a
+ * mesh of exactly converted points.
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include "CartaLib/ICoordinateFormatter.h"
+#include <vector>
+
+namespace Carta
+{
+namespace Lib
+{
+/// Converts between the pixel and world coordinates of the two display axes of an
+/// image plane, for when thousands of points (catalogue positions, region vertices)
+/// have to be converted and one WCS call per point would be too slow.
+///
+/// World coordinates are computed exactly on a square mesh over the plane and
+/// interpolated bilinearly in between. The mesh is refined until the interpolation
+/// error, measured in pixels at the centres and edge midpoints of the cells, is
+/// within half the tolerance. The error is only sampled at those points, so the
+/// tolerance is a target rather than a bound: a coordinate system that bends
+/// sharply inside a cell can be off by more. If no mesh is fine enough (for example
+/// when the plane straddles the wrap of a longitude axis), every conversion is done
+/// exactly. Points outside the plane, and world points that cannot be found on the
+/// mesh, are converted exactly as well. Callers that need exact results should use
+/// the formatter's own toWorldMany() and toPixelMany().
+///
+/// Points are packed as x,y pairs, for both pixel and world coordinates.
+class CoordinateMesh
+{
+    CLASS_BOILERPLATE( CoordinateMesh );
+
+public:
+
+    typedef CoordinateFormatterInterface::VD VD;
+
+    /// \param cf does the exact conversions; the mesh keeps its own copy
+    /// \param pixel a pixel of the plane, which gives the hidden axes their values
+    /// \param axisX the pixel (and world) axis shown horizontally
+    /// \param axisY the pixel (and world) axis shown vertically
+    /// \param width width of the plane in pixels
+    /// \param height height of the plane in pixels
+    /// \param tolerance the largest error aimed for, in pixels
+    CoordinateMesh( const CoordinateFormatterInterface & cf, const VD & pixel,
+                    int axisX, int axisY, int width, int height,
+                    double tolerance = 0.1 );
+
+    /// whether conversions inside the plane are interpolated, rather than exact
+    bool
+    isApproximate() const { return m_step > 0; }
+
+    /// distance between mesh points in pixels, or 0 if there is no mesh
+    int
+    step() const { return m_step; }
+
+    /// convert pixel coordinates to world coordinates
+    /// \param valid if not null, receives whether each point could be converted
+    /// \return whether all points could be converted
+    bool
+    toWorldMany( const VD & pixels, VD & worlds, std::vector < bool > * valid = nullptr ) const;
+
+    /// convert world coordinates to pixel coordinates
+    /// \see toWorldMany()
+    bool
+    toPixelMany( const VD & worlds, VD & pixels, std::vector < bool > * valid = nullptr ) const;
+
+private:
+
+    /// try a mesh with the given step, returns whether it is accurate enough
+    bool
+    _build( int step );
+
+    /// interpolate the world coordinates at a pixel inside the mesh
+    void
+    _interpolate( double x, double y, double & wx, double & wy ) const;
+
+    /// find the pixel on the mesh with the given world coordinates by Newton's method
+    /// \param x,y the starting pixel on input, the pixel found on output
+    /// \return whether a pixel was found
+    bool
+    _invert( double wx, double wy, double & x, double & y ) const;
+
+    /// derivatives of the world coordinates over the mesh cell containing a pixel
+    void
+    _jacobian( double x, double y, double jac[4] ) const;
+
+    /// whether a pixel lies on the mesh
+    bool
+    _onMesh( double x, double y ) const;
+
+    /// convert the listed points exactly, in one call to the formatter
+    /// \param pixelToWorld which way to convert
+    bool
+    _exact( bool pixelToWorld, const VD & input, const std::vector < size_t > & which,
+            VD & output, std::vector < bool > * valid ) const;
+
+    CoordinateFormatterInterface::UniquePtr m_cf;
+    int m_axisX, m_axisY;
+    int m_width, m_height;
+    double m_tolerance;
+
+    /// full pixel and world coordinates of the reference pixel of the plane, which
+    /// fill in the hidden axes of exact conversions
+    VD m_pixel, m_world;
+
+    /// distance between mesh points, 0 if conversions are exact
+    int m_step = 0;
+
+    /// mesh points along each axis
+    int m_nx = 0, m_ny = 0;
+
+    /// world x,y pairs of the mesh points, row after row
+    VD m_mesh;
+};
+}
+}
@@ -11,6 +11,7 @@ HistogramResult::HistogramResult( const QString histogramName,
 	    Plot2DResult( histogramName, unitsX, unitsY, histogramData ){
 	m_frequencyMin = -1;
 	m_frequencyMax = -1;
+	m_progress = 1;
 }
 
 
@@ -24,12 +25,22 @@ double HistogramResult::getFrequencyMax() const {
 }
 
 
+double HistogramResult::getProgress() const {
+    return m_progress;
+}
+
+
 void HistogramResult::setFrequencyBounds( double minFreq, double maxFreq ){
     m_frequencyMin = minFreq;
     m_frequencyMax = maxFreq;
 }
 
 
+void HistogramResult::setProgress( double progress ){
+    m_progress = progress;
+}
+
+
 QDataStream &operator<<(QDataStream& out, const HistogramResult& result ){
     out << result.getName()<< result.getUnitsX() << result.getUnitsY();
     std::vector<std::pair<double,double>> data = result.getData();
@@ -38,6 +49,7 @@ QDataStream &operator<<(QDataStream& out, const HistogramResult& result ){
     for ( int i = 0; i < dataCount; i++ ){
         out << data[i].first << data[i].second;
     }
+    out << result.getProgress();
     return out;
 }
 
@@ -56,7 +68,10 @@ QDataStream &operator>>(QDataStream& in, HistogramResult& result ){
         in >> firstEle >> secondEle;
         data[i] = std::pair<double,double>( firstEle, secondEle );
     }
+    double progress;
+    in >> progress;
     result = HistogramResult( name, unitsX, unitsY, data );
+    result.setProgress( progress );
     return in;
 }
 
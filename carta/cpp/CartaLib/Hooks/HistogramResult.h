@@ -32,6 +32,12 @@ class HistogramResult : public Plot2DResult {
      */
     double getFrequencyMax() const;
 
+    /**
+     * Returns the fraction of the data included in the histogram.
+     * @return a number in [0,1]; 1 means the histogram is complete.
+     */
+    double getProgress() const;
+
 
 
     /**
@@ -41,6 +47,12 @@ class HistogramResult : public Plot2DResult {
      */
     void setFrequencyBounds( double minFreq, double maxFreq );
 
+    /**
+     * Sets the fraction of the data included in a partially computed histogram.
+     * @param progress a number in [0,1]; 1 means the histogram is complete.
+     */
+    void setProgress( double progress );
+
     virtual ~HistogramResult(){}
 
 
@@ -48,6 +60,7 @@ class HistogramResult : public Plot2DResult {
   private:
       double m_frequencyMin;
       double m_frequencyMax;
+      double m_progress;
 };
 
 //Serialization so that the histogram result can be generated in a separate process.
@@ -13,6 +13,8 @@
 #include "CartaLib/ContourSet.h"
 #include <QObject>
 #include <QPolygonF>
+#include <QStringList>
+#include <functional>
 
 namespace Carta
 {
@@ -100,6 +102,37 @@ public:
     virtual void
     setInput( NdArray::RawViewInterface::SharedPtr rawView ) = 0;
 
+    /// identify the input, so that contours computed for it before can be reused;
+    /// the id must change whenever the data of the input changes
+    /// \param inputId unique id of the input, or an empty string if it has none
+    virtual void
+    setInputId( const QString & inputId )
+    {
+        Q_UNUSED( inputId );
+    }
+
+    /// ask the generator to compute contours for inputs that are likely to be needed
+    /// soon, e.g. the next channels of an animation, in the background; a new request
+    /// replaces the previous one
+    /// \param inputIds ids of the inputs, the most wanted first
+    /// \param makeInput makes the view of the input with the given index in inputIds
+    virtual void
+    prefetch( const QStringList & inputIds,
+              std::function < NdArray::RawViewInterface::SharedPtr ( int ) > makeInput )
+    {
+        Q_UNUSED( inputIds );
+        Q_UNUSED( makeInput );
+    }
+
+    /// tell the generator how large the contours will be drawn, so that it can skip
+    /// detail that would be smaller than a screen pixel
+    /// \param zoom how many screen pixels a data pixel occupies on screen
+    virtual void
+    setZoom( double zoom )
+    {
+        Q_UNUSED( zoom );
+    }
+
     /// \brief start the job
     /// \param jobId what id to assign to job, if -1, it'll be auto-generated (0,1,2,...)
     /// \return the jobId of the job
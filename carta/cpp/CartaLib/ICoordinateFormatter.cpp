@@ -4,4 +4,44 @@
 
 
 #include "ICoordinateFormatter.h"
+#include <algorithm>
 
+bool
+CoordinateFormatterInterface::toWorldMany( const VD & pixels, VD & worlds,
+                                           std::vector < bool > * valid ) const
+{
+    return _convertMany( pixels, worlds, valid, & Me::toWorld );
+}
+
+bool
+CoordinateFormatterInterface::toPixelMany( const VD & worlds, VD & pixels,
+                                           std::vector < bool > * valid ) const
+{
+    return _convertMany( worlds, pixels, valid, & Me::toPixel );
+}
+
+bool
+CoordinateFormatterInterface::_convertMany( const VD & input, VD & output,
+                                            std::vector < bool > * valid,
+                                            bool ( Me::* convert )( const VD &, VD & ) const ) const
+{
+    size_t axisCount = nAxes();
+    size_t count = axisCount > 0 ? input.size() / axisCount : 0;
+    output.assign( count * axisCount, 0.0 );
+    if ( valid ) {
+        valid-> assign( count, false );
+    }
+    bool allValid = true;
+    VD in( axisCount ), out;
+    for ( size_t i = 0 ; i < count ; ++i ) {
+        std::copy( input.begin() + i * axisCount, input.begin() + ( i + 1 ) * axisCount, in.begin() );
+        bool ok = ( this->* convert )( in, out );
+        std::copy( out.begin(), out.begin() + std::min( out.size(), axisCount ),
+                   output.begin() + i * axisCount );
+        if ( valid ) {
+            ( * valid )[i] = ok;
+        }
+        allValid = allValid && ok;
+    }
+    return allValid;
+}
@@ -87,8 +87,29 @@ public:
     /// convert world coordinates to pixel coordinates
     virtual bool toPixel(const VD& world, VD& pixel) const = 0;
 
+    /// convert many pixel coordinates to world coordinates at once
+    /// \param pixels coordinates of the points, nAxes() values per point, one point
+    /// after another
+    /// \param worlds receives the world coordinates, packed the same way
+    /// \param valid if not null, receives whether each point could be converted
+    /// \return whether all points could be converted
+    /// \note the default converts one point at a time, implementations should do better
+    virtual bool toWorldMany( const VD & pixels, VD & worlds,
+                              std::vector < bool > * valid = nullptr ) const;
+
+    /// convert many world coordinates to pixel coordinates at once
+    /// \see toWorldMany()
+    virtual bool toPixelMany( const VD & worlds, VD & pixels,
+                              std::vector < bool > * valid = nullptr ) const;
+
     /// virtual destructor
     virtual ~CoordinateFormatterInterface() {}
 
+private:
+
+    /// apply a per point conversion to packed points
+    bool _convertMany( const VD & input, VD & output, std::vector < bool > * valid,
+                       bool ( Me::* convert )( const VD &, VD & ) const ) const;
+
 };
 
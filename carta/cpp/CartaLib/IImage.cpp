@@ -64,6 +64,13 @@ Image::MetaDataInterface::SharedPtr Image::ImageInterface::metaData()
 }
 
 
+Image::MetaDataInterface::SharedPtr Image::MetaDataInterface::permuted( const std::vector < int > & indices )
+{
+    Q_UNUSED( indices );
+    return nullptr;
+}
+
+
 Image::MetaDataInterface::~MetaDataInterface()
 {
 
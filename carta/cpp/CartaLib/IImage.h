@@ -291,6 +291,12 @@ public:
     virtual QStringList
     otherInfo( TextFormat format = TextFormat::Plain ) = 0;
 
+    /// metadata of the same image with its axes permuted as by
+    /// ImageInterface::getPermuted(), without touching any pixels
+    /// \return the permuted metadata, or null if permuting is not supported
+    virtual SharedPtr
+    permuted( const std::vector < int > & indices );
+
     virtual ~MetaDataInterface();
 
 };
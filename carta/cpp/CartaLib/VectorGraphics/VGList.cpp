@@ -3,7 +3,13 @@
  **/
 
 #include "VGList.h"
+#include <QDataStream>
+#include <QDebug>
 #include <QPainter>
+#include <QSysInfo>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace Carta
 {
@@ -11,41 +17,760 @@ namespace Lib
 {
 namespace VectorGraphics
 {
+namespace
+{
+/// first word of a serialized list ("VGL1" in ascii)
+const quint32 SERIAL_MAGIC = 0x314c4756;
+const quint32 SERIAL_VERSION = 2;
+
+/// smaller lists are drawn without culling
+const int64_t CULL_MIN_ENTRIES = 256;
+
+quint32
+floatWord( double value )
+{
+    float f = value;
+    quint32 word;
+    std::memcpy( & word, & f, sizeof( word ) );
+    return word;
+}
+
+double
+wordFloat( quint32 word )
+{
+    float f;
+    std::memcpy( & f, & word, sizeof( f ) );
+    return f;
+}
+
+/// whether two boxes overlap, counting touching edges and boxes of zero size
+bool
+overlaps( double minX, double minY, double maxX, double maxY, const QRectF & box )
+{
+    return minX <= box.right() && maxX >= box.left() &&
+           minY <= box.bottom() && maxY >= box.top();
+}
+
+template < typename T >
+void
+writeTable( QDataStream & out, const std::vector < T > & table )
+{
+    out << quint32( table.size() );
+    for ( const T & value : table ) {
+        out << value;
+    }
+}
+
+template < typename T >
+void
+readTable( QDataStream & in, std::vector < T > & table )
+{
+    quint32 count = 0;
+    in >> count;
+
+    // every value takes at least a byte, so a larger count means a corrupt stream
+    if ( in.status() != QDataStream::Ok || count > in.device()-> bytesAvailable() ) {
+        in.setStatus( QDataStream::ReadCorruptData );
+        return;
+    }
+    table.resize( count );
+    for ( T & value : table ) {
+        in >> value;
+    }
+}
+}
+
+void
+VGList::Writer::op( Op code )
+{
+    m_list.m_offsets.push_back( m_list.m_words.size() );
+    m_list.m_words.push_back( quint32( code ) );
+}
+
+void
+VGList::Writer::integer( qint32 value )
+{
+    m_list.m_words.push_back( quint32( value ) );
+}
+
+void
+VGList::Writer::real( double value )
+{
+    m_list.m_words.push_back( floatWord( value ) );
+}
+
+void
+VGList::Writer::point( const QPointF & pt )
+{
+    real( pt.x() );
+    real( pt.y() );
+}
+
+void
+VGList::Writer::rect( const QRectF & rect )
+{
+    real( rect.x() );
+    real( rect.y() );
+    real( rect.width() );
+    real( rect.height() );
+}
+
+void
+VGList::Writer::color( const QColor & color )
+{
+    m_list.m_words.push_back( color.rgba() );
+}
+
+void
+VGList::Writer::polyline( const QPolygonF & poly )
+{
+    std::vector < quint32 > & words = m_list.m_words;
+    words.reserve( words.size() + 5 + 2 * poly.size() );
+    QRectF bounds = poly.boundingRect();
+    real( bounds.left() );
+    real( bounds.top() );
+    real( bounds.right() );
+    real( bounds.bottom() );
+    words.push_back( poly.size() );
+    for ( const QPointF & pt : poly ) {
+        words.push_back( floatWord( pt.x() ) );
+        words.push_back( floatWord( pt.y() ) );
+    }
+}
+
+void
+VGList::Writer::pen( const QPen & pen )
+{
+    m_list.m_words.push_back( _intern( m_list.m_pens, pen ) );
+}
+
+void
+VGList::Writer::brush( const QBrush & brush )
+{
+    m_list.m_words.push_back( _intern( m_list.m_brushes, brush ) );
+}
+
+void
+VGList::Writer::text( const QString & text )
+{
+    m_list.m_words.push_back( _intern( m_list.m_texts, text ) );
+}
+
+void
+VGList::Writer::transform( const QTransform & transform )
+{
+    m_list.m_words.push_back( _intern( m_list.m_transforms, transform ) );
+}
+
 VGList::VGList()
 { }
 
 VGList::~VGList()
+{ }
+
+template < typename T >
+quint32
+VGList::_intern( std::vector < T > & table, const T & value )
 {
-//    for ( auto & entry : m_entries ) {
-//        if ( entry ) {
-//            delete entry;
-//        }
-//    }
+    // lists reuse a handful of pens over and over, most often the latest one
+    for ( size_t i = table.size() ; i > 0 ; --i ) {
+        if ( table[i - 1] == value ) {
+            return i - 1;
+        }
+    }
+    table.push_back( value );
+    return table.size() - 1;
 }
 
-//void
-//VGList::setQImage( QImage img )
-//{
-//    m_qImage = img;
-//}
+const char *
+VGList::_argKinds( Op code )
+{
+    // i integer, r real, c color, P polyline (bounding box, vertex count and
+    // vertices), and references to the tables: p pen, b brush, t text, x transform
+    switch ( code )
+    {
+    case Op::Reset :
+    case Op::Save :
+    case Op::Restore :
+        return "";
+    case Op::DrawLine :
+    case Op::DrawRect :
+        return "rrrr";
+    case Op::DrawPolyline :
+        return "P";
+    case Op::SetPenWidth :
+    case Op::SetFontSize :
+        return "r";
+    case Op::SetPenColor :
+        return "c";
+    case Op::SetPen :
+        return "p";
+    case Op::SetFontIndex :
+    case Op::SetIndexedPen :
+    case Op::SetIndexedBrush :
+        return "i";
+    case Op::SetTransform :
+        return "xi";
+    case Op::FillRect :
+        return "rrrrc";
+    case Op::DrawText :
+        return "trr";
+    case Op::StoreIndexedPen :
+        return "ip";
+    case Op::StoreIndexedBrush :
+        return "ib";
+    case Op::SetBrush :
+        return "b";
+    default :
+        return nullptr;
+    } // switch
+} // _argKinds
 
-//const QImage &
-//VGList::qImage() const
-//{
-//    return m_qImage;
-//}
+void
+VGList::_appendList( const VGList & other )
+{
+    if ( other.m_words.empty() ) {
+        return;
+    }
+    quint32 base = m_words.size();
+    size_t firstEntry = m_offsets.size();
+    m_words.insert( m_words.end(), other.m_words.begin(), other.m_words.end() );
+    m_offsets.reserve( m_offsets.size() + other.m_offsets.size() );
+    for ( quint32 offset : other.m_offsets ) {
+        m_offsets.push_back( base + offset );
+    }
+
+    // the appended entries refer to the tables of the other list, which now come
+    // after ours
+    quint32 penBase = m_pens.size();
+    quint32 brushBase = m_brushes.size();
+    quint32 textBase = m_texts.size();
+    quint32 transformBase = m_transforms.size();
+    if ( penBase + brushBase + textBase + transformBase > 0 ) {
+        for ( size_t entry = firstEntry ; entry < m_offsets.size() ; ++entry ) {
+            quint32 pos = m_offsets[entry];
+            const char * kinds = _argKinds( Op( m_words[pos] ) );
+            pos++;
+            for ( ; * kinds ; ++kinds ) {
+                switch ( * kinds )
+                {
+                case 'p' :
+                    m_words[pos] += penBase;
+                    break;
+                case 'b' :
+                    m_words[pos] += brushBase;
+                    break;
+                case 't' :
+                    m_words[pos] += textBase;
+                    break;
+                case 'x' :
+                    m_words[pos] += transformBase;
+                    break;
+                case 'P' :
+                    pos += 4;
+                    pos += 2 * m_words[pos];
+                    break;
+                default :
+                    break;
+                } // switch
+                pos++;
+            }
+        }
+    }
+    for ( const Run & run : other.m_runs ) {
+        m_runs.push_back( run );
+        m_runs.back().begin += base;
+        m_runs.back().end += base;
+    }
+    m_pens.insert( m_pens.end(), other.m_pens.begin(), other.m_pens.end() );
+    m_brushes.insert( m_brushes.end(), other.m_brushes.begin(), other.m_brushes.end() );
+    m_texts.insert( m_texts.end(), other.m_texts.begin(), other.m_texts.end() );
+    m_transforms.insert( m_transforms.end(), other.m_transforms.begin(), other.m_transforms.end() );
+} // _appendList
+
+void
+VGList::_setEntry( int64_t ind, const IVGListEntry & entry )
+{
+    // encode the new entry at the end, then move it into place
+    size_t entryCount = m_offsets.size();
+    size_t tail = m_words.size();
+    Writer writer( * this );
+    entry.encode( writer );
+    std::vector < quint32 > encoded( m_words.begin() + tail, m_words.end() );
+    m_words.resize( tail );
+    m_offsets.resize( entryCount );
+
+    size_t begin = m_offsets[ind];
+    size_t end = size_t( ind + 1 ) < entryCount ? m_offsets[ind + 1] : tail;
+    m_runs.clear();
+    if ( encoded.size() == end - begin ) {
+        std::copy( encoded.begin(), encoded.end(), m_words.begin() + begin );
+        return;
+    }
+    m_words.erase( m_words.begin() + begin, m_words.begin() + end );
+    m_words.insert( m_words.begin() + begin, encoded.begin(), encoded.end() );
+    qint64 shift = qint64( encoded.size() ) - qint64( end - begin );
+    for ( size_t i = ind + 1 ; i < entryCount ; ++i ) {
+        m_offsets[i] += shift;
+    }
+} // _setEntry
+
+bool
+VGList::_index()
+{
+    m_offsets.clear();
+    size_t pos = 0;
+    size_t size = m_words.size();
+    while ( pos < size ) {
+        m_offsets.push_back( pos );
+        const char * kinds = _argKinds( Op( m_words[pos] ) );
+        if ( ! kinds ) {
+            return false;
+        }
+        pos++;
+        for ( ; * kinds ; ++kinds ) {
+            if ( pos >= size ) {
+                return false;
+            }
+            quint32 word = m_words[pos];
+            switch ( * kinds )
+            {
+            case 'p' :
+                if ( word >= m_pens.size() ) {
+                    return false;
+                }
+                break;
+            case 'b' :
+                if ( word >= m_brushes.size() ) {
+                    return false;
+                }
+                break;
+            case 't' :
+                if ( word >= m_texts.size() ) {
+                    return false;
+                }
+                break;
+            case 'x' :
+                if ( word >= m_transforms.size() ) {
+                    return false;
+                }
+                break;
+            case 'P' :
+                if ( size - pos < 5 ) {
+                    return false;
+                }
+                pos += 4;
+                word = m_words[pos];
+                if ( word > ( size - pos - 1 ) / 2 ) {
+                    return false;
+                }
+                pos += 2 * word;
+                break;
+            default :
+                break;
+            } // switch
+            pos++;
+        }
+    }
+    return true;
+} // _index
+
+void
+VGList::buildIndex( int runLength )
+{
+    m_runs.clear();
+    Run run;
+    int runCount = 0;
+    size_t entryCount = m_offsets.size();
+    for ( size_t entry = 0 ; entry < entryCount ; ++entry ) {
+        quint32 pos = m_offsets[entry];
+        bool polyline = Op( m_words[pos] ) == Op::DrawPolyline;
+        if ( runCount > 0 && ( ! polyline || runCount == runLength ) ) {
+            m_runs.push_back( run );
+            runCount = 0;
+        }
+        if ( ! polyline ) {
+            continue;
+        }
+        float minX = wordFloat( m_words[pos + 1] );
+        float minY = wordFloat( m_words[pos + 2] );
+        float maxX = wordFloat( m_words[pos + 3] );
+        float maxY = wordFloat( m_words[pos + 4] );
+        if ( runCount == 0 ) {
+            run.begin = pos;
+            run.minX = minX;
+            run.minY = minY;
+            run.maxX = maxX;
+            run.maxY = maxY;
+        }
+        else {
+            run.minX = std::min( run.minX, minX );
+            run.minY = std::min( run.minY, minY );
+            run.maxX = std::max( run.maxX, maxX );
+            run.maxY = std::max( run.maxY, maxY );
+        }
+        run.end = entry + 1 < entryCount ? m_offsets[entry + 1] : m_words.size();
+        runCount++;
+    }
+    if ( runCount > 0 ) {
+        m_runs.push_back( run );
+    }
+} // buildIndex
+
+void
+VGList::_appendClipped( const VGList & other, quint32 pos, const QRectF & box )
+{
+    const std::vector < quint32 > & words = other.m_words;
+    quint32 count = words[pos + 5];
+    quint32 first = pos + 6;
+    auto x = [&] ( quint32 i ) {
+        return wordFloat( words[first + 2 * i] );
+    };
+    auto y = [&] ( quint32 i ) {
+        return wordFloat( words[first + 2 * i + 1] );
+    };
+
+    // keep each stretch of segments that may show, with its own bounding box
+    auto appendRange = [&] ( quint32 begin, quint32 end ) {
+        float minX = x( begin ), maxX = minX, minY = y( begin ), maxY = minY;
+        for ( quint32 i = begin + 1 ; i <= end ; ++i ) {
+            minX = std::min( minX, x( i ) );
+            maxX = std::max( maxX, x( i ) );
+            minY = std::min( minY, y( i ) );
+            maxY = std::max( maxY, y( i ) );
+        }
+        m_offsets.push_back( m_words.size() );
+        m_words.push_back( quint32( Op::DrawPolyline ) );
+        m_words.push_back( floatWord( minX ) );
+        m_words.push_back( floatWord( minY ) );
+        m_words.push_back( floatWord( maxX ) );
+        m_words.push_back( floatWord( maxY ) );
+        m_words.push_back( end - begin + 1 );
+        m_words.insert( m_words.end(), words.begin() + first + 2 * begin,
+                        words.begin() + first + 2 * ( end + 1 ) );
+    };
+    bool open = false;
+    quint32 begin = 0;
+    for ( quint32 i = 0 ; i + 1 < count ; ++i ) {
+        bool visible = overlaps( std::min( x( i ), x( i + 1 ) ), std::min( y( i ), y( i + 1 ) ),
+                                 std::max( x( i ), x( i + 1 ) ), std::max( y( i ), y( i + 1 ) ),
+                                 box );
+        if ( visible && ! open ) {
+            begin = i;
+            open = true;
+        }
+        else if ( ! visible && open ) {
+            appendRange( begin, i );
+            open = false;
+        }
+    }
+    if ( open ) {
+        appendRange( begin, count - 1 );
+    }
+} // _appendClipped
+
+VGList
+VGList::culled( const QRectF & viewport, const QTransform & transform ) const
+{
+    VGList result;
+    result.m_words.reserve( m_words.size() );
+    result.m_offsets.reserve( m_offsets.size() );
+    result.m_pens = m_pens;
+    result.m_brushes = m_brushes;
+    result.m_texts = m_texts;
+    result.m_transforms = m_transforms;
+
+    // widen the viewport by the widest pen, so that thick lines just outside it
+    // are still drawn
+    double penWidth = 1;
+    for ( const QPen & pen : m_pens ) {
+        penWidth = std::max( penWidth, pen.widthF() );
+    }
+
+    // the viewport in the coordinates of the entries, under the current transform
+    QTransform current = transform;
+    std::vector < QTransform > saved;
+    QRectF box;
+    bool bounded = false;
+    auto updateBox = [&] () {
+        double scale = std::max( std::hypot( current.m11(), current.m12() ),
+                                 std::hypot( current.m21(), current.m22() ) );
+        double margin = penWidth * std::max( scale, 1.0 ) + 1;
+        QTransform inverse = current.inverted( & bounded );
+        if ( bounded ) {
+            box = inverse.mapRect( viewport.adjusted( - margin, - margin, margin, margin ) );
+        }
+    };
+    updateBox();
+
+    size_t entryCount = m_offsets.size();
+    size_t entry = 0;
+    size_t run = 0;
+    while ( entry < entryCount ) {
+        quint32 pos = m_offsets[entry];
+
+        // a run entirely outside the viewport is skipped with one test
+        while ( run < m_runs.size() && m_runs[run].begin < pos ) {
+            run++;
+        }
+        if ( bounded && run < m_runs.size() && m_runs[run].begin == pos ) {
+            const Run & r = m_runs[run];
+            run++;
+            if ( ! overlaps( r.minX, r.minY, r.maxX, r.maxY, box ) ) {
+                entry = std::lower_bound( m_offsets.begin() + entry, m_offsets.end(), r.end ) -
+                        m_offsets.begin();
+                continue;
+            }
+        }
+
+        quint32 end = entry + 1 < entryCount ? m_offsets[entry + 1] : m_words.size();
+        entry++;
+        switch ( Op( m_words[pos] ) )
+        {
+        case Op::Reset :
+            current = QTransform();
+            saved.clear();
+            updateBox();
+            break;
+        case Op::Save :
+            saved.push_back( current );
+            break;
+        case Op::Restore :
+            if ( ! saved.empty() ) {
+                current = saved.back();
+                saved.pop_back();
+                updateBox();
+            }
+            break;
+        case Op::SetTransform : {
+            const QTransform & t = m_transforms[m_words[pos + 1]];
+            current = m_words[pos + 2] ? t * current : t;
+            updateBox();
+            break;
+        }
+        case Op::SetPenWidth :
+            penWidth = std::max( penWidth, wordFloat( m_words[pos + 1] ) );
+            updateBox();
+            break;
+        case Op::DrawPolyline : {
+            float minX = wordFloat( m_words[pos + 1] );
+            float minY = wordFloat( m_words[pos + 2] );
+            float maxX = wordFloat( m_words[pos + 3] );
+            float maxY = wordFloat( m_words[pos + 4] );
+            if ( bounded && ! overlaps( minX, minY, maxX, maxY, box ) ) {
+                continue;
+            }
+            bool inside = ! bounded || ( box.contains( QPointF( minX, minY ) ) &&
+                                         box.contains( QPointF( maxX, maxY ) ) );
+            if ( ! inside && m_words[pos + 5] > 1 ) {
+                result._appendClipped( * this, pos, box );
+                continue;
+            }
+            break;
+        }
+        default :
+            break;
+        } // switch
+        result.m_offsets.push_back( result.m_words.size() );
+        result.m_words.insert( result.m_words.end(), m_words.begin() + pos, m_words.begin() + end );
+    }
+    return result;
+} // culled
+
+QByteArray
+VGList::serialize() const
+{
+    QByteArray data;
+    QDataStream out( & data, QIODevice::WriteOnly );
+    out.setVersion( QDataStream::Qt_5_3 );
+    out.setByteOrder( QDataStream::LittleEndian );
+    out << SERIAL_MAGIC << SERIAL_VERSION << quint32( m_words.size() );
+    if ( QSysInfo::ByteOrder == QSysInfo::LittleEndian ) {
+        out.writeRawData( reinterpret_cast < const char * > ( m_words.data() ),
+                          m_words.size() * sizeof( quint32 ) );
+    }
+    else {
+        for ( quint32 word : m_words ) {
+            out << word;
+        }
+    }
+    writeTable( out, m_pens );
+    writeTable( out, m_brushes );
+    writeTable( out, m_texts );
+    writeTable( out, m_transforms );
+    return data;
+} // serialize
+
+VGList
+VGList::deserialize( const QByteArray & data, bool * ok )
+{
+    VGList list;
+    QDataStream in( data );
+    in.setVersion( QDataStream::Qt_5_3 );
+    in.setByteOrder( QDataStream::LittleEndian );
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 wordCount = 0;
+    in >> magic >> version >> wordCount;
+    bool valid = in.status() == QDataStream::Ok && magic == SERIAL_MAGIC &&
+                 version == SERIAL_VERSION &&
+                 wordCount <= in.device()-> bytesAvailable() / sizeof( quint32 );
+    if ( valid ) {
+        list.m_words.resize( wordCount );
+        if ( QSysInfo::ByteOrder == QSysInfo::LittleEndian ) {
+            in.readRawData( reinterpret_cast < char * > ( list.m_words.data() ),
+                            wordCount * sizeof( quint32 ) );
+        }
+        else {
+            for ( quint32 & word : list.m_words ) {
+                in >> word;
+            }
+        }
+        readTable( in, list.m_pens );
+        readTable( in, list.m_brushes );
+        readTable( in, list.m_texts );
+        readTable( in, list.m_transforms );
+        valid = in.status() == QDataStream::Ok && list._index();
+    }
+    if ( ! valid ) {
+        list = VGList();
+    }
+    if ( ok ) {
+        * ok = valid;
+    }
+    return list;
+} // deserialize
 
 bool
 VGListQPainterRenderer::render( const VGList & vgList, QPainter & qPainter )
 {
-    BetterQPainter bp( qPainter );
-    for ( auto entry : vgList.entries() ) {
-        entry-> cplusplus( bp );
+    // BetterQPainter starts from the identity transform, so the viewport is the device
+    QPaintDevice * device = qPainter.device();
+    if ( device && vgList.size() >= CULL_MIN_ENTRIES ) {
+        QRectF viewport( 0, 0, device-> width(), device-> height() );
+        return _replay( vgList.culled( viewport ), qPainter );
     }
+    return _replay( vgList, qPainter );
+}
 
-//    qPainter.drawImage( 0, 0, vgList.qImage() );
+bool
+VGListQPainterRenderer::_replay( const VGList & vgList, QPainter & qPainter )
+{
+    typedef VGList::Op Op;
+    BetterQPainter bp( qPainter );
+    const std::vector < quint32 > & words = vgList.m_words;
+    size_t pos = 0;
+
+    auto integer = [&] () {
+        return qint32( words[pos++] );
+    };
+    auto real = [&] () {
+        return wordFloat( words[pos++] );
+    };
+    auto point = [&] () {
+        double x = real();
+        double y = real();
+        return QPointF( x, y );
+    };
+    auto rect = [&] () {
+        QPointF topLeft = point();
+        double width = real();
+        double height = real();
+        return QRectF( topLeft.x(), topLeft.y(), width, height );
+    };
+
+    // reused by every polyline, so drawing contours does not allocate
+    QPolygonF poly;
+    while ( pos < words.size() ) {
+        Op op = Op( words[pos++] );
+        switch ( op )
+        {
+        case Op::Reset :
+            bp.reset();
+            break;
+        case Op::DrawLine : {
+            QPointF p1 = point();
+            QPointF p2 = point();
+            bp.drawLine( p1, p2 );
+            break;
+        }
+        case Op::DrawPolyline : {
+            // skip the bounding box
+            pos += 4;
+            int count = words[pos++];
+            poly.resize( count );
+            for ( int i = 0 ; i < count ; ++i ) {
+                poly[i] = point();
+            }
+            bp.drawPolyline( poly );
+            break;
+        }
+        case Op::SetPenWidth :
+            bp.setPenWidth( real() );
+            break;
+        case Op::SetPenColor :
+            bp.setPenColor( QColor::fromRgba( words[pos++] ) );
+            break;
+        case Op::SetPen :
+            bp.setPen( vgList.m_pens[words[pos++]] );
+            break;
+        case Op::SetFontIndex :
+            bp.setFontIndex( integer() );
+            break;
+        case Op::SetFontSize :
+            bp.setFontSize( real() );
+            break;
+        case Op::Save :
+            bp.save();
+            break;
+        case Op::Restore :
+            bp.restore();
+            break;
+        case Op::SetTransform : {
+            const QTransform & transform = vgList.m_transforms[words[pos++]];
+            bool combine = integer();
+            bp.setTransform( transform, combine );
+            break;
+        }
+        case Op::FillRect : {
+            QRectF r = rect();
+            bp.fillRect( r, QColor::fromRgba( words[pos++] ) );
+            break;
+        }
+        case Op::DrawRect :
+            bp.drawRect( rect() );
+            break;
+        case Op::DrawText : {
+            const QString & text = vgList.m_texts[words[pos++]];
+            bp.drawText( text, point() );
+            break;
+        }
+        case Op::StoreIndexedPen : {
+            int ind = integer();
+            bp.storeIndexedPen( ind, vgList.m_pens[words[pos++]] );
+            break;
+        }
+        case Op::SetIndexedPen :
+            bp.setIndexedPen( integer() );
+            break;
+        case Op::StoreIndexedBrush : {
+            int ind = integer();
+            bp.storeIndexedBrush( ind, vgList.m_brushes[words[pos++]] );
+            break;
+        }
+        case Op::SetIndexedBrush :
+            bp.setIndexedBrush( integer() );
+            break;
+        case Op::SetBrush :
+            bp.setBrush( vgList.m_brushes[words[pos++]] );
+            break;
+        default :
+            qWarning() << "Unknown vector graphics command" << quint32( op );
+            return false;
+        } // switch
+    }
     return true;
-}
+} // _replay
 }
 }
 }
@@ -9,6 +9,10 @@
 #include <QStringList>
 #include <QPainter>
 #include <QFontInfo>
+#include <QByteArray>
+#include <QTransform>
+#include <memory>
+#include <vector>
 
 #pragma once
 
@@ -18,6 +22,205 @@ namespace Lib
 {
 namespace VectorGraphics
 {
+class VGComposer;
+class VGListQPainterRenderer;
+class IVGListEntry;
+
+/// container for vector graphics with enough APIs to rasterize it/convert it to PDF/EPS
+///
+/// Entries are stored in a flat command buffer: an opcode followed by its arguments,
+/// with coordinates inline as floats and pens, brushes, texts and transforms kept once
+/// in tables that the commands refer to by index. Copying or appending a list is
+/// therefore a copy of a few arrays, and no entry needs an allocation of its own.
+class VGList
+{
+public:
+
+    /// commands in the buffer, each followed by its arguments
+    enum class Op : quint32
+    {
+        Reset = 1,
+        DrawLine,
+        DrawPolyline,
+        SetPenWidth,
+        SetPenColor,
+        SetPen,
+        SetFontIndex,
+        SetFontSize,
+        Save,
+        Restore,
+        SetTransform,
+        FillRect,
+        DrawRect,
+        DrawText,
+        StoreIndexedPen,
+        SetIndexedPen,
+        StoreIndexedBrush,
+        SetIndexedBrush,
+        SetBrush,
+        Count
+    };
+
+    /// used by entries to append their command and arguments to a list
+    class Writer
+    {
+    public:
+
+        /// start a new entry
+        void
+        op( Op code );
+
+        void
+        integer( qint32 value );
+
+        /// stored as a float
+        void
+        real( double value );
+
+        void
+        point( const QPointF & pt );
+
+        void
+        rect( const QRectF & rect );
+
+        void
+        color( const QColor & color );
+
+        /// the bounding box, then the vertex count followed by the vertices
+        void
+        polyline( const QPolygonF & poly );
+
+        void
+        pen( const QPen & pen );
+
+        void
+        brush( const QBrush & brush );
+
+        void
+        text( const QString & text );
+
+        void
+        transform( const QTransform & transform );
+
+    private:
+
+        friend class VGList;
+        friend class VGComposer;
+
+        Writer( VGList & list )
+            : m_list( list )
+        { }
+
+        VGList & m_list;
+    };
+
+    /// make an empty list
+    VGList();
+
+    /// copy constructor
+    VGList( const VGList & other ) = default;
+
+    /// assignment operator
+    VGList &
+    operator= ( const VGList & other ) = default;
+
+    ~VGList();
+
+    /// number of entries in the list
+    int64_t
+    size() const { return m_offsets.size(); }
+
+    /// build the optional spatial index: consecutive polylines are grouped into runs
+    /// with a common bounding box, so that culling can skip a whole run with one test
+    ///
+    /// worth calling on large lists of polylines, such as contours; the index is kept
+    /// when the list is appended to another list
+    /// \param runLength the most polylines in a run
+    void
+    buildIndex( int runLength = 64 );
+
+    /// a copy of the list with only what can show inside a viewport
+    ///
+    /// polylines outside the viewport are dropped, and polylines crossing its edge
+    /// lose the segments outside it; other entries are kept
+    /// \param viewport the visible rectangle, in device coordinates
+    /// \param transform the transform in effect when the list is drawn
+    VGList
+    culled( const QRectF & viewport, const QTransform & transform = QTransform() ) const;
+
+    /// compact binary form of the list, e.g. for sending it to a client
+    ///
+    /// the command buffer is written as little endian 32 bit words, followed by the
+    /// tables in QDataStream format
+    QByteArray
+    serialize() const;
+
+    /// read a list written by serialize()
+    /// \param data the serialized list
+    /// \param ok set to false if data is not a valid list
+    /// \return the list, or an empty list if data was not valid
+    static VGList
+    deserialize( const QByteArray & data, bool * ok = nullptr );
+
+    /// compact binary form of the part of the list that shows inside a viewport
+    /// \see culled()
+    QByteArray
+    serialize( const QRectF & viewport, const QTransform & transform = QTransform() ) const
+    {
+        return culled( viewport, transform ).serialize();
+    }
+
+private:
+
+    /// a range of consecutive polyline entries and their common bounding box
+    struct Run {
+        quint32 begin;
+        quint32 end;
+        float minX, minY, maxX, maxY;
+    };
+
+    friend class VGComposer;
+    friend class VGListQPainterRenderer;
+
+    /// kinds of arguments of each command, one character per argument
+    static const char *
+    _argKinds( Op code );
+
+    /// append the entries of another list, renumbering its table references
+    void
+    _appendList( const VGList & other );
+
+    /// replace an entry, moving the entries after it if the new one is a different size
+    void
+    _setEntry( int64_t ind, const IVGListEntry & entry );
+
+    /// find where each entry starts and check that the buffer is well formed
+    bool
+    _index();
+
+    /// append the polyline at pos of another list, without the segments outside box
+    void
+    _appendClipped( const VGList & other, quint32 pos, const QRectF & box );
+
+    template < typename T >
+    static quint32
+    _intern( std::vector < T > & table, const T & value );
+
+    /// the command buffer
+    std::vector < quint32 > m_words;
+
+    /// where each entry starts in the command buffer
+    std::vector < quint32 > m_offsets;
+
+    /// the spatial index, sorted by position in the command buffer
+    std::vector < Run > m_runs;
+
+    std::vector < QPen > m_pens;
+    std::vector < QBrush > m_brushes;
+    std::vector < QString > m_texts;
+    std::vector < QTransform > m_transforms;
+};
+
 /// api for an entry in a VGList
 class IVGListEntry
 {
@@ -33,6 +236,10 @@ public:
     virtual QStringList
     javascript() = 0;
 
+    /// an entry stores itself in a VGList as a command and its arguments
+    virtual void
+    encode( VGList::Writer & writer ) const = 0;
+
     virtual
     ~IVGListEntry() { }
 };
@@ -48,6 +255,10 @@ public:
     {
         painter.reset();
     }
+    virtual void encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::Reset );
+    }
     virtual QStringList javascript() override
     {
         return QStringList()
@@ -74,6 +285,14 @@ public:
         painter.drawLine( m_p1, m_p2 );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::DrawLine );
+        writer.point( m_p1 );
+        writer.point( m_p2 );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -105,6 +324,13 @@ public:
         painter.drawPolyline( m_poly );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::DrawPolyline );
+        writer.polyline( m_poly );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -135,6 +361,13 @@ public:
         painter.setPenWidth( m_width );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetPenWidth );
+        writer.real( m_width );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -166,6 +399,13 @@ public:
         painter.setPenColor( m_color );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetPenColor );
+        writer.color( m_color );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -197,6 +437,13 @@ public:
         painter.setPen( m_pen );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetPen );
+        writer.pen( m_pen );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -230,6 +477,13 @@ public:
         painter.setFontIndex( m_fontIndex );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetFontIndex );
+        writer.integer( m_fontIndex );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -261,6 +515,13 @@ public:
         painter.setFontSize( m_size );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetFontSize );
+        writer.real( m_size );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -290,6 +551,12 @@ public:
         painter.save();
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::Save );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -316,6 +583,12 @@ public:
         painter.restore();
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::Restore );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -345,6 +618,14 @@ public:
         painter.setTransform( m_transform, m_combine );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetTransform );
+        writer.transform( m_transform );
+        writer.integer( m_combine );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -379,6 +660,14 @@ public:
         painter.fillRect( m_rect, m_color );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::FillRect );
+        writer.rect( m_rect );
+        writer.color( m_color );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -415,6 +704,13 @@ public:
         painter.drawRect( m_rect);
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::DrawRect );
+        writer.rect( m_rect );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -450,6 +746,14 @@ public:
         painter.drawText( m_text, m_pos );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::DrawText );
+        writer.text( m_text );
+        writer.point( m_pos );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -489,6 +793,14 @@ public:
         painter.storeIndexedPen( m_ind, m_pen );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::StoreIndexedPen );
+        writer.integer( m_ind );
+        writer.pen( m_pen );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -523,6 +835,13 @@ public:
         painter.setIndexedPen( m_ind );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetIndexedPen );
+        writer.integer( m_ind );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -555,6 +874,14 @@ public:
         painter.storeIndexedBrush( m_ind, m_brush );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::StoreIndexedBrush );
+        writer.integer( m_ind );
+        writer.brush( m_brush );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -588,6 +915,13 @@ public:
         painter.setIndexedBrush( m_ind );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetIndexedBrush );
+        writer.integer( m_ind );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -619,6 +953,13 @@ public:
         painter.setBrush( m_brush );
     }
 
+    virtual void
+    encode( VGList::Writer & writer ) const override
+    {
+        writer.op( VGList::Op::SetBrush );
+        writer.brush( m_brush );
+    }
+
     virtual QStringList
     javascript() override
     {
@@ -634,44 +975,6 @@ private:
 }
 
 
-class VGComposer;
-
-/// container for vector graphics with enough APIs to rasterize it/convert it to PDF/EPS
-class VGList
-{
-public:
-
-    /// make an empty list
-    VGList();
-
-    /// copy constructor
-    VGList( const VGList & other ) = default;
-
-    /// assignment operator
-    VGList &
-    operator= ( const VGList & other ) = default;
-
-    ~VGList();
-
-    /// get a list of entries (ie. list of shared pointers to entries)
-    const std::vector < IVGListEntry::SharedPtr > &
-    entries() const { return m_entries; }
-
-    /// get a list of entries (ie. list of shared pointers to entries)
-    /// with read/write access
-//    std::vector < IVGListEntry::SharedPtr > &
-//    rwEntries() { return m_entries; }
-
-private:
-
-    /// VGComposer has write access to the list of entries
-    friend class VGComposer;
-
-    /// list of entries
-    /// we use shared pointers to simplify memory management/copy constructor/assignments/etc
-    std::vector < IVGListEntry::SharedPtr > m_entries;
-};
-
 /// this class offers functionality to render a VG list onto a qpainter
 class VGListQPainterRenderer
 {
@@ -679,12 +982,21 @@ public:
 
     ///
     /// \brief renders the given vgList to a qPainter
+    ///
+    /// the command buffer is decoded directly into painter calls; a large list is
+    /// first culled to the painter's device
     /// \param vgList the vector graphics to render
     /// \param qPainter where to render it
     /// \return true on success
     ///
     bool
     render( const VGList & vgList, QPainter & qPainter );
+
+private:
+
+    /// draw every entry of the list
+    bool
+    _replay( const VGList & vgList, QPainter & qPainter );
 };
 
 /// this is the class you want to use to create vector graphics
@@ -711,8 +1023,17 @@ public:
     int64_t
     appendEntry( IVGListEntry * entry )
     {
-        m_vgList.m_entries.push_back( std::shared_ptr < IVGListEntry > ( entry ) );
-        return m_vgList.m_entries.size() - 1;
+        std::unique_ptr < IVGListEntry > owned( entry );
+        return appendEntry( * entry );
+    }
+
+    /// append a copy of an entry
+    int64_t
+    appendEntry( const IVGListEntry & entry )
+    {
+        VGList::Writer writer( m_vgList );
+        entry.encode( writer );
+        return m_vgList.size() - 1;
     }
 
     /// set a specific entry to something else
@@ -720,8 +1041,9 @@ public:
     void
     setEntry( int64_t ind, IVGListEntry * entry )
     {
-        CARTA_ASSERT( ind >= 0 && size_t( ind ) < m_vgList.m_entries.size() );
-        m_vgList.m_entries[ind].reset( entry );
+        std::unique_ptr < IVGListEntry > owned( entry );
+        CARTA_ASSERT( ind >= 0 && ind < m_vgList.size() );
+        m_vgList._setEntry( ind, * entry );
     }
 
     /// templated version of appendEntry
@@ -729,7 +1051,7 @@ public:
     int64_t
     append( Args && ... params )
     {
-        return appendEntry( new EntryType( std::forward < Args > ( params ) ... ) );
+        return appendEntry( EntryType( std::forward < Args > ( params ) ... ) );
     }
 
     /// templated version of setEntry()
@@ -737,22 +1059,21 @@ public:
     void
     set( int64_t ind, Args && ... params )
     {
-        return setEntry( ind, new EntryType( std::forward < Args > ( params ) ... ) );
+        CARTA_ASSERT( ind >= 0 && ind < m_vgList.size() );
+        m_vgList._setEntry( ind, EntryType( std::forward < Args > ( params ) ... ) );
     }
 
     /// append another list
     void appendList( const VGList & vglist)
     {
-        m_vgList.m_entries.insert( m_vgList.m_entries.end(),
-                                   vglist.m_entries.begin(),
-                                   vglist.m_entries.end());
+        m_vgList._appendList( vglist );
     }
 
     /// clear all entries
     void
     clear()
     {
-        m_vgList.m_entries.resize( 0 );
+        m_vgList = VGList();
     }
 
 private:
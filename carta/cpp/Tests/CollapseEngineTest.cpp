@@ -0,0 +1,188 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../core/Data/Image/CollapseEngine.h"
+#include "../core/Data/Image/MemoryImage.h"
+#include "../core/Algorithms/bulkRead.h"
+#include <cmath>
+#include <limits>
+
+using Carta::Data::CollapseEngine;
+using Carta::Data::MemoryImage;
+
+typedef std::shared_ptr < Carta::Lib::Image::ImageInterface > ImagePtr;
+
+/// metadata that only records how it was permuted
+class PermutationMetaData : public Carta::Lib::Image::MetaDataInterface
+{
+public:
+
+    PermutationMetaData( bool canPermute, const std::vector < int > & order = { } )
+        : m_canPermute( canPermute )
+        , m_order( order )
+    { }
+
+    virtual MetaDataInterface * clone() override { return new PermutationMetaData( * this ); }
+
+    virtual CoordinateFormatterInterface::SharedPtr coordinateFormatter() override { return nullptr; }
+
+    virtual PlotLabelGeneratorInterface::SharedPtr plotLabelGenerator() override { return nullptr; }
+
+    virtual QString title( TextFormat ) override { return QString(); }
+
+    virtual QStringList otherInfo( TextFormat ) override { return QStringList(); }
+
+    virtual SharedPtr permuted( const std::vector < int > & indices ) override
+    {
+        if ( ! m_canPermute ) {
+            return nullptr;
+        }
+        return std::make_shared < PermutationMetaData > ( true, indices );
+    }
+
+    const std::vector < int > & order() const { return m_order; }
+
+private:
+
+    bool m_canPermute;
+    std::vector < int > m_order;
+};
+
+static ImagePtr
+makeImage( const std::vector < int > & dims, const std::vector < float > & values,
+           Carta::Lib::Image::MetaDataInterface::SharedPtr metaData = nullptr )
+{
+    auto data = std::make_shared < std::vector < float > > ( values );
+    return std::make_shared < MemoryImage > ( dims, data, "Jy", metaData );
+}
+
+static std::vector < float >
+readImage( const ImagePtr & image, const SliceND & slice = SliceND() )
+{
+    std::unique_ptr < Carta::Lib::NdArray::RawViewInterface > view( image-> getDataSlice( slice ) );
+    REQUIRE( view.get() != nullptr );
+    return Carta::Core::Algorithms::readAll < float > ( view.get() );
+}
+
+TEST_CASE( "MemoryImage testing", "[image]" ) {
+    std::vector < float > values( 12 );
+    for ( int i = 0 ; i < 12 ; ++i ) {
+        values[i] = i;
+    }
+    ImagePtr image = makeImage( { 3, 2, 2 }, values );
+
+    SECTION( "slices") {
+        REQUIRE( readImage( image ) == values );
+
+        SliceND plane;
+        plane.slice( 2 ).start( 1 ).end( 2 );
+        REQUIRE( readImage( image, plane ) == std::vector < float > ( { 6, 7, 8, 9, 10, 11 } ) );
+
+        SliceND column;
+        column.slice( 0 ).start( 1 ).end( 2 );
+        REQUIRE( readImage( image, column ) == std::vector < float > ( { 1, 4, 7, 10 } ) );
+    }
+
+    SECTION( "permuting reorders the pixels and only the coordinates") {
+        auto meta = std::make_shared < PermutationMetaData > ( true );
+        ImagePtr withMeta = makeImage( { 3, 2, 2 }, values, meta );
+        ImagePtr permuted = withMeta-> getPermuted( { 1, 0, 2 } );
+        REQUIRE( permuted.get() != nullptr );
+        REQUIRE( permuted-> dims() == std::vector < int > ( { 2, 3, 2 } ) );
+        REQUIRE( readImage( permuted ) ==
+                 std::vector < float > ( { 0, 3, 1, 4, 2, 5, 6, 9, 7, 10, 8, 11 } ) );
+        auto permutedMeta = std::dynamic_pointer_cast < PermutationMetaData > ( permuted-> metaData() );
+        REQUIRE( permutedMeta.get() != nullptr );
+        REQUIRE( permutedMeta-> order() == std::vector < int > ( { 1, 0, 2 } ) );
+    }
+
+    SECTION( "coordinates that cannot be permuted") {
+        ImagePtr fixed = makeImage( { 3, 2, 2 }, values, std::make_shared < PermutationMetaData > ( false ) );
+        REQUIRE( ! fixed-> getPermuted( { 1, 0, 2 } ) );
+        REQUIRE( ! image-> getPermuted( { 1, 0 } ) );
+    }
+}
+
+TEST_CASE( "CollapseEngine testing", "[image]" ) {
+    const float nan = std::numeric_limits < float >::quiet_NaN();
+
+    // two pixels with three channels each, the channel axis last
+    ImagePtr cube = makeImage( { 2, 1, 3 }, { 1, 0, 2, nan, 3, 4 } );
+    const std::vector < CollapseEngine::CollapseType > allTypes = {
+        CollapseEngine::CollapseType::Moment0, CollapseEngine::CollapseType::Moment1,
+        CollapseEngine::CollapseType::Moment2, CollapseEngine::CollapseType::Peak,
+        CollapseEngine::CollapseType::Mean
+    };
+
+    SECTION( "every type from one pass") {
+        CollapseEngine engine( cube, 2 );
+        std::vector < ImagePtr > images = engine.compute( allTypes );
+        REQUIRE( images.size() == 5 );
+        for ( const ImagePtr & image : images ) {
+            REQUIRE( image-> dims() == std::vector < int > ( { 2, 1, 1 } ) );
+        }
+
+        // blanked values are left out; without spectral values the moments are in channels
+        std::vector < float > moment0 = readImage( images[0] );
+        REQUIRE( moment0[0] == Approx( 6 ) );
+        REQUIRE( moment0[1] == Approx( 4 ) );
+        std::vector < float > moment1 = readImage( images[1] );
+        REQUIRE( moment1[0] == Approx( 4.0 / 3 ) );
+        REQUIRE( moment1[1] == Approx( 2 ) );
+        std::vector < float > moment2 = readImage( images[2] );
+        REQUIRE( moment2[0] == Approx( std::sqrt( 5.0 / 9 ) ) );
+        REQUIRE( moment2[1] == Approx( 0 ) );
+        REQUIRE( readImage( images[3] ) == std::vector < float > ( { 3, 4 } ) );
+        REQUIRE( readImage( images[4] ) == std::vector < float > ( { 2, 2 } ) );
+    }
+
+    SECTION( "channel range") {
+        CollapseEngine engine( cube, 2 );
+        engine.setChannelRange( 1, 2 );
+        std::vector < ImagePtr > images = engine.compute( {
+            CollapseEngine::CollapseType::Moment0, CollapseEngine::CollapseType::Moment1 } );
+        REQUIRE( images.size() == 2 );
+        REQUIRE( readImage( images[0] ) == std::vector < float > ( { 5, 4 } ) );
+        std::vector < float > moment1 = readImage( images[1] );
+        REQUIRE( moment1[0] == Approx( 1.6 ) );
+        REQUIRE( moment1[1] == Approx( 2 ) );
+    }
+
+    SECTION( "include range") {
+        CollapseEngine engine( cube, 2 );
+        engine.setIncludeRange( 1.5, std::numeric_limits < double >::infinity() );
+        std::vector < ImagePtr > images = engine.compute( {
+            CollapseEngine::CollapseType::Moment0, CollapseEngine::CollapseType::Mean } );
+        REQUIRE( readImage( images[0] ) == std::vector < float > ( { 5, 4 } ) );
+        REQUIRE( readImage( images[1] ) == std::vector < float > ( { 2.5, 4 } ) );
+
+        // a pixel with no values in range is blank
+        engine.setIncludeRange( 3.5, 10 );
+        images = engine.compute( { CollapseEngine::CollapseType::Mean } );
+        std::vector < float > mean = readImage( images[0] );
+        REQUIRE( std::isnan( mean[0] ) );
+        REQUIRE( mean[1] == 4 );
+    }
+
+    SECTION( "spectral values") {
+        CollapseEngine engine( cube, 2 );
+        engine.setSpectralValues( { 10, 20, 30 }, "km/s" );
+        std::vector < ImagePtr > images = engine.compute( {
+            CollapseEngine::CollapseType::Moment0, CollapseEngine::CollapseType::Moment1 } );
+        REQUIRE( readImage( images[0] ) == std::vector < float > ( { 60, 40 } ) );
+        REQUIRE( images[0]-> getPixelUnit().toStr() == "Jy.km/s" );
+        std::vector < float > moment1 = readImage( images[1] );
+        REQUIRE( moment1[0] == Approx( 10 + 40.0 / 3 ) );
+        REQUIRE( moment1[1] == Approx( 30 ) );
+        REQUIRE( images[1]-> getPixelUnit().toStr() == "km/s" );
+    }
+
+    SECTION( "unsuitable input") {
+        CollapseEngine flat( makeImage( { 2, 3 }, { 1, 2, 3, 4, 5, 6 } ), 1 );
+        REQUIRE( flat.compute( allTypes ).empty() );
+        CollapseEngine engine( cube, 2 );
+        REQUIRE( engine.compute( { } ).empty() );
+    }
+}
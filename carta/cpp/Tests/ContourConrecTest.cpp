@@ -0,0 +1,50 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/Algorithms/ContourConrec.h"
+#include <cmath>
+#include <limits>
+
+using Carta::Lib::Algorithms::ContourConrec;
+
+TEST_CASE( "Contour block averaging testing", "[contour]" ) {
+    const double nan = std::numeric_limits < double >::quiet_NaN();
+    const double inf = std::numeric_limits < double >::infinity();
+
+    SECTION( "blocks with and without finite pixels") {
+        // the last column does not fill a block and is left out
+        std::vector < double > rows = {
+            1,   2,   5,   nan,   100,
+            3,   4,   nan, 7,     100,
+            nan, nan, inf, 8,     100,
+            nan, nan, 10,  - inf, 100
+        };
+        std::vector < double > blocks = ContourConrec::averageBlocks( rows, 5, 2, 2, 2 );
+        REQUIRE( blocks.size() == 4 );
+        REQUIRE( blocks[0] == Approx( 2.5 ) );
+        REQUIRE( blocks[1] == Approx( 6 ) );
+        REQUIRE( std::isnan( blocks[2] ) );
+        REQUIRE( blocks[3] == Approx( 9 ) );
+    }
+
+    SECTION( "a whole plane of non-finite pixels") {
+        std::vector < double > rows( 9 * 3, nan );
+        rows[4] = inf;
+        std::vector < double > blocks = ContourConrec::averageBlocks( rows, 9, 3, 1, 3 );
+        REQUIRE( blocks.size() == 3 );
+        for ( double block : blocks ) {
+            REQUIRE( std::isnan( block ) );
+        }
+    }
+
+    SECTION( "blocks of one pixel") {
+        std::vector < double > rows = { 1, nan, 3, 4 };
+        std::vector < double > blocks = ContourConrec::averageBlocks( rows, 2, 1, 2, 2 );
+        REQUIRE( blocks[0] == 1 );
+        REQUIRE( std::isnan( blocks[1] ) );
+        REQUIRE( blocks[2] == 3 );
+        REQUIRE( blocks[3] == 4 );
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/CoordinateMesh.h"
+#include <cmath>
+
+using Carta::Lib::CoordinateMesh;
+
+/// a gnomonic projection on the first two axes and a linear third axis
+class TanFormatter : public CoordinateFormatterInterface
+{
+public:
+
+    virtual CoordinateFormatterInterface * clone() const override { return new TanFormatter( * this ); }
+
+    virtual int nAxes() const override { return 3; }
+
+    virtual QStringList formatFromPixelCoordinate( const VD & ) override { return QStringList(); }
+
+    virtual QString calculateFormatDistance( const VD &, const VD & ) override { return QString(); }
+
+    virtual void setTextOutputFormat( TextFormat ) override { }
+
+    virtual const Carta::Lib::AxisInfo & axisInfo( int ) const override { return m_axisInfo; }
+
+    virtual Me & disableAxis( int ) override { return * this; }
+
+    virtual Me & enableAxis( int ) override { return * this; }
+
+    virtual KnownSkyCS skyCS() override { return KnownSkyCS::Unknown; }
+
+    virtual Me & setSkyCS( const KnownSkyCS & ) override { return * this; }
+
+    virtual SkyFormatting skyFormatting() override { return SkyFormatting::Default; }
+
+    virtual Me & setSkyFormatting( SkyFormatting ) override { return * this; }
+
+    virtual int axisPrecision( int ) override { return 0; }
+
+    virtual Me & setAxisPrecision( int, int ) override { return * this; }
+
+    virtual bool toWorld( const VD & pixel, VD & world ) const override
+    {
+        double x = ( pixel[0] - 500 ) * 1e-3;
+        double y = ( pixel[1] - 400 ) * 1e-3;
+        double r = std::hypot( x, y );
+        double s = r > 0 ? std::atan( r ) / r : 1;
+        world = { 10 + x * s, 20 + y * s, 1e9 + pixel[2] * 1e6 };
+        return true;
+    }
+
+    virtual bool toPixel( const VD & world, VD & pixel ) const override
+    {
+        double x = world[0] - 10;
+        double y = world[1] - 20;
+        double t = std::hypot( x, y );
+        double s = t > 0 ? std::tan( t ) / t : 1;
+        pixel = { x * s * 1e3 + 500, y * s * 1e3 + 400, ( world[2] - 1e9 ) / 1e6 };
+        return true;
+    }
+
+private:
+
+    Carta::Lib::AxisInfo m_axisInfo;
+};
+
+TEST_CASE( "CoordinateMesh testing", "[coordinates]" ) {
+    TanFormatter tan;
+    const double tolerance = 0.1;
+    CoordinateMesh mesh( tan, { 0, 0, 5 }, 0, 1, 1000, 800, tolerance );
+    REQUIRE( mesh.isApproximate() );
+
+    // points inside the image, and one outside that is converted exactly
+    CoordinateMesh::VD pixels;
+    for ( int i = 0 ; i < 1000 ; ++i ) {
+        pixels.push_back( ( i * 37 ) % 1000 + 0.3 );
+        pixels.push_back( ( i * 53 ) % 800 + 0.7 );
+    }
+    pixels.push_back( - 50 );
+    pixels.push_back( 30 );
+    size_t count = pixels.size() / 2;
+
+    SECTION( "pixel to world stays within the tolerance") {
+        CoordinateMesh::VD worlds;
+        std::vector < bool > valid;
+        REQUIRE( mesh.toWorldMany( pixels, worlds, & valid ) );
+        for ( size_t i = 0 ; i < count ; ++i ) {
+            CoordinateMesh::VD pixel;
+            tan.toPixel( { worlds[2 * i], worlds[2 * i + 1], 1e9 + 5e6 }, pixel );
+            REQUIRE( valid[i] );
+            REQUIRE( std::hypot( pixel[0] - pixels[2 * i], pixel[1] - pixels[2 * i + 1] ) < tolerance );
+        }
+    }
+
+    SECTION( "world to pixel stays within the tolerance") {
+        CoordinateMesh::VD worlds;
+        for ( size_t i = 0 ; i < count ; ++i ) {
+            CoordinateMesh::VD world;
+            tan.toWorld( { pixels[2 * i], pixels[2 * i + 1], 5 }, world );
+            worlds.push_back( world[0] );
+            worlds.push_back( world[1] );
+        }
+        CoordinateMesh::VD found;
+        REQUIRE( mesh.toPixelMany( worlds, found ) );
+        for ( size_t i = 0 ; i < count ; ++i ) {
+            REQUIRE( std::hypot( found[2 * i] - pixels[2 * i], found[2 * i + 1] - pixels[2 * i + 1] ) <
+                     tolerance );
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../core/Algorithms/histogramAlgorithms.h"
+#include <cmath>
+#include <cstdint>
+
+using Carta::Core::Algorithms::rebinHistogram;
+
+/// sum of the counts, failing if any of them is not a non-negative whole number
+static double
+wholeTotal( const std::vector < double > & counts )
+{
+    double total = 0;
+    for ( double count : counts ) {
+        REQUIRE( count >= 0 );
+        REQUIRE( count == std::round( count ) );
+        total += count;
+    }
+    return total;
+}
+
+TEST_CASE( "rebinHistogram keeps whole counts and the total", "[histogram]" )
+{
+    SECTION( "unaligned bins" ) {
+        std::vector < int64_t > counts = { 5, 3, 8, 1, 0, 7, 2 };
+        std::vector < double > result = rebinHistogram( counts.data(), 7, 0.0, 7.0, 3, 0.0, 7.0 );
+        REQUIRE( result.size() == 3 );
+        REQUIRE( wholeTotal( result ) == 26 );
+    }
+
+    SECTION( "many fine bins onto fewer coarse bins" ) {
+        std::vector < int64_t > counts( 4096 );
+        int64_t pixelCount = 0;
+        for ( int i = 0 ; i < 4096 ; i++ ) {
+            counts[i] = ( i * 7919 ) % 13;
+            pixelCount += counts[i];
+        }
+        std::vector < double > result = rebinHistogram( counts.data(), 4096, -1.5, 2.5, 100, -1.5, 2.5 );
+        REQUIRE( wholeTotal( result ) == pixelCount );
+    }
+
+    SECTION( "coarse range wider than the fine range" ) {
+        std::vector < int64_t > counts = { 1, 1, 1, 1, 1 };
+        std::vector < double > result = rebinHistogram( counts.data(), 5, 0.0, 1.0, 7, - 0.3, 1.2 );
+        REQUIRE( wholeTotal( result ) == 5 );
+    }
+
+    SECTION( "aligned bins are exact" ) {
+        std::vector < int64_t > counts = { 2, 4, 6, 8 };
+        std::vector < double > result = rebinHistogram( counts.data(), 4, 0.0, 4.0, 2, 0.0, 4.0 );
+        REQUIRE( result.size() == 2 );
+        REQUIRE( result[0] == 6 );
+        REQUIRE( result[1] == 14 );
+    }
+}
@@ -0,0 +1,32 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/Hooks/HistogramResult.h"
+#include <QByteArray>
+#include <QDataStream>
+
+using Carta::Lib::Hooks::HistogramResult;
+
+TEST_CASE( "HistogramResult serialization", "[histogram]" )
+{
+    std::vector < std::pair < double, double > > data = { { 0.5, 3 }, { 1.5, 7 }, { 2.5, 0 } };
+    HistogramResult original( "cube.fits", "Jy/beam", "count", data );
+    original.setProgress( 0.25 );
+
+    QByteArray bytes;
+    QDataStream out( & bytes, QIODevice::WriteOnly );
+    out << original;
+
+    HistogramResult copy;
+    QDataStream in( & bytes, QIODevice::ReadOnly );
+    in >> copy;
+
+    REQUIRE( in.status() == QDataStream::Ok );
+    REQUIRE( copy.getName().toStdString() == "cube.fits" );
+    REQUIRE( copy.getUnitsX().toStdString() == "Jy/beam" );
+    REQUIRE( copy.getUnitsY().toStdString() == "count" );
+    REQUIRE( copy.getData() == data );
+    REQUIRE( copy.getProgress() == 0.25 );
+}
@@ -0,0 +1,99 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../core/Data/Profile/HoverSpectrumExtractor.h"
+#include "../core/Data/Image/MemoryImage.h"
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTimer>
+#include <atomic>
+
+using Carta::Data::HoverSpectrumExtractor;
+using Carta::Data::MemoryImage;
+
+/// an image whose pixels can never be read
+class UnreadableImage : public MemoryImage
+{
+public:
+
+    UnreadableImage( const std::vector < int > & dims )
+        : MemoryImage( dims, std::make_shared < std::vector < float > > (), "Jy", nullptr )
+    { }
+
+    virtual Carta::Lib::NdArray::RawViewInterface *
+    getDataSlice( const SliceND & ) override
+    {
+        reads++;
+        return nullptr;
+    }
+
+    std::atomic < int > reads { 0 };
+};
+
+/// run the event loop until quit() or the timeout
+static void
+runEvents( QEventLoop & loop, int timeout )
+{
+    QTimer::singleShot( timeout, & loop, SLOT( quit() ) );
+    loop.exec();
+}
+
+TEST_CASE( "Hover spectrum testing", "[profile]" ) {
+    // the reads are reported through queued signals
+    int argc = 1;
+    char name[] = "tester";
+    char * argv[] = { name };
+    std::unique_ptr < QCoreApplication > app;
+    if ( ! QCoreApplication::instance() ) {
+        app.reset( new QCoreApplication( argc, argv ) );
+    }
+
+    HoverSpectrumExtractor extractor;
+    std::vector < int > readyPos;
+    std::vector < double > readySpectrum;
+    int readyCount = 0;
+    QEventLoop loop;
+    QObject::connect( & extractor, & HoverSpectrumExtractor::spectrumReady,
+                      [&] ( const std::vector < int > & pos, const std::vector < double > & spectrum ) {
+        readyPos = pos;
+        readySpectrum = spectrum;
+        readyCount++;
+        loop.quit();
+    });
+
+    SECTION( "spectrum under the cursor") {
+        // a 3x2 plane with four channels; each value is 100 * channel + pixel index
+        std::vector < float > values;
+        for ( int channel = 0 ; channel < 4 ; ++channel ) {
+            for ( int pixel = 0 ; pixel < 6 ; ++pixel ) {
+                values.push_back( 100 * channel + pixel );
+            }
+        }
+        auto image = std::make_shared < MemoryImage > (
+            std::vector < int > { 3, 2, 4 }, std::make_shared < std::vector < float > > ( values ),
+            "Jy", nullptr );
+        REQUIRE( extractor.requestSpectrum( image, 2, { 2, 1, 0 } ) );
+        runEvents( loop, 5000 );
+        REQUIRE( readyCount == 1 );
+        REQUIRE( readyPos == std::vector < int > ( { 2, 1, 0 } ) );
+        REQUIRE( readySpectrum == std::vector < double > ( { 5, 105, 205, 305 } ) );
+
+        // the neighbors were read with it and come from the cache right away
+        REQUIRE( extractor.requestSpectrum( image, 2, { 1, 0, 3 } ) );
+        REQUIRE( readyCount == 2 );
+        REQUIRE( readySpectrum == std::vector < double > ( { 1, 101, 201, 301 } ) );
+
+        REQUIRE( ! extractor.requestSpectrum( image, 2, { 3, 0, 0 } ) );
+        REQUIRE( ! extractor.requestSpectrum( image, 1, { 0, 0, 0 } ) );
+    }
+
+    SECTION( "a failed read is not retried") {
+        auto image = std::make_shared < UnreadableImage > ( std::vector < int > { 3, 2, 4 } );
+        REQUIRE( extractor.requestSpectrum( image, 2, { 1, 1, 0 } ) );
+        runEvents( loop, 500 );
+        REQUIRE( readyCount == 0 );
+        REQUIRE( image-> reads.load() == 1 );
+    }
+}
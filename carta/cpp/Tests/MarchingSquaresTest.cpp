@@ -0,0 +1,241 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/Algorithms/MarchingSquares.h"
+#include "../CartaLib/Algorithms/LineCombiner.h"
+#include <QLineF>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <tuple>
+
+using namespace Carta::Lib::Algorithms;
+
+/// the CONREC kernel that ContourConrec used before marching squares, kept as a
+/// reference: segments of each level in a cols x rows grid, with the levels in
+/// increasing order
+static std::vector < std::vector < QLineF > >
+referenceConrec( const double * data, int cols, int rows, const std::vector < double > & z )
+{
+    int nc = z.size();
+    std::vector < std::vector < QLineF > > result( nc );
+    auto acc = [&] ( int col, int row ) {
+        return data[row * cols + col];
+    };
+
+#define xsect( p1, p2 ) ( h[p2] * xh[p1] - h[p1] * xh[p2] ) / ( h[p2] - h[p1] )
+#define ysect( p1, p2 ) ( h[p2] * yh[p1] - h[p1] * yh[p2] ) / ( h[p2] - h[p1] )
+
+    int m1, m2, m3, case_value;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    double h[5];
+    int sh[5];
+    double xh[5], yh[5];
+    int im[4] = { 0, 1, 1, 0 }, jm[4] = { 0, 0, 1, 1 };
+    int castab[3][3][3] = {
+        { { 0, 0, 8 }, { 0, 2, 5 }, { 7, 6, 9 } },
+        { { 0, 3, 4 }, { 1, 3, 1 }, { 4, 3, 0 } },
+        { { 9, 6, 7 }, { 5, 2, 0 }, { 8, 0, 0 } }
+    };
+
+    for ( int j = 0 ; j < rows - 1 ; j++ ) {
+        for ( int i = 0 ; i < cols - 1 ; i++ ) {
+            double dmin = std::min( std::min( acc( i, j ), acc( i, j + 1 ) ),
+                                    std::min( acc( i + 1, j ), acc( i + 1, j + 1 ) ) );
+            if ( ! std::isfinite( dmin ) ) {
+                continue;
+            }
+            double dmax = std::max( std::max( acc( i, j ), acc( i, j + 1 ) ),
+                                    std::max( acc( i + 1, j ), acc( i + 1, j + 1 ) ) );
+            if ( dmax < z[0] || dmin > z[nc - 1] ) {
+                continue;
+            }
+            for ( int k = 0 ; k < nc ; k++ ) {
+                if ( z[k] < dmin || z[k] > dmax ) {
+                    continue;
+                }
+                for ( int m = 4 ; m >= 0 ; m-- ) {
+                    if ( m > 0 ) {
+                        h[m] = acc( i + im[m - 1], j + jm[m - 1] ) - z[k];
+                        xh[m] = i + im[m - 1];
+                        yh[m] = j + jm[m - 1];
+                    }
+                    else {
+                        h[0] = 0.25 * ( h[1] + h[2] + h[3] + h[4] );
+                        xh[0] = i + 0.5;
+                        yh[0] = j + 0.5;
+                    }
+                    sh[m] = h[m] > 0.0 ? 1 : ( h[m] < 0.0 ? - 1 : 0 );
+                }
+
+                // the centre is vertex 0, and each triangle joins it to two corners
+                for ( int m = 1 ; m <= 4 ; m++ ) {
+                    m1 = m;
+                    m2 = 0;
+                    m3 = m != 4 ? m + 1 : 1;
+                    if ( ( case_value = castab[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1] ) == 0 ) {
+                        continue;
+                    }
+                    switch ( case_value )
+                    {
+                    case 1 :
+                        x1 = xh[m1]; y1 = yh[m1]; x2 = xh[m2]; y2 = yh[m2];
+                        break;
+                    case 2 :
+                        x1 = xh[m2]; y1 = yh[m2]; x2 = xh[m3]; y2 = yh[m3];
+                        break;
+                    case 3 :
+                        x1 = xh[m3]; y1 = yh[m3]; x2 = xh[m1]; y2 = yh[m1];
+                        break;
+                    case 4 :
+                        x1 = xh[m1]; y1 = yh[m1]; x2 = xsect( m2, m3 ); y2 = ysect( m2, m3 );
+                        break;
+                    case 5 :
+                        x1 = xh[m2]; y1 = yh[m2]; x2 = xsect( m3, m1 ); y2 = ysect( m3, m1 );
+                        break;
+                    case 6 :
+                        x1 = xh[m3]; y1 = yh[m3]; x2 = xsect( m1, m2 ); y2 = ysect( m1, m2 );
+                        break;
+                    case 7 :
+                        x1 = xsect( m1, m2 ); y1 = ysect( m1, m2 );
+                        x2 = xsect( m2, m3 ); y2 = ysect( m2, m3 );
+                        break;
+                    case 8 :
+                        x1 = xsect( m2, m3 ); y1 = ysect( m2, m3 );
+                        x2 = xsect( m3, m1 ); y2 = ysect( m3, m1 );
+                        break;
+                    case 9 :
+                        x1 = xsect( m3, m1 ); y1 = ysect( m3, m1 );
+                        x2 = xsect( m1, m2 ); y2 = ysect( m1, m2 );
+                        break;
+                    default :
+                        break;
+                    }
+                    result[k].push_back( QLineF( x1, y1, x2, y2 ) );
+                }
+            }
+        }
+    }
+    return result;
+
+#undef xsect
+#undef ysect
+}
+
+/// closedness and rounded end points of each polyline, sorted, to compare the
+/// topology of two results whose vertices inside the cells differ
+static std::vector < std::tuple < bool, int, int, int, int > >
+topology( const std::vector < QPolygonF > & polys )
+{
+    std::vector < std::tuple < bool, int, int, int, int > > result;
+    auto round = [] ( double value ) {
+        return int( std::floor( value * 1e6 + 0.5 ) );
+    };
+    for ( const QPolygonF & poly : polys ) {
+        if ( poly.isClosed() ) {
+            result.push_back( std::make_tuple( true, 0, 0, 0, 0 ) );
+            continue;
+        }
+        std::pair < int, int > p1( round( poly.first().x() ), round( poly.first().y() ) );
+        std::pair < int, int > p2( round( poly.last().x() ), round( poly.last().y() ) );
+        if ( p2 < p1 ) {
+            std::swap( p1, p2 );
+        }
+        result.push_back( std::make_tuple( false, p1.first, p1.second, p2.first, p2.second ) );
+    }
+    std::sort( result.begin(), result.end() );
+    return result;
+}
+
+TEST_CASE( "Marching squares testing", "[contour]" ) {
+
+    SECTION( "flat input") {
+        std::vector < double > data( 16, 1.0 );
+        MarchingSquares ms( data.data(), 4, 4 );
+        auto res = ms.compute( { 0.5, 1.5 } );
+        REQUIRE( res.size() == 2 );
+        REQUIRE( res[0].size() == 0 );
+        REQUIRE( res[1].size() == 0 );
+    }
+
+    SECTION( "single peak") {
+        std::vector < double > data = {
+            0, 0, 0,
+            0, 1, 0,
+            0, 0, 0
+        };
+        MarchingSquares ms( data.data(), 3, 3 );
+        auto res = ms.compute( { 0.5 } );
+        REQUIRE( res[0].size() == 1 );
+        REQUIRE( res[0][0].size() == 5 );
+        REQUIRE( res[0][0].isClosed() );
+    }
+
+    SECTION( "saddle resolved by the average") {
+        std::vector < double > data = {
+            1, 0,
+            0, 1
+        };
+        MarchingSquares ms( data.data(), 2, 2 );
+        auto res = ms.compute( { 0.4, 0.6 } );
+        REQUIRE( res[0].size() == 2 );
+        REQUIRE( res[1].size() == 2 );
+
+        // below the average the low corners are cut off, above it the high ones
+        REQUIRE( ( res[0][0].first().x() < 0.5 ) != ( res[0][0].first().y() < 0.5 ) );
+        REQUIRE( ( res[1][0].first().x() < 0.5 ) == ( res[1][0].first().y() < 0.5 ) );
+    }
+
+    SECTION( "blanked pixels") {
+        std::vector < double > data = {
+            0, 0, 0,
+            0, 1, 0,
+            0, 0, NAN
+        };
+        MarchingSquares ms( data.data(), 3, 3 );
+        auto res = ms.compute( { 0.5 } );
+        REQUIRE( res[0].size() == 1 );
+        REQUIRE( ! res[0][0].isClosed() );
+    }
+
+    SECTION( "rows of a band") {
+        std::vector < double > data = {
+            0, 1, 0,
+            0, 1, 0
+        };
+        MarchingSquares ms( data.data(), 3, 2, 10 );
+        auto res = ms.compute( { 0.5 } );
+        REQUIRE( res[0].size() == 2 );
+        REQUIRE( res[0][0].first().y() >= 10 );
+        REQUIRE( res[0][0].last().y() <= 11 );
+    }
+
+    SECTION( "same topology as CONREC and the line combiner") {
+        int n = 200;
+        std::vector < double > data( n * n );
+        std::mt19937 generator( 42 );
+        std::uniform_real_distribution < double > noise( 0, 0.3 );
+        for ( int row = 0 ; row < n ; ++row ) {
+            for ( int col = 0 ; col < n ; ++col ) {
+                data[row * n + col] = sin( col * 0.1 ) * cos( row * 0.13 ) + noise( generator );
+            }
+        }
+        std::vector < double > levels = { - 0.5, 0, 0.5 };
+        MarchingSquares ms( data.data(), n, n );
+        auto res = ms.compute( levels );
+        auto segments = referenceConrec( data.data(), n, n, levels );
+        for ( size_t k = 0 ; k < levels.size() ; ++k ) {
+            // join the reference segments the old way, in an order of their own
+            std::shuffle( segments[k].begin(), segments[k].end(), generator );
+            LineCombiner lc( QRectF( 0, 0, n, n ), n + 1, n + 1, 1e-9 );
+            for ( auto & line : segments[k] ) {
+                lc.add( line.p1(), line.p2() );
+            }
+            std::vector < QPolygonF > combined = lc.getPolygons();
+            REQUIRE( res[k].size() > 0 );
+            REQUIRE( topology( res[k] ) == topology( combined ) );
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../core/Algorithms/pathSampling.h"
+#include <cmath>
+
+using namespace Carta::Core::Algorithms;
+
+TEST_CASE( "Path sampling testing", "[profile]" ) {
+
+    SECTION( "samples along a line") {
+        std::vector < PathSample > samples = samplePolyline( { { 0, 0 }, { 3, 0 } } );
+        REQUIRE( samples.size() == 4 );
+        for ( int i = 0 ; i < 4 ; ++i ) {
+            REQUIRE( samples[i].x == Approx( i ) );
+            REQUIRE( samples[i].y == Approx( 0 ) );
+            REQUIRE( samples[i].dx == Approx( 1 ) );
+            REQUIRE( samples[i].dy == Approx( 0 ) );
+        }
+
+        // the last sample is dropped if the path ends between samples
+        REQUIRE( samplePolyline( { { 0, 0 }, { 2.5, 0 } } ).size() == 3 );
+    }
+
+    SECTION( "spacing continues around the corners of a polyline") {
+        std::vector < PathSample > samples = samplePolyline( { { 0, 0 }, { 1.5, 0 }, { 1.5, 2 } } );
+        REQUIRE( samples.size() == 4 );
+        REQUIRE( samples[1].x == Approx( 1 ) );
+        REQUIRE( samples[2].x == Approx( 1.5 ) );
+        REQUIRE( samples[2].y == Approx( 0.5 ) );
+        REQUIRE( samples[2].dx == Approx( 0 ) );
+        REQUIRE( samples[2].dy == Approx( 1 ) );
+        REQUIRE( samples[3].y == Approx( 1.5 ) );
+    }
+
+    SECTION( "degenerate paths") {
+        REQUIRE( samplePolyline( { } ).empty() );
+        REQUIRE( samplePolyline( { { 0, 0 }, { 3, 0 } }, 0 ).empty() );
+        REQUIRE( samplePolyline( { { 2, 3 } } ).size() == 1 );
+        std::vector < PathSample > samples = samplePolyline( { { 2, 3 }, { 2, 3 } } );
+        REQUIRE( samples.size() == 1 );
+        REQUIRE( samples[0].x == 2 );
+        REQUIRE( samples[0].y == 3 );
+    }
+
+    SECTION( "bilinear interpolation") {
+        std::vector < float > plane = {
+            0, 1,
+            2, 3
+        };
+        REQUIRE( interpolateBilinear( plane.data(), 2, 2, 0.5, 0.5 ) == Approx( 1.5 ) );
+        REQUIRE( interpolateBilinear( plane.data(), 2, 2, 0.25, 0 ) == Approx( 0.25 ) );
+        REQUIRE( interpolateBilinear( plane.data(), 2, 2, 1, 1 ) == Approx( 3 ) );
+        REQUIRE( std::isnan( interpolateBilinear( plane.data(), 2, 2, -0.1, 0 ) ) );
+        REQUIRE( std::isnan( interpolateBilinear( plane.data(), 2, 2, 0, 1.1 ) ) );
+    }
+
+    SECTION( "interpolation next to blanked pixels") {
+        const float nan = std::numeric_limits < float >::quiet_NaN();
+        std::vector < float > plane = {
+            0, nan,
+            2, 3
+        };
+
+        // a blanked pixel with no weight is ignored
+        REQUIRE( interpolateBilinear( plane.data(), 2, 2, 0, 0.5 ) == Approx( 1 ) );
+        REQUIRE( std::isnan( interpolateBilinear( plane.data(), 2, 2, 0.5, 0.5 ) ) );
+    }
+
+    SECTION( "averaging across the path") {
+        std::vector < float > plane = {
+            0, 0, 0,
+            10, 10, 10,
+            20, 20, 20
+        };
+        PathSample sample = { 1, 1, 1, 0 };
+        REQUIRE( sampleAcross( plane.data(), 3, 3, sample, 0.5 ) == Approx( 10 ) );
+        sample.y = 0.5;
+        REQUIRE( sampleAcross( plane.data(), 3, 3, sample, 1 ) == Approx( 10 ) );
+
+        // values off the plane are left out of the mean
+        sample.y = 0;
+        REQUIRE( sampleAcross( plane.data(), 3, 3, sample, 1 ) == Approx( 5 ) );
+        sample.y = -5;
+        REQUIRE( std::isnan( sampleAcross( plane.data(), 3, 3, sample, 1 ) ) );
+    }
+
+    SECTION( "bounds of a path") {
+        std::vector < PathSample > samples = samplePolyline( { { 1.5, 1 }, { 3.5, 1 } } );
+        int64_t box[4];
+        REQUIRE( pathBounds( samples, 1.5, 10, 10, box ) );
+        REQUIRE( box[0] == 0 );
+        REQUIRE( box[1] == 0 );
+        REQUIRE( box[2] == 5 );
+        REQUIRE( box[3] == 2 );
+
+        // clipped by the plane
+        REQUIRE( pathBounds( samples, 1.5, 4, 2, box ) );
+        REQUIRE( box[2] == 3 );
+        REQUIRE( box[3] == 1 );
+
+        // outside the plane
+        REQUIRE( ! pathBounds( samplePolyline( { { 20, 20 }, { 30, 20 } } ), 1, 10, 10, box ) );
+        REQUIRE( ! pathBounds( { }, 1, 10, 10, box ) );
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../core/Data/Region/RegionSpans.h"
+
+using Carta::Data::RegionSpans;
+using Carta::Lib::RegionInfo;
+
+static RegionInfo
+makeRegion( RegionInfo::RegionType type, const std::vector < std::pair < double, double > > & corners )
+{
+    RegionInfo region;
+    region.setRegionType( type );
+    region.setCorners( corners );
+    return region;
+}
+
+static RegionSpans::Span
+span( int row, int start, int end )
+{
+    RegionSpans::Span result = { row, start, end };
+    return result;
+}
+
+TEST_CASE( "Region span testing", "[region]" ) {
+
+    SECTION( "rectangle") {
+        RegionSpans spans( { makeRegion( RegionInfo::RegionType::Polygon, { { 1, 1 }, { 3, 2 } } ) }, 10, 10 );
+        std::vector < RegionSpans::Span > expected = { span( 1, 1, 4 ), span( 2, 1, 4 ) };
+        REQUIRE( spans.getSpans() == expected );
+        REQUIRE( spans.getPixelCount() == 6 );
+        REQUIRE( spans.getBounds() == QRect( 1, 1, 3, 2 ) );
+    }
+
+    SECTION( "pixel centers on the edge are included") {
+        RegionSpans spans( { makeRegion( RegionInfo::RegionType::Polygon, { { -0.5, -0.5 }, { 1.5, 1.5 } } ) }, 10, 10 );
+        std::vector < RegionSpans::Span > expected = { span( 0, 0, 2 ), span( 1, 0, 2 ) };
+        REQUIRE( spans.getSpans() == expected );
+
+        // a box between pixel centers still covers the pixel it lies in
+        RegionSpans small( { makeRegion( RegionInfo::RegionType::Polygon, { { 2.2, 3.1 }, { 2.4, 3.3 } } ) }, 10, 10 );
+        REQUIRE( small.getPixelCount() == 1 );
+        REQUIRE( small.getBounds() == QRect( 2, 3, 1, 1 ) );
+    }
+
+    SECTION( "rectangles clipped by the image") {
+        RegionSpans low( { makeRegion( RegionInfo::RegionType::Polygon, { { -5, -5 }, { 2, 2 } } ) }, 10, 10 );
+        REQUIRE( low.getPixelCount() == 9 );
+        REQUIRE( low.getBounds() == QRect( 0, 0, 3, 3 ) );
+
+        RegionSpans high( { makeRegion( RegionInfo::RegionType::Polygon, { { 8, 8 }, { 15, 15 } } ) }, 10, 10 );
+        REQUIRE( high.getPixelCount() == 4 );
+        REQUIRE( high.getBounds() == QRect( 8, 8, 2, 2 ) );
+
+        RegionSpans outside( { makeRegion( RegionInfo::RegionType::Polygon, { { 20, 20 }, { 30, 30 } } ) }, 10, 10 );
+        REQUIRE( outside.isEmpty() );
+        REQUIRE( outside.getPixelCount() == 0 );
+        REQUIRE( outside.getBounds().isEmpty() );
+    }
+
+    SECTION( "polygon") {
+        RegionSpans spans( { makeRegion( RegionInfo::RegionType::Polygon, { { 0, 0 }, { 4, 0 }, { 0, 4 } } ) }, 10, 10 );
+
+        // the far vertex at (0,4) only touches its pixel center and is left out
+        std::vector < RegionSpans::Span > expected = {
+            span( 0, 0, 5 ), span( 1, 0, 4 ), span( 2, 0, 3 ), span( 3, 0, 2 )
+        };
+        REQUIRE( spans.getSpans() == expected );
+        REQUIRE( spans.getPixelCount() == 14 );
+    }
+
+    SECTION( "polygon clipped by the image") {
+        RegionSpans spans( { makeRegion( RegionInfo::RegionType::Polygon, { { -2, -2 }, { 2, -2 }, { -2, 2 } } ) }, 10, 10 );
+        std::vector < RegionSpans::Span > expected = { span( 0, 0, 1 ) };
+        REQUIRE( spans.getSpans() == expected );
+        REQUIRE( spans.getBounds() == QRect( 0, 0, 1, 1 ) );
+    }
+
+    SECTION( "ellipse") {
+        RegionSpans spans( { makeRegion( RegionInfo::RegionType::Ellipse, { { 0, 0 }, { 4, 2 } } ) }, 10, 10 );
+
+        // the ends of both axes lie on pixel centers
+        std::vector < RegionSpans::Span > expected = { span( 0, 2, 3 ), span( 1, 0, 5 ), span( 2, 2, 3 ) };
+        REQUIRE( spans.getSpans() == expected );
+        REQUIRE( spans.getPixelCount() == 7 );
+    }
+
+    SECTION( "ellipse clipped by the image") {
+        RegionSpans spans( { makeRegion( RegionInfo::RegionType::Ellipse, { { -2, -1 }, { 2, 1 } } ) }, 10, 10 );
+        std::vector < RegionSpans::Span > expected = { span( 0, 0, 3 ), span( 1, 0, 1 ) };
+        REQUIRE( spans.getSpans() == expected );
+    }
+
+    SECTION( "overlapping regions are merged") {
+        RegionSpans spans( {
+            makeRegion( RegionInfo::RegionType::Polygon, { { 0, 0 }, { 2, 0 } } ),
+            makeRegion( RegionInfo::RegionType::Polygon, { { 1, 0 }, { 4, 0 } } ),
+            makeRegion( RegionInfo::RegionType::Polygon, { { 7, 0 }, { 8, 0 } } )
+        }, 10, 10 );
+        std::vector < RegionSpans::Span > expected = { span( 0, 0, 5 ), span( 0, 7, 9 ) };
+        REQUIRE( spans.getSpans() == expected );
+    }
+
+    SECTION( "gather the covered pixels of every plane") {
+        RegionSpans spans( { makeRegion( RegionInfo::RegionType::Polygon, { { 0, 0 }, { 2, 0 }, { 0, 2 } } ) }, 3, 2 );
+
+        // the triangle covers the whole first row and two pixels of the second
+        REQUIRE( spans.getBounds() == QRect( 0, 0, 3, 2 ) );
+        std::vector < int > boxData = { 1, 2, 3, 4, 5, 6, 11, 12, 13, 14, 15, 16 };
+        std::vector < int > result;
+        spans.gather( boxData.data(), 2, result );
+        std::vector < int > expected = { 1, 2, 3, 4, 5, 11, 12, 13, 14, 15 };
+        REQUIRE( result == expected );
+    }
+}
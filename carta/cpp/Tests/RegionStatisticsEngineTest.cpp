@@ -0,0 +1,350 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../core/Data/Statistics/RegionStatisticsEngine.h"
+#include "../core/Data/Image/MemoryImage.h"
+#include "../core/Algorithms/runningStatistics.h"
+#include <cmath>
+#include <limits>
+
+using Carta::Core::Algorithms::RunningStatistics;
+using Carta::Data::RegionStatisticsEngine;
+using Carta::Data::MemoryImage;
+using Carta::Lib::AxisInfo;
+using Carta::Lib::RegionInfo;
+using Carta::Lib::StatInfo;
+
+typedef std::shared_ptr < Carta::Lib::Image::ImageInterface > ImagePtr;
+
+/// a formatter that only knows the axis types, and formats pixels as they are
+class AxisTypeFormatter : public CoordinateFormatterInterface
+{
+public:
+
+    AxisTypeFormatter( const std::vector < AxisInfo::KnownType > & types )
+    {
+        for ( AxisInfo::KnownType type : types ) {
+            AxisInfo info;
+            info.setKnownType( type );
+            m_axisInfos.push_back( info );
+        }
+    }
+
+    virtual CoordinateFormatterInterface * clone() const override { return new AxisTypeFormatter( * this ); }
+
+    virtual int nAxes() const override { return m_axisInfos.size(); }
+
+    virtual QStringList formatFromPixelCoordinate( const VD & pix ) override
+    {
+        QStringList list;
+        for ( double value : pix ) {
+            list.append( QString::number( value ) );
+        }
+        return list;
+    }
+
+    virtual QString calculateFormatDistance( const VD &, const VD & ) override { return QString(); }
+
+    virtual void setTextOutputFormat( TextFormat ) override { }
+
+    virtual const AxisInfo & axisInfo( int ind ) const override { return m_axisInfos[ind]; }
+
+    virtual Me & disableAxis( int ) override { return * this; }
+
+    virtual Me & enableAxis( int ) override { return * this; }
+
+    virtual KnownSkyCS skyCS() override { return KnownSkyCS::Unknown; }
+
+    virtual Me & setSkyCS( const KnownSkyCS & ) override { return * this; }
+
+    virtual SkyFormatting skyFormatting() override { return SkyFormatting::Default; }
+
+    virtual Me & setSkyFormatting( SkyFormatting ) override { return * this; }
+
+    virtual int axisPrecision( int ) override { return 0; }
+
+    virtual Me & setAxisPrecision( int, int ) override { return * this; }
+
+    virtual bool toWorld( const VD & pixel, VD & world ) const override { world = pixel; return true; }
+
+    virtual bool toPixel( const VD & world, VD & pixel ) const override { pixel = world; return true; }
+
+private:
+
+    std::vector < AxisInfo > m_axisInfos;
+};
+
+/// metadata with nothing but a coordinate formatter
+class FormatterMetaData : public Carta::Lib::Image::MetaDataInterface
+{
+public:
+
+    FormatterMetaData( CoordinateFormatterInterface::SharedPtr cf )
+        : m_cf( cf )
+    { }
+
+    virtual MetaDataInterface * clone() override { return new FormatterMetaData( * this ); }
+
+    virtual CoordinateFormatterInterface::SharedPtr coordinateFormatter() override { return m_cf; }
+
+    virtual PlotLabelGeneratorInterface::SharedPtr plotLabelGenerator() override { return nullptr; }
+
+    virtual QString title( TextFormat ) override { return QString(); }
+
+    virtual QStringList otherInfo( TextFormat ) override { return QStringList(); }
+
+private:
+
+    CoordinateFormatterInterface::SharedPtr m_cf;
+};
+
+static ImagePtr
+makeImage( const std::vector < int > & dims, const std::vector < float > & values,
+           Carta::Lib::Image::MetaDataInterface::SharedPtr metaData = nullptr )
+{
+    auto data = std::make_shared < std::vector < float > > ( values );
+    return std::make_shared < MemoryImage > ( dims, data, "Jy", metaData );
+}
+
+static RegionInfo
+makeBox( double left, double top, double right, double bottom )
+{
+    RegionInfo region;
+    region.setRegionType( RegionInfo::RegionType::Polygon );
+    region.setCorners( { { left, top }, { right, bottom } } );
+    return region;
+}
+
+static std::string
+findStat( const QList < StatInfo > & stats, StatInfo::StatType type )
+{
+    for ( const StatInfo & info : stats ) {
+        if ( info.getType() == type ) {
+            return info.getValue().toStdString();
+        }
+    }
+    return std::string();
+}
+
+TEST_CASE( "RunningStatistics testing", "[statistics]" ) {
+    const std::vector < double > values = { 4, 7, 13, 16, 1, 16, 8 };
+    RunningStatistics all;
+    for ( size_t i = 0 ; i < values.size() ; ++i ) {
+        all.add( values[i], i );
+    }
+
+    SECTION( "one set of values") {
+        REQUIRE( all.count == 7 );
+        REQUIRE( all.sum == Approx( 65 ) );
+        REQUIRE( all.sumSquares == Approx( 811 ) );
+        REQUIRE( all.mean == Approx( 65.0 / 7 ) );
+        REQUIRE( all.sigma() == Approx( std::sqrt( ( 811 - 65.0 * 65 / 7 ) / 6 ) ) );
+        REQUIRE( all.rms() == Approx( std::sqrt( 811.0 / 7 ) ) );
+        REQUIRE( all.min == 1 );
+        REQUIRE( all.minIndex == 4 );
+
+        // the first of equal maxima is kept
+        REQUIRE( all.max == 16 );
+        REQUIRE( all.maxIndex == 3 );
+    }
+
+    SECTION( "NaN values are ignored") {
+        RunningStatistics withNan = all;
+        withNan.add( std::numeric_limits < double >::quiet_NaN(), 100 );
+        REQUIRE( withNan.count == all.count );
+        REQUIRE( withNan.mean == all.mean );
+        REQUIRE( withNan.m2 == all.m2 );
+    }
+
+    SECTION( "merged parts match one pass") {
+        for ( size_t split = 0 ; split <= values.size() ; ++split ) {
+            RunningStatistics first, second;
+            for ( size_t i = 0 ; i < values.size() ; ++i ) {
+                ( i < split ? first : second ).add( values[i], i );
+            }
+            first.merge( second );
+            REQUIRE( first.count == all.count );
+            REQUIRE( first.sum == Approx( all.sum ) );
+            REQUIRE( first.mean == Approx( all.mean ) );
+            REQUIRE( first.sigma() == Approx( all.sigma() ) );
+            REQUIRE( first.min == all.min );
+            REQUIRE( first.minIndex == all.minIndex );
+            REQUIRE( first.max == all.max );
+            REQUIRE( first.maxIndex == all.maxIndex );
+        }
+    }
+
+    SECTION( "variance of values far from zero") {
+        // the sum of squares loses these deviations entirely
+        const double offset = 1e9;
+        RunningStatistics first, second;
+        for ( size_t i = 0 ; i < values.size() ; ++i ) {
+            ( i % 2 ? first : second ).add( offset + values[i], i );
+        }
+        first.merge( second );
+        REQUIRE( first.mean == Approx( offset + all.mean ) );
+        REQUIRE( first.sigma() == Approx( all.sigma() ) );
+    }
+
+    SECTION( "too few values") {
+        RunningStatistics empty;
+        REQUIRE( std::isnan( empty.sigma() ) );
+        REQUIRE( std::isnan( empty.rms() ) );
+        REQUIRE( empty.minIndex == - 1 );
+
+        RunningStatistics one;
+        one.add( 3, 0 );
+        REQUIRE( std::isnan( one.sigma() ) );
+        REQUIRE( one.rms() == 3 );
+
+        one.merge( empty );
+        REQUIRE( one.count == 1 );
+        empty.merge( one );
+        REQUIRE( empty.count == 1 );
+        REQUIRE( empty.mean == 3 );
+    }
+}
+
+TEST_CASE( "RegionStatisticsEngine testing", "[statistics]" ) {
+    const float nan = std::numeric_limits < float >::quiet_NaN();
+
+    // a 4x3 plane where each pixel is x + 4y
+    std::vector < float > values( 12 );
+    for ( int i = 0 ; i < 12 ; ++i ) {
+        values[i] = i;
+    }
+    ImagePtr image = makeImage( { 4, 3 }, values );
+
+    SECTION( "rectangle") {
+        RegionStatisticsEngine engine( image, { 0, 0 }, nullptr );
+        REQUIRE( engine.isSupported() );
+        engine.setQuantiles( { 0.5 } );
+        auto stats = engine.compute( { makeBox( 1, 0, 2, 1 ) } );
+        REQUIRE( stats.size() == 1 );
+
+        // pixels 1, 2, 5 and 6
+        REQUIRE( stats[0].count == 4 );
+        REQUIRE( stats[0].sum == Approx( 14 ) );
+        REQUIRE( stats[0].sumSquares == Approx( 66 ) );
+        REQUIRE( stats[0].mean == Approx( 3.5 ) );
+        REQUIRE( stats[0].sigma == Approx( std::sqrt( 17.0 / 3 ) ) );
+        REQUIRE( stats[0].rms == Approx( std::sqrt( 16.5 ) ) );
+        REQUIRE( stats[0].min == 1 );
+        REQUIRE( stats[0].max == 6 );
+        REQUIRE( stats[0].minPos == std::vector < int > ( { 1, 0 } ) );
+        REQUIRE( stats[0].maxPos == std::vector < int > ( { 2, 1 } ) );
+        REQUIRE( stats[0].blc == std::vector < int > ( { 1, 0 } ) );
+        REQUIRE( stats[0].trc == std::vector < int > ( { 2, 1 } ) );
+        REQUIRE( stats[0].quantiles[0] == 5 );
+
+        // there are no world coordinates without a coordinate system
+        REQUIRE( stats[0].blcWorld.isEmpty() );
+        QList < StatInfo > infos = RegionStatisticsEngine::toStatInfo( stats[0], makeBox( 1, 0, 2, 1 ), 2 );
+        REQUIRE( findStat( infos, StatInfo::StatType::FrameCount ) == "4" );
+        REQUIRE( findStat( infos, StatInfo::StatType::FluxDensity ) == "7" );
+        REQUIRE( findStat( infos, StatInfo::StatType::MinPos ) == "[1, 0]" );
+        REQUIRE( findStat( infos, StatInfo::StatType::Name ) == "Polygon:[1, 0] x [2, 1]" );
+        REQUIRE( findStat( infos, StatInfo::StatType::Blcf ).empty() );
+        REQUIRE( findStat( infos, StatInfo::StatType::MinPosf ).empty() );
+    }
+
+    SECTION( "NaN pixels and regions without pixels") {
+        std::vector < float > withNan = values;
+        withNan[1] = nan;
+        withNan[6] = nan;
+        RegionStatisticsEngine engine( makeImage( { 4, 3 }, withNan ), { 0, 0 }, nullptr );
+        auto stats = engine.compute( { makeBox( 1, 0, 2, 1 ), makeBox( 20, 20, 30, 30 ) } );
+        REQUIRE( stats.size() == 2 );
+        REQUIRE( stats[0].count == 2 );
+        REQUIRE( stats[0].mean == Approx( 3.5 ) );
+        REQUIRE( stats[0].minPos == std::vector < int > ( { 2, 0 } ) );
+        REQUIRE( stats[0].maxPos == std::vector < int > ( { 1, 1 } ) );
+        REQUIRE( stats[1].count == 0 );
+        REQUIRE( stats[1].blc.empty() );
+        REQUIRE( std::isnan( stats[1].mean ) );
+        REQUIRE( RegionStatisticsEngine::toStatInfo( stats[1], makeBox( 20, 20, 30, 30 ), 0 ).size() == 1 );
+    }
+
+    SECTION( "frame indices outside the image") {
+        RegionStatisticsEngine engine( makeImage( { 4, 3, 2 }, std::vector < float > ( 24, 1 ) ), { 0, 0, 2 }, nullptr );
+        REQUIRE( ! engine.isSupported() );
+        REQUIRE( engine.compute( { makeBox( 1, 0, 2, 1 ) } )[0].count == 0 );
+        REQUIRE( ! RegionStatisticsEngine( image, { 0 }, nullptr ).isSupported() );
+    }
+}
+
+TEST_CASE( "RegionStatisticsEngine direction axes", "[statistics]" ) {
+    typedef AxisInfo::KnownType KnownType;
+
+    // two channels, with the direction axes after the spectral axis; each pixel
+    // is 100 * lat + 10 * lon + channel
+    auto makeCube = [] ( bool lonFirst ) {
+        std::vector < KnownType > types = { KnownType::SPECTRAL, KnownType::DIRECTION_LAT, KnownType::DIRECTION_LON };
+        std::vector < int > dims = { 2, 3, 4 };
+        if ( lonFirst ) {
+            std::swap( types[1], types[2] );
+            std::swap( dims[1], dims[2] );
+        }
+        std::vector < float > values;
+        for ( int k = 0 ; k < dims[2] ; ++k ) {
+            for ( int j = 0 ; j < dims[1] ; ++j ) {
+                for ( int c = 0 ; c < dims[0] ; ++c ) {
+                    int lon = lonFirst ? j : k;
+                    int lat = lonFirst ? k : j;
+                    values.push_back( 100 * lat + 10 * lon + c );
+                }
+            }
+        }
+        auto cf = std::make_shared < AxisTypeFormatter > ( types );
+        return makeImage( dims, values, std::make_shared < FormatterMetaData > ( cf ) );
+    };
+
+    auto check = [&makeCube] ( bool lonFirst ) {
+        int lonAxis = lonFirst ? 1 : 2;
+        int latAxis = lonFirst ? 2 : 1;
+        // the engine gets its own copy of the formatter, as it does from the service
+        ImagePtr cube = makeCube( lonFirst );
+        std::shared_ptr < CoordinateFormatterInterface > formatter(
+            cube-> metaData()-> coordinateFormatter()-> clone() );
+        RegionStatisticsEngine engine( cube, { 1, 0, 0 }, formatter );
+        REQUIRE( engine.isSupported() );
+        REQUIRE( engine.getAxisX() == lonAxis );
+        REQUIRE( engine.getAxisY() == latAxis );
+
+        // longitude 1 to 3, latitude 0 to 1, channel 1
+        RegionInfo box = makeBox( 1, 0, 3, 1 );
+        auto stats = engine.compute( { box } );
+        REQUIRE( stats[0].count == 6 );
+        REQUIRE( stats[0].sum == Approx( 6 * ( 50 + 20 + 1 ) ) );
+        REQUIRE( stats[0].min == 11 );
+        REQUIRE( stats[0].max == 131 );
+
+        std::vector < int > minPos = { 1, 0, 0 };
+        minPos[lonAxis] = 1;
+        std::vector < int > maxPos = { 1, 0, 0 };
+        maxPos[lonAxis] = 3;
+        maxPos[latAxis] = 1;
+        REQUIRE( stats[0].minPos == minPos );
+        REQUIRE( stats[0].maxPos == maxPos );
+        REQUIRE( stats[0].blc == minPos );
+        REQUIRE( stats[0].trc == maxPos );
+
+        std::string minPosWorld = lonFirst ? "1, 1, 0" : "1, 0, 1";
+        std::string maxPosWorld = lonFirst ? "1, 3, 1" : "1, 1, 3";
+        QList < StatInfo > infos = RegionStatisticsEngine::toStatInfo( stats[0], box, 0 );
+        REQUIRE( findStat( infos, StatInfo::StatType::Blcf ) == minPosWorld );
+        REQUIRE( findStat( infos, StatInfo::StatType::Trcf ) == maxPosWorld );
+        REQUIRE( findStat( infos, StatInfo::StatType::MinPosf ) == minPosWorld );
+        REQUIRE( findStat( infos, StatInfo::StatType::MaxPosf ) == maxPosWorld );
+    };
+
+    SECTION( "longitude before latitude") {
+        check( true );
+    }
+
+    SECTION( "latitude before longitude") {
+        check( false );
+    }
+}
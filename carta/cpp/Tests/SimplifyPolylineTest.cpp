@@ -0,0 +1,117 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/Algorithms/SimplifyPolyline.h"
+#include <cmath>
+
+using Carta::Lib::Algorithms::simplifyPolyline;
+
+/// distance from p to the segment a-b
+static double
+distance( const QPointF & p, const QPointF & a, const QPointF & b )
+{
+    double dx = b.x() - a.x();
+    double dy = b.y() - a.y();
+    double lengthSq = dx * dx + dy * dy;
+    double t = 0;
+    if ( lengthSq > 0 ) {
+        t = ( ( p.x() - a.x() ) * dx + ( p.y() - a.y() ) * dy ) / lengthSq;
+        t = std::max( 0.0, std::min( 1.0, t ) );
+    }
+    return std::hypot( a.x() + t * dx - p.x(), a.y() + t * dy - p.y() );
+}
+
+/// largest distance of a vertex of poly from the part of simple that replaces it,
+/// or -1 if simple is not made of vertices of poly in their original order
+static double
+largestError( const QPolygonF & poly, const QPolygonF & simple )
+{
+    double largest = 0;
+    int kept = 0;
+    for ( int i = 0 ; i < poly.size() ; ++i ) {
+        if ( kept < simple.size() && poly[i] == simple[kept] ) {
+            kept++;
+            continue;
+        }
+        if ( kept == 0 || kept == simple.size() ) {
+            return - 1;
+        }
+        largest = std::max( largest, distance( poly[i], simple[kept - 1], simple[kept] ) );
+    }
+    return kept == simple.size() ? largest : - 1;
+}
+
+TEST_CASE( "Polyline simplification testing", "[polyline]" ) {
+
+    SECTION( "collinear vertices are removed") {
+        QPolygonF line;
+        line << QPointF( 0, 0 ) << QPointF( 1, 0 ) << QPointF( 2, 0 ) << QPointF( 3, 0 );
+        QPolygonF expected;
+        expected << QPointF( 0, 0 ) << QPointF( 3, 0 );
+        REQUIRE( simplifyPolyline( line, 0.1 ) == expected );
+    }
+
+    SECTION( "vertices are removed only within the tolerance") {
+        QPolygonF near;
+        near << QPointF( 0, 0 ) << QPointF( 1, 0.05 ) << QPointF( 2, 0 );
+        REQUIRE( simplifyPolyline( near, 0.1 ).size() == 2 );
+
+        QPolygonF far;
+        far << QPointF( 0, 0 ) << QPointF( 1, 0.5 ) << QPointF( 2, 0 );
+        REQUIRE( simplifyPolyline( far, 0.1 ) == far );
+    }
+
+    SECTION( "end points are kept") {
+        QPolygonF hook;
+        hook << QPointF( 0, 0 ) << QPointF( 0.01, 0 ) << QPointF( 5, 0 ) << QPointF( 5, 0.01 );
+        QPolygonF simple = simplifyPolyline( hook, 0.1 );
+        REQUIRE( simple.size() == 2 );
+        REQUIRE( simple.first() == hook.first() );
+        REQUIRE( simple.last() == hook.last() );
+    }
+
+    SECTION( "closed polylines stay closed") {
+        // a square with a vertex in the middle of each side
+        QPolygonF square;
+        square << QPointF( 0, 0 ) << QPointF( 1, 0 ) << QPointF( 2, 0 ) << QPointF( 2, 1 )
+               << QPointF( 2, 2 ) << QPointF( 1, 2 ) << QPointF( 0, 2 ) << QPointF( 0, 1 )
+               << QPointF( 0, 0 );
+        QPolygonF expected;
+        expected << QPointF( 0, 0 ) << QPointF( 2, 0 ) << QPointF( 2, 2 ) << QPointF( 0, 2 )
+                 << QPointF( 0, 0 );
+        REQUIRE( simplifyPolyline( square, 0.1 ) == expected );
+
+        // even when the whole loop is within the tolerance
+        QPolygonF small;
+        small << QPointF( 0, 0 ) << QPointF( 0.01, 0 ) << QPointF( 0, 0.01 ) << QPointF( 0, 0 );
+        QPolygonF simple = simplifyPolyline( small, 1 );
+        REQUIRE( simple.size() >= 3 );
+        REQUIRE( simple.isClosed() );
+    }
+
+    SECTION( "short polylines and no tolerance") {
+        QPolygonF pair;
+        pair << QPointF( 0, 0 ) << QPointF( 1, 1 );
+        REQUIRE( simplifyPolyline( pair, 1 ) == pair );
+
+        QPolygonF line;
+        line << QPointF( 0, 0 ) << QPointF( 1, 0 ) << QPointF( 2, 0 );
+        REQUIRE( simplifyPolyline( line, 0 ) == line );
+    }
+
+    SECTION( "long polylines stay within the tolerance") {
+        QPolygonF wave;
+        for ( int i = 0 ; i < 100000 ; ++i ) {
+            wave << QPointF( i * 0.01, std::sin( i * 0.001 ) + 0.01 * std::sin( i * 0.7 ) );
+        }
+        for ( double tolerance : { 0.001, 0.01, 0.1 } ) {
+            QPolygonF simple = simplifyPolyline( wave, tolerance );
+            REQUIRE( simple.size() < wave.size() );
+            double error = largestError( wave, simple );
+            REQUIRE( error >= 0 );
+            REQUIRE( error <= tolerance );
+        }
+    }
+}
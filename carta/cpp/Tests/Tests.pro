@@ -11,7 +11,19 @@ SOURCES += \
     SliceTester.cpp \
     StateTester.cpp \
     pixelPipelineTest.cpp \
-    LineCombinerTest.cpp
+    LineCombinerTest.cpp \
+    MarchingSquaresTest.cpp \
+    VGListTest.cpp \
+    CoordinateMeshTest.cpp \
+    RegionSpansTest.cpp \
+    CollapseEngineTest.cpp \
+    PathSamplingTest.cpp \
+    HoverSpectrumExtractorTest.cpp \
+    RegionStatisticsEngineTest.cpp \
+    SimplifyPolylineTest.cpp \
+    HistogramAlgorithmsTest.cpp \
+    HistogramResultTest.cpp \
+    ContourConrecTest.cpp
 
 #CONFIG += precompile_header
 #PRECOMPILED_HEADER = catch.h
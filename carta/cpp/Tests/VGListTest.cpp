@@ -0,0 +1,98 @@
+/**
+ *
+ **/
+
+#include "catch.h"
+#include "../CartaLib/VectorGraphics/VGList.h"
+
+using namespace Carta::Lib::VectorGraphics;
+namespace VGE = Entries;
+
+static QPolygonF
+makePolyline( int count )
+{
+    QPolygonF poly;
+    for ( int i = 0 ; i < count ; ++i ) {
+        poly << QPointF( i, i * 0.5 );
+    }
+    return poly;
+}
+
+TEST_CASE( "VGList command buffer testing", "[vg]" ) {
+
+    SECTION( "appending a list renumbers its pens and texts") {
+        VGComposer first;
+        first.append < VGE::SetPen > ( QPen( QColor( "red" ) ) );
+        first.append < VGE::DrawPolyline > ( makePolyline( 4 ) );
+        VGComposer second;
+        second.append < VGE::SetPen > ( QPen( QColor( "blue" ) ) );
+        second.append < VGE::DrawText > ( "label", QPointF( 1, 2 ) );
+        first.appendList( second.vgList() );
+
+        VGComposer all;
+        all.append < VGE::SetPen > ( QPen( QColor( "red" ) ) );
+        all.append < VGE::DrawPolyline > ( makePolyline( 4 ) );
+        all.append < VGE::SetPen > ( QPen( QColor( "blue" ) ) );
+        all.append < VGE::DrawText > ( "label", QPointF( 1, 2 ) );
+        REQUIRE( first.vgList().size() == 4 );
+        REQUIRE( first.vgList().serialize() == all.vgList().serialize() );
+    }
+
+    SECTION( "replacing an entry of a different size") {
+        VGComposer vgc;
+        int64_t ind = vgc.append < VGE::DrawPolyline > ( makePolyline( 3 ) );
+        vgc.append < VGE::SetIndexedPen > ( 1 );
+        vgc.set < VGE::DrawPolyline > ( ind, makePolyline( 5 ) );
+
+        VGComposer expected;
+        expected.append < VGE::DrawPolyline > ( makePolyline( 5 ) );
+        expected.append < VGE::SetIndexedPen > ( 1 );
+        REQUIRE( vgc.vgList().size() == 2 );
+        REQUIRE( vgc.vgList().serialize() == expected.vgList().serialize() );
+    }
+
+    SECTION( "serialization round trip") {
+        VGComposer vgc;
+        vgc.append < VGE::Reset > ();
+        vgc.append < VGE::StoreIndexedPen > ( 0, QPen( QColor( 1, 2, 3, 4 ), 2.5 ) );
+        vgc.append < VGE::SetIndexedPen > ( 0 );
+        vgc.append < VGE::SetTransform > ( QTransform().scale( 2, 3 ), true );
+        vgc.append < VGE::FillRect > ( QRectF( 1, 2, 3, 4 ), QColor( "green" ) );
+        vgc.append < VGE::DrawPolyline > ( makePolyline( 10 ) );
+        QByteArray data = vgc.vgList().serialize();
+
+        bool ok = false;
+        VGList copy = VGList::deserialize( data, & ok );
+        REQUIRE( ok );
+        REQUIRE( copy.size() == vgc.vgList().size() );
+        REQUIRE( copy.serialize() == data );
+
+        VGList truncated = VGList::deserialize( data.left( data.size() / 2 ), & ok );
+        REQUIRE( ! ok );
+        REQUIRE( truncated.size() == 0 );
+    }
+
+    SECTION( "culling to a viewport") {
+        VGComposer vgc;
+        vgc.append < VGE::SetPen > ( QPen( QColor( "red" ) ) );
+        vgc.append < VGE::DrawPolyline > ( QPolygonF() << QPointF( 10, 10 ) << QPointF( 20, 20 ) );
+        vgc.append < VGE::DrawPolyline > ( QPolygonF() << QPointF( 500, 500 ) << QPointF( 600, 600 ) );
+        vgc.append < VGE::DrawPolyline > ( QPolygonF() << QPointF( 50, 50 ) << QPointF( 60, 50 )
+                                                       << QPointF( 300, 50 ) << QPointF( 400, 50 ) );
+        VGList list = vgc.vgList();
+        list.buildIndex( 2 );
+
+        VGComposer expected;
+        expected.append < VGE::SetPen > ( QPen( QColor( "red" ) ) );
+        expected.append < VGE::DrawPolyline > ( QPolygonF() << QPointF( 10, 10 ) << QPointF( 20, 20 ) );
+        expected.append < VGE::DrawPolyline > ( QPolygonF() << QPointF( 50, 50 ) << QPointF( 60, 50 )
+                                                            << QPointF( 300, 50 ) );
+        QRectF viewport( 0, 0, 100, 100 );
+        REQUIRE( list.culled( viewport ).serialize() == expected.vgList().serialize() );
+        REQUIRE( list.serialize( viewport ) == expected.vgList().serialize() );
+
+        // under a transform that moves everything away, nothing is drawn
+        VGList moved = list.culled( viewport, QTransform().translate( 1000, 0 ) );
+        REQUIRE( moved.size() == 1 );
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * Helpers for reading pixel data through the bulk accessor of raw views, rather
+ * than pixel by pixel.
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include "CartaLib/IImage.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Carta
+{
+namespace Core
+{
+namespace Algorithms
+{
+/// default number of pixels handed out per chunk by forEachChunk()
+static const int64_t BULK_CHUNK_PIXELS = 1 << 20;
+
+/// visit the view one chunk at a time, with the pixels converted to Scalar
+/// \param view the view to read
+/// \param func called with a pointer to the converted pixels and their count
+/// \param chunkPixels maximum number of pixels per chunk
+///
+/// \note pixels arrive in sequential order, so the position of a pixel in the view
+/// is the running total of the counts seen so far
+template < typename Scalar >
+void
+forEachChunk( Carta::Lib::NdArray::RawViewInterface * view,
+              const std::function < void (const Scalar *, int64_t) > & func,
+              int64_t chunkPixels = BULK_CHUNK_PIXELS )
+{
+    CARTA_ASSERT( view );
+    Carta::Lib::Image::PixelType pixelType = view-> pixelType();
+    size_t pixelSize = Carta::Lib::Image::pixelType2size( pixelType );
+    if ( pixelType == Carta::Lib::Image::CType2PixelType < Scalar >::type ) {
+        view-> forEach( chunkPixels * pixelSize, [& func] ( const char * data, int64_t count ) {
+            func( reinterpret_cast < const Scalar * > ( data ), count );
+        });
+    }
+    else {
+        auto cvt = Carta::Lib::getConverter < Scalar > ( pixelType );
+        CARTA_ASSERT( cvt );
+        std::vector < Scalar > converted;
+        view-> forEach( chunkPixels * pixelSize,
+                        [& func, & converted, cvt, pixelSize] ( const char * data, int64_t count ) {
+            converted.resize( count );
+            for ( int64_t i = 0 ; i < count ; i++ ) {
+                converted[i] = cvt( data + i * pixelSize );
+            }
+            func( converted.data(), count );
+        });
+    }
+}
+
+/// read the whole view into memory through the bulk accessor
+/// \param view the view to read
+/// \return the pixels of the view in sequential order
+template < typename Scalar >
+std::vector < Scalar >
+readAll( Carta::Lib::NdArray::RawViewInterface * view )
+{
+    std::vector < Scalar > values;
+    int64_t total = 1;
+    for ( int dim : view-> dims() ) {
+        total *= dim;
+    }
+    values.reserve( total );
+    forEachChunk < Scalar > ( view, [& values] ( const Scalar * data, int64_t count ) {
+        values.insert( values.end(), data, data + count );
+    });
+    return values;
+}
+}
+}
+}
@@ -0,0 +1,79 @@
+/**
+ * Helpers for working with histograms that have already been computed.
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Carta
+{
+namespace Core
+{
+namespace Algorithms
+{
+/// redistribute the counts of a histogram onto a different set of equal width bins
+/// \param counts counts of the source histogram
+/// \param countSize number of bins in the source histogram
+/// \param minValue lower edge of the first source bin
+/// \param maxValue upper edge of the last source bin
+/// \param binCount number of bins in the result
+/// \param newMinValue lower edge of the first result bin
+/// \param newMaxValue upper edge of the last result bin
+/// \return the counts of the result bins, which are whole numbers
+///
+/// \note the pixels of a source bin are assumed to be spread evenly over the bin, so
+/// a source bin that straddles an edge of the result bins contributes to each of them
+/// in proportion to the overlap; this is exact when every result edge falls on a
+/// source edge. Otherwise the running total is rounded, so no pixels are gained or
+/// lost and a result covering the source range has the same total as the source.
+template < typename Count >
+std::vector < double >
+rebinHistogram( const Count * counts, int countSize, double minValue, double maxValue,
+                int binCount, double newMinValue, double newMaxValue )
+{
+    std::vector < double > result( std::max( binCount, 0 ), 0 );
+    if ( countSize <= 0 || binCount <= 0 || ! ( maxValue > minValue ) ||
+         ! ( newMaxValue > newMinValue ) ) {
+        return result;
+    }
+    double width = ( maxValue - minValue ) / countSize;
+    double newWidth = ( newMaxValue - newMinValue ) / binCount;
+    for ( int i = 0 ; i < countSize ; i++ ) {
+        if ( counts[i] == 0 ) {
+            continue;
+        }
+        double low = std::max( minValue + i * width, newMinValue );
+        double high = std::min( minValue + ( i + 1 ) * width, newMaxValue );
+        if ( low >= high ) {
+            continue;
+        }
+        int first = std::max( 0, static_cast < int > ( ( low - newMinValue ) / newWidth ) );
+        int last = std::min( binCount - 1, static_cast < int > ( ( high - newMinValue ) / newWidth ) );
+        double density = counts[i] / width;
+        for ( int j = first ; j <= last ; j++ ) {
+            double overlap = std::min( high, newMinValue + ( j + 1 ) * newWidth ) -
+                             std::max( low, newMinValue + j * newWidth );
+            if ( overlap > 0 ) {
+                result[j] += density * overlap;
+            }
+        }
+    }
+
+    // round the running total rather than each bin so the fractions do not add up
+    // to pixels that were never there
+    double total = 0;
+    double roundedTotal = 0;
+    for ( int j = 0 ; j < binCount ; j++ ) {
+        total += result[j];
+        double rounded = std::round( total );
+        result[j] = rounded - roundedTotal;
+        roundedTotal = rounded;
+    }
+    return result;
+}
+}
+}
+}
@@ -0,0 +1,75 @@
+/**
+ * Helpers for splitting work on large arrays between the threads of the global
+ * thread pool.
+ **/
+
+#pragma once
+
+#include "CartaLib/CartaLib.h"
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Carta
+{
+namespace Core
+{
+namespace Algorithms
+{
+/// a contiguous range [begin,end) of indices handed to one thread
+struct IndexRange {
+    int64_t begin;
+    int64_t end;
+    int part;
+};
+
+/// split [0,count) into contiguous ranges
+/// \param count number of items
+/// \param minRangeSize smallest range worth giving to a separate thread
+/// \return at most QThread::idealThreadCount() ranges covering [0,count) in order
+inline std::vector < IndexRange >
+splitRanges( int64_t count, int64_t minRangeSize )
+{
+    std::vector < IndexRange > ranges;
+    if ( count <= 0 ) {
+        return ranges;
+    }
+    int64_t maxParts = std::max( 1, QThread::idealThreadCount() );
+    int64_t parts = Carta::Lib::clamp < int64_t > ( count / std::max < int64_t > ( minRangeSize, 1 ),
+                                                     1, maxParts );
+    int64_t step = ( count + parts - 1 ) / parts;
+    for ( int64_t begin = 0 ; begin < count ; begin += step ) {
+        ranges.push_back( { begin, std::min( begin + step, count ), int( ranges.size() ) } );
+    }
+    return ranges;
+}
+
+/// run func on contiguous sub-ranges of [0,count) using the global thread pool
+/// and wait for all of them to finish
+/// \param count number of items
+/// \param minRangeSize smallest range worth giving to a separate thread
+/// \param func called as func(begin, end, part), where part is the index of the range
+/// \return the number of ranges used, i.e. one more than the largest part passed to func
+///
+/// \note small inputs are processed directly on the calling thread
+inline int
+parallelRanges( int64_t count, int64_t minRangeSize,
+                const std::function < void (int64_t, int64_t, int) > & func )
+{
+    std::vector < IndexRange > ranges = splitRanges( count, minRangeSize );
+    if ( ranges.size() == 1 ) {
+        func( ranges[0].begin, ranges[0].end, 0 );
+    }
+    else if ( ranges.size() > 1 ) {
+        QtConcurrent::blockingMap( ranges, [& func] ( IndexRange & range ) {
+            func( range.begin, range.end, range.part );
+        });
+    }
+    return ranges.size();
+}
+}
+}
+}
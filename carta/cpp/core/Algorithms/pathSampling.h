@@ -0,0 +1,167 @@
+/**
+ * Helpers for sampling an image plane along a line or polyline, with bilinear
+ * interpolation and averaging across the width of the path.
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Carta
+{
+namespace Core
+{
+namespace Algorithms
+{
+/// a point on a path, with the unit direction of the path at that point
+struct PathSample {
+    double x;
+    double y;
+    double dx;
+    double dy;
+};
+
+/// place samples at equal distances along a polyline
+/// \param vertices the vertices of the polyline in pixel coordinates
+/// \param spacing the distance between consecutive samples, in pixels
+/// \return samples at distances 0, spacing, 2*spacing, ... up to the length of the path;
+/// a single vertex yields a single sample
+inline std::vector < PathSample >
+samplePolyline( const std::vector < std::pair < double, double > > & vertices, double spacing = 1.0 )
+{
+    std::vector < PathSample > samples;
+    if ( vertices.empty() || ! ( spacing > 0 ) ) {
+        return samples;
+    }
+    if ( vertices.size() == 1 ) {
+        samples.push_back( { vertices[0].first, vertices[0].second, 1, 0 } );
+        return samples;
+    }
+
+    // distance along the path to the next sample, measured from the start of the segment
+    double next = 0;
+    PathSample last { vertices[0].first, vertices[0].second, 1, 0 };
+    for ( size_t i = 0 ; i + 1 < vertices.size() ; i++ ) {
+        double x0 = vertices[i].first;
+        double y0 = vertices[i].second;
+        double segX = vertices[i + 1].first - x0;
+        double segY = vertices[i + 1].second - y0;
+        double length = std::hypot( segX, segY );
+        if ( length <= 0 ) {
+            continue;
+        }
+        double dx = segX / length;
+        double dy = segY / length;
+        last = { vertices[i + 1].first, vertices[i + 1].second, dx, dy };
+        for ( ; next <= length ; next += spacing ) {
+            samples.push_back( { x0 + next * dx, y0 + next * dy, dx, dy } );
+        }
+        next -= length;
+    }
+    if ( samples.empty() ) {
+        // every vertex was at the same place
+        samples.push_back( last );
+    }
+    return samples;
+}
+
+/// bilinear interpolation in a plane, with pixel centers at integer coordinates
+/// \param plane the pixels of the plane, row by row
+/// \param width the number of pixels in a row
+/// \param height the number of rows
+/// \param x the column coordinate
+/// \param y the row coordinate
+/// \return the interpolated value, or NaN outside the plane or next to a NaN pixel
+inline double
+interpolateBilinear( const float * plane, int64_t width, int64_t height, double x, double y )
+{
+    const double nan = std::numeric_limits < double >::quiet_NaN();
+    if ( ! ( x >= 0 && y >= 0 && x <= width - 1 && y <= height - 1 ) ) {
+        return nan;
+    }
+    int64_t x0 = std::min < int64_t > ( std::floor( x ), width - 1 );
+    int64_t y0 = std::min < int64_t > ( std::floor( y ), height - 1 );
+    int64_t x1 = std::min < int64_t > ( x0 + 1, width - 1 );
+    int64_t y1 = std::min < int64_t > ( y0 + 1, height - 1 );
+    double fx = x - x0;
+    double fy = y - y0;
+    double v00 = plane[y0 * width + x0];
+    double v10 = plane[y0 * width + x1];
+    double v01 = plane[y1 * width + x0];
+    double v11 = plane[y1 * width + x1];
+
+    // pixels with no weight do not spoil the result
+    if ( fx == 0 ) {
+        v10 = v00;
+        v11 = v01;
+    }
+    if ( fy == 0 ) {
+        v01 = v00;
+        v11 = v10;
+    }
+    return ( v00 * ( 1 - fx ) + v10 * fx ) * ( 1 - fy ) + ( v01 * ( 1 - fx ) + v11 * fx ) * fy;
+}
+
+/// the mean of the interpolated values across the path at one sample
+/// \param plane the pixels of the plane, row by row
+/// \param width the number of pixels in a row
+/// \param height the number of rows
+/// \param sample the sample, in coordinates of the plane
+/// \param halfWidth values are averaged at unit steps up to this distance on each
+/// side of the path
+/// \return the mean of the valid values, or NaN if there were none
+inline double
+sampleAcross( const float * plane, int64_t width, int64_t height, const PathSample & sample,
+              double halfWidth )
+{
+    int steps = std::max( 0, int ( std::floor( halfWidth ) ) );
+    double sum = 0;
+    int count = 0;
+    for ( int i = - steps ; i <= steps ; i++ ) {
+        // the normal of the path is its direction turned by a right angle
+        double value = interpolateBilinear( plane, width, height,
+                                            sample.x - i * sample.dy, sample.y + i * sample.dx );
+        if ( std::isfinite( value ) ) {
+            sum += value;
+            count++;
+        }
+    }
+    return count > 0 ? sum / count : std::numeric_limits < double >::quiet_NaN();
+}
+
+/// the pixel rectangle needed to sample a path
+/// \param samples the samples of the path
+/// \param halfWidth the distance on each side of the path that is averaged
+/// \param width the number of pixels in a row of the plane
+/// \param height the number of rows of the plane
+/// \param box set to the left, top, right and bottom pixel of the rectangle, inclusive
+/// \return false if the path does not touch the plane
+inline bool
+pathBounds( const std::vector < PathSample > & samples, double halfWidth, int64_t width,
+            int64_t height, int64_t box[4] )
+{
+    if ( samples.empty() || width <= 0 || height <= 0 ) {
+        return false;
+    }
+    double reach = std::max( 0.0, std::floor( halfWidth ) );
+    double left = samples[0].x, right = left, top = samples[0].y, bottom = top;
+    for ( const PathSample & sample : samples ) {
+        left = std::min( left, sample.x );
+        right = std::max( right, sample.x );
+        top = std::min( top, sample.y );
+        bottom = std::max( bottom, sample.y );
+    }
+    box[0] = std::max < int64_t > ( 0, std::floor( left - reach ) );
+    box[1] = std::max < int64_t > ( 0, std::floor( top - reach ) );
+    box[2] = std::min < int64_t > ( width - 1, std::ceil( right + reach ) );
+    box[3] = std::min < int64_t > ( height - 1, std::ceil( bottom + reach ) );
+    return box[0] <= box[2] && box[1] <= box[3];
+}
+}
+}
+}
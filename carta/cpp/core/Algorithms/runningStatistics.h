@@ -0,0 +1,113 @@
+/**
+ * Single pass statistics that can be accumulated on several threads and merged.
+ **/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace Carta
+{
+namespace Core
+{
+namespace Algorithms
+{
+/// running count, mean, spread and extremes of a set of values
+///
+/// The mean and the sum of squared deviations are updated with Welford's method,
+/// and partial results from different threads are combined with the pairwise
+/// formula of Chan et al., so the variance stays accurate for large sets of
+/// values far from zero.
+struct RunningStatistics {
+    int64_t count = 0;
+    double sum = 0;
+    double sumSquares = 0;
+    double mean = 0;
+    /// sum of squared deviations from the mean
+    double m2 = 0;
+    double min = std::numeric_limits < double >::quiet_NaN();
+    double max = std::numeric_limits < double >::quiet_NaN();
+    /// caller supplied index of the first minimum/maximum, or -1 if there are no values
+    int64_t minIndex = - 1;
+    int64_t maxIndex = - 1;
+
+    /// add one value
+    /// \param value the value; NaN values are ignored
+    /// \param index identifies where the value came from, for minIndex and maxIndex
+    void
+    add( double value, int64_t index )
+    {
+        if ( std::isnan( value ) ) {
+            return;
+        }
+        count++;
+        sum += value;
+        sumSquares += value * value;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * ( value - mean );
+        if ( count == 1 || value < min ) {
+            min = value;
+            minIndex = index;
+        }
+        if ( count == 1 || value > max ) {
+            max = value;
+            maxIndex = index;
+        }
+    }
+
+    /// combine with statistics of a different set of values
+    /// \note extremes that tie keep the index of this set, so merging partial
+    /// results in order keeps the first occurrence
+    void
+    merge( const RunningStatistics & other )
+    {
+        if ( other.count == 0 ) {
+            return;
+        }
+        if ( count == 0 ) {
+            * this = other;
+            return;
+        }
+        int64_t total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count = total;
+        sum += other.sum;
+        sumSquares += other.sumSquares;
+        if ( other.min < min ) {
+            min = other.min;
+            minIndex = other.minIndex;
+        }
+        if ( other.max > max ) {
+            max = other.max;
+            maxIndex = other.maxIndex;
+        }
+    }
+
+    /// sample standard deviation, or NaN for fewer than two values
+    double
+    sigma() const
+    {
+        if ( count < 2 ) {
+            return std::numeric_limits < double >::quiet_NaN();
+        }
+        return std::sqrt( m2 / ( count - 1 ) );
+    }
+
+    /// root mean square, or NaN if there are no values
+    double
+    rms() const
+    {
+        if ( count == 0 ) {
+            return std::numeric_limits < double >::quiet_NaN();
+        }
+        return std::sqrt( sumSquares / count );
+    }
+};
+}
+}
+}
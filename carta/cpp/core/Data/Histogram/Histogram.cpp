@@ -68,6 +68,7 @@ const QString Histogram::CLIP_MIN_PERCENT = "clipMinPercent";
 const QString Histogram::CLIP_MAX_PERCENT = "clipMaxPercent";
 const QString Histogram::SIZE_ALL_RESTRICT ="limitCubeSize";
 const QString Histogram::RESTRICT_SIZE_MAX = "cubeSizeMax";
+const QString Histogram::PROGRESS = "progress";
 
 Clips*  Histogram::m_clips = nullptr;
 PlotStyles* Histogram::m_graphStyles = nullptr;
@@ -142,6 +143,8 @@ QString Histogram::addLink( CartaObject*  target){
                         this, SLOT(_updateChannel(Controller*, Carta::Lib::AxisInfo::KnownType)));
                 connect(controller, SIGNAL(clipsChanged(double,double)),
                         this, SLOT(_updateColorClips(double,double)));
+                connect(controller, SIGNAL(dataChangedRegion(Controller*)),
+                        this, SLOT(_updateRegions(Controller*)));
                 m_controllerLinked = true;
                 _createHistogram( controller );
             }
@@ -402,6 +405,10 @@ void Histogram::_histogramRendered(const Carta::Lib::Hooks::HistogramResult& res
         hr->registerError( resultName );
     }
     else {
+        //Large selections are shown as they are scanned, so the histogram
+        //converges while the user watches.
+        m_stateData.setValue<double>( PROGRESS, result.getProgress() );
+        m_stateData.flushState();
         m_plotManager->addData( &result );
         m_plotManager->updatePlot();
         double freqLow = result.getFrequencyMin();
@@ -437,6 +444,8 @@ void Histogram::_initializeDefaultState(){
     m_stateData.insertValue<double>(CLIP_MAX_PERCENT, 100);
     m_stateData.insertValue<double>(PLANE_MIN, 0 );
     m_stateData.insertValue<double>(PLANE_MAX, 1 );
+    //Fraction of the selected data included in the displayed histogram.
+    m_stateData.insertValue<double>(PROGRESS, 1 );
     m_stateData.insertValue<int>(PLANE_CHANNEL, 0 );
     m_stateData.insertValue<int>(PLANE_CHANNEL_MAX, 0 );
     m_stateData.insertValue<bool>(PLANE_MODE_RANGE_VALID, true );
@@ -462,7 +471,9 @@ void Histogram::_initializeDefaultState(){
     m_state.insertValue<bool>(GRAPH_COLORED, false );
     m_state.insertValue<QString>(PLANE_MODE, PLANE_MODE_ALL );
     m_state.insertValue<QString>(FREQUENCY_UNIT, m_channelUnits->getDefaultUnit());
-    m_state.insertValue<bool>(SIZE_ALL_RESTRICT, true );
+    //Histograms of large cubes are shown while they are computed, so there
+    //is no need to fall back to a single channel by default.
+    m_state.insertValue<bool>(SIZE_ALL_RESTRICT, false );
     m_state.insertValue<int>(RESTRICT_SIZE_MAX, 1000000 );
     m_state.insertValue<QString>(FOOT_PRINT, FOOT_PRINT_IMAGE );
     m_state.insertValue<int>(Util::SIGNIFICANT_DIGITS, 6 );
@@ -1003,10 +1014,25 @@ void Histogram::_loadData( Controller* controller ){
 
         std::shared_ptr<Carta::Lib::PixelPipeline::CustomizablePixelPipeline> pipeline = dataSource->_getPipeline();
 
+        //Regions have no selection state, so the selected region is the one
+        //added most recently.
+        std::vector<Carta::Lib::RegionInfo> regions;
+        QString footPrint = m_state.getValue<QString>(FOOT_PRINT);
+        if ( footPrint == FOOT_PRINT_REGION_ALL ){
+            regions = controller->getRegions();
+        }
+        else if ( footPrint == FOOT_PRINT_REGION ){
+            std::vector<Carta::Lib::RegionInfo> allRegions = controller->getRegions();
+            if ( !allRegions.empty() ){
+                regions.push_back( allRegions.back() );
+            }
+        }
+
         m_plotManager->setPipeline( pipeline );
         m_renderService->renderHistogram(image,
                     binCount, minChannel, maxChannel, minFrequency, maxFrequency,
-                    rangeUnits, minIntensity, maxIntensity, dataSource->_getFileName());
+                    rangeUnits, minIntensity, maxIntensity, dataSource->_getFileName(),
+                    regions );
     }
     else {
         _resetDefaultStateData();
@@ -1069,6 +1095,7 @@ void Histogram::_resetDefaultStateData(){
    m_stateData.setValue<double>(CLIP_MAX_PERCENT, 100);
    m_stateData.setValue<double>(PLANE_MIN, 0 );
    m_stateData.setValue<double>(PLANE_MAX, 1 );
+   m_stateData.setValue<double>(PROGRESS, 1 );
    m_stateData.flushState();
 }
 
@@ -1989,6 +2016,14 @@ void Histogram::_updateColorClips( double colorMinPercent, double colorMaxPercen
     }
 }
 
+void Histogram::_updateRegions( Controller* controller ){
+    QString footPrint = m_state.getValue<QString>(FOOT_PRINT);
+    if ( footPrint != FOOT_PRINT_IMAGE ){
+        _generateHistogram( controller );
+    }
+}
+
+
 void Histogram::_updateColorSelection(){
     bool valid = false;
     std::pair<double,double> range = m_plotManager->getRangeColor( &valid );
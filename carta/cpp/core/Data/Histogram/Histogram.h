@@ -367,6 +367,8 @@ private slots:
 
     void _updateChannel( Controller* controller, Carta::Lib::AxisInfo::KnownType type );
     void _updateColorClips( double colorMinPercent, double colorMaxPercent);
+    //Regenerate the histogram when the regions it is restricted to change.
+    void _updateRegions( Controller* controller );
 
 
     void  _updateColorSelection();
@@ -455,6 +457,7 @@ private:
     const static QString CLIP_MAX_PERCENT;
     const static QString SIZE_ALL_RESTRICT;
     const static QString RESTRICT_SIZE_MAX;
+    const static QString PROGRESS;
     
     static ChannelUnits* m_channelUnits;
 
@@ -0,0 +1,81 @@
+#include "HistogramBase.h"
+#include "Data/Region/RegionSpans.h"
+#include "Algorithms/histogramAlgorithms.h"
+#include <cmath>
+
+namespace Carta
+{
+namespace Data
+{
+
+const int HistogramBase::BIN_COUNT = 1 << 16;
+
+
+HistogramBase::HistogramBase( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const std::pair<int,int>& channels, std::shared_ptr<RegionSpans> region,
+        double minValue, double maxValue, bool coversData, const std::vector<int64_t>& counts ):
+    m_image( image ),
+    m_channels( channels ),
+    m_region( region ),
+    m_minValue( minValue ),
+    m_maxValue( maxValue ),
+    m_coversData( coversData ),
+    m_counts( counts ){
+}
+
+
+bool HistogramBase::canRebin( double minValue, double maxValue, int binCount ) const {
+    if ( m_counts.empty() || binCount <= 0 || !( maxValue > minValue ) ){
+        return false;
+    }
+    double baseWidth = ( m_maxValue - m_minValue ) / m_counts.size();
+    if ( !m_coversData ){
+        //Pixels outside the base range were never counted.  Allow for rounding
+        //in range values that went through the user interface.
+        double tolerance = baseWidth * 1e-3;
+        if ( minValue < m_minValue - tolerance || maxValue > m_maxValue + tolerance ){
+            return false;
+        }
+    }
+    double requestedWidth = ( maxValue - minValue ) / binCount;
+    return requestedWidth >= baseWidth;
+}
+
+
+bool HistogramBase::coversData() const {
+    return m_coversData;
+}
+
+
+std::vector<double> HistogramBase::getCounts( int binCount, double minValue, double maxValue ) const {
+    return Carta::Core::Algorithms::rebinHistogram( m_counts.data(), m_counts.size(),
+            m_minValue, m_maxValue, binCount, minValue, maxValue );
+}
+
+
+std::shared_ptr<Carta::Lib::Image::ImageInterface> HistogramBase::getImage() const {
+    return m_image;
+}
+
+
+std::pair<double,double> HistogramBase::getRange() const {
+    return std::pair<double,double>( m_minValue, m_maxValue );
+}
+
+
+bool HistogramBase::isFor( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const std::pair<int,int>& channels, std::shared_ptr<RegionSpans> region ) const {
+    if ( m_image != image || m_channels != channels ){
+        return false;
+    }
+    if ( !m_region || !region ){
+        return !m_region && !region;
+    }
+    return m_region == region || *m_region == *region;
+}
+
+
+HistogramBase::~HistogramBase(){
+}
+}
+}
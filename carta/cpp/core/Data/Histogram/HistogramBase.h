@@ -0,0 +1,113 @@
+/**
+ * A high resolution histogram of one selection of an image, from which histograms
+ * with coarser bins over any part of its range can be produced without reading pixels.
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class RegionSpans;
+
+class HistogramBase {
+
+public:
+
+    /**
+     * Constructor.
+     * @param image - the image the histogram was computed from.
+     * @param channels - the first and last channel of the selection.
+     * @param region - the pixels of each plane in the selection, or null for whole planes.
+     * @param minValue - the lower edge of the first bin.
+     * @param maxValue - the upper edge of the last bin.
+     * @param coversData - true if every valid pixel of the selection lies in the bins.
+     * @param counts - the number of pixels in each bin.
+     */
+    HistogramBase( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const std::pair<int,int>& channels, std::shared_ptr<RegionSpans> region,
+            double minValue, double maxValue, bool coversData, const std::vector<int64_t>& counts );
+
+    /**
+     * Returns whether a histogram with the given bins can be produced from this one
+     * without losing resolution or missing pixels.
+     * @param minValue - the lower bound of the histogram.
+     * @param maxValue - the upper bound of the histogram.
+     * @param binCount - the number of bins in the histogram.
+     * @return - true if the requested bins are no narrower than the base bins and the
+     *      requested range does not extend past pixels that were not counted.
+     */
+    bool canRebin( double minValue, double maxValue, int binCount ) const;
+
+    /**
+     * Returns the histogram rebinned to the given bins.
+     * @param binCount - the number of bins in the histogram.
+     * @param minValue - the lower bound of the histogram.
+     * @param maxValue - the upper bound of the histogram.
+     * @return - the count of pixels in each bin.
+     */
+    std::vector<double> getCounts( int binCount, double minValue, double maxValue ) const;
+
+    /**
+     * Returns whether every valid pixel of the selection was counted.
+     * @return - true if the base range is the data range of the selection.
+     */
+    bool coversData() const;
+
+    /**
+     * Returns the image the histogram was computed from.
+     * @return - the source image.
+     */
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> getImage() const;
+
+    /**
+     * Returns the range of the base bins.
+     * @return - the lower edge of the first bin and the upper edge of the last bin.
+     */
+    std::pair<double,double> getRange() const;
+
+    /**
+     * Returns whether this is the histogram of a selection.
+     * @param image - the image of the selection.
+     * @param channels - the first and last channel of the selection.
+     * @param region - the pixels of each plane in the selection, or null for whole planes.
+     * @return - true if the histogram was computed from the given selection.
+     */
+    bool isFor( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const std::pair<int,int>& channels, std::shared_ptr<RegionSpans> region ) const;
+
+    /**
+     * Destructor.
+     */
+    ~HistogramBase();
+
+    //Number of bins in a base histogram.
+    static const int BIN_COUNT;
+
+private:
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    std::pair<int,int> m_channels;
+    std::shared_ptr<RegionSpans> m_region;
+    double m_minValue;
+    double m_maxValue;
+    bool m_coversData;
+    std::vector<int64_t> m_counts;
+
+    HistogramBase( const HistogramBase& other);
+    HistogramBase& operator=( const HistogramBase& other );
+};
+}
+}
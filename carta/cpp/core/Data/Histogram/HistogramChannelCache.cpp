@@ -0,0 +1,246 @@
+#include "HistogramChannelCache.h"
+#include "HistogramEngine.h"
+#include "Algorithms/histogramAlgorithms.h"
+#include "Algorithms/parallelAlgorithms.h"
+#include "CartaLib/CartaLib.h"
+#include "CartaLib/IImage.h"
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Carta
+{
+namespace Data
+{
+
+namespace
+{
+//Smallest number of pixels worth binning on a separate thread.
+const int64_t MIN_PIXELS_PER_THREAD = 1 << 16;
+//Smallest number of bins per channel worth caching.
+const int MIN_FINE_BIN_COUNT = 256;
+}
+
+const int HistogramChannelCache::FINE_BIN_COUNT = 4096;
+const int64_t HistogramChannelCache::MAX_CACHE_BYTES = 256 * 1024 * 1024;
+const int64_t HistogramChannelCache::MAX_CUBE_PIXELS = 256 * 1024 * 1024;
+
+
+HistogramChannelCache::HistogramChannelCache( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex ):
+    m_image( image ),
+    m_spectralIndex( spectralIndex ),
+    m_channelCount( 1 ),
+    m_binCount( 0 ),
+    m_minValue( 0 ),
+    m_maxValue( 0 ),
+    m_valid( false ){
+    if ( m_image && m_spectralIndex >= 0 ){
+        m_channelCount = m_image->dims()[m_spectralIndex];
+    }
+    m_binCount = _getBinCount( m_channelCount );
+}
+
+
+int HistogramChannelCache::_getBinCount( int64_t channelCount ){
+    //Use fewer bins per channel rather than exceed the memory budget on cubes
+    //with many channels, and none at all once too few bins are affordable.
+    int64_t affordable = MAX_CACHE_BYTES / ( ( channelCount + 1 ) * int64_t( sizeof(int64_t) ) );
+    int binCount = static_cast<int>( std::min<int64_t>( affordable, FINE_BIN_COUNT ) );
+    if ( binCount < MIN_FINE_BIN_COUNT ){
+        binCount = 0;
+    }
+    return binCount;
+}
+
+
+bool HistogramChannelCache::isWorthCaching( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex ){
+    if ( !image || spectralIndex < 0 ){
+        return false;
+    }
+    std::vector<int> dims = image->dims();
+    if ( spectralIndex >= static_cast<int>( dims.size() ) || dims[spectralIndex] <= 1 ){
+        return false;
+    }
+    //Building reads the whole cube twice in the background, which is only
+    //reasonable for cubes of moderate size.
+    int64_t pixelCount = 1;
+    for ( int dim : dims ){
+        pixelCount *= dim;
+    }
+    if ( pixelCount > MAX_CUBE_PIXELS ){
+        return false;
+    }
+    return _getBinCount( dims[spectralIndex] ) > 0;
+}
+
+
+bool HistogramChannelCache::build( const std::function<bool()>& isCancelled ){
+    using namespace Carta::Core::Algorithms;
+    m_valid = false;
+    if ( !m_image || m_binCount <= 0 ){
+        return false;
+    }
+    HistogramEngine engine( m_image, m_spectralIndex );
+    engine.setMonitor( isCancelled, nullptr );
+    int maxParts = std::max( 1, QThread::idealThreadCount() );
+
+    //First pass: the data range of every channel.
+    m_channelMin.assign( m_channelCount, std::numeric_limits<double>::max() );
+    m_channelMax.assign( m_channelCount, std::numeric_limits<double>::lowest() );
+    std::vector<double> partMin( maxParts );
+    std::vector<double> partMax( maxParts );
+    engine.scanPlanes( [this, &partMin, &partMax]( int channel, const float* data, int64_t count ){
+        int parts = parallelRanges( count, MIN_PIXELS_PER_THREAD,
+                [data, &partMin, &partMax]( int64_t begin, int64_t end, int part ){
+            double localMin = std::numeric_limits<double>::max();
+            double localMax = std::numeric_limits<double>::lowest();
+            for ( int64_t i = begin; i < end; i++ ){
+                float val = data[i];
+                if ( Q_LIKELY( std::isfinite( val ) ) ){
+                    localMin = std::min<double>( localMin, val );
+                    localMax = std::max<double>( localMax, val );
+                }
+            }
+            partMin[part] = localMin;
+            partMax[part] = localMax;
+        });
+        for ( int part = 0; part < parts; part++ ){
+            m_channelMin[channel] = std::min( m_channelMin[channel], partMin[part] );
+            m_channelMax[channel] = std::max( m_channelMax[channel], partMax[part] );
+        }
+    });
+    m_minValue = *std::min_element( m_channelMin.begin(), m_channelMin.end() );
+    m_maxValue = *std::max_element( m_channelMax.begin(), m_channelMax.end() );
+    if ( m_minValue > m_maxValue || engine.isCancelled() ){
+        m_prefixCounts.clear();
+        return false;
+    }
+    if ( m_minValue == m_maxValue ){
+        m_maxValue = m_minValue + 1;
+    }
+
+    //Second pass: bin every channel on the shared grid.  Row c+1 receives the
+    //counts of channel c; the rows are accumulated afterwards.
+    const int binCount = m_binCount;
+    const double lowBound = m_minValue;
+    const double highBound = m_maxValue;
+    const double scale = binCount / ( highBound - lowBound );
+    m_prefixCounts.assign( int64_t( m_channelCount + 1 ) * binCount, 0 );
+    std::vector<std::vector<int64_t> > partCounts( maxParts, std::vector<int64_t>( binCount, 0 ) );
+    engine.scanPlanes( [this, &partCounts, lowBound, highBound, scale, binCount]
+                        ( int channel, const float* data, int64_t count ){
+        int parts = parallelRanges( count, MIN_PIXELS_PER_THREAD,
+                [&partCounts, data, lowBound, highBound, scale, binCount]( int64_t begin, int64_t end, int part ){
+            int64_t* bins = partCounts[part].data();
+            for ( int64_t i = begin; i < end; i++ ){
+                double val = data[i];
+                //NaN fails both comparisons.
+                if ( val >= lowBound && val <= highBound ){
+                    int bin = static_cast<int>( ( val - lowBound ) * scale );
+                    if ( bin >= binCount ){
+                        bin = binCount - 1;
+                    }
+                    bins[bin]++;
+                }
+            }
+        });
+        int64_t* row = m_prefixCounts.data() + int64_t( channel + 1 ) * binCount;
+        for ( int part = 0; part < parts; part++ ){
+            std::vector<int64_t>& bins = partCounts[part];
+            for ( int i = 0; i < binCount; i++ ){
+                row[i] += bins[i];
+            }
+            std::fill( bins.begin(), bins.end(), 0 );
+        }
+    });
+    for ( int channel = 1; channel <= m_channelCount; channel++ ){
+        int64_t* row = m_prefixCounts.data() + int64_t( channel ) * binCount;
+        const int64_t* previous = row - binCount;
+        for ( int i = 0; i < binCount; i++ ){
+            row[i] += previous[i];
+        }
+    }
+    if ( engine.isCancelled() ){
+        m_prefixCounts.clear();
+        return false;
+    }
+    m_valid = true;
+    return m_valid;
+}
+
+
+bool HistogramChannelCache::canRebin( double minValue, double maxValue, int binCount ) const {
+    if ( !m_valid || binCount <= 0 || !( maxValue > minValue ) ){
+        return false;
+    }
+    double cachedWidth = ( m_maxValue - m_minValue ) / m_binCount;
+    double requestedWidth = ( maxValue - minValue ) / binCount;
+    return requestedWidth >= cachedWidth;
+}
+
+
+std::pair<int,int> HistogramChannelCache::_clampChannels( int minChannel, int maxChannel ) const {
+    int chanMin = Carta::Lib::clamp( minChannel, 0, m_channelCount - 1 );
+    int chanMax = Carta::Lib::clamp( maxChannel, 0, m_channelCount - 1 );
+    return std::pair<int,int>( std::min( chanMin, chanMax ), std::max( chanMin, chanMax ) );
+}
+
+
+std::vector<int64_t> HistogramChannelCache::getCounts( int minChannel, int maxChannel ) const {
+    std::vector<int64_t> counts;
+    if ( !m_valid ){
+        return counts;
+    }
+    std::pair<int,int> channels = _clampChannels( minChannel, maxChannel );
+    counts.resize( m_binCount );
+    const int64_t* low = m_prefixCounts.data() + int64_t( channels.first ) * m_binCount;
+    const int64_t* high = m_prefixCounts.data() + int64_t( channels.second + 1 ) * m_binCount;
+    for ( int i = 0; i < m_binCount; i++ ){
+        counts[i] = high[i] - low[i];
+    }
+    return counts;
+}
+
+
+std::vector<double> HistogramChannelCache::getCounts( int minChannel, int maxChannel, int binCount,
+        double minValue, double maxValue ) const {
+    std::vector<int64_t> counts = getCounts( minChannel, maxChannel );
+    if ( counts.empty() ){
+        return std::vector<double>( std::max( binCount, 0 ), 0 );
+    }
+    return Carta::Core::Algorithms::rebinHistogram( counts.data(), m_binCount,
+            m_minValue, m_maxValue, binCount, minValue, maxValue );
+}
+
+
+std::pair<double,double> HistogramChannelCache::getDataRange( int minChannel, int maxChannel ) const {
+    std::pair<double,double> range( std::numeric_limits<double>::max(),
+            std::numeric_limits<double>::lowest() );
+    if ( m_valid ){
+        std::pair<int,int> channels = _clampChannels( minChannel, maxChannel );
+        for ( int channel = channels.first; channel <= channels.second; channel++ ){
+            range.first = std::min( range.first, m_channelMin[channel] );
+            range.second = std::max( range.second, m_channelMax[channel] );
+        }
+    }
+    return range;
+}
+
+
+std::shared_ptr<Carta::Lib::Image::ImageInterface> HistogramChannelCache::getImage() const {
+    return m_image;
+}
+
+
+bool HistogramChannelCache::isValid() const {
+    return m_valid;
+}
+
+
+HistogramChannelCache::~HistogramChannelCache(){
+}
+}
+}
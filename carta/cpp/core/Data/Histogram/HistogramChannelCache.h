@@ -0,0 +1,148 @@
+/**
+ * Per-channel histograms of an image cube, binned on a single shared grid so that the
+ * histogram of any channel range can be produced without reading pixels.
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class HistogramChannelCache {
+
+public:
+
+    /**
+     * Constructor.
+     * @param image - the image whose channels will be binned.
+     * @param spectralIndex - the index of the spectral axis in the image or -1 if there
+     *      is no spectral axis.
+     */
+    HistogramChannelCache( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, int spectralIndex );
+
+    /**
+     * Read the image and bin every channel.  The data range of the cube is found first
+     * so that all channels share the same bin edges.
+     * @param isCancelled - polled while the cube is read; the build stops when it returns true.
+     * @return - true if the cube contained valid data, fits in the memory budget, and
+     *      the build was not cancelled; false otherwise.
+     * @note this reads the whole cube and should not be called on the main thread.
+     */
+    bool build( const std::function<bool()>& isCancelled = nullptr );
+
+    /**
+     * Returns whether a cache of the image is worth building.
+     * @param image - the image whose channels would be binned.
+     * @param spectralIndex - the index of the spectral axis in the image or -1 if there
+     *      is no spectral axis.
+     * @return - true if the image has several channels, is small enough to be read in
+     *      the background, and enough bins per channel fit in the memory budget;
+     *      false otherwise.
+     */
+    static bool isWorthCaching( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            int spectralIndex );
+
+    /**
+     * Returns whether the cache can produce a histogram with the given bins without
+     * losing resolution.
+     * @param minValue - the lower bound of the histogram.
+     * @param maxValue - the upper bound of the histogram.
+     * @param binCount - the number of bins in the histogram.
+     * @return - true if the requested bins are no narrower than the cached bins.
+     */
+    bool canRebin( double minValue, double maxValue, int binCount ) const;
+
+    /**
+     * Returns the number of pixels in each cached bin for a range of channels.
+     * @param minChannel - the first channel.
+     * @param maxChannel - the last channel.
+     * @return - the summed counts of the channels on the shared bin grid.
+     */
+    std::vector<int64_t> getCounts( int minChannel, int maxChannel ) const;
+
+    /**
+     * Returns the histogram of a range of channels rebinned to the given bins.
+     * @param minChannel - the first channel.
+     * @param maxChannel - the last channel.
+     * @param binCount - the number of bins in the histogram.
+     * @param minValue - the lower bound of the histogram.
+     * @param maxValue - the upper bound of the histogram.
+     * @return - the count of pixels in each bin.
+     */
+    std::vector<double> getCounts( int minChannel, int maxChannel, int binCount,
+            double minValue, double maxValue ) const;
+
+    /**
+     * Returns the smallest and largest valid pixel value in a range of channels.
+     * @param minChannel - the first channel.
+     * @param maxChannel - the last channel.
+     * @return - the data range; the minimum is larger than the maximum if the channels
+     *      contain no valid data.
+     */
+    std::pair<double,double> getDataRange( int minChannel, int maxChannel ) const;
+
+    /**
+     * Returns the image that was binned.
+     * @return - the source image of the cache.
+     */
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> getImage() const;
+
+    /**
+     * Returns whether the cache has been built.
+     * @return - true if the cache holds histograms of valid data.
+     */
+    bool isValid() const;
+
+    /**
+     * Destructor.
+     */
+    ~HistogramChannelCache();
+
+    //Largest number of bins per channel.
+    static const int FINE_BIN_COUNT;
+    //Upper bound on the memory used for the counts of all channels, in bytes.
+    static const int64_t MAX_CACHE_BYTES;
+    //Largest cube, in pixels, that is binned in the background.
+    static const int64_t MAX_CUBE_PIXELS;
+
+private:
+
+    //Bins per channel that fit in the memory budget, or 0 if too few do.
+    static int _getBinCount( int64_t channelCount );
+
+    //Clamp a channel range to the channels of the image.
+    std::pair<int,int> _clampChannels( int minChannel, int maxChannel ) const;
+
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    int m_spectralIndex;
+    int m_channelCount;
+    int m_binCount;
+    double m_minValue;
+    double m_maxValue;
+    bool m_valid;
+
+    //Row c holds the summed counts of the channels before channel c, so
+    //that the counts of any channel range are the difference of two rows.
+    std::vector<int64_t> m_prefixCounts;
+    std::vector<double> m_channelMin;
+    std::vector<double> m_channelMax;
+
+    HistogramChannelCache( const HistogramChannelCache& other);
+    HistogramChannelCache& operator=( const HistogramChannelCache& other );
+};
+}
+}
@@ -0,0 +1,495 @@
+#include "HistogramEngine.h"
+#include "HistogramBase.h"
+#include "HistogramChannelCache.h"
+#include "Data/Util.h"
+#include "Data/Region/RegionSpans.h"
+#include "Data/Error/ErrorManager.h"
+#include "Algorithms/bulkRead.h"
+#include "Algorithms/parallelAlgorithms.h"
+#include "Globals.h"
+#include "PluginManager.h"
+#include "CartaLib/Hooks/ConversionSpectralHook.h"
+#include "CartaLib/IImage.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtCore/qmath.h>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Carta
+{
+namespace Data
+{
+
+namespace
+{
+//Smallest number of pixels worth binning on a separate thread.
+const int64_t MIN_PIXELS_PER_THREAD = 1 << 16;
+//Minimum time between partial results, in milliseconds.
+const int PARTIAL_RESULT_INTERVAL = 250;
+
+std::vector<double> _convertSpectral( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const QString& oldUnits, const QString& newUnits, const std::vector<double>& values ){
+    std::vector<double> converted;
+    auto result = Globals::instance()-> pluginManager()
+                     -> prepare <Carta::Lib::Hooks::ConversionSpectralHook>(image,
+                             oldUnits, newUnits, values );
+    auto lam = [&converted] ( const Carta::Lib::Hooks::ConversionSpectralHook::ResultType &data ) {
+        converted = data;
+    };
+    try {
+        result.forEach( lam );
+    }
+    catch( char*& error ){
+        QString errorStr( error );
+        ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
+        hr->registerError( errorStr );
+    }
+    return converted;
+}
+}
+
+
+HistogramEngine::HistogramEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex ):
+    m_image( image ),
+    m_spectralIndex( spectralIndex ),
+    m_minChannel( -1 ),
+    m_maxChannel( -1 ),
+    m_binCount( 25 ),
+    m_minIntensity( 0 ),
+    m_maxIntensity( 0 ),
+    m_minFrequency( -1 ),
+    m_maxFrequency( -1 ){
+}
+
+
+Carta::Lib::Hooks::HistogramResult HistogramEngine::compute( std::shared_ptr<HistogramBase>* base ) const {
+    Carta::Lib::Hooks::HistogramResult result;
+    if ( !m_image ){
+        result.setName( Util::ERROR + ": There was no image for the histogram.");
+        return result;
+    }
+    if ( m_binCount <= 0 ){
+        result.setName( Util::ERROR + ": Invalid histogram bin count: "+QString::number( m_binCount ) );
+        return result;
+    }
+    double minValue = m_minIntensity;
+    double maxValue = m_maxIntensity;
+    std::vector<int64_t> baseCounts;
+    std::vector<int64_t> counts = computeCounts( &minValue, &maxValue, base ? &baseCounts : nullptr );
+    result = _makeResult( std::vector<double>( counts.begin(), counts.end() ), minValue, maxValue );
+    if ( isCancelled() ){
+        result.setProgress( 0 );
+    }
+    else if ( base && !baseCounts.empty() ){
+        bool dataRange = ( m_minIntensity >= m_maxIntensity );
+        base->reset( new HistogramBase( m_image, getChannels(), _getRegion(), minValue, maxValue,
+                dataRange, baseCounts ) );
+    }
+    return result;
+}
+
+
+bool HistogramEngine::computeFromBase( const HistogramBase& base,
+        Carta::Lib::Hooks::HistogramResult* result ) const {
+    if ( !m_image || m_binCount <= 0 || !base.isFor( m_image, getChannels(), _getRegion() ) ){
+        return false;
+    }
+    double minValue = m_minIntensity;
+    double maxValue = m_maxIntensity;
+    if ( minValue >= maxValue ){
+        //The data range is only known if the base was computed over it.
+        if ( !base.coversData() ){
+            return false;
+        }
+        std::pair<double,double> range = base.getRange();
+        minValue = range.first;
+        maxValue = range.second;
+    }
+    if ( !base.canRebin( minValue, maxValue, m_binCount ) ){
+        return false;
+    }
+    *result = _makeResult( base.getCounts( m_binCount, minValue, maxValue ), minValue, maxValue );
+    return true;
+}
+
+
+bool HistogramEngine::computeFromCache( const HistogramChannelCache& cache,
+        Carta::Lib::Hooks::HistogramResult* result ) const {
+    if ( !m_image || !cache.isValid() || cache.getImage() != m_image || m_binCount <= 0 ){
+        return false;
+    }
+    if ( _getRegion() ){
+        //The cache holds histograms of whole planes.
+        return false;
+    }
+    std::pair<int,int> channels = getChannels();
+    double minValue = m_minIntensity;
+    double maxValue = m_maxIntensity;
+    if ( minValue >= maxValue ){
+        std::pair<double,double> range = cache.getDataRange( channels.first, channels.second );
+        minValue = range.first;
+        maxValue = range.second;
+        if ( minValue > maxValue ){
+            *result = _makeResult( std::vector<double>(), 0, 0 );
+            return true;
+        }
+        if ( minValue == maxValue ){
+            maxValue = minValue + 1;
+        }
+    }
+    if ( !cache.canRebin( minValue, maxValue, m_binCount ) ){
+        return false;
+    }
+    std::vector<double> counts = cache.getCounts( channels.first, channels.second,
+            m_binCount, minValue, maxValue );
+    *result = _makeResult( counts, minValue, maxValue );
+    return true;
+}
+
+
+std::vector<int64_t> HistogramEngine::computeCounts( double* minValue, double* maxValue,
+        std::vector<int64_t>* baseCounts ) const {
+    using namespace Carta::Core::Algorithms;
+    int maxParts = std::max( 1, QThread::idealThreadCount() );
+
+    //Without a valid intensity range, we need a first pass to find the data range.
+    //No partial histograms can be shown during that pass, but it counts toward the
+    //progress.
+    double lowBound = m_minIntensity;
+    double highBound = m_maxIntensity;
+    double progressStart = 0;
+    if ( lowBound >= highBound ){
+        progressStart = 0.5;
+        std::vector<double> partMin( maxParts, std::numeric_limits<double>::max() );
+        std::vector<double> partMax( maxParts, std::numeric_limits<double>::lowest() );
+        scanPlanes( [&partMin, &partMax]( int /*channel*/, const float* data, int64_t count ){
+            parallelRanges( count, MIN_PIXELS_PER_THREAD,
+                    [data, &partMin, &partMax]( int64_t begin, int64_t end, int part ){
+                double localMin = partMin[part];
+                double localMax = partMax[part];
+                for ( int64_t i = begin; i < end; i++ ){
+                    float val = data[i];
+                    if ( Q_LIKELY( std::isfinite( val ) ) ){
+                        localMin = std::min<double>( localMin, val );
+                        localMax = std::max<double>( localMax, val );
+                    }
+                }
+                partMin[part] = localMin;
+                partMax[part] = localMax;
+            });
+        });
+        lowBound = *std::min_element( partMin.begin(), partMin.end() );
+        highBound = *std::max_element( partMax.begin(), partMax.end() );
+        if ( lowBound > highBound || isCancelled() ){
+            //No valid data.
+            *minValue = 0;
+            *maxValue = 0;
+            return std::vector<int64_t>();
+        }
+        if ( lowBound == highBound ){
+            highBound = lowBound + 1;
+        }
+    }
+    *minValue = lowBound;
+    *maxValue = highBound;
+
+    //Every thread counts into its own bins, which are summed at the end.
+    const int binCount = m_binCount;
+    const double scale = binCount / ( highBound - lowBound );
+    std::vector<std::vector<int64_t> > partCounts( maxParts, std::vector<int64_t>( binCount, 0 ) );
+    const int baseBinCount = baseCounts ? HistogramBase::BIN_COUNT : 0;
+    const double baseScale = baseBinCount / ( highBound - lowBound );
+    std::vector<std::vector<int64_t> > partBaseCounts( maxParts, std::vector<int64_t>( baseBinCount, 0 ) );
+    const int64_t pixelCount = std::max<int64_t>( 1, _getPixelCount() );
+    int64_t scanned = 0;
+    QElapsedTimer partialTimer;
+    partialTimer.start();
+    scanPlanes( [this, &partCounts, &partBaseCounts, &scanned, &partialTimer, lowBound, highBound,
+                 scale, binCount, baseScale, baseBinCount, pixelCount, progressStart]
+                 ( int /*channel*/, const float* data, int64_t count ){
+        parallelRanges( count, MIN_PIXELS_PER_THREAD,
+                [&partCounts, &partBaseCounts, data, lowBound, highBound, scale, binCount,
+                 baseScale, baseBinCount]( int64_t begin, int64_t end, int part ){
+            int64_t* bins = partCounts[part].data();
+            int64_t* baseBins = partBaseCounts[part].data();
+            for ( int64_t i = begin; i < end; i++ ){
+                double val = data[i];
+                //NaN fails both comparisons.
+                if ( val >= lowBound && val <= highBound ){
+                    int bin = static_cast<int>( ( val - lowBound ) * scale );
+                    if ( bin >= binCount ){
+                        bin = binCount - 1;
+                    }
+                    bins[bin]++;
+                    if ( baseBinCount > 0 ){
+                        int baseBin = static_cast<int>( ( val - lowBound ) * baseScale );
+                        if ( baseBin >= baseBinCount ){
+                            baseBin = baseBinCount - 1;
+                        }
+                        baseBins[baseBin]++;
+                    }
+                }
+            }
+        });
+        scanned += count;
+        if ( m_partialResult && partialTimer.elapsed() >= PARTIAL_RESULT_INTERVAL && scanned < pixelCount ){
+            partialTimer.restart();
+            std::vector<double> partial( binCount, 0 );
+            for ( const std::vector<int64_t>& bins : partCounts ){
+                for ( int i = 0; i < binCount; i++ ){
+                    partial[i] += bins[i];
+                }
+            }
+            Carta::Lib::Hooks::HistogramResult result = _makeResult( partial, lowBound, highBound );
+            double fraction = double( scanned ) / pixelCount;
+            result.setProgress( progressStart + ( 1 - progressStart ) * fraction );
+            m_partialResult( result );
+        }
+    });
+    std::vector<int64_t> counts( binCount, 0 );
+    for ( int part = 0; part < maxParts; part++ ){
+        for ( int i = 0; i < binCount; i++ ){
+            counts[i] += partCounts[part][i];
+        }
+    }
+    if ( baseCounts ){
+        baseCounts->assign( baseBinCount, 0 );
+        for ( int part = 0; part < maxParts; part++ ){
+            for ( int i = 0; i < baseBinCount; i++ ){
+                (*baseCounts)[i] += partBaseCounts[part][i];
+            }
+        }
+    }
+    return counts;
+}
+
+
+std::pair<int,int> HistogramEngine::getChannelBounds(
+        std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        double minFrequency, double maxFrequency, const QString& units ){
+    std::pair<int,int> bounds( -1, -1 );
+    int spectralIndex = Util::getAxisIndex( image, Carta::Lib::AxisInfo::KnownType::SPECTRAL );
+    if ( spectralIndex < 0 ){
+        return bounds;
+    }
+    std::vector<double> pixels = _convertSpectral( image, units, "", { minFrequency, maxFrequency } );
+    if ( pixels.size() == 2 ){
+        int maxChannel = image->dims()[spectralIndex] - 1;
+        int channelLow = Carta::Lib::clamp( qRound( pixels[0] ), 0, maxChannel );
+        int channelHigh = Carta::Lib::clamp( qRound( pixels[1] ), 0, maxChannel );
+        bounds.first = std::min( channelLow, channelHigh );
+        bounds.second = std::max( channelLow, channelHigh );
+    }
+    return bounds;
+}
+
+
+std::shared_ptr<RegionSpans> HistogramEngine::_getRegion() const {
+    //Regions are drawn on the first two axes, which must not be the spectral axis.
+    std::shared_ptr<RegionSpans> region;
+    if ( m_region && m_spectralIndex != 0 && m_spectralIndex != 1 && m_image->dims().size() >= 2 ){
+        region = m_region;
+    }
+    return region;
+}
+
+
+std::pair<int,int> HistogramEngine::getChannels() const {
+    int channelCount = 1;
+    if ( m_spectralIndex >= 0 ){
+        channelCount = m_image->dims()[m_spectralIndex];
+    }
+    std::pair<int,int> channels( 0, channelCount - 1 );
+    if ( m_spectralIndex >= 0 && m_minChannel >= 0 && m_maxChannel >= 0 ){
+        channels.first = std::min( m_minChannel, channelCount - 1 );
+        channels.second = std::min( m_maxChannel, channelCount - 1 );
+    }
+    return channels;
+}
+
+
+std::pair<double,double> HistogramEngine::getFrequencyBounds(
+        std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int minChannel, int maxChannel, const QString& units ){
+    std::pair<double,double> bounds( -1, -1 );
+    int spectralIndex = Util::getAxisIndex( image, Carta::Lib::AxisInfo::KnownType::SPECTRAL );
+    if ( spectralIndex < 0 ){
+        return bounds;
+    }
+    int channelCount = image->dims()[spectralIndex];
+    int chanMin = std::max( 0, minChannel );
+    int chanMax = channelCount - 1;
+    if ( maxChannel >= 0 ){
+        chanMax = std::min( chanMax, maxChannel );
+    }
+    std::vector<double> frequencies = _convertSpectral( image, "", units,
+            { double(chanMin), double(chanMax) } );
+    if ( frequencies.size() == 2 ){
+        bounds.first = std::min( frequencies[0], frequencies[1] );
+        bounds.second = std::max( frequencies[0], frequencies[1] );
+    }
+    return bounds;
+}
+
+
+int64_t HistogramEngine::_getPixelCount() const {
+    std::vector<int> dims = m_image->dims();
+    std::shared_ptr<RegionSpans> region = _getRegion();
+    int64_t pixelCount = 1;
+    int firstAxis = 0;
+    if ( region ){
+        pixelCount = region->getPixelCount();
+        firstAxis = 2;
+    }
+    for ( int i = firstAxis; i < static_cast<int>( dims.size() ); i++ ){
+        if ( i != m_spectralIndex ){
+            pixelCount *= dims[i];
+        }
+    }
+    std::pair<int,int> channels = getChannels();
+    return pixelCount * ( channels.second - channels.first + 1 );
+}
+
+
+Carta::Lib::Hooks::HistogramResult HistogramEngine::_makeResult( const std::vector<double>& counts,
+        double minValue, double maxValue ) const {
+    //Report the bin centers, like casacore does.
+    std::vector<std::pair<double,double> > data;
+    if ( !counts.empty() ){
+        int binCount = counts.size();
+        double binWidth = ( maxValue - minValue ) / binCount;
+        data.resize( binCount );
+        for ( int i = 0; i < binCount; i++ ){
+            data[i] = std::pair<double,double>( minValue + ( i + 0.5 ) * binWidth, counts[i] );
+        }
+    }
+    QString unitsY = m_image->getPixelUnit().toStr();
+    Carta::Lib::Hooks::HistogramResult result( m_name, "pixels", unitsY, data );
+    result.setFrequencyBounds( m_minFrequency, m_maxFrequency );
+    return result;
+}
+
+
+void HistogramEngine::scanPlanes( const std::function<void(int, const float*, int64_t)>& func ) const {
+    std::pair<int,int> channels = getChannels();
+    bool masked = m_image->hasMask();
+    std::vector<float> maskedData;
+    std::shared_ptr<RegionSpans> region = _getRegion();
+    if ( region && region->isEmpty() ){
+        return;
+    }
+    std::vector<float> regionData;
+    for ( int channel = channels.first; channel <= channels.second && !isCancelled(); channel++ ){
+        SliceND planeSlice;
+        if ( m_spectralIndex >= 0 ){
+            planeSlice.slice( m_spectralIndex ).start( channel ).end( channel + 1 );
+        }
+        if ( region ){
+            QRect bounds = region->getBounds();
+            planeSlice.slice( 0 ).start( bounds.left() ).end( bounds.right() + 1 );
+            planeSlice.slice( 1 ).start( bounds.top() ).end( bounds.bottom() + 1 );
+        }
+        std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view( m_image->getDataSlice( planeSlice ) );
+        if ( !view ){
+            continue;
+        }
+        //A mask that cannot be read is treated as no mask.
+        std::unique_ptr<Carta::Lib::NdArray::Byte> maskView;
+        if ( masked ){
+            maskView.reset( m_image->getMaskSlice( planeSlice ) );
+        }
+        if ( region ){
+            //Read the bounding box of the region, then keep the pixels of its spans.
+            std::vector<float> boxData = Carta::Core::Algorithms::readAll<float>( view.get() );
+            if ( maskView ){
+                std::vector<uint8_t> mask = Carta::Core::Algorithms::readAll<uint8_t>( maskView->rawView() );
+                for ( size_t i = 0; i < boxData.size(); i++ ){
+                    if ( !mask[i] ){
+                        boxData[i] = std::numeric_limits<float>::quiet_NaN();
+                    }
+                }
+            }
+            int64_t boxSize = int64_t( region->getBounds().width() ) * region->getBounds().height();
+            region->gather( boxData.data(), boxData.size() / boxSize, regionData );
+            if ( !isCancelled() ){
+                func( channel, regionData.data(), regionData.size() );
+            }
+            continue;
+        }
+        //The view is read to the end, but once the computation is cancelled the
+        //remaining chunks are not processed.
+        if ( !maskView ){
+            Carta::Core::Algorithms::forEachChunk<float>( view.get(),
+                    [this, &func, channel]( const float* data, int64_t count ){
+                if ( !isCancelled() ){
+                    func( channel, data, count );
+                }
+            });
+        }
+        else {
+            std::vector<uint8_t> mask = Carta::Core::Algorithms::readAll<uint8_t>( maskView->rawView() );
+            int64_t offset = 0;
+            Carta::Core::Algorithms::forEachChunk<float>( view.get(),
+                    [this, &func, &mask, &maskedData, &offset, channel]( const float* data, int64_t count ){
+                if ( isCancelled() ){
+                    return;
+                }
+                maskedData.assign( data, data + count );
+                for ( int64_t i = 0; i < count; i++ ){
+                    if ( !mask[offset + i] ){
+                        maskedData[i] = std::numeric_limits<float>::quiet_NaN();
+                    }
+                }
+                offset += count;
+                func( channel, maskedData.data(), count );
+            });
+        }
+    }
+}
+
+
+bool HistogramEngine::isCancelled() const {
+    return m_isCancelled && m_isCancelled();
+}
+
+
+void HistogramEngine::setBins( int binCount, double minIntensity, double maxIntensity ){
+    m_binCount = binCount;
+    m_minIntensity = minIntensity;
+    m_maxIntensity = maxIntensity;
+}
+
+
+void HistogramEngine::setChannelRange( int minChannel, int maxChannel ){
+    m_minChannel = minChannel;
+    m_maxChannel = maxChannel;
+}
+
+
+void HistogramEngine::setMonitor( const std::function<bool()>& isCancelled,
+        const std::function<void(const Carta::Lib::Hooks::HistogramResult&)>& partialResult ){
+    m_isCancelled = isCancelled;
+    m_partialResult = partialResult;
+}
+
+
+void HistogramEngine::setRegion( std::shared_ptr<RegionSpans> region ){
+    m_region = region;
+}
+
+
+void HistogramEngine::setResultInfo( const QString& name, double minFrequency, double maxFrequency ){
+    m_name = name;
+    m_minFrequency = minFrequency;
+    m_maxFrequency = maxFrequency;
+}
+
+
+HistogramEngine::~HistogramEngine(){
+}
+}
+}
@@ -0,0 +1,210 @@
+/**
+ * Computes histogram data for an image cube inside the viewer process.
+ **/
+
+#pragma once
+
+#include "CartaLib/Hooks/HistogramResult.h"
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class HistogramBase;
+class HistogramChannelCache;
+class RegionSpans;
+
+class HistogramEngine {
+
+public:
+
+    /**
+     * Constructor.
+     * @param image - the image that will be the source of the histogram.
+     * @param spectralIndex - the index of the spectral axis in the image or -1 if there
+     *      is no spectral axis.
+     */
+    HistogramEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, int spectralIndex );
+
+    /**
+     * Compute the histogram.  Planes along the spectral axis are read one at a
+     * time with the bulk accessor and the pixels of each chunk are binned in parallel,
+     * with every thread counting into its own bins.  NaN and masked pixels are
+     * ignored.  Partial results are reported through the monitor, if one is set.
+     * @param base - if not null, set to a high resolution histogram of the selection
+     *      computed in the same pass, for answering later requests without a scan.
+     * @return - the histogram data; if the histogram could not be computed the name of
+     *      the result starts with Util::ERROR.
+     */
+    Carta::Lib::Hooks::HistogramResult compute( std::shared_ptr<HistogramBase>* base = nullptr ) const;
+
+    /**
+     * Compute the bin counts.
+     * @param minValue - the lower bound of the histogram; set to the data minimum if the
+     *      intensity range is not set.
+     * @param maxValue - the upper bound of the histogram; set to the data maximum if the
+     *      intensity range is not set.
+     * @param baseCounts - if not null, set to the pixel counts of HistogramBase::BIN_COUNT
+     *      bins over the same range.
+     * @return - the count of pixels in each bin.
+     */
+    std::vector<int64_t> computeCounts( double* minValue, double* maxValue,
+            std::vector<int64_t>* baseCounts = nullptr ) const;
+
+    /**
+     * Compute the histogram by rebinning a high resolution histogram of the selection.
+     * @param base - a high resolution histogram of the selection.
+     * @param result - set to the histogram data if it could be computed from the base.
+     * @return - true if the base could answer the request at the requested resolution;
+     *      false if the image needs to be scanned.
+     */
+    bool computeFromBase( const HistogramBase& base,
+            Carta::Lib::Hooks::HistogramResult* result ) const;
+
+    /**
+     * Compute the histogram from cached per-channel histograms instead of reading
+     * the image.
+     * @param cache - per-channel histograms of the image.
+     * @param result - set to the histogram data if it could be computed from the cache.
+     * @return - true if the cache could answer the request at the requested resolution;
+     *      false if the image needs to be scanned.
+     */
+    bool computeFromCache( const HistogramChannelCache& cache,
+            Carta::Lib::Hooks::HistogramResult* result ) const;
+
+    /**
+     * Return the channels of the spectral axis that will be scanned.
+     * @return - the first and last channel of the histogram.
+     */
+    std::pair<int,int> getChannels() const;
+
+    /**
+     * Visit the pixels of the selected planes in chunks, with masked pixels replaced
+     * by NaN.  With a region, only the bounding box of the region is read and the
+     * pixels it covers are visited once per plane.  Once the computation is cancelled
+     * no more chunks are visited.
+     * @param func - called with the channel, the pixels, and the number of pixels.
+     */
+    void scanPlanes( const std::function<void(int, const float*, int64_t)>& func ) const;
+
+    /**
+     * Returns whether the computation has been cancelled.
+     * @return - true if the cancellation callback asks the computation to stop.
+     */
+    bool isCancelled() const;
+
+    /**
+     * Set callbacks for following and stopping a long computation.
+     * @param isCancelled - polled between chunks of pixels; when it returns true the
+     *      scan stops early and the result is incomplete.
+     * @param partialResult - called periodically from the computing thread with the
+     *      histogram of the pixels scanned so far; its progress is the fraction of the
+     *      pixels that have been scanned.
+     */
+    void setMonitor( const std::function<bool()>& isCancelled,
+            const std::function<void(const Carta::Lib::Hooks::HistogramResult&)>& partialResult );
+
+    /**
+     * Restrict the histogram to a range of channels.
+     * @param minChannel - the minimum channel or -1 if there is no minimum.
+     * @param maxChannel - the maximum channel or -1 if there is no maximum.
+     */
+    void setChannelRange( int minChannel, int maxChannel );
+
+    /**
+     * Set the number of bins and the intensity range they cover.
+     * @param binCount - the number of bins the histogram should have.
+     * @param minIntensity - minimum histogram intensity.
+     * @param maxIntensity - maximum histogram intensity.
+     * If the minimum is not smaller than the maximum, the data range is used.
+     */
+    void setBins( int binCount, double minIntensity, double maxIntensity );
+
+    /**
+     * Restrict the histogram to the pixels covered by regions.
+     * @param region - the pixels of each plane to include, or null for whole planes.
+     */
+    void setRegion( std::shared_ptr<RegionSpans> region );
+
+    /**
+     * Set the name and frequency bounds reported with the result.
+     * @param name - the name of the histogram.
+     * @param minFrequency - the minimum frequency of the channel range.
+     * @param maxFrequency - the maximum frequency of the channel range.
+     */
+    void setResultInfo( const QString& name, double minFrequency, double maxFrequency );
+
+    /**
+     * Return the channel range of the histogram in frequency units.
+     * @param image - the image that will be the source of the histogram.
+     * @param minChannel - the minimum channel.
+     * @param maxChannel - the maximum channel.
+     * @param units - frequency units.
+     * @return - the smallest and largest frequency of the channel range, or -1 if they
+     *      could not be determined.
+     * @note the conversion uses plugin hooks and should be done on the main thread.
+     */
+    static std::pair<double,double> getFrequencyBounds(
+            std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            int minChannel, int maxChannel, const QString& units );
+
+    /**
+     * Return the channel range corresponding to a frequency range.
+     * @param image - the image that will be the source of the histogram.
+     * @param minFrequency - the minimum frequency.
+     * @param maxFrequency - the maximum frequency.
+     * @param units - frequency units.
+     * @return - the smallest and largest channel in the frequency range, or -1 if they
+     *      could not be determined.
+     * @note the conversion uses plugin hooks and should be done on the main thread.
+     */
+    static std::pair<int,int> getChannelBounds(
+            std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            double minFrequency, double maxFrequency, const QString& units );
+
+    /**
+     * Destructor.
+     */
+    ~HistogramEngine();
+
+private:
+
+    //Returns the region restricting the planes, if it can be applied to the image.
+    std::shared_ptr<RegionSpans> _getRegion() const;
+
+    //Returns the number of pixels in the selected planes.
+    int64_t _getPixelCount() const;
+
+    //Package bin counts as histogram data.
+    Carta::Lib::Hooks::HistogramResult _makeResult( const std::vector<double>& counts,
+            double minValue, double maxValue ) const;
+
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    int m_spectralIndex;
+    int m_minChannel;
+    int m_maxChannel;
+    int m_binCount;
+    double m_minIntensity;
+    double m_maxIntensity;
+    QString m_name;
+    double m_minFrequency;
+    double m_maxFrequency;
+    std::shared_ptr<RegionSpans> m_region;
+    std::function<bool()> m_isCancelled;
+    std::function<void(const Carta::Lib::Hooks::HistogramResult&)> m_partialResult;
+};
+}
+}
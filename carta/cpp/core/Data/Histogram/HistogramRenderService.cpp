@@ -1,29 +1,40 @@
 #include "HistogramRenderService.h"
 #include "HistogramRenderWorker.h"
-#include "HistogramRenderThread.h"
-#include "CartaLib/Hooks/Histogram.h"
+#include "HistogramBase.h"
+#include "HistogramChannelCache.h"
+#include "CartaLib/IImage.h"
 #include "Data/Util.h"
+#include <QtConcurrent/QtConcurrentRun>
 
 namespace Carta {
 namespace Data {
 
+const int HistogramRenderService::BASE_HISTOGRAM_MAX = 8;
+
 HistogramRenderService::HistogramRenderService( QObject * parent ) :
         QObject( parent ),
-        m_worker( nullptr),
-        m_renderThread( nullptr ){
+        m_worker( new HistogramRenderWorker() ){
     m_renderQueued = false;
+    m_requestCount = 0;
+    m_runningRequest = 0;
+    m_cachedResultQueued = false;
+    m_cachedRequest = 0;
+    m_partialRequest = 0;
+    m_partialQueued = false;
+    connect( &m_watcher, SIGNAL(finished()), this, SLOT( _postResult()));
+    connect( &m_cacheWatcher, SIGNAL(finished()), this, SLOT( _cacheBuilt()));
 }
 
 
 bool HistogramRenderService::renderHistogram(std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
         int binCount, int minChannel, int maxChannel, double minFrequency, double maxFrequency,
         const QString& rangeUnits, double minIntensity, double maxIntensity,
-        const QString& fileName ){
+        const QString& fileName, const std::vector<Carta::Lib::RegionInfo>& regions ){
     bool histogramRender = true;
     if ( dataSource ){
 
         _scheduleRender( dataSource, binCount, minChannel, maxChannel, minFrequency, maxFrequency,
-                rangeUnits, minIntensity, maxIntensity, fileName );
+                rangeUnits, minIntensity, maxIntensity, fileName, regions );
     }
     else {
         histogramRender = false;
@@ -32,53 +43,191 @@ bool HistogramRenderService::renderHistogram(std::shared_ptr<Carta::Lib::Image::
 }
 
 
+void HistogramRenderService::_buildChannelCache( std::shared_ptr<HistogramRenderWorker> worker ){
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> image = worker->getDataSource();
+    int spectralIndex = worker->getSpectralIndex();
+    if ( !HistogramChannelCache::isWorthCaching( image, spectralIndex ) ){
+        return;
+    }
+    if ( m_channelCache && m_channelCache->getImage() == image ){
+        return;
+    }
+    if ( m_channelCacheBuild || m_renderQueued ){
+        //Only one build at a time, and scans for requests the user is waiting on
+        //come first; the build is retried when they finish.
+        return;
+    }
+    m_channelCache.reset();
+    std::shared_ptr<HistogramChannelCache> cache( new HistogramChannelCache( image, spectralIndex ) );
+    std::shared_ptr<std::atomic<bool> > cancelled( new std::atomic<bool>( false ) );
+    m_channelCacheBuild = cache;
+    m_cancelBuild = cancelled;
+    m_cacheWatcher.setFuture( QtConcurrent::run( [cache, cancelled](){
+        return cache->build( [cancelled](){ return cancelled->load(); } );
+    }));
+}
+
+
+void HistogramRenderService::_cacheBuilt( ){
+    std::shared_ptr<HistogramChannelCache> cache = m_channelCacheBuild;
+    m_channelCacheBuild.reset();
+    if ( cache && m_cacheWatcher.result() && cache->getImage() == m_worker->getDataSource() ){
+        m_channelCache = cache;
+    }
+    else if ( m_worker->getDataSource() ){
+        //The build was cancelled or the image changed in the meantime.
+        _buildChannelCache( m_worker );
+    }
+}
+
+
 void HistogramRenderService::_scheduleRender( std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
         int binCount, int minChannel, int maxChannel, double minFrequency, double maxFrequency,
-        const QString& rangeUnits, double minIntensity, double maxIntensity, const QString& fileName ){
+        const QString& rangeUnits, double minIntensity, double maxIntensity, const QString& fileName,
+        const std::vector<Carta::Lib::RegionInfo>& regions ){
+    //The running computation keeps its own copy of the parameters, so a new
+    //worker is needed whenever something changes.
+    std::shared_ptr<HistogramRenderWorker> worker( new HistogramRenderWorker( *m_worker ) );
+    bool paramsChanged = worker->setParameters( dataSource, binCount, minChannel, maxChannel, minFrequency, maxFrequency,
+               rangeUnits, minIntensity, maxIntensity, fileName, regions );
+    if ( !paramsChanged ){
+        return;
+    }
+    m_worker = worker;
+    m_requestCount++;
+
+    //A running scan is now out of date.
+    if ( m_renderQueued && m_cancelScan ){
+        m_cancelScan->store( true );
+    }
+
+    //Answer from histograms already computed when possible, so that zooming,
+    //changing the bin count, or dragging the channel range does not read any pixels.
+    if ( _computeFromCaches( worker, &m_cachedResult ) ){
+        m_pendingRender = nullptr;
+        m_cachedRequest = m_requestCount;
+        if ( !m_cachedResultQueued ){
+            m_cachedResultQueued = true;
+            QMetaObject::invokeMethod( this, "_postCachedResult", Qt::QueuedConnection );
+        }
+        return;
+    }
+
     if ( m_renderQueued ) {
+        //Start the latest request once the cancelled scan has stopped.
+        m_pendingRender = [this, worker](){
+            _startScan( worker );
+        };
         return;
     }
-    m_renderQueued = true;
-    if ( !m_worker ){
-        m_worker = new HistogramRenderWorker();
-    }
-    bool paramsChanged = m_worker->setParameters( dataSource, binCount, minChannel, maxChannel, minFrequency, maxFrequency,
-               rangeUnits, minIntensity, maxIntensity, fileName );
-    if ( paramsChanged ){
-
-        int pid = m_worker->computeHist();
-        if ( pid != -1 ){
-            if ( !m_renderThread ){
-                m_renderThread = new HistogramRenderThread( pid );
-                connect( m_renderThread, SIGNAL(finished()), this, SLOT( _postResult()));
-            }
-            else {
-                m_renderThread->setFileDescriptor( pid );
-            }
-            m_renderThread->start();
+    _startScan( worker );
+}
+
+
+bool HistogramRenderService::_computeFromCaches( std::shared_ptr<HistogramRenderWorker> worker,
+        Carta::Lib::Hooks::HistogramResult* result ) const {
+    for ( const std::shared_ptr<HistogramBase>& base : m_baseHistograms ){
+        if ( worker->computeHist( *base, result ) ){
+            return true;
         }
-        else {
-            qDebug() << "Bad file descriptor: "<<pid;
-            m_renderQueued = false;
+    }
+    return m_channelCache && worker->computeHist( *m_channelCache, result );
+}
+
+
+void HistogramRenderService::_startScan( std::shared_ptr<HistogramRenderWorker> worker ){
+    //Scans the user is waiting for take priority over building the channel cache.
+    if ( m_cancelBuild ){
+        m_cancelBuild->store( true );
+    }
+    std::shared_ptr<std::atomic<bool> > cancelled( new std::atomic<bool>( false ) );
+    std::shared_ptr<std::shared_ptr<HistogramBase> > base( new std::shared_ptr<HistogramBase>() );
+    m_cancelScan = cancelled;
+    m_scanBase = base;
+    m_renderQueued = true;
+    m_runningRequest = m_requestCount;
+    int request = m_runningRequest;
+    auto isCancelled = [cancelled](){
+        return cancelled->load();
+    };
+    auto partialResult = [this, request]( const Carta::Lib::Hooks::HistogramResult& partial ){
+        QMutexLocker locker( &m_partialMutex );
+        m_partialResult = partial;
+        m_partialRequest = request;
+        if ( !m_partialQueued ){
+            m_partialQueued = true;
+            QMetaObject::invokeMethod( this, "_postPartialResult", Qt::QueuedConnection );
         }
+    };
+    m_watcher.setFuture( QtConcurrent::run( [worker, isCancelled, partialResult, base](){
+        return worker->computeHist( isCancelled, partialResult, base.get() );
+    }));
+}
+
+
+void HistogramRenderService::_postCachedResult( ){
+    m_cachedResultQueued = false;
+    if ( m_cachedRequest == m_requestCount ){
+        emit histogramResult( m_cachedResult );
     }
-    else {
-        m_renderQueued = false;
+}
+
+
+void HistogramRenderService::_postPartialResult( ){
+    Carta::Lib::Hooks::HistogramResult result;
+    int request = 0;
+    {
+        QMutexLocker locker( &m_partialMutex );
+        result = m_partialResult;
+        request = m_partialRequest;
+        m_partialQueued = false;
+    }
+    if ( m_renderQueued && request == m_runningRequest && request == m_requestCount ){
+        emit histogramResult( result );
     }
 }
 
+
 void HistogramRenderService::_postResult( ){
-    Carta::Lib::Hooks::HistogramResult result = m_renderThread->getResult();
-    emit histogramResult( result );
+    Carta::Lib::Hooks::HistogramResult result = m_watcher.result();
     m_renderQueued = false;
-
+    bool current = ( m_runningRequest == m_requestCount );
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> image = m_worker->getDataSource();
+    if ( m_scanBase && *m_scanBase && (*m_scanBase)->getImage() == image ){
+        //Histograms of other images are no longer useful.
+        m_baseHistograms.remove_if( [image]( const std::shared_ptr<HistogramBase>& base ){
+            return base->getImage() != image;
+        });
+        m_baseHistograms.push_front( *m_scanBase );
+        while ( static_cast<int>( m_baseHistograms.size() ) > BASE_HISTOGRAM_MAX ){
+            m_baseHistograms.pop_back();
+        }
+    }
+    m_scanBase.reset();
+    if ( m_pendingRender ){
+        std::function<void()> pending = m_pendingRender;
+        m_pendingRender = nullptr;
+        pending();
+    }
+    else {
+        _buildChannelCache( m_worker );
+    }
+    if ( current ){
+        emit histogramResult( result );
+    }
 }
 
 
 HistogramRenderService::~HistogramRenderService(){
-    delete m_worker;
-    delete m_renderThread;
+    m_pendingRender = nullptr;
+    if ( m_cancelScan ){
+        m_cancelScan->store( true );
+    }
+    if ( m_cancelBuild ){
+        m_cancelBuild->store( true );
+    }
+    m_watcher.waitForFinished();
+    m_cacheWatcher.waitForFinished();
 }
 }
 }
-
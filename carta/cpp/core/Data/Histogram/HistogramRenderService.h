@@ -6,8 +6,15 @@
 
 #include "CartaLib/CartaLib.h"
 #include "CartaLib/Hooks/HistogramResult.h"
+#include "CartaLib/RegionInfo.h"
 #include <QObject>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include <list>
 #include <memory>
+#include <vector>
 
 namespace Carta {
 namespace Lib {
@@ -21,8 +28,9 @@ class ImageInterface;
 namespace Carta{
 namespace Data{
 
+class HistogramBase;
+class HistogramChannelCache;
 class HistogramRenderWorker;
-class HistogramRenderThread;
 
 class HistogramRenderService : public QObject {
     Q_OBJECT
@@ -46,11 +54,13 @@ public:
      * @param minIntensity - minimum histogram intensity.
      * @param maxIntensity - maximum histogram intensity.
      * @param fileName - the file name.
+     * @param regions - regions restricting the pixels of each plane, or an empty list
+     *      for whole planes.
      */
     bool renderHistogram(std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
             int binCount, int minChannel, int maxChannel, double minFrequency, double maxFrequency,
             const QString& rangeUnits, double minIntensity, double maxIntensity,
-            const QString& fileName);
+            const QString& fileName, const std::vector<Carta::Lib::RegionInfo>& regions );
 
     /**
      * Destructor.
@@ -60,25 +70,74 @@ public:
 signals:
 
     /**
-     * Notification that new histogram data has been computed.
+     * Notification that new histogram data has been computed.  While a large
+     * image is being scanned this is sent periodically with the histogram of the
+     * data read so far; such partial results have a progress less than one.
      */
     void histogramResult( const Carta::Lib::Hooks::HistogramResult& result );
 
 private slots:
 
     void _postResult( );
+    void _postPartialResult( );
+    void _postCachedResult( );
+    void _cacheBuilt( );
 
 private:
+    //Start binning every channel of the image in the background, unless this
+    //has already been done.
+    void _buildChannelCache( std::shared_ptr<HistogramRenderWorker> worker );
+
     void _scheduleRender( std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
                 int binCount, int minChannel, int maxChannel, double minFrequency, double maxFrequency,
                 const QString& rangeUnits, double minIntensity, double maxIntensity,
-                const QString& fileName);
-    HistogramRenderWorker* m_worker;
-    HistogramRenderThread* m_renderThread;
-    bool m_renderQueued;
+                const QString& fileName, const std::vector<Carta::Lib::RegionInfo>& regions );
+
+    //Scan the image on the thread pool.
+    void _startScan( std::shared_ptr<HistogramRenderWorker> worker );
 
+    //Try to answer a request without reading pixels.
+    bool _computeFromCaches( std::shared_ptr<HistogramRenderWorker> worker,
+            Carta::Lib::Hooks::HistogramResult* result ) const;
 
+    //Parameters of the most recent request.
+    std::shared_ptr<HistogramRenderWorker> m_worker;
+
+    //Delivers the result of the computation running on the thread pool.
+    QFutureWatcher<Carta::Lib::Hooks::HistogramResult> m_watcher;
+    bool m_renderQueued;
 
+    //The latest request made while a computation was running.
+    std::function<void()> m_pendingRender;
+
+    //Requests are numbered so that results of superseded scans are not shown.
+    int m_requestCount;
+    int m_runningRequest;
+    //Set to stop the running scan once a newer request supersedes it.
+    std::shared_ptr<std::atomic<bool> > m_cancelScan;
+
+    //The latest partial result, handed over from the thread pool.
+    QMutex m_partialMutex;
+    Carta::Lib::Hooks::HistogramResult m_partialResult;
+    int m_partialRequest;
+    bool m_partialQueued;
+
+    Carta::Lib::Hooks::HistogramResult m_cachedResult;
+    int m_cachedRequest;
+    bool m_cachedResultQueued;
+
+    //High resolution histograms of recent selections, most recent first.
+    std::list<std::shared_ptr<HistogramBase> > m_baseHistograms;
+    //Receives the high resolution histogram of the running scan.
+    std::shared_ptr<std::shared_ptr<HistogramBase> > m_scanBase;
+    //Largest number of high resolution histograms that are kept.
+    static const int BASE_HISTOGRAM_MAX;
+
+    //Per-channel histograms of the current image, and the ones being built.
+    std::shared_ptr<HistogramChannelCache> m_channelCache;
+    std::shared_ptr<HistogramChannelCache> m_channelCacheBuild;
+    QFutureWatcher<bool> m_cacheWatcher;
+    std::shared_ptr<std::atomic<bool> > m_cancelBuild;
 
     HistogramRenderService( const HistogramRenderService& other);
     HistogramRenderService& operator=( const HistogramRenderService& other );
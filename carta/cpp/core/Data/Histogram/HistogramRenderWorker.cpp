@@ -1,27 +1,33 @@
 #include "HistogramRenderWorker.h"
+#include "HistogramEngine.h"
 #include "Data/Util.h"
-#include "Globals.h"
-#include "PluginManager.h"
-#include "CartaLib/Hooks/Histogram.h"
+#include "Data/Region/RegionSpans.h"
 #include "CartaLib/Hooks/HistogramResult.h"
-#include <QFile>
-#include <QDataStream>
-#include <string.h>
-#include <unistd.h>
+#include "CartaLib/IImage.h"
 
 namespace Carta
 {
 namespace Data
 {
 
-HistogramRenderWorker::HistogramRenderWorker(){
+HistogramRenderWorker::HistogramRenderWorker():
+    m_binCount( 0 ),
+    m_minChannel( -1 ),
+    m_maxChannel( -1 ),
+    m_minFrequency( -1 ),
+    m_maxFrequency( -1 ),
+    m_minIntensity( 0 ),
+    m_maxIntensity( 0 ),
+    m_spectralIndex( -1 ),
+    m_channelBounds( -1, -1 ),
+    m_frequencyBounds( -1, -1 ){
 }
 
 
 bool HistogramRenderWorker::setParameters(std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
         int binCount, int minChannel, int maxChannel, double minFrequency, double maxFrequency,
         const QString& rangeUnits, double minIntensity, double maxIntensity,
-        const QString& fileName ){
+        const QString& fileName, const std::vector<Carta::Lib::RegionInfo>& regions ){
     bool paramsChanged = false;
     if ( m_binCount != binCount ){
         m_binCount = binCount;
@@ -61,59 +67,82 @@ bool HistogramRenderWorker::setParameters(std::shared_ptr<Carta::Lib::Image::Ima
     }
     if ( m_dataSource.get() != dataSource.get() ){
         m_dataSource = dataSource;
+        paramsChanged = true;
+    }
+    //Regions are compared by the pixels they cover.
+    std::shared_ptr<RegionSpans> regionSpans;
+    if ( !regions.empty() && m_dataSource && m_dataSource->dims().size() >= 2 ){
+        std::vector<int> dims = m_dataSource->dims();
+        regionSpans.reset( new RegionSpans( regions, dims[0], dims[1] ) );
+    }
+    if ( !regionSpans || !m_regionSpans ){
+        if ( regionSpans != m_regionSpans ){
+            m_regionSpans = regionSpans;
+            paramsChanged = true;
+        }
+    }
+    else if ( *regionSpans != *m_regionSpans ){
+        m_regionSpans = regionSpans;
+        paramsChanged = true;
+    }
+    if ( paramsChanged ){
+        m_spectralIndex = Util::getAxisIndex( m_dataSource, Carta::Lib::AxisInfo::KnownType::SPECTRAL );
+        if ( m_minFrequency < 0 || m_maxFrequency < 0 ){
+            m_channelBounds = std::pair<int,int>( m_minChannel, m_maxChannel );
+            m_frequencyBounds = HistogramEngine::getFrequencyBounds( m_dataSource,
+                    m_minChannel, m_maxChannel, m_rangeUnits );
+        }
+        else {
+            m_channelBounds = HistogramEngine::getChannelBounds( m_dataSource,
+                    m_minFrequency, m_maxFrequency, m_rangeUnits );
+            m_frequencyBounds = std::pair<double,double>( m_minFrequency, m_maxFrequency );
+        }
     }
     return paramsChanged;
 }
 
 
-int HistogramRenderWorker::computeHist(){
-    //Note:  we compute the histogram in a separate process because casacore tables
-    //cannot be accessed by different threads at the same time.
-    int histogramPipes [2];
-    if (pipe (histogramPipes)){
-        qDebug() << "*** HistogramRenderWorker::run: pipe creation failed: " << strerror (errno);
-        return -1;
-    }
+Carta::Lib::Hooks::HistogramResult HistogramRenderWorker::computeHist( const std::function<bool()>& isCancelled,
+        const std::function<void(const Carta::Lib::Hooks::HistogramResult&)>& partialResult,
+        std::shared_ptr<HistogramBase>* base ) const {
+    HistogramEngine engine( m_dataSource, m_spectralIndex );
+    _initEngine( engine );
+    engine.setMonitor( isCancelled, partialResult );
+    return engine.compute( base );
+}
 
-    int pid = fork ();
-    if (pid == -1){
-        // Failure
-        qDebug() << "*** HistogramRenderWorker::run: fork failed: " << strerror (errno);
-        return -1;
 
-    }
-    else if (pid != 0){
-        // The original process comes here.
-        close (histogramPipes [1]); // close write end of the pipe
-        return histogramPipes [0]; // return the read end of the pipe
-    }
+bool HistogramRenderWorker::computeHist( const HistogramBase& base,
+        Carta::Lib::Hooks::HistogramResult* result ) const {
+    HistogramEngine engine( m_dataSource, m_spectralIndex );
+    _initEngine( engine );
+    return engine.computeFromBase( base, result );
+}
 
-    // We're our own process
-    auto result = Globals::instance()-> pluginManager()
-                          -> prepare <Carta::Lib::Hooks::HistogramHook>(m_dataSource, m_binCount,
-                                  m_minChannel, m_maxChannel, m_minFrequency, m_maxFrequency, m_rangeUnits,
-                                  m_minIntensity, m_maxIntensity);
-    auto lam = [=] ( const Carta::Lib::Hooks::HistogramResult &data ) {
-        m_result = data;
-    };
-    try {
-        result.forEach( lam );
-    }
-    catch( char*& error ){
-        qDebug() << "HistogramRenderWorker::run: caught error: " << error;
-        m_result.setName( Util::ERROR +": "+QString(error) );
-    }
 
-    QFile file;
-    if ( !file.open( histogramPipes[1], QIODevice::WriteOnly, QFileDevice::AutoCloseHandle ) ){
-        qDebug() << "Could not write histogram results";
-        return 0;
-    }
-    QDataStream dataStream( &file );
-    dataStream << m_result;
-    file.close();
-    exit(0);
-    return 0;
+bool HistogramRenderWorker::computeHist( const HistogramChannelCache& cache,
+        Carta::Lib::Hooks::HistogramResult* result ) const {
+    HistogramEngine engine( m_dataSource, m_spectralIndex );
+    _initEngine( engine );
+    return engine.computeFromCache( cache, result );
+}
+
+
+std::shared_ptr<Carta::Lib::Image::ImageInterface> HistogramRenderWorker::getDataSource() const {
+    return m_dataSource;
+}
+
+
+int HistogramRenderWorker::getSpectralIndex() const {
+    return m_spectralIndex;
+}
+
+
+void HistogramRenderWorker::_initEngine( HistogramEngine& engine ) const {
+    engine.setChannelRange( m_channelBounds.first, m_channelBounds.second );
+    engine.setBins( m_binCount, m_minIntensity, m_maxIntensity );
+    engine.setResultInfo( m_fileName, m_frequencyBounds.first, m_frequencyBounds.second );
+    engine.setRegion( m_regionSpans );
 }
 
 
@@ -1,11 +1,14 @@
 /**
- * Initiates the work of computing the histogram in a separate process.
+ * Holds the parameters of a histogram computation and performs the computation.
  **/
 
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <vector>
 #include "CartaLib/Hooks/HistogramResult.h"
+#include "CartaLib/RegionInfo.h"
 
 namespace Carta {
 namespace Lib {
@@ -20,6 +23,11 @@ class ImageInterface;
 namespace Carta{
 namespace Data{
 
+class HistogramBase;
+class HistogramChannelCache;
+class HistogramEngine;
+class RegionSpans;
+
 class HistogramRenderWorker{
 
 public:
@@ -30,7 +38,14 @@ public:
     HistogramRenderWorker();
 
     /**
-     * Store the parameters needed for computing the histogram.
+     * Copy constructor; each computation works on its own copy of the parameters.
+     * @param other - the parameters to copy.
+     */
+    HistogramRenderWorker( const HistogramRenderWorker& other ) = default;
+
+    /**
+     * Store the parameters needed for computing the histogram.  The channel and
+     * frequency bounds are resolved here, so this should be called on the main thread.
      * @param dataSource - the image that will bee the source of the histogram.
      * @param binCount - the number of bins the histogram should have.
      * @param minChannel - the minimum channel or -1 if there is no minimum.
@@ -41,18 +56,58 @@ public:
      * @param minIntensity - minimum histogram intensity.
      * @param maxIntensity - maximum histogram intensity.
      * @param fileName - the file name.
+     * @param regions - regions restricting the pixels of each plane, or an empty list
+     *      for whole planes.
      */
     bool setParameters(std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
             int binCount, int minChannel, int maxChannel, double minFrequency, double maxFrequency,
             const QString& rangeUnits, double minIntensity, double maxIntensity,
-            const QString& fileName);
+            const QString& fileName, const std::vector<Carta::Lib::RegionInfo>& regions );
 
     /**
-     * Performs the work of computing the histogram data in a separate process.
-     * @return - the file descriptor for the pipe that can be used to read the
-     *      histogram data.
+     * Performs the work of computing the histogram data.  This may be called from
+     * any thread.
+     * @param isCancelled - polled during the computation; it stops early when this returns true.
+     * @param partialResult - called from the computing thread with histograms of the
+     *      data scanned so far.
+     * @param base - if not null, set to a high resolution histogram of the selection.
+     * @return - the computed data for a histogram plot.
      */
-    int computeHist();
+    Carta::Lib::Hooks::HistogramResult computeHist( const std::function<bool()>& isCancelled = nullptr,
+            const std::function<void(const Carta::Lib::Hooks::HistogramResult&)>& partialResult = nullptr,
+            std::shared_ptr<HistogramBase>* base = nullptr ) const;
+
+    /**
+     * Computes the histogram data by rebinning a high resolution histogram.
+     * @param base - a high resolution histogram of a selection.
+     * @param result - set to the computed data if the base could answer the request.
+     * @return - true if the histogram was computed from the base; false if the image
+     *      needs to be scanned.
+     */
+    bool computeHist( const HistogramBase& base,
+            Carta::Lib::Hooks::HistogramResult* result ) const;
+
+    /**
+     * Computes the histogram data from cached per-channel histograms.
+     * @param cache - per-channel histograms of the image.
+     * @param result - set to the computed data if the cache could answer the request.
+     * @return - true if the histogram was computed from the cache; false if the image
+     *      needs to be scanned.
+     */
+    bool computeHist( const HistogramChannelCache& cache,
+            Carta::Lib::Hooks::HistogramResult* result ) const;
+
+    /**
+     * Returns the image that is the source of the histogram.
+     * @return - the source image.
+     */
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> getDataSource() const;
+
+    /**
+     * Returns the index of the spectral axis in the source image.
+     * @return - the index of the spectral axis or -1 if there is no spectral axis.
+     */
+    int getSpectralIndex() const;
 
     /**
      * Destructor.
@@ -60,6 +115,9 @@ public:
     ~HistogramRenderWorker();
 
 private:
+    //Set up an engine with the stored parameters.
+    void _initEngine( HistogramEngine& engine ) const;
+
     std::shared_ptr<Carta::Lib::Image::ImageInterface> m_dataSource;
     int m_binCount;
     int m_minChannel;
@@ -70,9 +128,11 @@ private:
     double m_minIntensity;
     double m_maxIntensity;
     QString m_fileName;
-    Carta::Lib::Hooks::HistogramResult m_result;
+    int m_spectralIndex;
+    std::pair<int,int> m_channelBounds;
+    std::pair<double,double> m_frequencyBounds;
+    std::shared_ptr<RegionSpans> m_regionSpans;
 
-    HistogramRenderWorker( const HistogramRenderWorker& other);
     HistogramRenderWorker& operator=( const HistogramRenderWorker& other );
 };
 }
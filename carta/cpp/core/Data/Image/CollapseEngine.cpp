@@ -0,0 +1,293 @@
+#include "CollapseEngine.h"
+#include "MemoryImage.h"
+#include "Algorithms/bulkRead.h"
+#include "Algorithms/parallelAlgorithms.h"
+#include "CartaLib/IImage.h"
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+#include <cmath>
+#include <limits>
+
+namespace Carta {
+
+namespace Data {
+
+namespace {
+//Fewer pixels than this are not worth handing to another thread.
+const int64_t MIN_PIXELS_PER_THREAD = 65536;
+}
+
+CollapseEngine::CollapseEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex ):
+    m_image( image ),
+    m_spectralIndex( spectralIndex ),
+    m_firstChannel( 0 ),
+    m_lastChannel( -1 ),
+    m_minValue( -std::numeric_limits<double>::infinity() ),
+    m_maxValue( std::numeric_limits<double>::infinity() ){
+    if ( m_image && m_spectralIndex >= 0 && m_spectralIndex < static_cast<int>( m_image->dims().size() ) ){
+        m_lastChannel = m_image->dims()[m_spectralIndex] - 1;
+    }
+}
+
+
+std::vector<std::shared_ptr<Carta::Lib::Image::ImageInterface> > CollapseEngine::compute(
+        const std::vector<CollapseType>& collapseTypes ) const {
+    std::vector<std::shared_ptr<Carta::Lib::Image::ImageInterface> > images;
+    if ( !m_image || collapseTypes.empty() ){
+        return images;
+    }
+    std::vector<int> dims = m_image->dims();
+    int dimCount = dims.size();
+    //The planes lie in the first two axes, so the collapsed axis must be another one.
+    if ( dimCount < 3 || m_spectralIndex < 2 || m_spectralIndex >= dimCount ){
+        qDebug() << "Collapsing needs a spectral axis after the first two axes.";
+        return images;
+    }
+    int firstChannel = std::max( m_firstChannel, 0 );
+    int lastChannel = std::min( m_lastChannel, dims[m_spectralIndex] - 1 );
+    if ( firstChannel > lastChannel ){
+        return images;
+    }
+
+    //Only the sums needed by the requested images are kept, one value per pixel.
+    bool needWeights = false;
+    bool needFirst = false;
+    bool needSecond = false;
+    bool needCount = false;
+    bool needPeak = false;
+    for ( CollapseType collapseType : collapseTypes ){
+        switch ( collapseType ){
+        case CollapseType::Moment2:
+            needSecond = true;
+            //fall through
+        case CollapseType::Moment1:
+            needFirst = true;
+            //fall through
+        case CollapseType::Moment0:
+            needWeights = true;
+            break;
+        case CollapseType::Mean:
+            needWeights = true;
+            needCount = true;
+            break;
+        case CollapseType::Peak:
+            needPeak = true;
+            break;
+        }
+    }
+    int64_t planeSize = int64_t( dims[0] ) * dims[1];
+    std::vector<double> weights( needWeights ? planeSize : 0, 0 );
+    std::vector<double> firstSums( needFirst ? planeSize : 0, 0 );
+    std::vector<double> secondSums( needSecond ? planeSize : 0, 0 );
+    std::vector<int> counts( needCount ? planeSize : 0, 0 );
+    std::vector<float> peaks( needPeak ? planeSize : 0, std::numeric_limits<float>::quiet_NaN() );
+
+    //Spectral coordinates are taken relative to the first channel to keep the
+    //sums of squares accurate.
+    auto spectralValue = [this] ( int channel ){
+        if ( channel < static_cast<int>( m_spectralValues.size() ) ){
+            return m_spectralValues[channel];
+        }
+        return double( channel );
+    };
+    double reference = spectralValue( firstChannel );
+    double channelWidth = 1;
+    if ( lastChannel > firstChannel ){
+        channelWidth = std::fabs( ( spectralValue( lastChannel ) - reference ) / ( lastChannel - firstChannel ) );
+    }
+    else if ( dims[m_spectralIndex] > 1 ){
+        int other = firstChannel > 0 ? firstChannel - 1 : firstChannel + 1;
+        channelWidth = std::fabs( spectralValue( other ) - reference );
+    }
+
+    //At most two planes are held: the one being accumulated and the next one being read.
+    QFuture<std::vector<float> > nextPlane = QtConcurrent::run( [this, firstChannel](){
+        return _readChannel( firstChannel );
+    });
+    for ( int channel = firstChannel; channel <= lastChannel; channel++ ){
+        std::vector<float> plane = nextPlane.result();
+        if ( m_isCancelled && m_isCancelled() ){
+            return images;
+        }
+        if ( channel < lastChannel ){
+            nextPlane = QtConcurrent::run( [this, channel](){
+                return _readChannel( channel + 1 );
+            });
+        }
+        if ( static_cast<int64_t>( plane.size() ) != planeSize ){
+            continue;
+        }
+        double offset = spectralValue( channel ) - reference;
+        double minValue = m_minValue;
+        double maxValue = m_maxValue;
+        auto accumulate = [&] ( int64_t begin, int64_t end, int /*part*/ ){
+            for ( int64_t i = begin; i < end; i++ ){
+                float value = plane[i];
+                if ( std::isnan( value ) || value < minValue || value > maxValue ){
+                    continue;
+                }
+                if ( needWeights ){
+                    weights[i] += value;
+                }
+                if ( needFirst ){
+                    firstSums[i] += value * offset;
+                }
+                if ( needSecond ){
+                    secondSums[i] += value * offset * offset;
+                }
+                if ( needCount ){
+                    counts[i]++;
+                }
+                if ( needPeak && !( value <= peaks[i] ) ){
+                    peaks[i] = value;
+                }
+            }
+        };
+        Carta::Core::Algorithms::parallelRanges( planeSize, MIN_PIXELS_PER_THREAD, accumulate );
+    }
+
+    //The collapsed images keep every axis so that they share the coordinates of the cube.
+    std::vector<int> collapsedDims( dimCount, 1 );
+    collapsedDims[0] = dims[0];
+    collapsedDims[1] = dims[1];
+    QString unit = m_image->getPixelUnit().toStr();
+    Carta::Lib::Image::MetaDataInterface::SharedPtr metaData = m_image->metaData();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for ( CollapseType collapseType : collapseTypes ){
+        std::shared_ptr<std::vector<float> > data( new std::vector<float>( planeSize, nan ) );
+        std::vector<float>& values = *data;
+        QString collapsedUnit = unit;
+        auto fill = [&] ( int64_t begin, int64_t end, int /*part*/ ){
+            for ( int64_t i = begin; i < end; i++ ){
+                switch ( collapseType ){
+                case CollapseType::Moment0:
+                    values[i] = weights[i] * channelWidth;
+                    break;
+                case CollapseType::Moment1:
+                    if ( weights[i] > 0 ){
+                        values[i] = reference + firstSums[i] / weights[i];
+                    }
+                    break;
+                case CollapseType::Moment2:
+                    if ( weights[i] > 0 ){
+                        double mean = firstSums[i] / weights[i];
+                        double variance = secondSums[i] / weights[i] - mean * mean;
+                        values[i] = std::sqrt( std::max( variance, 0.0 ) );
+                    }
+                    break;
+                case CollapseType::Mean:
+                    if ( counts[i] > 0 ){
+                        values[i] = weights[i] / counts[i];
+                    }
+                    break;
+                case CollapseType::Peak:
+                    values[i] = peaks[i];
+                    break;
+                }
+            }
+        };
+        Carta::Core::Algorithms::parallelRanges( planeSize, MIN_PIXELS_PER_THREAD, fill );
+        if ( collapseType == CollapseType::Moment0 && !m_spectralUnit.isEmpty() ){
+            collapsedUnit = unit + "." + m_spectralUnit;
+        }
+        else if ( collapseType == CollapseType::Moment1 || collapseType == CollapseType::Moment2 ){
+            collapsedUnit = m_spectralUnit;
+        }
+        images.push_back( std::make_shared<MemoryImage>( collapsedDims, data, collapsedUnit, metaData ) );
+    }
+    return images;
+}
+
+
+std::vector<float> CollapseEngine::_readChannel( int channel ) const {
+    std::vector<float> values;
+    std::vector<int> dims = m_image->dims();
+    SliceND planeSlice;
+    planeSlice.slice( 0 );
+    planeSlice.slice( 1 );
+    for ( int i = 2; i < static_cast<int>( dims.size() ); i++ ){
+        int pos = channel;
+        if ( i != m_spectralIndex ){
+            pos = i < static_cast<int>( m_pos.size() ) ? m_pos[i] : 0;
+            pos = Carta::Lib::clamp( pos, 0, dims[i] - 1 );
+        }
+        planeSlice.slice( i ).start( pos ).end( pos + 1 );
+    }
+    std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view( m_image->getDataSlice( planeSlice ) );
+    if ( !view ){
+        return values;
+    }
+    values = Carta::Core::Algorithms::readAll<float>( view.get() );
+    //A mask that cannot be read is treated as no mask.
+    std::unique_ptr<Carta::Lib::NdArray::Byte> maskView;
+    if ( m_image->hasMask() ){
+        maskView.reset( m_image->getMaskSlice( planeSlice ) );
+    }
+    if ( maskView ){
+        std::vector<uint8_t> mask = Carta::Core::Algorithms::readAll<uint8_t>( maskView->rawView() );
+        for ( size_t i = 0; i < values.size(); i++ ){
+            if ( !mask[i] ){
+                values[i] = std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+    }
+    return values;
+}
+
+
+void CollapseEngine::setChannelRange( int firstChannel, int lastChannel ){
+    m_firstChannel = firstChannel;
+    m_lastChannel = lastChannel;
+}
+
+
+void CollapseEngine::setIncludeRange( double minValue, double maxValue ){
+    m_minValue = minValue;
+    m_maxValue = maxValue;
+}
+
+
+void CollapseEngine::setMonitor( const std::function<bool()>& isCancelled ){
+    m_isCancelled = isCancelled;
+}
+
+
+void CollapseEngine::setPosition( const std::vector<int>& pos ){
+    m_pos = pos;
+}
+
+
+void CollapseEngine::setSpectralValues( const std::vector<double>& spectralValues, const QString& unit ){
+    m_spectralValues = spectralValues;
+    m_spectralUnit = unit;
+}
+
+
+QString CollapseEngine::toString( CollapseType collapseType ){
+    QString name;
+    switch ( collapseType ){
+    case CollapseType::Moment0:
+        name = "moment 0";
+        break;
+    case CollapseType::Moment1:
+        name = "moment 1";
+        break;
+    case CollapseType::Moment2:
+        name = "moment 2";
+        break;
+    case CollapseType::Peak:
+        name = "peak";
+        break;
+    case CollapseType::Mean:
+        name = "mean";
+        break;
+    }
+    return name;
+}
+
+
+CollapseEngine::~CollapseEngine(){
+}
+}
+}
@@ -0,0 +1,130 @@
+/***
+ * Collapses a channel range of an image cube into moment maps and other images of
+ * the first two axes.
+ */
+
+#pragma once
+
+#include <QString>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta {
+
+namespace Data {
+
+class CollapseEngine {
+
+public:
+
+    /// Ways of combining the channels of each pixel.
+    enum class CollapseType {
+        //Integrated intensity.
+        Moment0,
+        //Intensity weighted mean spectral coordinate.
+        Moment1,
+        //Intensity weighted dispersion of the spectral coordinate about moment 1.
+        Moment2,
+        //Largest value.
+        Peak,
+        //Mean value.
+        Mean
+    };
+
+    /**
+     * Constructor.
+     * @param image - the image cube to collapse.
+     * @param spectralIndex - the index of the axis to collapse; it must follow the first two axes.
+     */
+    CollapseEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, int spectralIndex );
+
+    /**
+     * Compute the collapsed images.  Channels are read one at a time, the next one
+     * while the current one is accumulated on the threads of the global thread pool,
+     * and all of the requested images are built from the same pass.
+     * @param collapseTypes - the images to compute.
+     * @return - an image for each requested type, in the same order, with the collapsed
+     *      axis and any others beyond the first two reduced to length one; empty if the
+     *      image is unsuitable or the computation was cancelled.
+     */
+    std::vector<std::shared_ptr<Carta::Lib::Image::ImageInterface> > compute(
+            const std::vector<CollapseType>& collapseTypes ) const;
+
+    /**
+     * Set the channels to collapse.
+     * @param firstChannel - the first channel to include.
+     * @param lastChannel - the last channel to include.
+     */
+    void setChannelRange( int firstChannel, int lastChannel );
+
+    /**
+     * Only include pixel values inside a range; others are treated as blanked.
+     * @param minValue - the smallest value to include.
+     * @param maxValue - the largest value to include.
+     */
+    void setIncludeRange( double minValue, double maxValue );
+
+    /**
+     * Set a callback for stopping a long computation.
+     * @param isCancelled - polled between channels; when it returns true the
+     *      computation stops and no images are produced.
+     */
+    void setMonitor( const std::function<bool()>& isCancelled );
+
+    /**
+     * Set the position along axes other than the first two and the collapsed axis.
+     * @param pos - the index along every image axis; entries for the first two and
+     *      the collapsed axis are ignored.  Missing entries are taken to be zero.
+     */
+    void setPosition( const std::vector<int>& pos );
+
+    /**
+     * Set the spectral coordinate of each channel, used by the moments.
+     * @param spectralValues - the coordinate of every channel of the collapsed axis.
+     * @param unit - the unit of the coordinates.
+     */
+    void setSpectralValues( const std::vector<double>& spectralValues, const QString& unit );
+
+    /**
+     * Returns a name for a collapsed image.
+     * @param collapseType - the way channels were combined.
+     * @return - a short description such as "moment 0".
+     */
+    static QString toString( CollapseType collapseType );
+
+    /**
+     * Destructor.
+     */
+    ~CollapseEngine();
+
+private:
+
+    //Read one plane of the first two axes, with masked pixels replaced by NaN.
+    std::vector<float> _readChannel( int channel ) const;
+
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    int m_spectralIndex;
+    int m_firstChannel;
+    int m_lastChannel;
+    double m_minValue;
+    double m_maxValue;
+    std::vector<int> m_pos;
+    std::vector<double> m_spectralValues;
+    QString m_spectralUnit;
+    std::function<bool()> m_isCancelled;
+
+    CollapseEngine( const CollapseEngine& other);
+    CollapseEngine& operator=( const CollapseEngine& other );
+};
+}
+}
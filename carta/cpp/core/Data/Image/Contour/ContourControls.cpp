@@ -25,6 +25,8 @@ const QString ContourControls::LEVEL_LIST = "levels";
 
 const QString ContourControls::LEVEL_SEPARATOR = ";";
 
+const QString ContourControls::PREFETCH_CHANNELS = "prefetchChannels";
+
 
 class ContourControls::Factory : public Carta::State::CartaObjectFactory {
 
@@ -290,6 +292,7 @@ void ContourControls::_initializeDefaultState(){
 
     int contourSetCount = m_dataContours.size();
     m_stateData.insertArray( CONTOUR_SETS, contourSetCount );
+    m_stateData.insertValue<int>( PREFETCH_CHANNELS, 0 );
     _updateContourSetState();
 }
 
@@ -530,6 +533,23 @@ void ContourControls::_initializeCallbacks(){
         return result;
     });
 
+    addCommandCallback( "setPrefetchChannels", [=] (const QString & /*cmd*/,
+                        const QString & params, const QString & /*sessionId*/) -> QString {
+        std::set<QString> keys = {PREFETCH_CHANNELS};
+        std::map<QString,QString> dataValues = Carta::State::UtilState::parseParamMap( params, keys );
+        bool validInt = false;
+        QString result;
+        int channels = dataValues[*keys.begin()].toInt(&validInt);
+        if ( validInt ){
+            setPrefetchChannels( channels );
+        }
+        else {
+            result = "The number of channels to precompute contours for must be an integer: "+dataValues[*keys.begin()];
+        }
+        Util::commandPostProcess( result );
+        return result;
+    });
+
     addCommandCallback( "setLevelMin", [=] (const QString & /*cmd*/,
                             const QString & params, const QString & /*sessionId*/) -> QString {
             std::set<QString> keys = {GeneratorState::LEVEL_MIN};
@@ -731,6 +751,18 @@ QString ContourControls::setLevelCount( int count ){
     return result;
 }
 
+void ContourControls::setPrefetchChannels( int channels ){
+    if ( channels < 0 ){
+        channels = -1;
+    }
+    int oldChannels = m_stateData.getValue<int>( PREFETCH_CHANNELS );
+    if ( channels != oldChannels ){
+        m_stateData.setValue<int>( PREFETCH_CHANNELS, channels );
+        m_stateData.flushState();
+        emit prefetchChannelsChanged( channels );
+    }
+}
+
 QString ContourControls::setLevelMax( double value ){
     QString result = m_generatorState->setLevelMax( value );
     return result;
@@ -151,6 +151,14 @@ public:
      */
     void setPercentIntensityMap( IPercentIntensityMap* mapper );
 
+    /**
+     * Set how many channels on each side of the current one should have their contours
+     * computed in the background, so that animating with contours is not held up.
+     * @param channels - the number of channels on each side of the current one, 0 to
+     *      compute only the current channel, or a negative number for all channels.
+     */
+    void setPrefetchChannels( int channels );
+
     /**
      * Set the interval used to generate contour levels between a min and a max.
      * @param interval - a fixed interval of spacing to use between contour levels.
@@ -183,11 +191,20 @@ public:
 signals:
     void drawContoursChanged();
 
+    /**
+     * Signal that the number of channels to compute contours for in the background
+     * has changed.
+     * @param channels - the number of channels on each side of the current one, or a
+     *      negative number for all channels.
+     */
+    void prefetchChannelsChanged( int channels );
+
 private:
     const static QString CONTOUR_SETS;
     const static QString CONTOUR_SET_NAME;
     const static QString LEVEL_LIST;
     const static QString LEVEL_SEPARATOR;
+    const static QString PREFETCH_CHANNELS;
 
     void _addContourSet( const std::vector<double>& levels, const QString& contourSetName );
 
@@ -9,6 +9,7 @@
 #include "Data/Image/Grid/GridControls.h"
 #include "Data/Image/Contour/ContourControls.h"
 #include "Data/Image/Contour/DataContours.h"
+#include "Data/Image/CollapseEngine.h"
 
 #include "Data/Settings.h"
 #include "Data/DataLoader.h"
@@ -16,14 +17,21 @@
 
 #include "Data/Region/Region.h"
 
+#include "Data/Profile/ProfileEngine.h"
+#include "Data/Profile/PVSliceGenerator.h"
+#include "Data/Units/UnitsSpectral.h"
 #include "Data/Util.h"
 #include "ImageView.h"
 #include "CartaLib/IImage.h"
+#include "CartaLib/ProfileInfo.h"
 #include "Globals.h"
 
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QDebug>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QList>
 #include <QtCore/QDir>
+#include <cmath>
 #include <memory>
 #include <set>
 
@@ -103,6 +111,8 @@ Controller::Controller( const QString& path, const QString& id ) :
      m_contourControls->setPercentIntensityMap( this );
      connect( m_contourControls.get(), SIGNAL(drawContoursChanged()),
              this, SLOT(_loadViewQueued()));
+     connect( m_contourControls.get(), SIGNAL(prefetchChannelsChanged(int)),
+             this, SLOT(_contourPrefetchChanged(int)));
 
      Settings* settingsObj = objMan->createObject<Settings>();
      m_settings.reset( settingsObj );
@@ -137,6 +147,182 @@ QString Controller::_addDataImage(const QString& fileName, bool* success ) {
 }
 
 
+QString Controller::addCollapsedImages( const QStringList& collapseTypes,
+        int firstChannel, int lastChannel, double minValue, double maxValue ){
+    QString result;
+    std::shared_ptr<Layer> layer = getLayer();
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> image;
+    if ( layer ){
+        image = layer->_getImage();
+    }
+    if ( !image ){
+        result = "There is no image to collapse.";
+        return result;
+    }
+    int spectralIndex = Util::getAxisIndex( image, AxisInfo::KnownType::SPECTRAL );
+    if ( spectralIndex < 0 ){
+        result = "The image does not have a spectral axis to collapse.";
+        return result;
+    }
+
+    std::vector<CollapseEngine::CollapseType> types;
+    const std::vector<CollapseEngine::CollapseType> knownTypes = {
+            CollapseEngine::CollapseType::Moment0, CollapseEngine::CollapseType::Moment1,
+            CollapseEngine::CollapseType::Moment2, CollapseEngine::CollapseType::Peak,
+            CollapseEngine::CollapseType::Mean };
+    for ( const QString& collapseType : collapseTypes ){
+        bool found = false;
+        for ( CollapseEngine::CollapseType knownType : knownTypes ){
+            if ( collapseType.trimmed().compare( CollapseEngine::toString( knownType ), Qt::CaseInsensitive ) == 0 ){
+                types.push_back( knownType );
+                found = true;
+                break;
+            }
+        }
+        if ( !found ){
+            result = "Unrecognized collapse type: "+collapseType;
+            return result;
+        }
+    }
+    if ( types.empty() ){
+        result = "Please specify the images to compute.";
+        return result;
+    }
+    int channelCount = image->dims()[spectralIndex];
+    if ( lastChannel < 0 ){
+        lastChannel = channelCount - 1;
+    }
+    if ( firstChannel < 0 || firstChannel > lastChannel || lastChannel >= channelCount ){
+        result = "Invalid channel range ["+QString::number( firstChannel )+", "+
+                QString::number( lastChannel )+"] for an image with "+
+                QString::number( channelCount )+" channels.";
+        return result;
+    }
+    if ( std::isnan( minValue ) || std::isnan( maxValue ) || minValue > maxValue ){
+        result = "Invalid pixel value range ["+QString::number( minValue )+", "+
+                QString::number( maxValue )+"] for collapsing.";
+        return result;
+    }
+
+    std::vector<double> spectralValues = _getVelocities( image );
+    std::shared_ptr<CollapseEngine> engine( new CollapseEngine( image, spectralIndex ) );
+    engine->setChannelRange( firstChannel, lastChannel );
+    engine->setIncludeRange( minValue, maxValue );
+    engine->setPosition( getImageSlice() );
+    //Without a velocity conversion the moments are left in channels.
+    if ( !spectralValues.empty() ){
+        engine->setSpectralValues( spectralValues, UnitsSpectral::UNIT_KMS );
+    }
+
+    QString layerName = layer->_getLayerName();
+    typedef std::vector<std::shared_ptr<Carta::Lib::Image::ImageInterface> > CollapsedImages;
+    QFutureWatcher<CollapsedImages>* watcher = new QFutureWatcher<CollapsedImages>( this );
+    connect( watcher, &QFutureWatcher<CollapsedImages>::finished, this, [=](){
+        CollapsedImages collapsedImages = watcher->result();
+        for ( size_t i = 0; i < collapsedImages.size() && i < types.size(); i++ ){
+            _addDataImage( collapsedImages[i], layerName + " " + CollapseEngine::toString( types[i] ) );
+        }
+        if ( collapsedImages.empty() ){
+            ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
+            hr->registerError( "Could not collapse "+layerName );
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture( QtConcurrent::run( [engine, types](){
+        return engine->compute( types );
+    }));
+    return result;
+}
+
+
+QString Controller::addPVSlice( const std::vector<std::pair<double,double> >& vertices, double halfWidth ){
+    QString result;
+    std::shared_ptr<Layer> layer = getLayer();
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> image;
+    if ( layer ){
+        image = layer->_getImage();
+    }
+    if ( !image ){
+        result = "There is no image to slice.";
+        return result;
+    }
+    int spectralIndex = Util::getAxisIndex( image, AxisInfo::KnownType::SPECTRAL );
+    if ( spectralIndex < 0 ){
+        result = "The image does not have a spectral axis for a position-velocity slice.";
+        return result;
+    }
+    if ( vertices.size() < 2 ){
+        result = "A position-velocity slice needs at least two points.";
+        return result;
+    }
+    if ( !( halfWidth >= 0 ) ){
+        result = "Invalid position-velocity slice width: "+QString::number( halfWidth );
+        return result;
+    }
+
+    std::vector<double> spectralValues = _getVelocities( image );
+    QString spectralLabel = "Velocity";
+    QString spectralUnit = UnitsSpectral::UNIT_KMS;
+    if ( spectralValues.empty() ){
+        spectralLabel = "Channel";
+        spectralUnit = "";
+    }
+    QString pixelUnit = image->getPixelUnit().toStr();
+    std::shared_ptr<PVSliceGenerator> generator( new PVSliceGenerator( image, spectralIndex ) );
+    generator->setPosition( getImageSlice() );
+
+    QString layerName = layer->_getLayerName();
+    typedef std::shared_ptr<Carta::Lib::Image::ImageInterface> SliceImage;
+    QFutureWatcher<SliceImage>* watcher = new QFutureWatcher<SliceImage>( this );
+    connect( watcher, &QFutureWatcher<SliceImage>::finished, this, [=](){
+        SliceImage sliceImage = watcher->result();
+        if ( sliceImage ){
+            _addDataImage( sliceImage, layerName + " PV slice" );
+        }
+        else {
+            ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
+            hr->registerError( "Could not compute a position-velocity slice of "+layerName );
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture( QtConcurrent::run( [=](){
+        PVSliceGenerator::PVSlice slice = generator->compute( vertices, halfWidth );
+        return PVSliceGenerator::toImage( slice, pixelUnit, spectralValues, spectralLabel, spectralUnit );
+    }));
+    return result;
+}
+
+
+void Controller::_addDataImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const QString& name ){
+    m_stack->_addDataImage( image, name );
+    if ( isStackSelectAuto() ){
+        QStringList selectedLayers;
+        QString stackId= m_stack->_getCurrentId();
+        selectedLayers.append( stackId );
+        _setLayersSelected( selectedLayers );
+    }
+    _updateDisplayAxes();
+    emit dataChanged( this );
+}
+
+
+std::vector<double> Controller::_getVelocities( std::shared_ptr<Carta::Lib::Image::ImageInterface> image ) const {
+    //The spectral conversion uses plugin hooks, so it is done here on the main thread.
+    Carta::Lib::ProfileInfo profileInfo;
+    profileInfo.setSpectralType( UnitsSpectral::NAME_VELOCITY_RADIO );
+    profileInfo.setSpectralUnit( UnitsSpectral::UNIT_KMS );
+    std::vector<double> spectralValues = ProfileEngine::getSpectralValues( image, profileInfo );
+    //Channel indices come back when there is no velocity conversion.
+    for ( int i = 0; i < static_cast<int>( spectralValues.size() ); i++ ){
+        if ( spectralValues[i] != i ){
+            return spectralValues;
+        }
+    }
+    return std::vector<double>();
+}
+
+
 void Controller::_addDataRegions( std::vector<std::shared_ptr<Region> > regions ){
     if ( regions.size() > 0 ){
         m_stack->_addDataRegions( regions );
@@ -241,6 +427,11 @@ void Controller::_contourSetRemoved( const QString setName ){
     }
 }
 
+void Controller::_contourPrefetchChanged( int channels ){
+    m_stack->_setContourPrefetch( channels );
+    _loadViewQueued();
+}
+
 
 void Controller::_displayAxesChanged(std::vector<AxisInfo::KnownType> displayAxisTypes,
         bool applyAll ){
@@ -453,6 +644,84 @@ void Controller::_gridChanged( const StateInterface& state, bool applyAll ){
 }
 
 void Controller::_initializeCallbacks(){
+    addCommandCallback( "collapseImage", [=] (const QString & /*cmd*/,
+                        const QString & params, const QString & /*sessionId*/) -> QString {
+        const QString TYPES( "types" );
+        const QString FIRST_CHANNEL( "firstChannel" );
+        const QString LAST_CHANNEL( "lastChannel" );
+        const QString MIN_VALUE( "minValue" );
+        const QString MAX_VALUE( "maxValue" );
+        std::set<QString> keys = {TYPES, FIRST_CHANNEL, LAST_CHANNEL, MIN_VALUE, MAX_VALUE};
+        std::map<QString,QString> dataValues = Carta::State::UtilState::parseParamMap( params, keys );
+        bool validFirst = false;
+        int firstChannel = dataValues[FIRST_CHANNEL].toInt( &validFirst );
+        bool validLast = false;
+        int lastChannel = dataValues[LAST_CHANNEL].toInt( &validLast );
+        //An empty threshold leaves that side of the pixel value range open.
+        bool validMin = true;
+        double minValue = -std::numeric_limits<double>::infinity();
+        if ( !dataValues[MIN_VALUE].isEmpty() ){
+            minValue = dataValues[MIN_VALUE].toDouble( &validMin );
+        }
+        bool validMax = true;
+        double maxValue = std::numeric_limits<double>::infinity();
+        if ( !dataValues[MAX_VALUE].isEmpty() ){
+            maxValue = dataValues[MAX_VALUE].toDouble( &validMax );
+        }
+        QString result;
+        if ( !validFirst || !validLast ){
+            result = "Collapsing an image needs an integer channel range: "+params;
+        }
+        else if ( !validMin || !validMax ){
+            result = "Collapsing an image needs numeric or empty pixel value thresholds: "+params;
+        }
+        else {
+            //Types are separated by semicolons since commas separate the parameters.
+            QStringList collapseTypes = dataValues[TYPES].split( ";", QString::SkipEmptyParts );
+            result = addCollapsedImages( collapseTypes, firstChannel, lastChannel, minValue, maxValue );
+        }
+        Util::commandPostProcess( result );
+        return result;
+    });
+
+    addCommandCallback( "pvSlice", [=] (const QString & /*cmd*/,
+                        const QString & params, const QString & /*sessionId*/) -> QString {
+        const QString POINTS( "points" );
+        const QString HALF_WIDTH( "halfWidth" );
+        std::set<QString> keys = {POINTS, HALF_WIDTH};
+        std::map<QString,QString> dataValues = Carta::State::UtilState::parseParamMap( params, keys );
+        bool validWidth = false;
+        double halfWidth = dataValues[HALF_WIDTH].toDouble( &validWidth );
+        //Points are separated by semicolons and their coordinates by spaces, since
+        //commas separate the parameters.
+        std::vector<std::pair<double,double> > vertices;
+        bool validPoints = true;
+        QStringList points = dataValues[POINTS].split( ";", QString::SkipEmptyParts );
+        for ( const QString& point : points ){
+            QStringList coords = point.split( " ", QString::SkipEmptyParts );
+            bool validX = false;
+            bool validY = false;
+            if ( coords.size() == 2 ){
+                double x = coords[0].toDouble( &validX );
+                double y = coords[1].toDouble( &validY );
+                vertices.push_back( std::pair<double,double>( x, y ) );
+            }
+            if ( !validX || !validY ){
+                validPoints = false;
+                break;
+            }
+        }
+        QString result;
+        if ( validWidth && validPoints ){
+            result = addPVSlice( vertices, halfWidth );
+        }
+        else {
+            result = "A position-velocity slice needs points given as x y pairs and a numeric width: "+params;
+        }
+        Util::commandPostProcess( result );
+        return result;
+    });
+
     addCommandCallback( "hideImage", [=] (const QString & /*cmd*/,
                         const QString & params, const QString & /*sessionId*/) -> QString {
         std::set<QString> keys = {Util::ID};
@@ -1202,6 +1471,7 @@ void Controller::_updateCursor( int mouseX, int mouseY ){
         m_stateMouse.setValue<int>( ImageView::MOUSE_Y, mouseY );
         _updateCursorText( false );
         m_stateMouse.flushState();
+        emit cursorChanged( this, mouseX, mouseY );
     }
 }
 
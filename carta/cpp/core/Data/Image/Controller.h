@@ -15,6 +15,7 @@
 #include <QList>
 #include <QObject>
 
+#include <limits>
 #include <set>
 
 class CoordinateFormatterInterface;
@@ -77,6 +78,34 @@ public:
      */
     QString addData(const QString& fileName, bool* success);
 
+    /**
+     * Collapse a channel range of the current image and add the results as new layers.
+     * @param collapseTypes - the images to compute: "moment 0", "moment 1", "moment 2",
+     *      "peak", or "mean".
+     * @param firstChannel - the first channel to include.
+     * @param lastChannel - the last channel to include, or a negative value for the last
+     *      channel of the image.
+     * @param minValue - pixel values below this are left out of the collapsed images.
+     * @param maxValue - pixel values above this are left out of the collapsed images.
+     * @return - an error message if the collapsed images could not be computed; otherwise,
+     *      an empty string.  The layers are added once the computation finishes.
+     */
+    QString addCollapsedImages( const QStringList& collapseTypes, int firstChannel, int lastChannel,
+            double minValue = -std::numeric_limits<double>::infinity(),
+            double maxValue = std::numeric_limits<double>::infinity() );
+
+    /**
+     * Sample a path through the current image in every channel and add the
+     * position-velocity slice as a new layer.
+     * @param vertices - the vertices of the path in pixel coordinates of the first two
+     *      image axes.
+     * @param halfWidth - values are averaged across the path up to this distance, in
+     *      pixels, on each side.
+     * @return - an error message if the slice could not be computed; otherwise, an empty
+     *      string.  The layer is added once the computation finishes.
+     */
+    QString addPVSlice( const std::vector<std::pair<double,double> >& vertices, double halfWidth );
+
     /**
      * Apply the indicated clips to managed images.
      * @param minIntensityPercentile the minimum clip percentile [0,1].
@@ -537,6 +566,14 @@ signals:
      */
     void colorChanged( Controller* controller );
 
+    /**
+     * Notification that the mouse has moved over the image.
+     * @param controller - this Controller.
+     * @param mouseX - the x-coordinate of the mouse in screen pixels.
+     * @param mouseY - the y-coordinate of the mouse in screen pixels.
+     */
+    void cursorChanged( Controller* controller, int mouseX, int mouseY );
+
     /**
      *  Notification that the image/selection managed by this controller has
      *  changed.
@@ -567,6 +604,7 @@ private slots:
 
     void _contourSetAdded( Layer* cData, const QString& setName );
     void _contourSetRemoved( const QString setName );
+    void _contourPrefetchChanged( int channels );
 
     void _gridChanged( const Carta::State::StateInterface& state, bool applyAll );
 
@@ -594,6 +632,9 @@ private:
     /// Add an image to the stack from a file.
     QString _addDataImage( const QString& fileName, bool* success );
 
+    /// Add an image computed from another image to the stack.
+    void _addDataImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, const QString& name );
+
     //Clear the color map.
     void _clearColorMap();
 
@@ -604,6 +645,10 @@ private:
     std::set<Carta::Lib::AxisInfo::KnownType> _getAxesHidden() const;
     std::vector<Carta::Lib::AxisInfo::KnownType> _getAxisZTypes() const;
 
+    //Radio velocities in km/s of the channels of an image, or an empty vector if
+    //there is no velocity conversion.
+    std::vector<double> _getVelocities( std::shared_ptr<Carta::Lib::Image::ImageInterface> image ) const;
+
 
     QString _getPreferencesId() const;
 
@@ -25,8 +25,10 @@ const QString DataSource::CLASS_NAME = "DataSource";
 const double DataSource::ZOOM_DEFAULT = 1.0;
 
 CoordinateSystems* DataSource::m_coords = nullptr;
+int DataSource::m_imageCount = 0;
 
 DataSource::DataSource() :
+    m_imageSerial( -1 ),
     m_image( nullptr ),
     m_permuteImage( nullptr),
     m_axisIndexX( 0 ),
@@ -534,6 +536,9 @@ QString DataSource::_getViewIdCurrent( const std::vector<int>& frames ) const {
    // We create an identifier consisting of the file name and -1 for the two display axes
    // and frame indices for the other axes.
    QString renderId = m_fileName;
+   if ( renderId.isEmpty() ){
+       renderId = "image" + QString::number( m_imageSerial );
+   }
    if ( m_image ){
        int imageSize = m_image->dims().size();
        for ( int i = 0; i < imageSize; i++ ){
@@ -639,14 +644,7 @@ QString DataSource::_setFileName( const QString& fileName, bool* success ){
                                       -> prepare <Carta::Lib::Hooks::LoadAstroImage>( file )
                                       .first();
                 if (!res.isNull()){
-                    m_image = res.val();
-                    m_permuteImage = m_image;
-                    // reset zoom/pan
-                    _resetZoom();
-                    _resetPan();
-
-                    // clear quantile cache
-                    _resizeQuantileCache();
+                    _setImage( res.val() );
                     m_fileName = file;
                 }
                 else {
@@ -671,6 +669,19 @@ QString DataSource::_setFileName( const QString& fileName, bool* success ){
 }
 
 
+void DataSource::_setImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image ){
+    m_image = image;
+    m_permuteImage = m_image;
+    m_imageSerial = m_imageCount++;
+    // reset zoom/pan
+    _resetZoom();
+    _resetPan();
+
+    // clear quantile cache
+    _resizeQuantileCache();
+}
+
+
 void DataSource::_setColorMap( const QString& name ){
     Carta::State::ObjectManager* objManager = Carta::State::ObjectManager::objectManager();
     Carta::State::CartaObject* obj = objManager->getObject( Colormaps::CLASS_NAME );
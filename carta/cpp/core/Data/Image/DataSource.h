@@ -411,6 +411,12 @@ private:
      */
     QString _setFileName( const QString& fileName, bool* success );
 
+    /**
+     * Display an image that is not backed by a file, such as one computed from another image.
+     * @param image - the image to display.
+     */
+    void _setImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image );
+
 
     /**
      * Set the data transform.
@@ -440,6 +446,11 @@ private:
     DataSource();
 
     QString m_fileName;
+
+    //Identifies images that were not loaded from a file.
+    int m_imageSerial;
+    static int m_imageCount;
+
     bool m_cmapUseCaching;
     bool m_cmapUseInterpolatedCaching;
     int m_cmapCacheSize;
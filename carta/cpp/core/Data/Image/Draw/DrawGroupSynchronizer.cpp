@@ -45,6 +45,7 @@ void DrawGroupSynchronizer::render(
                 std::shared_ptr<RenderRequest> layerRequest( new RenderRequest(
                         request->getFrames(), request->getCoordinateSystem(),
                         topOfStack, request->getOutputSize() ));
+                layerRequest->setContourPrefetch( request->getContourPrefetch() );
                 m_layers[i]->_render( layerRequest );
                 stackIndex++;
             }
@@ -58,6 +58,7 @@ void DrawStackSynchronizer::_render( QList<std::shared_ptr<Layer> >& datas,
             std::shared_ptr<RenderRequest> layerRequest( new RenderRequest(
                                    request->getFrames(), request->getCoordinateSystem(),
                                    topOfStack, request->getOutputSize() ));
+            layerRequest->setContourPrefetch( request->getContourPrefetch() );
             datas[i]->_viewResize( clientSize );
             datas[i]->_render( /*frames, cs, topOfStack, size*/layerRequest );
         }
@@ -69,6 +69,7 @@ void DrawSynchronizer::_contourDone( const Result & result,
             }
         }
         m_cecVGList = vgc.vgList();
+        m_cecVGList.buildIndex();
         m_cecDone = true;
         _checkAndEmit();
     }
@@ -83,8 +84,10 @@ void DrawSynchronizer::_irsDone( QImage img, int64_t jobId ){
     }
 }
 
-void DrawSynchronizer::setInput( std::shared_ptr<Carta::Lib::NdArray::RawViewInterface> rawView ){
+void DrawSynchronizer::setInput( std::shared_ptr<Carta::Lib::NdArray::RawViewInterface> rawView,
+        const QString& inputId ){
     m_cec->setInput( rawView );
+    m_cec->setInputId( inputId );
 }
 
 
@@ -107,6 +110,15 @@ void DrawSynchronizer::setContours( const std::set<std::shared_ptr<DataContours>
     }
 }
 
+void DrawSynchronizer::setPrefetch( const QStringList& inputIds,
+        std::function<std::shared_ptr<Carta::Lib::NdArray::RawViewInterface>(int)> makeInput ){
+    m_cec->prefetch( inputIds, makeInput );
+}
+
+void DrawSynchronizer::setZoom( double zoom ){
+    m_cec->setZoom( zoom );
+}
+
 int64_t DrawSynchronizer::start( bool contourDraw, bool gridDraw, int64_t jobId ){
     m_irsDone = false;
     m_grsDone = !gridDraw;
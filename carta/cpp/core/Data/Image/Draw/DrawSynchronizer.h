@@ -4,6 +4,8 @@
 
 #pragma once
 #include <CartaLib/VectorGraphics/VGList.h>
+#include <QStringList>
+#include <functional>
 #include <set>
 
 
@@ -42,8 +44,19 @@ public:
     /**
      * Sets the data to be used in calculating contours.
      * @param rawView - the data for calculating contours.
+     * @param inputId - an identifier of the data, used to reuse contours computed before.
      */
-    void setInput( std::shared_ptr<Carta::Lib::NdArray::RawViewInterface> rawView );
+    void setInput( std::shared_ptr<Carta::Lib::NdArray::RawViewInterface> rawView,
+            const QString& inputId = QString() );
+
+    /**
+     * Sets data whose contours are likely to be drawn soon, so that they can be computed
+     * in the background.
+     * @param inputIds - identifiers of the data, the most likely to be drawn first.
+     * @param makeInput - makes the data with the given index in inputIds.
+     */
+    void setPrefetch( const QStringList& inputIds,
+            std::function<std::shared_ptr<Carta::Lib::NdArray::RawViewInterface>(int)> makeInput );
 
     /**
      * Sets the contour set(s) to be drawn.
@@ -51,6 +64,12 @@ public:
      */
     void setContours( const std::set<std::shared_ptr<DataContours> > & contours );
 
+    /**
+     * Sets the zoom the contours will be drawn at.
+     * @param zoom - how many screen pixels a data pixel occupies on screen.
+     */
+    void setZoom( double zoom );
+
     /**
      * Start a synchronized rendering.
      * @param contourDraw - true if contours should be rendered; false otherwise.
@@ -15,6 +15,7 @@
 #include "../../ImageRenderService.h"
 
 #include <QDebug>
+#include <QSet>
 #include <QTime>
 #include "LayerData.h"
 
@@ -623,8 +624,10 @@ void LayerData::_renderStart(){
     gridService->setAxisDisplayInfo( axisInfo );
 
     std::shared_ptr<Carta::Lib::NdArray::RawViewInterface> rawData( m_dataSource->_getRawData( frames ));
-    m_drawSync->setInput( rawData );
+    QString inputId = m_dataSource->_getViewIdCurrent( m_dataSource->_fitFramesToImage( frames ) );
+    m_drawSync->setInput( rawData, inputId );
     m_drawSync->setContours( m_dataContours );
+    m_drawSync->setZoom( imageService->zoom() );
 
     //Which display axes will be drawn.
     AxisInfo::KnownType xType = m_dataSource->_getAxisXType();
@@ -648,6 +651,50 @@ void LayerData::_renderStart(){
     }
 
     m_drawSync-> start( contourDraw, gridDraw );
+
+    int prefetchChannels = 0;
+    if ( contourDraw ){
+        prefetchChannels = request->getContourPrefetch();
+    }
+    _prefetchContours( frames, prefetchChannels );
+}
+
+void LayerData::_prefetchContours( const std::vector<int>& frames, int channels ){
+    QStringList inputIds;
+    std::vector<std::vector<int> > inputFrames;
+    const AxisInfo::KnownType spectralType = AxisInfo::KnownType::SPECTRAL;
+    int spectralIndex = static_cast<int>( spectralType );
+    int channelCount = m_dataSource->_getFrameCount( spectralType );
+    bool spectralDisplayed = m_dataSource->_getAxisXType() == spectralType ||
+            m_dataSource->_getAxisYType() == spectralType;
+    if ( channels != 0 && channelCount > 1 && !spectralDisplayed ){
+        std::vector<int> currentFrames = m_dataSource->_fitFramesToImage( frames );
+        int currentChannel = currentFrames[spectralIndex];
+        int window = channelCount / 2;
+        if ( channels > 0 && channels < window ){
+            window = channels;
+        }
+        //Alternate between the channels after and before the current one, wrapping
+        //around the ends as the animator does.
+        QSet<QString> seenIds;
+        for ( int i = 1; i <= window; i++ ){
+            for ( int step : { i, -i } ){
+                std::vector<int> channelFrames = currentFrames;
+                channelFrames[spectralIndex] = ( currentChannel + step + channelCount ) % channelCount;
+                QString inputId = m_dataSource->_getViewIdCurrent( channelFrames );
+                if ( !seenIds.contains( inputId ) ){
+                    seenIds.insert( inputId );
+                    inputIds.append( inputId );
+                    inputFrames.push_back( channelFrames );
+                }
+            }
+        }
+    }
+    std::shared_ptr<DataSource> dataSource = m_dataSource;
+    m_drawSync->setPrefetch( inputIds, [dataSource, inputFrames]( int index ){
+        return std::shared_ptr<Carta::Lib::NdArray::RawViewInterface>(
+                dataSource->_getRawData( inputFrames[index] ) );
+    });
 }
 
 
@@ -763,6 +810,17 @@ QString LayerData::_setFileName( const QString& fileName, bool * success ){
     return result;
 }
 
+QString LayerData::_setImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const QString& name ){
+    m_dataSource->_setImage( image );
+    QString layerName = m_state.getValue<QString>( LAYER_NAME );
+    if ( layerName.isEmpty() ){
+        m_state.setValue<QString>( LAYER_NAME, name );
+        m_state.flushState();
+    }
+    return m_state.getValue<QString>( Util::ID );
+}
+
 bool LayerData::_setLayersGrouped( bool /*grouped*/  ){
     return false;
 }
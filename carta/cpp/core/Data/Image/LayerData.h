@@ -294,6 +294,14 @@ protected:
      */
     virtual QString _setFileName( const QString& fileName, bool* success ) Q_DECL_OVERRIDE;
 
+    /**
+     * Display an image that is not backed by a file.
+     * @param image - the image to display.
+     * @param name - the name of the layer.
+     * @return - the id of the layer.
+     */
+    QString _setImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, const QString& name );
+
     /**
      * Returns the location on the image corresponding to a screen point in
      * pixels.
@@ -444,6 +452,15 @@ private:
 
     void _initializeState();
 
+    /**
+     * Ask for the contours of the channels around the current one to be computed in the
+     * background.
+     * @param frames - the frames being rendered, one for each of the known axis types.
+     * @param channels - the number of channels on each side of the current one, 0 for
+     *      none, or a negative number for all channels.
+     */
+    void _prefetchContours( const std::vector<int>& frames, int channels );
+
 
     /**
      *  Constructor.
@@ -69,27 +69,10 @@ void LayerGroup::_addContourSet( std::shared_ptr<DataContours> contourSet){
 QString LayerGroup::_addData(const QString& fileName, bool* success, int* stackIndex,
         QSize viewSize ) {
     QString result;
-    Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
-    LayerData* targetSource = objMan->createObject<LayerData>();
-    connect( targetSource, SIGNAL(contourSetAdded(Layer*,const QString&)),
-            this, SIGNAL(contourSetAdded(Layer*, const QString&)));
-    connect( targetSource, SIGNAL(contourSetRemoved(const QString&)),
-            this, SIGNAL(contourSetRemoved(const QString&)));
-    connect( targetSource, SIGNAL(colorStateChanged()), this, SIGNAL(colorStateChanged() ));
+    LayerData* targetSource = _createDataLayer();
     result = targetSource->_setFileName(fileName, success );
-    //If we are making a new layer, see if there is a selected group.  If so,
-    //add to the group.  If not, add to this group.
     if ( *success ){
-        targetSource->_viewResize( viewSize );
-        _setColorSupport( targetSource );
-        std::shared_ptr<Layer> selectedGroup = _getSelectedGroup();
-        if (selectedGroup ){
-            selectedGroup->_addLayer( std::shared_ptr<Layer>(targetSource) );
-        }
-        else {
-            m_children.append( std::shared_ptr<Layer>(targetSource) );
-            *stackIndex = m_children.size() - 1;
-        }
+        _addDataLayer( targetSource, stackIndex, viewSize );
     }
     else {
         delete targetSource;
@@ -98,6 +81,31 @@ QString LayerGroup::_addData(const QString& fileName, bool* success, int* stackI
 }
 
 
+QString LayerGroup::_addData( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const QString& name, int* stackIndex, QSize viewSize ){
+    LayerData* targetSource = _createDataLayer();
+    QString result = targetSource->_setImage( image, name );
+    _addDataLayer( targetSource, stackIndex, viewSize );
+    return result;
+}
+
+
+void LayerGroup::_addDataLayer( LayerData* targetSource, int* stackIndex, QSize viewSize ){
+    //If we are making a new layer, see if there is a selected group.  If so,
+    //add to the group.  If not, add to this group.
+    targetSource->_viewResize( viewSize );
+    _setColorSupport( targetSource );
+    std::shared_ptr<Layer> selectedGroup = _getSelectedGroup();
+    if (selectedGroup ){
+        selectedGroup->_addLayer( std::shared_ptr<Layer>(targetSource) );
+    }
+    else {
+        m_children.append( std::shared_ptr<Layer>(targetSource) );
+        *stackIndex = m_children.size() - 1;
+    }
+}
+
+
 bool LayerGroup::_addGroup(){
     Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
     LayerGroup* targetSource = objMan->createObject<LayerGroup>();
@@ -187,6 +195,19 @@ void LayerGroup::_clearData(){
     }
 }
 
+
+LayerData* LayerGroup::_createDataLayer(){
+    Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
+    LayerData* targetSource = objMan->createObject<LayerData>();
+    connect( targetSource, SIGNAL(contourSetAdded(Layer*,const QString&)),
+            this, SIGNAL(contourSetAdded(Layer*, const QString&)));
+    connect( targetSource, SIGNAL(contourSetRemoved(const QString&)),
+            this, SIGNAL(contourSetRemoved(const QString&)));
+    connect( targetSource, SIGNAL(colorStateChanged()), this, SIGNAL(colorStateChanged() ));
+    return targetSource;
+}
+
+
 std::shared_ptr<DataContours> LayerGroup::_getContour( const QString& name ){
     std::shared_ptr<DataContours> contourSet( nullptr );
     for ( std::shared_ptr<Layer> layer : m_children ){
@@ -53,6 +53,18 @@ protected:
     QString _addData(const QString& fileName, bool* success, int* stackIndex,
                       QSize viewSize=QSize()  );
 
+    /**
+     * Add a data layer for an image that is not backed by a file.
+     * @param image - the image to display.
+     * @param name - the name of the layer.
+     * @param stackIndex - set to the index of the image in this group if it is added
+     *      to this group.
+     * @param viewSize - the current client view size.
+     * @return - the id of the layer.
+     */
+    QString _addData( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, const QString& name,
+            int* stackIndex, QSize viewSize=QSize() );
+
 
 
     virtual bool _addGroup( /*const QString& state*/ );
@@ -474,9 +486,15 @@ private slots:
 
 private:
 
+    //Add a new data layer to the selected group or this one.
+    void _addDataLayer( LayerData* targetSource, int* stackIndex, QSize viewSize );
+
     void _assignColor( int index );
     void _clearData();
 
+    //Create a data layer that forwards its notifications through this group.
+    LayerData* _createDataLayer();
+
 
 
     //Get a default name based on the id of the group.
@@ -0,0 +1,269 @@
+#include "MemoryImage.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace Carta {
+
+namespace Data {
+
+namespace {
+
+//A view into the pixels of a MemoryImage.
+class MemoryRawView : public Carta::Lib::NdArray::RawViewInterface {
+
+public:
+
+    MemoryRawView( std::shared_ptr<std::vector<float> > data, const VI& dims,
+            const SliceND::ApplyResult& applyResult ):
+        m_data( data ),
+        m_origDims( dims ),
+        m_appliedSlice( applyResult ){
+        for ( const Slice1D::ApplyResult& x : m_appliedSlice.dims() ){
+            m_viewDims.push_back( std::max<int>( x.count, 1 ) );
+        }
+        //Offset between consecutive pixels along each axis of the original data.
+        int64_t stride = 1;
+        for ( int dim : m_origDims ){
+            m_strides.push_back( stride );
+            stride *= dim;
+        }
+        m_currPos.resize( m_viewDims.size(), 0 );
+    }
+
+    virtual PixelType pixelType() override {
+        return PixelType::Real32;
+    }
+
+    virtual const VI& dims() override {
+        return m_viewDims;
+    }
+
+    virtual const char* get( const VI& pos ) override {
+        int64_t offset = 0;
+        const std::vector<Slice1D::ApplyResult>& slices = m_appliedSlice.dims();
+        for ( size_t i = 0; i < slices.size(); i++ ){
+            int64_t p = i < pos.size() ? pos[i] : 0;
+            offset += ( slices[i].start + p * slices[i].step ) * m_strides[i];
+        }
+        return reinterpret_cast<const char*>( m_data->data() + offset );
+    }
+
+    virtual void forEach( std::function<void (const char*)> func, Traversal /*traversal*/ ) override {
+        _forEachRow( [&func, this] ( const float* row, int64_t step, int64_t count ){
+            for ( int64_t i = 0; i < count; i++ ){
+                m_currPos[0] = i;
+                func( reinterpret_cast<const char*>( row + i * step ) );
+            }
+        });
+    }
+
+    virtual const VI& currentPos() override {
+        return m_currPos;
+    }
+
+    virtual RawViewInterface* getView( const SliceND& sliceInfo ) override {
+        SliceND::ApplyResult ar = sliceInfo.apply( dims() );
+        SliceND::ApplyResult newAr = SliceND::ApplyResult::combine( m_appliedSlice, ar );
+        return new MemoryRawView( m_data, m_origDims, newAr );
+    }
+
+    virtual int64_t read( int64_t /*buffSize*/, char* /*buff*/, Traversal /*traversal*/ ) override {
+        qFatal( "not implemented" );
+        return 0;
+    }
+
+    virtual void seek( int64_t /*ind*/ ) override {
+        qFatal( "not implemented" );
+    }
+
+    virtual int64_t read( int64_t /*chunk*/, int64_t /*buffSize*/, char* /*buff*/,
+            Traversal /*traversal*/ ) override {
+        qFatal( "not implemented" );
+        return 0;
+    }
+
+    virtual void forEach( int64_t buffSize, std::function<void (const char*, int64_t)> func,
+            char* buff, Traversal /*traversal*/ ) override {
+        int64_t maxCount = std::max<int64_t>( 1, buffSize / int64_t( sizeof( float ) ) );
+        std::vector<float> ownBuffer;
+        float* dest = reinterpret_cast<float*>( buff );
+        if ( !dest ){
+            ownBuffer.resize( maxCount );
+            dest = ownBuffer.data();
+        }
+        int64_t filled = 0;
+        _forEachRow( [&] ( const float* row, int64_t step, int64_t count ){
+            for ( int64_t i = 0; i < count; i++ ){
+                dest[filled++] = row[i * step];
+                if ( filled == maxCount ){
+                    func( reinterpret_cast<const char*>( dest ), filled );
+                    filled = 0;
+                }
+            }
+        });
+        if ( filled > 0 ){
+            func( reinterpret_cast<const char*>( dest ), filled );
+        }
+    }
+
+private:
+
+    //Visit the view one run along the first axis at a time, in sequential order.
+    void _forEachRow( const std::function<void (const float*, int64_t, int64_t)>& func ){
+        const std::vector<Slice1D::ApplyResult>& slices = m_appliedSlice.dims();
+        int dimCount = slices.size();
+        if ( dimCount == 0 ){
+            return;
+        }
+        for ( int count : m_viewDims ){
+            if ( count <= 0 ){
+                return;
+            }
+        }
+        std::fill( m_currPos.begin(), m_currPos.end(), 0 );
+        while ( true ){
+            int64_t offset = slices[0].start * m_strides[0];
+            for ( int i = 1; i < dimCount; i++ ){
+                offset += ( slices[i].start + m_currPos[i] * slices[i].step ) * m_strides[i];
+            }
+            func( m_data->data() + offset, slices[0].step * m_strides[0], m_viewDims[0] );
+            int axis = 1;
+            for ( ; axis < dimCount; axis++ ){
+                m_currPos[axis]++;
+                if ( m_currPos[axis] < m_viewDims[axis] ){
+                    break;
+                }
+                m_currPos[axis] = 0;
+            }
+            if ( axis == dimCount ){
+                break;
+            }
+        }
+    }
+
+    std::shared_ptr<std::vector<float> > m_data;
+    VI m_origDims;
+    SliceND::ApplyResult m_appliedSlice;
+    VI m_viewDims;
+    std::vector<int64_t> m_strides;
+    VI m_currPos;
+};
+}
+
+
+MemoryImage::MemoryImage( const std::vector<int>& dims, std::shared_ptr<std::vector<float> > data,
+        const QString& unit, Carta::Lib::Image::MetaDataInterface::SharedPtr metaData ):
+    m_dims( dims ),
+    m_data( data ),
+    m_unit( unit ),
+    m_metaData( metaData ){
+}
+
+
+Carta::Lib::Image::PixelType MemoryImage::errorType() const {
+    return Carta::Lib::Image::PixelType::Real32;
+}
+
+
+const MemoryImage::VI& MemoryImage::dims() const {
+    return m_dims;
+}
+
+
+Carta::Lib::NdArray::RawViewInterface* MemoryImage::getDataSlice( const SliceND& sliceInfo ){
+    SliceND::ApplyResult applyResult = sliceInfo.apply( m_dims );
+    if ( applyResult.isError() ){
+        return nullptr;
+    }
+    return new MemoryRawView( m_data, m_dims, applyResult );
+}
+
+
+Carta::Lib::NdArray::RawViewInterface* MemoryImage::getErrorSlice( const SliceND& /*sliceInfo*/ ){
+    return nullptr;
+}
+
+
+Carta::Lib::NdArray::Byte* MemoryImage::getMaskSlice( const SliceND& /*sliceInfo*/ ){
+    //Blanked pixels are stored as NaN.
+    return nullptr;
+}
+
+
+std::shared_ptr<Carta::Lib::Image::ImageInterface> MemoryImage::getPermuted( const std::vector<int>& indices ){
+    int dimCount = m_dims.size();
+    if ( static_cast<int>( indices.size() ) != dimCount ){
+        qWarning() << "MemoryImage: permutation does not match the number of axes";
+        return nullptr;
+    }
+    //Only the coordinate system is reordered; the image this one was computed from
+    //is left alone.
+    Carta::Lib::Image::MetaDataInterface::SharedPtr permutedMeta;
+    if ( m_metaData ){
+        permutedMeta = m_metaData->permuted( indices );
+        if ( !permutedMeta ){
+            qWarning() << "MemoryImage: the coordinates could not be permuted";
+            return nullptr;
+        }
+    }
+    std::vector<int> permutedDims( dimCount );
+    for ( int i = 0; i < dimCount; i++ ){
+        permutedDims[i] = m_dims[indices[i]];
+    }
+    std::vector<int64_t> strides( dimCount );
+    int64_t stride = 1;
+    for ( int i = 0; i < dimCount; i++ ){
+        strides[i] = stride;
+        stride *= m_dims[i];
+    }
+
+    //Walk the permuted image in order, picking up pixels from the original.
+    std::shared_ptr<std::vector<float> > permutedData( new std::vector<float>( m_data->size() ) );
+    std::vector<int> pos( dimCount, 0 );
+    for ( float& value : *permutedData ){
+        int64_t offset = 0;
+        for ( int i = 0; i < dimCount; i++ ){
+            offset += pos[i] * strides[indices[i]];
+        }
+        value = ( *m_data )[offset];
+        for ( int i = 0; i < dimCount; i++ ){
+            pos[i]++;
+            if ( pos[i] < permutedDims[i] ){
+                break;
+            }
+            pos[i] = 0;
+        }
+    }
+    return std::make_shared<MemoryImage>( permutedDims, permutedData, m_unit.toStr(), permutedMeta );
+}
+
+
+const Carta::Lib::Unit& MemoryImage::getPixelUnit() const {
+    return m_unit;
+}
+
+
+bool MemoryImage::hasErrorsInfo() const {
+    return false;
+}
+
+
+bool MemoryImage::hasMask() const {
+    return false;
+}
+
+
+Carta::Lib::Image::MetaDataInterface::SharedPtr MemoryImage::metaData(){
+    return m_metaData;
+}
+
+
+Carta::Lib::Image::PixelType MemoryImage::pixelType() const {
+    return Carta::Lib::Image::PixelType::Real32;
+}
+
+
+MemoryImage::~MemoryImage(){
+}
+}
+}
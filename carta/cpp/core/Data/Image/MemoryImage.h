@@ -0,0 +1,56 @@
+/***
+ * An image whose pixels are held in memory, such as one computed from another image.
+ */
+
+#pragma once
+
+#include "CartaLib/IImage.h"
+
+#include <memory>
+#include <vector>
+
+namespace Carta {
+
+namespace Data {
+
+class MemoryImage : public Carta::Lib::Image::ImageInterface {
+
+public:
+
+    /**
+     * Constructor.
+     * @param dims - the size of the image along each axis.
+     * @param data - the pixels with the first axis varying fastest; NaN for blanked pixels.
+     * @param unit - the unit of the pixels.
+     * @param metaData - the coordinates of the image, often shared with the image it was
+     *      computed from; null if the image has no coordinates.
+     */
+    MemoryImage( const std::vector<int>& dims, std::shared_ptr<std::vector<float> > data,
+            const QString& unit, Carta::Lib::Image::MetaDataInterface::SharedPtr metaData );
+
+    virtual const Carta::Lib::Unit& getPixelUnit() const Q_DECL_OVERRIDE;
+    virtual std::shared_ptr<Carta::Lib::Image::ImageInterface>
+        getPermuted( const std::vector<int>& indices ) Q_DECL_OVERRIDE;
+    virtual const VI& dims() const Q_DECL_OVERRIDE;
+    virtual bool hasMask() const Q_DECL_OVERRIDE;
+    virtual bool hasErrorsInfo() const Q_DECL_OVERRIDE;
+    virtual PixelType pixelType() const Q_DECL_OVERRIDE;
+    virtual PixelType errorType() const Q_DECL_OVERRIDE;
+    virtual Carta::Lib::NdArray::RawViewInterface* getDataSlice( const SliceND& sliceInfo ) Q_DECL_OVERRIDE;
+    virtual Carta::Lib::NdArray::Byte* getMaskSlice( const SliceND& sliceInfo ) Q_DECL_OVERRIDE;
+    virtual Carta::Lib::NdArray::RawViewInterface* getErrorSlice( const SliceND& sliceInfo ) Q_DECL_OVERRIDE;
+    virtual Carta::Lib::Image::MetaDataInterface::SharedPtr metaData() Q_DECL_OVERRIDE;
+
+    virtual ~MemoryImage();
+
+private:
+    VI m_dims;
+    std::shared_ptr<std::vector<float> > m_data;
+    Carta::Lib::Unit m_unit;
+    Carta::Lib::Image::MetaDataInterface::SharedPtr m_metaData;
+
+    MemoryImage( const MemoryImage& other);
+    MemoryImage& operator=( const MemoryImage& other );
+};
+}
+}
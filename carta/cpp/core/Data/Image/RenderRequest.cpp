@@ -15,6 +15,7 @@ RenderRequest::RenderRequest( const std::vector<int>& frames,
     m_stackTop = topOfStack;
     m_outputSize = outputSize;
     m_topIndex = -1;
+    m_contourPrefetch = 0;
 }
 
 
@@ -22,6 +23,10 @@ std::vector<int> RenderRequest::getFrames() const {
     return m_frames;
 }
 
+int RenderRequest::getContourPrefetch() const {
+    return m_contourPrefetch;
+}
+
 Carta::Lib::KnownSkyCS RenderRequest::getCoordinateSystem() const {
     return m_cs;
 }
@@ -39,6 +44,10 @@ bool RenderRequest::isStackTop() const {
 }
 
 
+void RenderRequest::setContourPrefetch( int channels ){
+    m_contourPrefetch = channels;
+}
+
 void RenderRequest::setTopIndex( int topIndex ){
     m_topIndex = topIndex;
 }
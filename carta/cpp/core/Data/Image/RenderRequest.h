@@ -30,6 +30,14 @@ public:
      */
     std::vector<int> getFrames() const;
 
+    /**
+     * Returns how many channels on each side of the current one should have their
+     * contours computed in the background.
+     * @return - the number of channels on each side, 0 for none, or a negative number
+     *      for all channels.
+     */
+    int getContourPrefetch() const;
+
     /**
      * Returns the coordinate system to use for rendering.
      * @return - the coordinate system to use for rendering.
@@ -54,6 +62,14 @@ public:
      */
     QSize getOutputSize() const;
 
+    /**
+     * Set how many channels on each side of the current one should have their
+     * contours computed in the background.
+     * @param channels - the number of channels on each side, 0 for none, or a negative
+     *      number for all channels.
+     */
+    void setContourPrefetch( int channels );
+
     /**
      * Set the index of the top image in the stack.
      * @param topIndex - the index of the top image in the stack.
@@ -69,6 +85,7 @@ private:
     int m_topIndex;
     bool m_stackTop;
     QSize m_outputSize;
+    int m_contourPrefetch;
 
     RenderRequest( const RenderRequest& other);
     RenderRequest& operator=( const RenderRequest& other );
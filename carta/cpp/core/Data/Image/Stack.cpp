@@ -48,7 +48,8 @@ bool Stack::m_registered =
 Stack::Stack(const QString& path, const QString& id) :
     LayerGroup( CLASS_NAME, path, id),
     m_stackDraw(nullptr),
-    m_selectImage(nullptr){
+    m_selectImage(nullptr),
+    m_contourPrefetch( 0 ){
     _initializeState();
     _initializeSelections();
 }
@@ -64,6 +65,18 @@ QString Stack::_addDataImage(const QString& fileName, bool* success ) {
     return result;
 }
 
+QString Stack::_addDataImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const QString& name ){
+    int stackIndex = -1;
+    QSize viewSize = m_stackDraw->getClientSize();
+    QString result = _addData( image, name, &stackIndex, viewSize );
+    if ( stackIndex >= 0 ){
+        _resetFrames( stackIndex );
+    }
+    _saveState();
+    return result;
+}
+
 void Stack::_addDataRegions( std::vector<std::shared_ptr<Region>> regions ){
     int count = regions.size();
     for ( int i = 0; i < count; i++ ){
@@ -464,6 +477,7 @@ void Stack::_render( QList<std::shared_ptr<Layer> > datas, int gridIndex){
     QSize size;
     std::shared_ptr<RenderRequest> request( new RenderRequest( frames, cs, false, size));
     request->setTopIndex( gridIndex );
+    request->setContourPrefetch( m_contourPrefetch );
     m_stackDraw->_render( datas, /*frames, cs, gridIndex, size*/ request);
 }
 
@@ -658,6 +672,10 @@ bool Stack::_setCompositionMode( const QString& id, const QString& compositionMo
     return stateChanged;
 }
 
+void Stack::_setContourPrefetch( int channels ){
+    m_contourPrefetch = channels;
+}
+
 void Stack::_setFrameAxis(int value, AxisInfo::KnownType axisType ) {
     int axisIndex = static_cast<int>( axisType );
     int selectCount = m_selects.size();
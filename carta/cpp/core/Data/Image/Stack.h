@@ -77,6 +77,7 @@ private slots:
 private:
 
     QString _addDataImage(const QString& fileName, bool* success );
+    QString _addDataImage( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, const QString& name );
     void _addDataRegions( std::vector<std::shared_ptr<Region>> regions );
 
     QString _closeRegion( const QString& regionId );
@@ -154,6 +155,7 @@ private:
     void _saveStateRegions();
     bool _setCompositionMode( const QString& id, const QString& compositionMode,
                QString& errorMsg );
+    void _setContourPrefetch( int channels );
     void _setFrameAxis(int value, Carta::Lib::AxisInfo::KnownType axisType);
     QString _setFrameImage( int val );
     void _setMaskAlpha( const QString& id, int alphaAmount, QString& result );
@@ -191,6 +193,9 @@ private:
     /// Saves images
     SaveService *m_saveService;
 
+    /// Channels on each side of the current one to compute contours for in the background.
+    int m_contourPrefetch;
+
     Stack(const Stack& other);
     Stack& operator=(const Stack& other);
 };
@@ -0,0 +1,271 @@
+#include "HoverSpectrumExtractor.h"
+#include "Algorithms/bulkRead.h"
+#include "CartaLib/IImage.h"
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+#include <cmath>
+#include <limits>
+
+namespace Carta
+{
+namespace Data
+{
+
+const int HoverSpectrumExtractor::CACHE_SIZE = 256;
+const int HoverSpectrumExtractor::PREFETCH_RADIUS = 1;
+const int HoverSpectrumExtractor::LOOKAHEAD = 3;
+const int HoverSpectrumExtractor::BLOCK_SPECTRA_MAX = 64;
+
+HoverSpectrumExtractor::HoverSpectrumExtractor( QObject* parent ):
+    QObject( parent ),
+    m_cache( CACHE_SIZE ),
+    m_cacheNext( 0 ),
+    m_spectralIndex( -1 ),
+    m_velocityX( 0 ),
+    m_velocityY( 0 ),
+    m_waiting( false ),
+    m_prefetched( true ),
+    m_reading( false ){
+    connect( &m_watcher, SIGNAL(finished()), this, SLOT(_readFinished()));
+}
+
+
+void HoverSpectrumExtractor::_cache( const Spectrum& spectrum ){
+    m_cache[m_cacheNext] = spectrum;
+    m_cacheNext = ( m_cacheNext + 1 ) % CACHE_SIZE;
+}
+
+
+void HoverSpectrumExtractor::clear(){
+    m_cache.assign( CACHE_SIZE, Spectrum() );
+    m_cacheNext = 0;
+    m_image.reset();
+    m_pos.clear();
+    m_readImage.reset();
+    m_readPos.clear();
+    m_velocityX = 0;
+    m_velocityY = 0;
+    m_waiting = false;
+    m_prefetched = true;
+}
+
+
+const HoverSpectrumExtractor::Spectrum* HoverSpectrumExtractor::_find(
+        std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const std::vector<int>& pos ) const {
+    for ( const Spectrum& spectrum : m_cache ){
+        if ( spectrum.m_pos == pos && spectrum.m_image.lock() == image ){
+            return &spectrum;
+        }
+    }
+    return nullptr;
+}
+
+
+std::vector<int> HoverSpectrumExtractor::_predict( const std::vector<int>& pos ) const {
+    std::vector<int> predicted = pos;
+    std::vector<int> dims = m_image->dims();
+    predicted[0] = qBound( 0, pos[0] + int( std::round( LOOKAHEAD * m_velocityX ) ), dims[0] - 1 );
+    predicted[1] = qBound( 0, pos[1] + int( std::round( LOOKAHEAD * m_velocityY ) ), dims[1] - 1 );
+    return predicted;
+}
+
+
+std::vector<HoverSpectrumExtractor::Spectrum> HoverSpectrumExtractor::_readBlock( const Block& block ){
+    std::vector<Spectrum> spectra;
+    SliceND slice;
+    int64_t dimCount = block.m_pos.size();
+    for ( int i = 0; i < dimCount; i++ ){
+        if ( i == 0 ){
+            slice.slice( i ).start( block.m_pos[0] ).end( block.m_pos[0] + block.m_width );
+        }
+        else if ( i == 1 ){
+            slice.slice( i ).start( block.m_pos[1] ).end( block.m_pos[1] + block.m_height );
+        }
+        else if ( i != block.m_spectralIndex ){
+            slice.slice( i ).start( block.m_pos[i] ).end( block.m_pos[i] + 1 );
+        }
+    }
+    std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view( block.m_image->getDataSlice( slice ) );
+    if ( !view ){
+        return spectra;
+    }
+    //One read for every spectrum in the block; the first axis varies fastest.
+    std::vector<float> data = Carta::Core::Algorithms::readAll<float>( view.get() );
+    //A mask that cannot be read is treated as no mask.
+    std::unique_ptr<Carta::Lib::NdArray::Byte> maskView;
+    if ( block.m_image->hasMask() ){
+        maskView.reset( block.m_image->getMaskSlice( slice ) );
+    }
+    if ( maskView ){
+        std::vector<uint8_t> mask = Carta::Core::Algorithms::readAll<uint8_t>( maskView->rawView() );
+        for ( size_t i = 0; i < data.size(); i++ ){
+            if ( !mask[i] ){
+                data[i] = std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+    }
+    int64_t planeSize = int64_t( block.m_width ) * block.m_height;
+    int64_t channelCount = block.m_image->dims()[block.m_spectralIndex];
+    if ( static_cast<int64_t>( data.size() ) != planeSize * channelCount ){
+        return spectra;
+    }
+    for ( int y = 0; y < block.m_height; y++ ){
+        for ( int x = 0; x < block.m_width; x++ ){
+            Spectrum spectrum;
+            spectrum.m_image = block.m_image;
+            spectrum.m_pos = block.m_pos;
+            spectrum.m_pos[0] += x;
+            spectrum.m_pos[1] += y;
+            spectrum.m_values.resize( channelCount );
+            const float* src = data.data() + int64_t( y ) * block.m_width + x;
+            for ( int64_t channel = 0; channel < channelCount; channel++ ){
+                spectrum.m_values[channel] = src[channel * planeSize];
+            }
+            spectra.push_back( spectrum );
+        }
+    }
+    return spectra;
+}
+
+
+void HoverSpectrumExtractor::_advance(){
+    if ( !m_image ){
+        return;
+    }
+    if ( m_waiting ){
+        const Spectrum* spectrum = _find( m_image, m_pos );
+        if ( spectrum ){
+            m_waiting = false;
+            emit spectrumReady( m_pos, spectrum->m_values );
+        }
+        else if ( m_readImage == m_image && m_readPos == m_pos ){
+            //The block just read was centered on the request but did not contain it,
+            //so reading it again would fail the same way.
+            qWarning() << "Could not read the spectrum under the cursor";
+            m_waiting = false;
+            m_prefetched = true;
+            return;
+        }
+        else {
+            //The cursor moved on while the block was read.
+            _startRead( m_image, m_spectralIndex, m_pos, _predict( m_pos ) );
+            return;
+        }
+    }
+    //Use the idle time to read ahead of the cursor.
+    if ( !m_prefetched ){
+        m_prefetched = true;
+        std::vector<int> predicted = _predict( m_pos );
+        if ( !_find( m_image, predicted ) ){
+            _startRead( m_image, m_spectralIndex, predicted, predicted );
+        }
+    }
+}
+
+
+void HoverSpectrumExtractor::_readFinished(){
+    m_reading = false;
+    std::vector<Spectrum> spectra = m_watcher.result();
+    for ( const Spectrum& spectrum : spectra ){
+        _cache( spectrum );
+    }
+    _advance();
+}
+
+
+bool HoverSpectrumExtractor::requestSpectrum( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex, const std::vector<int>& pos ){
+    if ( !image ){
+        return false;
+    }
+    std::vector<int> dims = image->dims();
+    //Spectra run along an axis other than the plane of the cursor.
+    if ( spectralIndex < 2 || spectralIndex >= static_cast<int>( dims.size() ) ||
+            pos.size() != dims.size() ){
+        return false;
+    }
+    std::vector<int> key = pos;
+    key[spectralIndex] = 0;
+    for ( size_t i = 0; i < dims.size(); i++ ){
+        if ( key[i] < 0 || key[i] >= dims[i] ){
+            return false;
+        }
+    }
+
+    //Follow the cursor motion, smoothed over recent moves.
+    if ( m_image == image && m_pos.size() == key.size() ){
+        m_velocityX = ( m_velocityX + ( key[0] - m_pos[0] ) ) / 2;
+        m_velocityY = ( m_velocityY + ( key[1] - m_pos[1] ) ) / 2;
+    }
+    else {
+        m_velocityX = 0;
+        m_velocityY = 0;
+    }
+    m_image = image;
+    m_spectralIndex = spectralIndex;
+    m_pos = key;
+    m_prefetched = false;
+
+    const Spectrum* spectrum = _find( image, key );
+    if ( spectrum ){
+        m_waiting = false;
+        emit spectrumReady( key, spectrum->m_values );
+        if ( !m_reading ){
+            _advance();
+        }
+    }
+    else {
+        m_waiting = true;
+        //Requests made while a block is being read are coalesced; only the
+        //latest is read when the block is done.
+        if ( !m_reading ){
+            _startRead( image, spectralIndex, key, _predict( key ) );
+        }
+    }
+    return true;
+}
+
+
+void HoverSpectrumExtractor::_startRead( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex, const std::vector<int>& pos, const std::vector<int>& predicted ){
+    std::vector<int> dims = image->dims();
+    int left = std::min( pos[0], predicted[0] ) - PREFETCH_RADIUS;
+    int right = std::max( pos[0], predicted[0] ) + PREFETCH_RADIUS;
+    int top = std::min( pos[1], predicted[1] ) - PREFETCH_RADIUS;
+    int bottom = std::max( pos[1], predicted[1] ) + PREFETCH_RADIUS;
+    if ( ( right - left + 1 ) * ( bottom - top + 1 ) > BLOCK_SPECTRA_MAX ){
+        //Moving fast; read only around the cursor.
+        left = pos[0] - PREFETCH_RADIUS;
+        right = pos[0] + PREFETCH_RADIUS;
+        top = pos[1] - PREFETCH_RADIUS;
+        bottom = pos[1] + PREFETCH_RADIUS;
+    }
+    left = std::max( left, 0 );
+    top = std::max( top, 0 );
+    right = std::min( right, dims[0] - 1 );
+    bottom = std::min( bottom, dims[1] - 1 );
+
+    Block block;
+    block.m_image = image;
+    block.m_spectralIndex = spectralIndex;
+    block.m_pos = pos;
+    block.m_pos[0] = left;
+    block.m_pos[1] = top;
+    block.m_width = right - left + 1;
+    block.m_height = bottom - top + 1;
+    m_readImage = image;
+    m_readPos = pos;
+    m_reading = true;
+    m_watcher.setFuture( QtConcurrent::run( [block](){
+        return _readBlock( block );
+    }));
+}
+
+
+HoverSpectrumExtractor::~HoverSpectrumExtractor(){
+    m_watcher.disconnect( this );
+    m_watcher.waitForFinished();
+}
+}
+}
@@ -0,0 +1,143 @@
+/**
+ * Extracts the spectrum under the image cursor.  Spectra around the cursor, and
+ * where it is heading, are read ahead of time into a small ring cache.
+ **/
+
+#pragma once
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class HoverSpectrumExtractor : public QObject {
+    Q_OBJECT
+
+public:
+
+    /**
+     * Constructor.
+     */
+    explicit HoverSpectrumExtractor( QObject* parent = 0 );
+
+    /**
+     * Clear the cached spectra and forget the cursor motion.
+     */
+    void clear();
+
+    /**
+     * Ask for the spectrum at a pixel.  A cached spectrum is delivered before this
+     * returns.  Otherwise it is read on the thread pool; if a read is already
+     * running, only the latest request made in the meantime is read after it.
+     * @param image - the image cube.
+     * @param spectralIndex - the index of the spectral axis; it must follow the first two axes.
+     * @param pos - the pixel index along every image axis; the spectral entry is ignored.
+     * @return - false if no spectrum can be extracted at the position; true otherwise.
+     */
+    bool requestSpectrum( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            int spectralIndex, const std::vector<int>& pos );
+
+    /**
+     * Destructor.
+     */
+    ~HoverSpectrumExtractor();
+
+    //Number of spectra kept in the cache.
+    static const int CACHE_SIZE;
+    //Spectra this many pixels around the cursor are read along with it.
+    static const int PREFETCH_RADIUS;
+    //Number of cursor moves ahead that are read in advance.
+    static const int LOOKAHEAD;
+    //Largest number of spectra read at once.
+    static const int BLOCK_SPECTRA_MAX;
+
+signals:
+
+    /**
+     * Notification that the spectrum of the latest request is available.
+     * @param pos - the pixel index along every image axis.
+     * @param spectrum - the value in each channel; NaN for masked pixels.
+     */
+    void spectrumReady( const std::vector<int>& pos, const std::vector<double>& spectrum );
+
+private slots:
+
+    void _readFinished();
+
+private:
+
+    struct Spectrum {
+        std::weak_ptr<Carta::Lib::Image::ImageInterface> m_image;
+        std::vector<int> m_pos;
+        std::vector<double> m_values;
+    };
+
+    struct Block {
+        std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+        int m_spectralIndex;
+        //Pixel index along every axis of the first spectrum in the block.
+        std::vector<int> m_pos;
+        int m_width;
+        int m_height;
+    };
+
+    //Deliver the spectrum of the latest request if it has arrived, then start the
+    //next read: the latest request if it is still missing, or else the spectra
+    //ahead of the cursor.
+    void _advance();
+
+    //Store a spectrum, replacing the oldest one.
+    void _cache( const Spectrum& spectrum );
+
+    //Returns the cached spectrum at a position, or null.
+    const Spectrum* _find( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const std::vector<int>& pos ) const;
+
+    //Returns the position the cursor is expected to reach in a few moves.
+    std::vector<int> _predict( const std::vector<int>& pos ) const;
+
+    //Read the spectra around pos and, if it fits in the block, around predicted.
+    void _startRead( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, int spectralIndex,
+            const std::vector<int>& pos, const std::vector<int>& predicted );
+
+    //Read the spectra of a block of pixels.
+    static std::vector<Spectrum> _readBlock( const Block& block );
+
+    std::vector<Spectrum> m_cache;
+    int m_cacheNext;
+
+    //The most recent request and the smoothed cursor motion per request.
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    int m_spectralIndex;
+    std::vector<int> m_pos;
+    double m_velocityX;
+    double m_velocityY;
+    //Whether the most recent request is still waiting for its spectrum.
+    bool m_waiting;
+    //Whether spectra ahead of the most recent request have been read.
+    bool m_prefetched;
+    //Whether a block is being read.
+    bool m_reading;
+    //The image and position the latest block was read around.
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_readImage;
+    std::vector<int> m_readPos;
+
+    QFutureWatcher<std::vector<Spectrum> > m_watcher;
+
+    HoverSpectrumExtractor( const HoverSpectrumExtractor& other);
+    HoverSpectrumExtractor& operator=( const HoverSpectrumExtractor& other );
+};
+}
+}
@@ -0,0 +1,378 @@
+#include "PVSliceGenerator.h"
+#include "Data/Image/MemoryImage.h"
+#include "Algorithms/bulkRead.h"
+#include "Algorithms/parallelAlgorithms.h"
+#include "Algorithms/pathSampling.h"
+#include "CartaLib/IImage.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Carta
+{
+namespace Data
+{
+
+namespace
+{
+
+//One axis of a slice, with the world coordinate given at every pixel and
+//interpolated linearly in between.
+struct PVAxis {
+    Carta::Lib::AxisInfo info;
+    std::vector<double> values;
+    int precision;
+};
+
+//Coordinates of a position-velocity slice: offset along the path and the
+//spectral coordinate of the cube.
+class PVCoordinateFormatter : public CoordinateFormatterInterface {
+
+public:
+
+    PVCoordinateFormatter( const std::vector<PVAxis>& axes ):
+        m_axes( axes ){
+    }
+
+    virtual CoordinateFormatterInterface* clone() const override {
+        return new PVCoordinateFormatter( *this );
+    }
+
+    virtual int nAxes() const override {
+        return m_axes.size();
+    }
+
+    virtual QStringList formatFromPixelCoordinate( const VD& pix ) override {
+        QStringList list;
+        VD world;
+        if ( toWorld( pix, world ) ){
+            for ( int i = 0; i < nAxes(); i++ ){
+                QString text = QString::number( world[i], 'f', m_axes[i].precision );
+                QString unit = m_axes[i].info.unit();
+                if ( !unit.isEmpty() ){
+                    text = text + " " + unit;
+                }
+                list.append( text );
+            }
+        }
+        return list;
+    }
+
+    virtual QString calculateFormatDistance( const VD& /*p1*/, const VD& /*p2*/ ) override {
+        return QString();
+    }
+
+    virtual void setTextOutputFormat( TextFormat /*fmt*/ ) override {
+    }
+
+    virtual const Carta::Lib::AxisInfo& axisInfo( int ind ) const override {
+        CARTA_ASSERT( ind >= 0 && ind < nAxes() );
+        return m_axes[ind].info;
+    }
+
+    virtual Me& disableAxis( int /*ind*/ ) override {
+        return *this;
+    }
+
+    virtual Me& enableAxis( int /*ind*/ ) override {
+        return *this;
+    }
+
+    virtual KnownSkyCS skyCS() override {
+        return KnownSkyCS::Unknown;
+    }
+
+    virtual Me& setSkyCS( const KnownSkyCS& /*scs*/ ) override {
+        return *this;
+    }
+
+    virtual SkyFormatting skyFormatting() override {
+        return SkyFormatting::Default;
+    }
+
+    virtual Me& setSkyFormatting( SkyFormatting /*format*/ ) override {
+        return *this;
+    }
+
+    virtual int axisPrecision( int axis ) override {
+        CARTA_ASSERT( axis >= 0 && axis < nAxes() );
+        return m_axes[axis].precision;
+    }
+
+    virtual Me& setAxisPrecision( int precision, int axis ) override {
+        for ( int i = 0; i < nAxes(); i++ ){
+            if ( axis < 0 || axis == i ){
+                m_axes[i].precision = precision;
+            }
+        }
+        return *this;
+    }
+
+    virtual bool toWorld( const VD& pixel, VD& world ) const override {
+        int axisCount = nAxes();
+        if ( static_cast<int>( pixel.size() ) < axisCount ){
+            return false;
+        }
+        world.resize( axisCount );
+        for ( int i = 0; i < axisCount; i++ ){
+            if ( !std::isfinite( pixel[i] ) ){
+                return false;
+            }
+            const std::vector<double>& values = m_axes[i].values;
+            int count = values.size();
+            if ( count == 1 ){
+                world[i] = values[0] + pixel[i];
+                continue;
+            }
+            int index = Carta::Lib::clamp<int>( std::floor( pixel[i] ), 0, count - 2 );
+            world[i] = values[index] + ( pixel[i] - index ) * ( values[index + 1] - values[index] );
+        }
+        return true;
+    }
+
+    virtual bool toPixel( const VD& world, VD& pixel ) const override {
+        int axisCount = nAxes();
+        if ( static_cast<int>( world.size() ) < axisCount ){
+            return false;
+        }
+        pixel.resize( axisCount );
+        for ( int i = 0; i < axisCount; i++ ){
+            const std::vector<double>& values = m_axes[i].values;
+            int count = values.size();
+            if ( count == 1 ){
+                pixel[i] = world[i] - values[0];
+                continue;
+            }
+            //The coordinates of an axis are monotonic, in either direction.
+            std::vector<double>::const_iterator found;
+            if ( values.back() >= values.front() ){
+                found = std::lower_bound( values.begin(), values.end(), world[i] );
+            }
+            else {
+                found = std::lower_bound( values.begin(), values.end(), world[i], std::greater<double>() );
+            }
+            int index = Carta::Lib::clamp<int>( found - values.begin() - 1, 0, count - 2 );
+            double step = values[index + 1] - values[index];
+            if ( step == 0 ){
+                return false;
+            }
+            pixel[i] = index + ( world[i] - values[index] ) / step;
+        }
+        return true;
+    }
+
+    //The formatter with its axes in a new order.
+    PVCoordinateFormatter* permuted( const std::vector<int>& indices ) const {
+        std::vector<PVAxis> axes;
+        for ( int index : indices ){
+            if ( index < 0 || index >= nAxes() ){
+                return nullptr;
+            }
+            axes.push_back( m_axes[index] );
+        }
+        return new PVCoordinateFormatter( axes );
+    }
+
+private:
+    std::vector<PVAxis> m_axes;
+};
+
+
+class PVMetaData : public Carta::Lib::Image::MetaDataInterface {
+
+public:
+
+    PVMetaData( std::shared_ptr<PVCoordinateFormatter> formatter ):
+        m_formatter( formatter ){
+    }
+
+    virtual MetaDataInterface* clone() override {
+        return new PVMetaData( m_formatter );
+    }
+
+    virtual CoordinateFormatterInterface::SharedPtr coordinateFormatter() override {
+        return m_formatter;
+    }
+
+    virtual PlotLabelGeneratorInterface::SharedPtr plotLabelGenerator() override {
+        return nullptr;
+    }
+
+    virtual QString title( TextFormat /*format*/ ) override {
+        return "Position-velocity slice";
+    }
+
+    virtual QStringList otherInfo( TextFormat /*format*/ ) override {
+        return QStringList();
+    }
+
+    virtual SharedPtr permuted( const std::vector<int>& indices ) override {
+        std::shared_ptr<PVCoordinateFormatter> formatter( m_formatter->permuted( indices ) );
+        SharedPtr meta;
+        if ( formatter ){
+            meta = std::make_shared<PVMetaData>( formatter );
+        }
+        return meta;
+    }
+
+private:
+    std::shared_ptr<PVCoordinateFormatter> m_formatter;
+};
+
+
+PVAxis _makeAxis( const QString& label, const QString& unit, const std::vector<double>& values ){
+    PVAxis axis;
+    axis.info.setKnownType( Carta::Lib::AxisInfo::KnownType::LINEAR );
+    axis.info.setLongLabel( Carta::Lib::HtmlString::fromPlain( label ) );
+    axis.info.setShortLabel( Carta::Lib::HtmlString::fromPlain( label ) );
+    axis.info.setUnit( unit );
+    axis.values = values;
+    axis.precision = 3;
+    return axis;
+}
+}
+
+PVSliceGenerator::PVSliceGenerator( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex ):
+    m_image( image ),
+    m_spectralIndex( spectralIndex ){
+}
+
+
+PVSliceGenerator::PVSlice PVSliceGenerator::compute(
+        const std::vector<std::pair<double,double> >& vertices, double halfWidth ) const {
+    using namespace Carta::Core::Algorithms;
+    PVSlice slice;
+    slice.positionCount = 0;
+    slice.channelCount = 0;
+    slice.spacing = 1;
+    if ( !m_image ){
+        return slice;
+    }
+    std::vector<int> dims = m_image->dims();
+    //The path lies in the plane of the first two axes, so the spectral axis must be another one.
+    if ( dims.size() < 3 || m_spectralIndex < 2 || m_spectralIndex >= static_cast<int>( dims.size() ) ){
+        qWarning() << "A position-velocity slice needs a spectral axis after the first two axes.";
+        return slice;
+    }
+    std::vector<PathSample> samples = samplePolyline( vertices, slice.spacing );
+    int positionCount = samples.size();
+    int channelCount = dims[m_spectralIndex];
+    slice.positionCount = positionCount;
+    slice.channelCount = channelCount;
+    for ( const PathSample& sample : samples ){
+        slice.positions.push_back( std::pair<double,double>( sample.x, sample.y ) );
+    }
+    slice.values.assign( int64_t( positionCount ) * channelCount,
+            std::numeric_limits<float>::quiet_NaN() );
+    int64_t box[4] = { 0, 0, 0, 0 };
+    if ( !pathBounds( samples, halfWidth, dims[0], dims[1], box ) ){
+        return slice;
+    }
+
+    //Only the part of each plane the path passes through is read.
+    SliceND planeSlice;
+    planeSlice.slice( 0 ).start( box[0] ).end( box[2] + 1 );
+    planeSlice.slice( 1 ).start( box[1] ).end( box[3] + 1 );
+    for ( int i = 2; i < static_cast<int>( dims.size() ); i++ ){
+        if ( i != m_spectralIndex ){
+            int pos = i < static_cast<int>( m_pos.size() ) ? m_pos[i] : 0;
+            pos = Carta::Lib::clamp( pos, 0, dims[i] - 1 );
+            planeSlice.slice( i ).start( pos ).end( pos + 1 );
+        }
+    }
+    for ( PathSample& sample : samples ){
+        sample.x -= box[0];
+        sample.y -= box[1];
+    }
+    int64_t width = box[2] - box[0] + 1;
+    int64_t height = box[3] - box[1] + 1;
+
+    auto computeChannels = [this, &slice, &samples, &planeSlice, halfWidth, width, height]
+                            ( int64_t begin, int64_t end, int /*part*/ ){
+        SliceND channelSlice = planeSlice;
+        for ( int64_t channel = begin; channel < end; channel++ ){
+            if ( m_isCancelled && m_isCancelled() ){
+                return;
+            }
+            channelSlice.slice( m_spectralIndex ).start( channel ).end( channel + 1 );
+            std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view(
+                    m_image->getDataSlice( channelSlice ) );
+            if ( !view ){
+                continue;
+            }
+            std::vector<float> plane = readAll<float>( view.get() );
+            //A mask that cannot be read is treated as no mask.
+            std::unique_ptr<Carta::Lib::NdArray::Byte> maskView;
+            if ( m_image->hasMask() ){
+                maskView.reset( m_image->getMaskSlice( channelSlice ) );
+            }
+            if ( maskView ){
+                std::vector<uint8_t> mask = readAll<uint8_t>( maskView->rawView() );
+                for ( size_t i = 0; i < plane.size(); i++ ){
+                    if ( !mask[i] ){
+                        plane[i] = std::numeric_limits<float>::quiet_NaN();
+                    }
+                }
+            }
+            float* row = slice.values.data() + channel * slice.positionCount;
+            for ( int i = 0; i < slice.positionCount; i++ ){
+                row[i] = sampleAcross( plane.data(), width, height, samples[i], halfWidth );
+            }
+        }
+    };
+    parallelRanges( channelCount, 1, computeChannels );
+    if ( m_isCancelled && m_isCancelled() ){
+        slice.values.clear();
+    }
+    return slice;
+}
+
+
+std::shared_ptr<Carta::Lib::Image::ImageInterface> PVSliceGenerator::toImage( const PVSlice& slice,
+        const QString& pixelUnit, const std::vector<double>& spectralValues,
+        const QString& spectralLabel, const QString& spectralUnit ){
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> image;
+    int64_t pixelCount = int64_t( slice.positionCount ) * slice.channelCount;
+    if ( pixelCount <= 0 || static_cast<int64_t>( slice.values.size() ) != pixelCount ){
+        return image;
+    }
+    std::vector<double> offsets( slice.positionCount );
+    for ( int i = 0; i < slice.positionCount; i++ ){
+        offsets[i] = i * slice.spacing;
+    }
+    std::vector<double> channels = spectralValues;
+    if ( static_cast<int>( channels.size() ) != slice.channelCount ){
+        channels.resize( slice.channelCount );
+        for ( int i = 0; i < slice.channelCount; i++ ){
+            channels[i] = i;
+        }
+    }
+    std::vector<PVAxis> axes = {
+            _makeAxis( "Offset", "pixel", offsets ),
+            _makeAxis( spectralLabel, spectralUnit, channels ) };
+    std::shared_ptr<PVCoordinateFormatter> formatter( new PVCoordinateFormatter( axes ) );
+
+    //The slice is stored one channel after another, so position varies fastest.
+    std::vector<int> dims = { slice.positionCount, slice.channelCount };
+    std::shared_ptr<std::vector<float> > data( new std::vector<float>( slice.values ) );
+    image = std::make_shared<MemoryImage>( dims, data, pixelUnit, std::make_shared<PVMetaData>( formatter ) );
+    return image;
+}
+
+
+void PVSliceGenerator::setMonitor( const std::function<bool()>& isCancelled ){
+    m_isCancelled = isCancelled;
+}
+
+
+void PVSliceGenerator::setPosition( const std::vector<int>& pos ){
+    m_pos = pos;
+}
+
+
+PVSliceGenerator::~PVSliceGenerator(){
+}
+}
+}
@@ -0,0 +1,106 @@
+/**
+ * Samples a path through the image plane in every channel to produce a
+ * position-velocity slice.
+ **/
+
+#pragma once
+
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class PVSliceGenerator {
+
+public:
+
+    /// A two dimensional image with position along the path as the first axis and
+    /// channel as the second.
+    struct PVSlice {
+        int positionCount;
+        int channelCount;
+        //Distance between consecutive positions, in pixels.
+        double spacing;
+        //Position of each sample in pixel coordinates of the first two image axes.
+        std::vector<std::pair<double,double> > positions;
+        //Values row by row, one row per channel; NaN where the path leaves the image.
+        std::vector<float> values;
+    };
+
+    /**
+     * Constructor.
+     * @param image - the image cube to slice.
+     * @param spectralIndex - the index of the spectral axis in the image.
+     */
+    PVSliceGenerator( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, int spectralIndex );
+
+    /**
+     * Compute the slice.  Channels are divided between the threads of the global
+     * thread pool and each channel is read once, only over the part of the plane
+     * the path passes through.
+     * @param vertices - the vertices of the path in pixel coordinates of the first two axes.
+     * @param halfWidth - values are averaged across the path up to this distance, in
+     *      pixels, on each side.
+     * @return - the slice; it has no values if the image or path is unsuitable or the
+     *      computation was cancelled.
+     */
+    PVSlice compute( const std::vector<std::pair<double,double> >& vertices, double halfWidth ) const;
+
+    /**
+     * Wrap a slice as an image that can be shown as a layer.
+     * @param slice - a slice returned by compute().
+     * @param pixelUnit - the unit of the values of the slice.
+     * @param spectralValues - the spectral coordinate of every channel; the channel
+     *      index is used if this is empty.
+     * @param spectralLabel - what the spectral coordinate is, such as "Velocity".
+     * @param spectralUnit - the unit of the spectral coordinates.
+     * @return - an image with the offset along the path in pixels as the first axis
+     *      and the spectral coordinate as the second; null if the slice has no values.
+     */
+    static std::shared_ptr<Carta::Lib::Image::ImageInterface> toImage( const PVSlice& slice,
+            const QString& pixelUnit, const std::vector<double>& spectralValues,
+            const QString& spectralLabel, const QString& spectralUnit );
+
+    /**
+     * Set the position along axes other than the first two and the spectral axis.
+     * @param pos - the index along every image axis; entries for the first two and
+     *      the spectral axis are ignored.  Missing entries are taken to be zero.
+     */
+    void setPosition( const std::vector<int>& pos );
+
+    /**
+     * Set a callback for stopping a long computation.
+     * @param isCancelled - polled between channels; when it returns true the
+     *      computation stops and the slice has no values.
+     */
+    void setMonitor( const std::function<bool()>& isCancelled );
+
+    /**
+     * Destructor.
+     */
+    ~PVSliceGenerator();
+
+private:
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    int m_spectralIndex;
+    std::vector<int> m_pos;
+    std::function<bool()> m_isCancelled;
+
+    PVSliceGenerator( const PVSliceGenerator& other);
+    PVSliceGenerator& operator=( const PVSliceGenerator& other );
+};
+}
+}
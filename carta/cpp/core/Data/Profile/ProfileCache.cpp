@@ -0,0 +1,116 @@
+#include "ProfileCache.h"
+
+namespace Carta
+{
+namespace Data
+{
+
+const int64_t ProfileCache::MAX_CACHE_BYTES = 32 * 1024 * 1024;
+
+
+ProfileCache::ProfileCache( int64_t maxBytes ):
+    m_maxBytes( maxBytes ),
+    m_usedBytes( 0 ){
+}
+
+
+bool ProfileCache::find( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const Carta::Lib::RegionInfo& regionInfo, const Carta::Lib::ProfileInfo& profInfo,
+        Carta::Lib::Hooks::ProfileResult* result ){
+    _removeClosed();
+    for ( auto iter = m_entries.begin(); iter != m_entries.end(); iter++ ){
+        if ( _isImage( *iter, image ) && iter->m_regionInfo == regionInfo &&
+                iter->m_profileInfo == profInfo ){
+            *result = iter->m_result;
+            //Move it to the front so it is discarded last.
+            m_entries.splice( m_entries.begin(), m_entries, iter );
+            return true;
+        }
+    }
+    return false;
+}
+
+
+int64_t ProfileCache::getMemoryUsage() const {
+    return m_usedBytes;
+}
+
+
+int ProfileCache::getProfileCount() const {
+    return m_entries.size();
+}
+
+
+void ProfileCache::insert( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const Carta::Lib::RegionInfo& regionInfo, const Carta::Lib::ProfileInfo& profInfo,
+        const Carta::Lib::Hooks::ProfileResult& result ){
+    if ( !image || !result.getError().isEmpty() ){
+        return;
+    }
+    Carta::Lib::Hooks::ProfileResult existing;
+    if ( find( image, regionInfo, profInfo, &existing ) ){
+        //The entry found is now at the front.
+        m_usedBytes -= m_entries.front().m_bytes;
+        m_entries.pop_front();
+    }
+    Entry entry;
+    entry.m_image = image;
+    entry.m_regionInfo = regionInfo;
+    entry.m_profileInfo = profInfo;
+    entry.m_result = result;
+    entry.m_bytes = sizeof( Entry ) +
+            result.getData().size() * sizeof( std::pair<double,double> ) +
+            regionInfo.getCorners().size() * sizeof( std::pair<double,double> );
+    m_usedBytes += entry.m_bytes;
+    m_entries.push_front( entry );
+    _trim();
+}
+
+
+bool ProfileCache::_isImage( const Entry& entry,
+        std::shared_ptr<Carta::Lib::Image::ImageInterface> image ){
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> entryImage = entry.m_image.lock();
+    return entryImage && entryImage == image;
+}
+
+
+void ProfileCache::remove( std::shared_ptr<Carta::Lib::Image::ImageInterface> image ){
+    for ( auto iter = m_entries.begin(); iter != m_entries.end(); ){
+        if ( !image || _isImage( *iter, image ) ){
+            m_usedBytes -= iter->m_bytes;
+            iter = m_entries.erase( iter );
+        }
+        else {
+            iter++;
+        }
+    }
+    _removeClosed();
+}
+
+
+void ProfileCache::_removeClosed(){
+    for ( auto iter = m_entries.begin(); iter != m_entries.end(); ){
+        if ( iter->m_image.expired() ){
+            m_usedBytes -= iter->m_bytes;
+            iter = m_entries.erase( iter );
+        }
+        else {
+            iter++;
+        }
+    }
+}
+
+
+void ProfileCache::_trim(){
+    //The most recent profile is kept even if it is larger than the bound.
+    while ( m_usedBytes > m_maxBytes && m_entries.size() > 1 ){
+        m_usedBytes -= m_entries.back().m_bytes;
+        m_entries.pop_back();
+    }
+}
+
+
+ProfileCache::~ProfileCache(){
+}
+}
+}
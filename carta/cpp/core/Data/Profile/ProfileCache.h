@@ -0,0 +1,120 @@
+/**
+ * Keeps recently computed profiles so that asking again for a profile of the same
+ * image, region, and statistic does not read the image.  Profiles are found by the
+ * geometry of their region, so an edited region never matches its old profiles, and
+ * the profiles of an image are discarded once the image is closed.
+ **/
+
+#pragma once
+
+#include "CartaLib/Hooks/ProfileResult.h"
+#include "CartaLib/ProfileInfo.h"
+#include "CartaLib/RegionInfo.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class ProfileCache {
+
+public:
+
+    /**
+     * Constructor.
+     * @param maxBytes - the most memory the stored profiles may use, in bytes.
+     */
+    explicit ProfileCache( int64_t maxBytes = MAX_CACHE_BYTES );
+
+    /**
+     * Look up a profile.
+     * @param image - the image that is the source of the profile.
+     * @param regionInfo - the region that was profiled.
+     * @param profInfo - the statistic, rest frequency, and spectral units of the profile.
+     * @param result - set to the stored profile if there is one.
+     * @return - true if the profile was found; false otherwise.
+     */
+    bool find( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const Carta::Lib::RegionInfo& regionInfo, const Carta::Lib::ProfileInfo& profInfo,
+            Carta::Lib::Hooks::ProfileResult* result );
+
+    /**
+     * Returns the memory used by the stored profiles.
+     * @return - an estimate of the memory used, in bytes.
+     */
+    int64_t getMemoryUsage() const;
+
+    /**
+     * Returns the number of stored profiles.
+     * @return - the number of profiles in the cache.
+     */
+    int getProfileCount() const;
+
+    /**
+     * Store a profile, discarding the least recently used ones if the cache is full.
+     * Profiles with errors are not stored.
+     * @param image - the image that is the source of the profile.
+     * @param regionInfo - the region that was profiled.
+     * @param profInfo - the statistic, rest frequency, and spectral units of the profile.
+     * @param result - the computed profile.
+     */
+    void insert( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const Carta::Lib::RegionInfo& regionInfo, const Carta::Lib::ProfileInfo& profInfo,
+            const Carta::Lib::Hooks::ProfileResult& result );
+
+    /**
+     * Discard the profiles of an image.
+     * @param image - the image whose profiles should be discarded, or null to
+     *      discard all profiles.
+     */
+    void remove( std::shared_ptr<Carta::Lib::Image::ImageInterface> image );
+
+    /**
+     * Destructor.
+     */
+    ~ProfileCache();
+
+    //Default upper bound on the memory used by the stored profiles, in bytes.
+    static const int64_t MAX_CACHE_BYTES;
+
+private:
+
+    struct Entry {
+        //The cache does not keep closed images alive.
+        std::weak_ptr<Carta::Lib::Image::ImageInterface> m_image;
+        Carta::Lib::RegionInfo m_regionInfo;
+        Carta::Lib::ProfileInfo m_profileInfo;
+        Carta::Lib::Hooks::ProfileResult m_result;
+        int64_t m_bytes;
+    };
+
+    //Returns whether an entry holds a profile of the given image.
+    static bool _isImage( const Entry& entry,
+            std::shared_ptr<Carta::Lib::Image::ImageInterface> image );
+
+    //Discard the profiles of images that have been closed.
+    void _removeClosed();
+
+    //Discard the least recently used profiles until the memory bound is met.
+    void _trim();
+
+    //Most recently used first.
+    std::list<Entry> m_entries;
+    int64_t m_maxBytes;
+    int64_t m_usedBytes;
+
+    ProfileCache( const ProfileCache& other);
+    ProfileCache& operator=( const ProfileCache& other );
+};
+}
+}
@@ -0,0 +1,382 @@
+#include "ProfileEngine.h"
+#include "Data/Util.h"
+#include "Data/Region/RegionSpans.h"
+#include "Data/Units/UnitsSpectral.h"
+#include "Data/Error/ErrorManager.h"
+#include "Algorithms/bulkRead.h"
+#include "Algorithms/parallelAlgorithms.h"
+#include "Algorithms/runningStatistics.h"
+#include "Globals.h"
+#include "PluginManager.h"
+#include "CartaLib/Hooks/ConversionSpectralHook.h"
+#include "CartaLib/IImage.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Carta
+{
+namespace Data
+{
+
+namespace
+{
+std::vector<double> _convertSpectral( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const QString& oldUnits, const QString& newUnits, const std::vector<double>& values ){
+    std::vector<double> converted;
+    auto result = Globals::instance()-> pluginManager()
+                     -> prepare <Carta::Lib::Hooks::ConversionSpectralHook>(image,
+                             oldUnits, newUnits, values );
+    auto lam = [&converted] ( const Carta::Lib::Hooks::ConversionSpectralHook::ResultType &data ) {
+        converted = data;
+    };
+    try {
+        result.forEach( lam );
+    }
+    catch( char*& error ){
+        QString errorStr( error );
+        ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
+        hr->registerError( errorStr );
+    }
+    return converted;
+}
+}
+
+
+ProfileEngine::ProfileEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        int spectralIndex ):
+    m_image( image ),
+    m_spectralIndex( spectralIndex ),
+    m_parallel( true ){
+}
+
+
+Carta::Lib::Hooks::ProfileResult ProfileEngine::compute( const Carta::Lib::ProfileInfo& profileInfo,
+        const std::vector<double>& spectralValues ) const {
+    std::vector<std::vector<Carta::Lib::Hooks::ProfileResult> > results =
+            computeBatch( { m_region }, { profileInfo.getAggregateType() }, spectralValues );
+    return results[0][0];
+}
+
+
+std::vector<std::vector<Carta::Lib::Hooks::ProfileResult> > ProfileEngine::computeBatch(
+        const std::vector<std::shared_ptr<RegionSpans> >& regions,
+        const std::vector<Carta::Lib::ProfileInfo::AggregateType>& aggregateTypes,
+        const std::vector<double>& spectralValues ) const {
+    int regionCount = regions.size();
+    int typeCount = aggregateTypes.size();
+    std::vector<std::vector<Carta::Lib::Hooks::ProfileResult> > results( regionCount,
+            std::vector<Carta::Lib::Hooks::ProfileResult>( typeCount ) );
+    if ( !m_image ){
+        for ( std::vector<Carta::Lib::Hooks::ProfileResult>& regionResults : results ){
+            for ( Carta::Lib::Hooks::ProfileResult& result : regionResults ){
+                result.setError( "There was no image for the profile." );
+            }
+        }
+        return results;
+    }
+    std::vector<std::vector<ChannelStatistics> > stats = computeStatistics( regions );
+    if ( isCancelled() ){
+        return results;
+    }
+    int channelCount = getChannelCount();
+    std::vector<std::pair<double,double> > data( channelCount );
+    for ( int i = 0; i < regionCount; i++ ){
+        for ( int j = 0; j < typeCount; j++ ){
+            for ( int channel = 0; channel < channelCount; channel++ ){
+                double x = channel;
+                if ( channel < static_cast<int>( spectralValues.size() ) ){
+                    x = spectralValues[channel];
+                }
+                data[channel] = std::pair<double,double>( x,
+                        getValue( stats[i][channel], aggregateTypes[j] ) );
+            }
+            results[i][j].setData( data );
+        }
+    }
+    return results;
+}
+
+
+std::vector<ProfileEngine::ChannelStatistics> ProfileEngine::computeStatistics() const {
+    return computeStatistics( { m_region } )[0];
+}
+
+
+std::vector<std::vector<ProfileEngine::ChannelStatistics> > ProfileEngine::computeStatistics(
+        const std::vector<std::shared_ptr<RegionSpans> >& regions ) const {
+    using namespace Carta::Core::Algorithms;
+    int channelCount = getChannelCount();
+    int regionCount = regions.size();
+    std::vector<std::vector<ChannelStatistics> > stats( regionCount,
+            std::vector<ChannelStatistics>( channelCount ) );
+    if ( !m_image || regionCount == 0 ){
+        return stats;
+    }
+
+    //Each channel is read once, over a rectangle holding every region; a region
+    //without pixels of its own stands for whole planes.
+    bool useRegions = _isRegionAxes();
+    QRect box;
+    bool wholePlane = false;
+    for ( const std::shared_ptr<RegionSpans>& region : regions ){
+        if ( !region ){
+            wholePlane = true;
+        }
+        else {
+            box = box.united( region->getBounds() );
+        }
+    }
+    if ( useRegions && wholePlane ){
+        std::vector<int> dims = m_image->dims();
+        box = QRect( 0, 0, dims[0], dims[1] );
+    }
+    if ( useRegions && box.isEmpty() ){
+        //None of the regions covers a pixel.
+        for ( int i = 0; i < regionCount; i++ ){
+            for ( int channel = 0; channel < channelCount; channel++ ){
+                _computeChannelStatistics( std::vector<float>(), stats[i][channel] );
+            }
+        }
+        return stats;
+    }
+
+    //Reads of the image are serialized, but the statistics of one channel are
+    //computed while other channels are being read.
+    auto computeChannels = [this, &stats, &regions, useRegions, box]( int64_t begin, int64_t end, int /*part*/ ){
+        std::vector<float> planeData;
+        std::vector<float> regionData;
+        for ( int64_t channel = begin; channel < end && !isCancelled(); channel++ ){
+            _readChannel( channel, useRegions ? box : QRect(), planeData );
+            int64_t boxSize = int64_t( box.width() ) * box.height();
+            for ( size_t i = 0; i < regions.size(); i++ ){
+                if ( useRegions && regions[i] ){
+                    int64_t planeCount = boxSize > 0 ? planeData.size() / boxSize : 0;
+                    regions[i]->gather( planeData.data(), box, planeCount, regionData );
+                    _computeChannelStatistics( regionData, stats[i][channel] );
+                }
+                else {
+                    _computeChannelStatistics( planeData, stats[i][channel] );
+                }
+            }
+        }
+    };
+    if ( m_parallel ){
+        parallelRanges( channelCount, 1, computeChannels );
+    }
+    else {
+        computeChannels( 0, channelCount, 0 );
+    }
+    return stats;
+}
+
+
+void ProfileEngine::_computeChannelStatistics( const std::vector<float>& values,
+        ChannelStatistics& channelStats ){
+    Carta::Core::Algorithms::RunningStatistics running;
+    std::vector<float> valid;
+    valid.reserve( values.size() );
+    for ( float val : values ){
+        if ( Q_LIKELY( std::isfinite( val ) ) ){
+            running.add( val, 0 );
+            valid.push_back( val );
+        }
+    }
+    channelStats.count = running.count;
+    channelStats.sum = running.sum;
+    channelStats.sumSquares = running.sumSquares;
+    channelStats.min = std::numeric_limits<double>::max();
+    channelStats.max = std::numeric_limits<double>::lowest();
+    channelStats.variance = 0;
+    if ( running.count > 0 ){
+        channelStats.min = running.min;
+        channelStats.max = running.max;
+    }
+    if ( running.count > 1 ){
+        //Sample variance, like casacore.
+        channelStats.variance = running.m2 / ( running.count - 1 );
+    }
+    channelStats.median = std::numeric_limits<double>::quiet_NaN();
+    if ( !valid.empty() ){
+        //With an even count, the median is the mean of the two middle values.
+        size_t middle = valid.size() / 2;
+        std::nth_element( valid.begin(), valid.begin() + middle, valid.end() );
+        channelStats.median = valid[middle];
+        if ( valid.size() % 2 == 0 ){
+            float lower = *std::max_element( valid.begin(), valid.begin() + middle );
+            channelStats.median = ( channelStats.median + lower ) / 2;
+        }
+    }
+}
+
+
+int ProfileEngine::getChannelCount() const {
+    int channelCount = 1;
+    if ( m_image && m_spectralIndex >= 0 ){
+        channelCount = m_image->dims()[m_spectralIndex];
+    }
+    return channelCount;
+}
+
+
+bool ProfileEngine::_isRegionAxes() const {
+    //Regions are drawn on the first two axes, which must not be the spectral axis.
+    return m_spectralIndex != 0 && m_spectralIndex != 1 && m_image->dims().size() >= 2;
+}
+
+
+double ProfileEngine::getRestFrequency( std::shared_ptr<Carta::Lib::Image::ImageInterface> image ){
+    //The rest frequency is the frequency at zero velocity.
+    double restFrequency = 0;
+    std::vector<double> converted = _convertSpectral( image, UnitsSpectral::UNIT_KMS, "Hz", { 0 } );
+    if ( converted.size() == 1 && std::isfinite( converted[0] ) ){
+        restFrequency = converted[0];
+    }
+    return restFrequency;
+}
+
+
+std::vector<double> ProfileEngine::getSpectralValues(
+        std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const Carta::Lib::ProfileInfo& profileInfo ){
+    int channelCount = 1;
+    int spectralIndex = Util::getAxisIndex( image, Carta::Lib::AxisInfo::KnownType::SPECTRAL );
+    if ( spectralIndex >= 0 ){
+        channelCount = image->dims()[spectralIndex];
+    }
+    std::vector<double> channels( channelCount );
+    for ( int i = 0; i < channelCount; i++ ){
+        channels[i] = i;
+    }
+    QString spectralUnit = profileInfo.getSpectralUnit();
+    if ( spectralIndex < 0 || profileInfo.getSpectralType() == UnitsSpectral::NAME_CHANNEL ||
+            spectralUnit.isEmpty() || spectralUnit == "pixel" ){
+        return channels;
+    }
+    std::vector<double> converted = _convertSpectral( image, "", spectralUnit, channels );
+    if ( static_cast<int>( converted.size() ) != channelCount ){
+        qDebug() << "Could not convert profile channels to "<<spectralUnit;
+        return channels;
+    }
+    return converted;
+}
+
+
+double ProfileEngine::getValue( const ChannelStatistics& stats,
+        Carta::Lib::ProfileInfo::AggregateType aggregateType ){
+    if ( stats.count <= 0 ){
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double value = stats.sum / stats.count;
+    if ( aggregateType == Carta::Lib::ProfileInfo::AggregateType::MEDIAN ){
+        value = stats.median;
+    }
+    else if ( aggregateType == Carta::Lib::ProfileInfo::AggregateType::SUM ){
+        value = stats.sum;
+    }
+    else if ( aggregateType == Carta::Lib::ProfileInfo::AggregateType::VARIANCE ){
+        value = stats.variance;
+    }
+    else if ( aggregateType == Carta::Lib::ProfileInfo::AggregateType::MIN ){
+        value = stats.min;
+    }
+    else if ( aggregateType == Carta::Lib::ProfileInfo::AggregateType::MAX ){
+        value = stats.max;
+    }
+    else if ( aggregateType == Carta::Lib::ProfileInfo::AggregateType::RMS ){
+        value = std::sqrt( stats.sumSquares / stats.count );
+    }
+    return value;
+}
+
+
+bool ProfileEngine::isCancelled() const {
+    return m_isCancelled && m_isCancelled();
+}
+
+
+bool ProfileEngine::isSupported( const Carta::Lib::ProfileInfo& profileInfo ){
+    //Flux density needs the beam, which is only known to casacore.
+    Carta::Lib::ProfileInfo::AggregateType aggregateType = profileInfo.getAggregateType();
+    if ( aggregateType == Carta::Lib::ProfileInfo::AggregateType::FLUX_DENSITY ||
+            aggregateType == Carta::Lib::ProfileInfo::AggregateType::OTHER ){
+        return false;
+    }
+    //The spectral conversion uses the image rest frequency and radio velocities.
+    QString spectralType = profileInfo.getSpectralType();
+    bool supported = false;
+    if ( spectralType.isEmpty() || spectralType == UnitsSpectral::NAME_CHANNEL ||
+            spectralType == UnitsSpectral::NAME_FREQUENCY ||
+            spectralType == UnitsSpectral::NAME_WAVELENGTH ){
+        supported = true;
+    }
+    else if ( spectralType == UnitsSpectral::NAME_VELOCITY_RADIO ){
+        supported = profileInfo.getRestUnit().trimmed().isEmpty();
+    }
+    return supported;
+}
+
+
+std::shared_ptr<RegionSpans> ProfileEngine::makeRegion(
+        std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const Carta::Lib::RegionInfo& regionInfo ){
+    std::shared_ptr<RegionSpans> region;
+    if ( image && image->dims().size() >= 2 && !regionInfo.getCorners().empty() ){
+        std::vector<int> dims = image->dims();
+        region.reset( new RegionSpans( { regionInfo }, dims[0], dims[1] ) );
+    }
+    return region;
+}
+
+
+void ProfileEngine::_readChannel( int channel, const QRect& box, std::vector<float>& values ) const {
+    values.clear();
+    SliceND planeSlice;
+    if ( m_spectralIndex >= 0 ){
+        planeSlice.slice( m_spectralIndex ).start( channel ).end( channel + 1 );
+    }
+    if ( !box.isNull() ){
+        planeSlice.slice( 0 ).start( box.left() ).end( box.right() + 1 );
+        planeSlice.slice( 1 ).start( box.top() ).end( box.bottom() + 1 );
+    }
+    std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view( m_image->getDataSlice( planeSlice ) );
+    if ( !view ){
+        return;
+    }
+    values = Carta::Core::Algorithms::readAll<float>( view.get() );
+    //A mask that cannot be read is treated as no mask.
+    std::unique_ptr<Carta::Lib::NdArray::Byte> maskView;
+    if ( m_image->hasMask() ){
+        maskView.reset( m_image->getMaskSlice( planeSlice ) );
+    }
+    if ( maskView ){
+        std::vector<uint8_t> mask = Carta::Core::Algorithms::readAll<uint8_t>( maskView->rawView() );
+        for ( size_t i = 0; i < values.size(); i++ ){
+            if ( !mask[i] ){
+                values[i] = std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+    }
+}
+
+
+void ProfileEngine::setMonitor( const std::function<bool()>& isCancelled ){
+    m_isCancelled = isCancelled;
+}
+
+
+void ProfileEngine::setParallel( bool parallel ){
+    m_parallel = parallel;
+}
+
+
+void ProfileEngine::setRegion( std::shared_ptr<RegionSpans> region ){
+    m_region = region;
+}
+
+
+ProfileEngine::~ProfileEngine(){
+}
+}
+}
@@ -0,0 +1,201 @@
+/**
+ * Computes spectral profiles of image regions inside the viewer process.
+ **/
+
+#pragma once
+
+#include "CartaLib/Hooks/ProfileResult.h"
+#include "CartaLib/ProfileInfo.h"
+#include "CartaLib/RegionInfo.h"
+#include <QRect>
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class RegionSpans;
+
+class ProfileEngine {
+
+public:
+
+    /// Summary of the valid pixels of a region in one channel.
+    struct ChannelStatistics {
+        int64_t count;
+        double sum;
+        double sumSquares;
+        /// sample variance, accumulated with Welford's method; 0 for fewer than two pixels
+        double variance;
+        double min;
+        double max;
+        double median;
+    };
+
+    /**
+     * Constructor.
+     * @param image - the image that will be the source of the profile.
+     * @param spectralIndex - the index of the spectral axis in the image or -1 if there
+     *      is no spectral axis.
+     */
+    ProfileEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image, int spectralIndex );
+
+    /**
+     * Compute the profile.
+     * @param profileInfo - the statistic used for combining the pixels of each channel.
+     * @param spectralValues - the spectral coordinate of each channel.
+     * @return - the profile data; on failure the result has an error message.
+     */
+    Carta::Lib::Hooks::ProfileResult compute( const Carta::Lib::ProfileInfo& profileInfo,
+            const std::vector<double>& spectralValues ) const;
+
+    /**
+     * Compute profiles of several regions with several statistics.  Each channel
+     * is read once for all of the profiles.
+     * @param regions - the pixels of each plane in each region; a null region
+     *      stands for whole planes.
+     * @param aggregateTypes - the statistics to compute for every region.
+     * @param spectralValues - the spectral coordinate of each channel.
+     * @return - the profiles, indexed by region and then by statistic.
+     */
+    std::vector<std::vector<Carta::Lib::Hooks::ProfileResult> > computeBatch(
+            const std::vector<std::shared_ptr<RegionSpans> >& regions,
+            const std::vector<Carta::Lib::ProfileInfo::AggregateType>& aggregateTypes,
+            const std::vector<double>& spectralValues ) const;
+
+    /**
+     * Compute the statistics of every channel.  Each channel is read once and all
+     * statistics are computed from that read; unless disabled, channels are divided
+     * between the threads of the global thread pool.  NaN and masked pixels are ignored.
+     * @return - the statistics of each channel along the spectral axis.
+     */
+    std::vector<ChannelStatistics> computeStatistics() const;
+
+    /**
+     * Compute the statistics of every channel for several regions.  Each channel is
+     * read once, over a rectangle containing all of the regions.
+     * @param regions - the pixels of each plane in each region; a null region
+     *      stands for whole planes.
+     * @return - the statistics of each channel, indexed by region and then by channel.
+     */
+    std::vector<std::vector<ChannelStatistics> > computeStatistics(
+            const std::vector<std::shared_ptr<RegionSpans> >& regions ) const;
+
+    /**
+     * Returns the number of channels along the spectral axis.
+     * @return - the length of the profile.
+     */
+    int getChannelCount() const;
+
+    /**
+     * Returns whether the computation has been cancelled.
+     * @return - true if the cancellation callback asks the computation to stop.
+     */
+    bool isCancelled() const;
+
+    /**
+     * Set a callback for stopping a long computation.
+     * @param isCancelled - polled between channels; when it returns true the
+     *      computation stops early and the result is incomplete.
+     */
+    void setMonitor( const std::function<bool()>& isCancelled );
+
+    /**
+     * Set whether channels are divided between the threads of the global thread pool.
+     * @param parallel - true to compute channels in parallel; false to compute them
+     *      on the calling thread.
+     */
+    void setParallel( bool parallel );
+
+    /**
+     * Restrict the profile to the pixels covered by regions.
+     * @param region - the pixels of each plane to include, or null for whole planes.
+     */
+    void setRegion( std::shared_ptr<RegionSpans> region );
+
+    /**
+     * Returns the value of a statistic.
+     * @param stats - the statistics of a channel.
+     * @param aggregateType - the statistic to return.
+     * @return - the value of the statistic or NaN if the channel had no valid pixels.
+     */
+    static double getValue( const ChannelStatistics& stats,
+            Carta::Lib::ProfileInfo::AggregateType aggregateType );
+
+    /**
+     * Returns whether a profile can be computed by the engine.
+     * @param profileInfo - information about the profile to be generated.
+     * @return - true if the statistic and spectral axis do not need the casacore
+     *      profile plugin; false otherwise.
+     */
+    static bool isSupported( const Carta::Lib::ProfileInfo& profileInfo );
+
+    /**
+     * Return the rest frequency of the image.
+     * @param image - the image that will be the source of the profile.
+     * @return - the rest frequency in Hz, or 0 if it could not be determined.
+     * @note the conversion uses plugin hooks and should be done on the main thread.
+     */
+    static double getRestFrequency( std::shared_ptr<Carta::Lib::Image::ImageInterface> image );
+
+    /**
+     * Return the spectral coordinate of every channel in the units of the profile.
+     * @param image - the image that will be the source of the profile.
+     * @param profileInfo - information about the profile to be generated.
+     * @return - the coordinate of each channel; channel indices if no conversion
+     *      is needed or possible.
+     * @note the conversion uses plugin hooks and should be done on the main thread.
+     */
+    static std::vector<double> getSpectralValues(
+            std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const Carta::Lib::ProfileInfo& profileInfo );
+
+    /**
+     * Rasterize the region of a profile.
+     * @param image - the image that will be the source of the profile.
+     * @param regionInfo - the region, with corners in pixel coordinates.
+     * @return - the pixels covered by the region, or null if the region has no
+     *      corners and the whole plane should be used.
+     */
+    static std::shared_ptr<RegionSpans> makeRegion(
+            std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const Carta::Lib::RegionInfo& regionInfo );
+
+    /**
+     * Destructor.
+     */
+    ~ProfileEngine();
+
+private:
+
+    //Summarize the valid values of one channel.
+    static void _computeChannelStatistics( const std::vector<float>& values,
+            ChannelStatistics& channelStats );
+
+    //Returns whether regions can be applied to the planes of the image.
+    bool _isRegionAxes() const;
+
+    //Read the pixels of one channel inside a rectangle of the first two axes, or
+    //the whole channel if the rectangle is null, with masked pixels replaced by NaN.
+    void _readChannel( int channel, const QRect& box, std::vector<float>& values ) const;
+
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    int m_spectralIndex;
+    bool m_parallel;
+    std::shared_ptr<RegionSpans> m_region;
+    std::function<bool()> m_isCancelled;
+};
+}
+}
@@ -1,16 +1,14 @@
 #include "ProfileRenderService.h"
 #include "ProfileRenderWorker.h"
-#include "ProfileRenderThread.h"
-#include "CartaLib/Hooks/ProfileHook.h"
+#include <QtConcurrent/QtConcurrentRun>
 
 namespace Carta {
 namespace Data {
 
+const int ProfileRenderService::RUNNING_JOB_MAX = 2;
+
 ProfileRenderService::ProfileRenderService( QObject * parent ) :
-        QObject( parent ),
-        m_worker( nullptr),
-        m_renderThread( nullptr ){
-    m_renderQueued = false;
+        QObject( parent ){
 }
 
 
@@ -19,15 +17,47 @@ bool ProfileRenderService::renderProfile(std::shared_ptr<Carta::Lib::Image::Imag
         int curveIndex, const QString& layerName, bool createNew ){
     bool profileRender = true;
     if ( dataSource ){
-        RenderRequest request;
-        request.m_image = dataSource;
-        request.m_regionInfo = regionInfo;
-        request.m_profileInfo = profInfo;
-        request.m_curveIndex = curveIndex;
-        request.m_layerName = layerName;
-        request.m_createNew = createNew;
-        m_requests.enqueue( request );
-        _scheduleRender( dataSource, regionInfo, profInfo );
+        std::shared_ptr<RenderJob> job( new RenderJob() );
+        job->m_createNew = createNew;
+        job->m_curveIndex = curveIndex;
+        job->m_layerName = layerName;
+        job->m_image = dataSource;
+        job->m_regionInfo = regionInfo;
+        job->m_profileInfo = profInfo;
+        job->m_cancelled.reset( new std::atomic<bool>( false ) );
+        job->m_watcher = nullptr;
+
+        //Requests for the same curve that have not been answered yet are out of date.
+        for ( int i = m_waitingJobs.size() - 1; i >= 0; i-- ){
+            if ( _isSuperseded( *m_waitingJobs[i], *job ) ){
+                m_waitingJobs.removeAt( i );
+            }
+        }
+        for ( int i = m_cachedJobs.size() - 1; i >= 0; i-- ){
+            if ( _isSuperseded( *m_cachedJobs[i], *job ) ){
+                m_cachedJobs.removeAt( i );
+            }
+        }
+        for ( std::shared_ptr<RenderJob>& running : m_runningJobs ){
+            if ( _isSuperseded( *running, *job ) ){
+                running->m_cancelled->store( true );
+            }
+        }
+
+        if ( m_cache.find( dataSource, regionInfo, profInfo, &job->m_result ) ){
+            m_cachedJobs.append( job );
+            if ( m_cachedJobs.size() == 1 ){
+                QMetaObject::invokeMethod( this, "_postCachedResults", Qt::QueuedConnection );
+            }
+        }
+        else {
+            //Spectral conversions use plugin hooks, so the parameters are resolved
+            //here on the main thread.
+            job->m_worker.reset( new ProfileRenderWorker() );
+            job->m_worker->setParameters( dataSource, regionInfo, profInfo );
+            m_waitingJobs.append( job );
+            _startJobs();
+        }
     }
     else {
         profileRender = false;
@@ -36,61 +66,86 @@ bool ProfileRenderService::renderProfile(std::shared_ptr<Carta::Lib::Image::Imag
 }
 
 
-void ProfileRenderService::_scheduleRender( std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
-        Carta::Lib::RegionInfo& regionInfo, Carta::Lib::ProfileInfo& profInfo){
+void ProfileRenderService::clearCache( std::shared_ptr<Carta::Lib::Image::ImageInterface> image ){
+    m_cache.remove( image );
+}
 
-    if ( m_renderQueued ) {
-        return;
-    }
-    m_renderQueued = true;
 
+int64_t ProfileRenderService::getCacheMemoryUsage() const {
+    return m_cache.getMemoryUsage();
+}
 
-    //Create a worker if we don't have one.
-    if ( !m_worker ){
-        m_worker = new ProfileRenderWorker();
-    }
-    bool paramsChanged = m_worker->setParameters( dataSource, regionInfo, profInfo );
-    if ( paramsChanged ){
-
-        int pid = m_worker->computeProfile();
-        if ( pid != -1 ){
-            if ( !m_renderThread ){
-                m_renderThread = new ProfileRenderThread( pid );
-                connect( m_renderThread, SIGNAL(finished()), this, SLOT( _postResult()));
-            }
-            else {
-                m_renderThread->setFileDescriptor( pid );
-            }
-            m_renderThread->start();
-        }
-        else {
-            qDebug() << "Bad file descriptor: "<<pid;
-            m_renderQueued = false;
+
+bool ProfileRenderService::_isSuperseded( const RenderJob& older, const RenderJob& newer ){
+    //A request that creates a curve is never replaced, since a later request may
+    //refer to the curve it creates.
+    return !older.m_createNew && !newer.m_createNew &&
+            older.m_curveIndex == newer.m_curveIndex &&
+            older.m_layerName == newer.m_layerName;
+}
+
+
+void ProfileRenderService::_jobFinished( RenderJob* finished ){
+    std::shared_ptr<RenderJob> job;
+    for ( int i = 0; i < m_runningJobs.size(); i++ ){
+        if ( m_runningJobs[i].get() == finished ){
+            job = m_runningJobs.takeAt( i );
+            break;
         }
     }
-    else {
-        m_renderQueued = false;
+    if ( !job ){
+        return;
+    }
+    //The watcher is sending the notification, so it is deleted later.
+    job->m_watcher->deleteLater();
+    _startJobs();
+    if ( !job->m_cancelled->load() ){
+        Carta::Lib::Hooks::ProfileResult result = job->m_watcher->result();
+        m_cache.insert( job->m_image, job->m_regionInfo, job->m_profileInfo, result );
+        emit profileResult( result, job->m_curveIndex, job->m_layerName,
+                job->m_createNew, job->m_image );
     }
 }
 
-void ProfileRenderService::_postResult( ){
-    Carta::Lib::Hooks::ProfileResult result = m_renderThread->getResult();
-    RenderRequest request = m_requests.dequeue();
-    emit profileResult( result, request.m_curveIndex, request.m_layerName,
-            request.m_createNew, request.m_image );
-    m_renderQueued = false;
-    if ( m_requests.size() > 0 ){
-        RenderRequest& head = m_requests.head();
-         _scheduleRender( head.m_image,
-                head.m_regionInfo, head.m_profileInfo );
+
+void ProfileRenderService::_postCachedResults(){
+    QList<std::shared_ptr<RenderJob> > jobs;
+    jobs.swap( m_cachedJobs );
+    for ( std::shared_ptr<RenderJob>& job : jobs ){
+        emit profileResult( job->m_result, job->m_curveIndex, job->m_layerName,
+                job->m_createNew, job->m_image );
+    }
+}
+
+
+void ProfileRenderService::_startJobs(){
+    while ( m_runningJobs.size() < RUNNING_JOB_MAX && !m_waitingJobs.isEmpty() ){
+        std::shared_ptr<RenderJob> job = m_waitingJobs.takeFirst();
+        m_runningJobs.append( job );
+        std::shared_ptr<ProfileRenderWorker> worker = job->m_worker;
+        std::shared_ptr<std::atomic<bool> > cancelled = job->m_cancelled;
+        job->m_watcher = new QFutureWatcher<Carta::Lib::Hooks::ProfileResult>();
+        RenderJob* jobPtr = job.get();
+        connect( job->m_watcher, &QFutureWatcherBase::finished, this, [this, jobPtr](){
+            _jobFinished( jobPtr );
+        });
+        job->m_watcher->setFuture( QtConcurrent::run( [worker, cancelled](){
+            return worker->computeProfile( [cancelled](){ return cancelled->load(); } );
+        }));
     }
 }
 
 
 ProfileRenderService::~ProfileRenderService(){
-    delete m_worker;
-    delete m_renderThread;
+    m_waitingJobs.clear();
+    for ( std::shared_ptr<RenderJob>& running : m_runningJobs ){
+        running->m_cancelled->store( true );
+    }
+    for ( std::shared_ptr<RenderJob>& running : m_runningJobs ){
+        running->m_watcher->disconnect( this );
+        running->m_watcher->waitForFinished();
+        delete running->m_watcher;
+    }
 }
 }
 }
-
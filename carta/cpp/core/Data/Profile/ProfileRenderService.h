@@ -4,13 +4,14 @@
 
 #pragma once
 
-
 #include "CartaLib/CartaLib.h"
 #include "CartaLib/RegionInfo.h"
 #include "CartaLib/Hooks/ProfileResult.h"
-
+#include "ProfileCache.h"
 #include <QObject>
-#include <QQueue>
+#include <QFutureWatcher>
+#include <QList>
+#include <atomic>
 #include <memory>
 
 namespace Carta {
@@ -26,7 +27,6 @@ namespace Carta{
 namespace Data{
 
 class ProfileRenderWorker;
-class ProfileRenderThread;
 
 class ProfileRenderService : public QObject {
     Q_OBJECT
@@ -39,7 +39,9 @@ public:
     explicit ProfileRenderService( QObject * parent = 0 );
 
     /**
-     * Initiates the process of rendering the Profile.
+     * Initiates the process of rendering the Profile.  A request for a curve that
+     * already has a request waiting or running replaces it.  Profiles that have
+     * been computed recently are answered from the cache without reading the image.
      * @param dataSource - the image that will be the source of the profile.
      * @param regionInfo - information about the region within the image that will be profiled.
      * @param profInfo - information about the profile to be rendered such as rest frequency.
@@ -52,11 +54,27 @@ public:
             Carta::Lib::RegionInfo& regionInfo, Carta::Lib::ProfileInfo& profInfo,
             int curveIndex, const QString& layerName, bool createNew );
 
+    /**
+     * Discard cached profiles.
+     * @param image - the image whose profiles should be discarded, or null to discard
+     *      all cached profiles.
+     */
+    void clearCache( std::shared_ptr<Carta::Lib::Image::ImageInterface> image = nullptr );
+
+    /**
+     * Returns the memory used by cached profiles.
+     * @return - an estimate of the memory used by the profile cache, in bytes.
+     */
+    int64_t getCacheMemoryUsage() const;
+
     /**
      * Destructor.
      */
     ~ProfileRenderService();
 
+    //Largest number of profiles computed at the same time.
+    static const int RUNNING_JOB_MAX;
+
 signals:
 
     /**
@@ -68,31 +86,44 @@ signals:
 
 private slots:
 
-    void _postResult( );
+    void _postCachedResults();
 
 private:
-    void _scheduleRender( std::shared_ptr<Carta::Lib::Image::ImageInterface> dataSource,
-            Carta::Lib::RegionInfo& regionInfo, Carta::Lib::ProfileInfo& profInfo );
-    ProfileRenderWorker* m_worker;
-    ProfileRenderThread* m_renderThread;
-    bool m_renderQueued;
-
 
-    struct RenderRequest {
+    struct RenderJob {
         bool m_createNew;
         int m_curveIndex;
         QString m_layerName;
-        Carta::Lib::ProfileInfo m_profileInfo;
-        Carta::Lib ::RegionInfo m_regionInfo;
         std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+        Carta::Lib::RegionInfo m_regionInfo;
+        Carta::Lib::ProfileInfo m_profileInfo;
+        //Set instead of a worker when the profile was found in the cache.
+        Carta::Lib::Hooks::ProfileResult m_result;
+        std::shared_ptr<ProfileRenderWorker> m_worker;
+        //Set when a newer request for the same curve supersedes this one.
+        std::shared_ptr<std::atomic<bool> > m_cancelled;
+        //Created when the job starts.
+        QFutureWatcher<Carta::Lib::Hooks::ProfileResult>* m_watcher;
     };
-    QQueue<RenderRequest> m_requests;
+
+    //Whether a newer request replaces an older one.
+    static bool _isSuperseded( const RenderJob& older, const RenderJob& newer );
+
+    //Deliver the result of a finished job and start waiting ones.
+    void _jobFinished( RenderJob* finished );
+
+    //Start waiting jobs while there is room.
+    void _startJobs();
+
+    QList<std::shared_ptr<RenderJob> > m_waitingJobs;
+    QList<std::shared_ptr<RenderJob> > m_runningJobs;
+    //Requests answered from the cache, delivered from the event loop so that results
+    //always arrive after the request returns.
+    QList<std::shared_ptr<RenderJob> > m_cachedJobs;
+    ProfileCache m_cache;
 
     ProfileRenderService( const ProfileRenderService& other);
     ProfileRenderService& operator=( const ProfileRenderService& other );
 };
 }
 }
-
-
-
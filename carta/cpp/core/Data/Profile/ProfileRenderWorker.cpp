@@ -1,18 +1,18 @@
 #include "ProfileRenderWorker.h"
+#include "ProfileEngine.h"
+#include "Data/Util.h"
 #include "Globals.h"
 #include "PluginManager.h"
 #include "CartaLib/Hooks/ProfileHook.h"
-#include <QFile>
-#include <QDataStream>
-#include <string.h>
-#include <unistd.h>
+#include <QDebug>
 
 namespace Carta
 {
 namespace Data
 {
 
-ProfileRenderWorker::ProfileRenderWorker(){
+ProfileRenderWorker::ProfileRenderWorker():
+    m_restFrequency( 0 ){
 }
 
 
@@ -31,57 +31,61 @@ bool ProfileRenderWorker::setParameters(std::shared_ptr<Carta::Lib::Image::Image
         m_dataSource = dataSource;
         paramsChanged = true;
     }
+    if ( paramsChanged && ProfileEngine::isSupported( m_profileInfo ) ){
+        //The spectral axis is converted with plugin hooks, here on the main thread.
+        m_spectralValues = ProfileEngine::getSpectralValues( m_dataSource, m_profileInfo );
+        if ( m_profileInfo.getRestUnit().trimmed().isEmpty() ){
+            m_restFrequency = ProfileEngine::getRestFrequency( m_dataSource );
+        }
+    }
     return paramsChanged;
 }
 
 
-int ProfileRenderWorker::computeProfile(){
-    //Note:  we compute the Profile in a separate process because casacore tables
-    //cannot be accessed by different threads at the same time.
-    int ProfilePipes [2];
-    if (pipe (ProfilePipes)){
-        qDebug() << "*** ProfileRenderWorker::run: pipe creation failed: " << strerror (errno);
-        return -1;
+Carta::Lib::Hooks::ProfileResult ProfileRenderWorker::computeProfile(
+        const std::function<bool()>& isCancelled ) const {
+    Carta::Lib::Hooks::ProfileResult result;
+    if ( ProfileEngine::isSupported( m_profileInfo ) ){
+        result = _computeNative( isCancelled );
+    }
+    else {
+        result = _computePlugin();
     }
+    return result;
+}
 
-    int pid = fork ();
-    if (pid == -1){
-        // Failure
-        qDebug() << "*** ProfileRenderWorker::run: fork failed: " << strerror (errno);
-        return -1;
 
+Carta::Lib::Hooks::ProfileResult ProfileRenderWorker::_computeNative(
+        const std::function<bool()>& isCancelled ) const {
+    int spectralIndex = Util::getAxisIndex( m_dataSource, Carta::Lib::AxisInfo::KnownType::SPECTRAL );
+    ProfileEngine engine( m_dataSource, spectralIndex );
+    engine.setRegion( ProfileEngine::makeRegion( m_dataSource, m_regionInfo ) );
+    engine.setMonitor( isCancelled );
+    Carta::Lib::Hooks::ProfileResult result = engine.compute( m_profileInfo, m_spectralValues );
+    if ( m_profileInfo.getRestUnit().trimmed().isEmpty() ){
+        result.setRestFrequency( m_restFrequency );
+        result.setRestUnits( "Hz" );
     }
-    else if (pid != 0){
-        // The original process comes here.
-        close (ProfilePipes [1]); // close write end of the pipe
-        return ProfilePipes [0]; // return the read end of the pipe
-    }
+    return result;
+}
+
 
-    // We're our own process
+Carta::Lib::Hooks::ProfileResult ProfileRenderWorker::_computePlugin() const {
+    Carta::Lib::Hooks::ProfileResult profileResult;
     auto result = Globals::instance()-> pluginManager()
                           -> prepare <Carta::Lib::Hooks::ProfileHook>(m_dataSource, m_regionInfo,
                                   m_profileInfo);
-    auto lam = [=] ( const Carta::Lib::Hooks::ProfileResult &data ) {
-        m_result = data;
+    auto lam = [&profileResult] ( const Carta::Lib::Hooks::ProfileResult &data ) {
+        profileResult = data;
     };
     try {
         result.forEach( lam );
     }
     catch( char*& error ){
-        qDebug() << "ProfileRenderWorker::run: caught error: " << error;
-        m_result.setError( QString(error) );
-    }
-
-    QFile file;
-    if ( !file.open( ProfilePipes[1], QIODevice::WriteOnly, QFileDevice::AutoCloseHandle ) ){
-        qDebug() << "Could not write Profile results";
-        return 0;
+        qDebug() << "ProfileRenderWorker::computeProfile: caught error: " << error;
+        profileResult.setError( QString(error) );
     }
-    QDataStream dataStream( &file );
-    dataStream << m_result;
-    file.close();
-    exit(0);
-    return 0;
+    return profileResult;
 }
 
 
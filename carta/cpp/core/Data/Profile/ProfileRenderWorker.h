@@ -1,10 +1,12 @@
 /**
- * Initiates the work of computing the Profile in a separate process.
+ * Holds the parameters of a profile computation and performs the computation.
  **/
 
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <vector>
 #include "CartaLib/Hooks/ProfileResult.h"
 #include "CartaLib/RegionInfo.h"
 #include "CartaLib/ProfileInfo.h"
@@ -32,7 +34,8 @@ public:
     ProfileRenderWorker();
 
     /**
-     * Store the parameters needed for computing the Profile.
+     * Store the parameters needed for computing the Profile.  The spectral axis is
+     * resolved here, so this should be called on the main thread.
      * @param dataSource - the image that will be the source of the Profile.
      * @param regionInfo - information about the region used to generate the profile.
      * @param profInfo - information about the profile to be generated.
@@ -43,11 +46,12 @@ public:
          Carta::Lib::RegionInfo& regionInfo, Carta::Lib::ProfileInfo& profInfo );
 
     /**
-     * Performs the work of computing the Profile data in a separate process.
-     * @return - the file descriptor for the pipe that can be used to read the
-     *      Profile data.
+     * Performs the work of computing the Profile data.  This may be called from
+     * any thread.
+     * @param isCancelled - polled during the computation; it stops early when this returns true.
+     * @return - the computed data for a profile plot.
      */
-    int computeProfile();
+    Carta::Lib::Hooks::ProfileResult computeProfile( const std::function<bool()>& isCancelled = nullptr ) const;
 
     /**
      * Destructor.
@@ -55,10 +59,18 @@ public:
     ~ProfileRenderWorker();
 
 private:
+    //Compute the profile with the native engine.
+    Carta::Lib::Hooks::ProfileResult _computeNative( const std::function<bool()>& isCancelled ) const;
+    //Compute the profile with the casacore profile plugin.
+    Carta::Lib::Hooks::ProfileResult _computePlugin() const;
+
     std::shared_ptr<Carta::Lib::Image::ImageInterface> m_dataSource;
     Carta::Lib::RegionInfo m_regionInfo;
     Carta::Lib::ProfileInfo m_profileInfo;
-    Carta::Lib::Hooks::ProfileResult m_result;
+    //Spectral coordinates of the channels and the image rest frequency, resolved
+    //when the parameters are set.
+    std::vector<double> m_spectralValues;
+    double m_restFrequency;
 
     ProfileRenderWorker( const ProfileRenderWorker& other);
     ProfileRenderWorker& operator=( const ProfileRenderWorker& other );
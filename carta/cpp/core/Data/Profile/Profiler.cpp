@@ -1,6 +1,7 @@
 #include "Profiler.h"
 #include "CurveData.h"
 #include "GenerateModes.h"
+#include "HoverSpectrumExtractor.h"
 #include "ProfilePlotStyles.h"
 #include "Data/Clips.h"
 #include "Data/DataLoader.h"
@@ -43,6 +44,8 @@ const QString Profiler::CURVES = "curves";
 const QString Profiler::CURVE_SELECT = "selectCurve";
 const QString Profiler::GEN_MODE = "genMode";
 const QString Profiler::GRID_LINES = "gridLines";
+const QString Profiler::HOVER_CURVE = "Cursor";
+const QString Profiler::HOVER_SPECTRUM = "hoverSpectrum";
 const QString Profiler::IMAGES = "images";
 const QString Profiler::LEGEND_LOCATION = "legendLocation";
 const QString Profiler::LEGEND_EXTERNAL = "legendExternal";
@@ -91,7 +94,8 @@ Profiler::Profiler( const QString& path, const QString& id):
             m_plotManager( new Plot2DManager( path, id ) ),
             m_legendLocations( nullptr),
             m_stateData( UtilState::getLookup(path, StateInterface::STATE_DATA) ),
-            m_renderService( new ProfileRenderService() ){
+            m_renderService( new ProfileRenderService() ),
+            m_hoverExtractor( new HoverSpectrumExtractor() ){
 
     m_oldFrame = 0;
     m_currentFrame = 0;
@@ -101,6 +105,9 @@ Profiler::Profiler( const QString& path, const QString& id):
             SIGNAL(profileResult(const Carta::Lib::Hooks::ProfileResult&,int,const QString&,bool,std::shared_ptr<Carta::Lib::Image::ImageInterface>)),
             this,
             SLOT(_profileRendered(const Carta::Lib::Hooks::ProfileResult&,int,const QString&,bool, std::shared_ptr<Carta::Lib::Image::ImageInterface>)));
+    connect( m_hoverExtractor.get(),
+            SIGNAL(spectrumReady(const std::vector<int>&,const std::vector<double>&)),
+            this, SLOT(_hoverSpectrumReady(const std::vector<int>&,const std::vector<double>&)));
 
     Carta::State::ObjectManager* objMan = Carta::State::ObjectManager::objectManager();
     Settings* prefObj = objMan->createObject<Settings>();
@@ -138,6 +145,8 @@ QString Profiler::addLink( CartaObject*  target){
                         this , SLOT(_loadProfile(Controller*)));
                 connect(controller, SIGNAL(frameChanged(Controller*, Carta::Lib::AxisInfo::KnownType)),
                         this, SLOT( _updateChannel(Controller*, Carta::Lib::AxisInfo::KnownType)));
+                connect(controller, SIGNAL(cursorChanged(Controller*,int,int)),
+                        this, SLOT( _cursorMoved(Controller*,int,int)));
                 m_controllerLinked = true;
                 _loadProfile( controller);
             }
@@ -227,6 +236,7 @@ void Profiler::_assignCurveName( std::shared_ptr<CurveData>& profileCurve ) cons
 
 void Profiler::_clearData(){
     m_plotManager->clearData();
+    m_renderService->clearCache();
     int curveSize = m_plotCurves.size();
     for ( int i = curveSize - 1; i>= 0; i-- ){
         QString curveName = m_plotCurves[i]->getName();
@@ -309,6 +319,49 @@ std::vector<double> Profiler::_convertUnitsY( std::shared_ptr<CurveData> curveDa
     return converted;
 }
 
+void Profiler::_cursorMoved( Controller* controller, int mouseX, int mouseY ){
+    if ( !controller || !m_state.getValue<bool>( HOVER_SPECTRUM ) ){
+        return;
+    }
+    std::shared_ptr<Layer> layer = controller->getLayer();
+    if ( !layer ){
+        return;
+    }
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> image = layer->_getImage();
+    bool valid = false;
+    QPointF imagePt = layer->_getImagePt( QPointF( mouseX, mouseY ), &valid );
+    if ( !image || !valid ){
+        return;
+    }
+
+    //The displayed axes come from the cursor and the others from the current frames.
+    Carta::Lib::AxisInfo::KnownType xType = layer->_getAxisXType();
+    Carta::Lib::AxisInfo::KnownType yType = layer->_getAxisYType();
+    //Only reading axis information, so a copy of the formatter is not needed.
+    std::shared_ptr<CoordinateFormatterInterface> cf = image->metaData()->coordinateFormatter();
+    int axisCount = image->dims().size();
+    std::vector<int> pos( axisCount, 0 );
+    for ( int i = 0; i < axisCount; i++ ){
+        Carta::Lib::AxisInfo::KnownType axisType = cf->axisInfo( i ).knownType();
+        if ( axisType == xType ){
+            pos[i] = qRound( imagePt.x() );
+        }
+        else if ( axisType == yType ){
+            pos[i] = qRound( imagePt.y() );
+        }
+        else {
+            pos[i] = controller->getFrame( axisType );
+        }
+    }
+    if ( image != m_hoverImage ){
+        m_hoverImage = image;
+        m_hoverValuesX.clear();
+    }
+    int spectralIndex = Util::getAxisIndex( image, Carta::Lib::AxisInfo::KnownType::SPECTRAL );
+    m_hoverExtractor->requestSpectrum( image, spectralIndex, pos );
+}
+
+
 void Profiler::_cursorUpdate( double x, double y ){
     QString cursorText;
     int curveCount = m_plotCurves.size();
@@ -616,6 +669,35 @@ double Profiler::getZoomMaxPercent() const {
 }
 
 
+void Profiler::_hoverSpectrumReady( const std::vector<int>& /*pos*/,
+        const std::vector<double>& spectrum ){
+    if ( !m_hoverImage || !m_state.getValue<bool>( HOVER_SPECTRUM ) ){
+        return;
+    }
+    int channelCount = spectrum.size();
+    //The spectral coordinates only change with the image or the units, so they are
+    //converted once rather than on every cursor move.
+    QString bottomUnit = _getUnitUnits( m_state.getValue<QString>( AXIS_UNITS_BOTTOM ) );
+    if ( static_cast<int>( m_hoverValuesX.size() ) != channelCount || m_hoverUnitsX != bottomUnit ){
+        m_hoverValuesX.resize( channelCount );
+        for ( int i = 0; i < channelCount; i++ ){
+            m_hoverValuesX[i] = i;
+        }
+        if ( !bottomUnit.isEmpty() ){
+            _convertX( m_hoverValuesX, m_hoverImage, "", bottomUnit );
+        }
+        m_hoverUnitsX = bottomUnit;
+    }
+    std::vector< std::pair<double,double> > plotData( channelCount );
+    for ( int i = 0; i < channelCount; i++ ){
+        plotData[i] = std::pair<double,double>( m_hoverValuesX[i], spectrum[i] );
+    }
+    Carta::Lib::Hooks::Plot2DResult plotResult( HOVER_CURVE, "", "", plotData );
+    m_plotManager->addData( &plotResult );
+    m_plotManager->updatePlot();
+}
+
+
 void Profiler::_initializeDefaultState(){
     //Data state is the curves
     m_stateData.insertArray( IMAGES, 0 );
@@ -638,6 +720,7 @@ void Profiler::_initializeDefaultState(){
     m_state.insertValue<QString>( AXIS_UNITS_LEFT, m_intensityUnits->getDefault());
     m_state.insertValue<QString>(GEN_MODE, m_generateModes->getDefault());
     m_state.insertValue<bool>(TOOL_TIPS, false );
+    m_state.insertValue<bool>(HOVER_SPECTRUM, false );
 
 
     //Legend
@@ -886,6 +969,24 @@ void Profiler::_initializeCallbacks(){
             return result;
         });
 
+    addCommandCallback( "setHoverSpectrum", [=] (const QString & /*cmd*/,
+                const QString & params, const QString & /*sessionId*/) -> QString {
+            std::set<QString> keys = {HOVER_SPECTRUM};
+            std::map<QString,QString> dataValues = Carta::State::UtilState::parseParamMap( params, keys );
+            QString hoverStr = dataValues[HOVER_SPECTRUM];
+            bool validBool = false;
+            bool hoverSpectrum = Util::toBool( hoverStr, &validBool );
+            QString result;
+            if ( validBool ){
+                setHoverSpectrum( hoverSpectrum );
+            }
+            else {
+                result = "Set following the cursor spectrum must be true/false: "+params;
+            }
+            Util::commandPostProcess( result );
+            return result;
+        });
+
     addCommandCallback( "setLegendLocation", [=] (const QString & /*cmd*/,
             const QString & params, const QString & /*sessionId*/) -> QString {
         std::set<QString> keys = {LEGEND_LOCATION};
@@ -1529,6 +1630,22 @@ QString Profiler::setLegendLocation( const QString& locateStr ){
     return result;
 }
 
+void Profiler::setHoverSpectrum( bool hoverSpectrum ){
+    bool oldHoverSpectrum = m_state.getValue<bool>( HOVER_SPECTRUM );
+    if ( oldHoverSpectrum != hoverSpectrum ){
+        m_state.setValue<bool>( HOVER_SPECTRUM, hoverSpectrum );
+        m_state.flushState();
+        if ( !hoverSpectrum ){
+            m_hoverExtractor->clear();
+            m_hoverImage.reset();
+            m_hoverValuesX.clear();
+            m_plotManager->removeData( HOVER_CURVE );
+            m_plotManager->updatePlot();
+        }
+    }
+}
+
+
 void Profiler::setLegendExternal( bool external ){
     bool oldExternal = m_state.getValue<bool>( LEGEND_EXTERNAL );
     if ( external != oldExternal ){
@@ -38,6 +38,7 @@ class Plot2DManager;
 class Controller;
 class CurveData;
 class GenerateModes;
+class HoverSpectrumExtractor;
 class LegendLocations;
 class LinkableImpl;
 class Layer;
@@ -181,6 +182,12 @@ public:
      */
     void setGridLines( bool showLines );
 
+    /**
+     * Set whether the spectrum under the image cursor is shown as the cursor moves.
+     * @param hoverSpectrum - true to follow the cursor; false otherwise.
+     */
+    void setHoverSpectrum( bool hoverSpectrum );
+
     /**
      * Set the drawing style for the Profiler (outline, filled, etc).
      * @param style a unique identifier for a Profiler drawing style.
@@ -316,7 +323,9 @@ protected:
     virtual void timerEvent( QTimerEvent* event );
 
 private slots:
+    void _cursorMoved( Controller* controller, int mouseX, int mouseY );
     void _cursorUpdate( double x, double y );
+    void _hoverSpectrumReady( const std::vector<int>& pos, const std::vector<double>& spectrum );
     void _loadProfile( Controller* controller);
     void _movieFrame();
     void _profileRendered( const Carta::Lib::Hooks::ProfileResult& result,
@@ -333,6 +342,8 @@ private:
     const static QString CURVE_SELECT;
     const static QString GEN_MODE;
     const static QString GRID_LINES;
+    const static QString HOVER_CURVE;
+    const static QString HOVER_SPECTRUM;
     const static QString IMAGES;
     const static QString LEGEND_SHOW;
     const static QString LEGEND_LINE;
@@ -448,6 +459,13 @@ private:
     //Compute the profile in a thread
     std::unique_ptr<ProfileRenderService> m_renderService;
 
+    //Spectrum under the image cursor.
+    std::unique_ptr<HoverSpectrumExtractor> m_hoverExtractor;
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_hoverImage;
+    //Spectral coordinates of the channels of the hover image in the bottom axis units.
+    std::vector<double> m_hoverValuesX;
+    QString m_hoverUnitsX;
+
 	Profiler( const Profiler& other);
 	Profiler& operator=( const Profiler& other );
 };
@@ -0,0 +1,209 @@
+#include "RegionSpans.h"
+#include "CartaLib/CartaLib.h"
+
+#include <QtCore/qmath.h>
+#include <QDebug>
+#include <cmath>
+
+namespace Carta {
+
+namespace Data {
+
+namespace {
+
+typedef std::vector<std::vector<std::pair<int,int> > > RowCoverage;
+
+//Mark the pixels in [xMin,xMax] of a row, clipped to the image.
+void _addRun( RowCoverage& rows, int width, int row, int xMin, int xMax ){
+    if ( row < 0 || row >= static_cast<int>( rows.size() ) ){
+        return;
+    }
+    int start = std::max( xMin, 0 );
+    int end = std::min( xMax + 1, width );
+    if ( start < end ){
+        rows[row].push_back( std::pair<int,int>( start, end ) );
+    }
+}
+}
+
+
+RegionSpans::RegionSpans( const std::vector<Carta::Lib::RegionInfo>& regions, int width, int height ):
+    m_pixelCount( 0 ){
+    RowCoverage rows( std::max( height, 0 ) );
+    for ( const Carta::Lib::RegionInfo& region : regions ){
+        std::vector<std::pair<double,double> > corners = region.getCorners();
+        Carta::Lib::RegionInfo::RegionType regionType = region.getRegionType();
+        if ( corners.empty() ){
+            continue;
+        }
+        if ( regionType == Carta::Lib::RegionInfo::RegionType::Ellipse ){
+            _rasterizeEllipse( corners, width, height, rows );
+        }
+        else if ( regionType == Carta::Lib::RegionInfo::RegionType::Polygon ){
+            //One or two corners describe a rectangle.
+            if ( corners.size() <= 2 ){
+                _rasterizeBox( corners, width, height, rows );
+            }
+            else {
+                _rasterizePolygon( corners, width, height, rows );
+            }
+        }
+        else {
+            qWarning() << "Unsupported region type for rasterization";
+        }
+    }
+
+    //Merge overlapping runs so every pixel is visited once.
+    int left = width;
+    int right = 0;
+    int top = height;
+    int bottom = 0;
+    for ( int row = 0; row < static_cast<int>( rows.size() ); row++ ){
+        std::vector<std::pair<int,int> >& runs = rows[row];
+        if ( runs.empty() ){
+            continue;
+        }
+        std::sort( runs.begin(), runs.end() );
+        Span current = { row, runs[0].first, runs[0].second };
+        for ( size_t i = 1; i < runs.size(); i++ ){
+            if ( runs[i].first <= current.end ){
+                current.end = std::max( current.end, runs[i].second );
+            }
+            else {
+                m_spans.push_back( current );
+                current.start = runs[i].first;
+                current.end = runs[i].second;
+            }
+        }
+        m_spans.push_back( current );
+        top = std::min( top, row );
+        bottom = std::max( bottom, row );
+    }
+    for ( const Span& span : m_spans ){
+        left = std::min( left, span.start );
+        right = std::max( right, span.end - 1 );
+        m_pixelCount += span.end - span.start;
+    }
+    if ( !m_spans.empty() ){
+        m_bounds = QRect( QPoint( left, top ), QPoint( right, bottom ) );
+    }
+}
+
+
+QRect RegionSpans::getBounds() const {
+    return m_bounds;
+}
+
+
+int64_t RegionSpans::getPixelCount() const {
+    return m_pixelCount;
+}
+
+
+const std::vector<RegionSpans::Span>& RegionSpans::getSpans() const {
+    return m_spans;
+}
+
+
+bool RegionSpans::isEmpty() const {
+    return m_spans.empty();
+}
+
+
+void RegionSpans::_rasterizeBox( const std::vector<std::pair<double,double> >& corners,
+        int width, int height, RowCoverage& rows ){
+    double xMin = corners[0].first;
+    double xMax = corners[0].first;
+    double yMin = corners[0].second;
+    double yMax = corners[0].second;
+    for ( const std::pair<double,double>& corner : corners ){
+        xMin = std::min( xMin, corner.first );
+        xMax = std::max( xMax, corner.first );
+        yMin = std::min( yMin, corner.second );
+        yMax = std::max( yMax, corner.second );
+    }
+    //Pixel i covers [i-0.5,i+0.5]; a box too small to contain a pixel center
+    //still covers the pixel it lies in.
+    int colStart = qCeil( xMin );
+    int colEnd = qFloor( xMax );
+    if ( colStart > colEnd ){
+        colStart = colEnd = qRound( ( xMin + xMax ) / 2 );
+    }
+    int rowStart = qCeil( yMin );
+    int rowEnd = qFloor( yMax );
+    if ( rowStart > rowEnd ){
+        rowStart = rowEnd = qRound( ( yMin + yMax ) / 2 );
+    }
+    for ( int row = std::max( rowStart, 0 ); row <= std::min( rowEnd, height - 1 ); row++ ){
+        _addRun( rows, width, row, colStart, colEnd );
+    }
+}
+
+
+void RegionSpans::_rasterizeEllipse( const std::vector<std::pair<double,double> >& corners,
+        int width, int height, RowCoverage& rows ){
+    if ( corners.size() != 2 ){
+        qWarning() << "Invalid corner count for an ellipse: "<<corners.size();
+        return;
+    }
+    double centerX = ( corners[0].first + corners[1].first ) / 2;
+    double centerY = ( corners[0].second + corners[1].second ) / 2;
+    double radiusX = qAbs( corners[1].first - corners[0].first ) / 2;
+    double radiusY = qAbs( corners[1].second - corners[0].second ) / 2;
+    if ( radiusX <= 0 || radiusY <= 0 ){
+        _rasterizeBox( corners, width, height, rows );
+        return;
+    }
+    int rowStart = std::max( qCeil( centerY - radiusY ), 0 );
+    int rowEnd = std::min( qFloor( centerY + radiusY ), height - 1 );
+    for ( int row = rowStart; row <= rowEnd; row++ ){
+        double dy = ( row - centerY ) / radiusY;
+        double halfWidth = radiusX * std::sqrt( std::max( 0.0, 1 - dy * dy ) );
+        _addRun( rows, width, row, qCeil( centerX - halfWidth ), qFloor( centerX + halfWidth ) );
+    }
+}
+
+
+void RegionSpans::_rasterizePolygon( const std::vector<std::pair<double,double> >& corners,
+        int width, int height, RowCoverage& rows ){
+    double yMin = corners[0].second;
+    double yMax = corners[0].second;
+    for ( const std::pair<double,double>& corner : corners ){
+        yMin = std::min( yMin, corner.second );
+        yMax = std::max( yMax, corner.second );
+    }
+    int cornerCount = corners.size();
+    std::vector<double> crossings;
+    int rowStart = std::max( qCeil( yMin ), 0 );
+    int rowEnd = std::min( qFloor( yMax ), height - 1 );
+    for ( int row = rowStart; row <= rowEnd; row++ ){
+        //Even-odd rule along the line through the pixel centers of the row.  An
+        //edge counts when the row is in [lower,upper) so shared vertices are
+        //not counted twice.
+        crossings.clear();
+        for ( int i = 0; i < cornerCount; i++ ){
+            const std::pair<double,double>& p1 = corners[i];
+            const std::pair<double,double>& p2 = corners[( i + 1 ) % cornerCount];
+            if ( ( p1.second <= row && row < p2.second ) || ( p2.second <= row && row < p1.second ) ){
+                double t = ( row - p1.second ) / ( p2.second - p1.second );
+                crossings.push_back( p1.first + t * ( p2.first - p1.first ) );
+            }
+        }
+        std::sort( crossings.begin(), crossings.end() );
+        for ( size_t i = 0; i + 1 < crossings.size(); i += 2 ){
+            _addRun( rows, width, row, qCeil( crossings[i] ), qFloor( crossings[i+1] ) );
+        }
+    }
+}
+
+
+bool RegionSpans::operator==( const RegionSpans& other ) const {
+    return m_spans == other.m_spans;
+}
+
+
+bool RegionSpans::operator!=( const RegionSpans& other ) const {
+    return !( *this == other );
+}
+}
+}
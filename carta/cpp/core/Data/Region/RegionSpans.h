@@ -0,0 +1,120 @@
+/***
+ * The pixels of an image plane covered by one or more regions, stored as runs of
+ * pixels along rows.
+ */
+
+#pragma once
+
+#include "CartaLib/RegionInfo.h"
+#include <QRect>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Carta {
+
+namespace Data {
+
+class RegionSpans {
+
+public:
+
+    /// A run of pixels [start,end) on one row of a plane.
+    struct Span {
+        int row;
+        int start;
+        int end;
+        bool operator==( const Span& other ) const {
+            return row == other.row && start == other.start && end == other.end;
+        }
+    };
+
+    /**
+     * Constructor.  The regions are rasterized once; a pixel belongs to the
+     * result if its center lies inside any of the regions.
+     * @param regions - regions with corners in pixel coordinates of the first two image axes.
+     * @param width - the size of the image along the first axis.
+     * @param height - the size of the image along the second axis.
+     */
+    RegionSpans( const std::vector<Carta::Lib::RegionInfo>& regions, int width, int height );
+
+    /**
+     * Returns the smallest rectangle containing every pixel of the regions.
+     * @return - the bounding box of the regions; an empty rectangle if no pixels are covered.
+     */
+    QRect getBounds() const;
+
+    /**
+     * Returns the number of pixels covered by the regions in one plane.
+     * @return - the pixel count of the regions.
+     */
+    int64_t getPixelCount() const;
+
+    /**
+     * Returns the covered pixels, ordered by row and then by column, with no overlaps.
+     * @return - the runs of covered pixels.
+     */
+    const std::vector<Span>& getSpans() const;
+
+    /**
+     * Returns whether the regions cover no pixels.
+     * @return - true if there are no covered pixels; false otherwise.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Copy the covered pixels out of data read for the bounding box.
+     * @param boxData - pixels of the bounding box, row by row, repeated for every plane
+     *      of the remaining axes.
+     * @param planeCount - the number of bounding box planes in boxData.
+     * @param result - receives the covered pixels.
+     */
+    template <typename T>
+    void gather( const T* boxData, int64_t planeCount, std::vector<T>& result ) const {
+        gather( boxData, m_bounds, planeCount, result );
+    }
+
+    /**
+     * Copy the covered pixels out of data read for a rectangle containing the
+     * bounding box, so that several regions can share one read.
+     * @param boxData - pixels of the rectangle, row by row, repeated for every plane
+     *      of the remaining axes.
+     * @param box - the rectangle that was read; it must contain the bounding box.
+     * @param planeCount - the number of rectangle planes in boxData.
+     * @param result - receives the covered pixels.
+     */
+    template <typename T>
+    void gather( const T* boxData, const QRect& box, int64_t planeCount, std::vector<T>& result ) const {
+        int64_t boxWidth = box.width();
+        int64_t boxSize = boxWidth * box.height();
+        result.resize( m_pixelCount * planeCount );
+        T* dest = result.data();
+        for ( int64_t plane = 0; plane < planeCount; plane++ ){
+            const T* planeData = boxData + plane * boxSize;
+            for ( const Span& span : m_spans ){
+                const T* src = planeData + ( span.row - box.top() ) * boxWidth +
+                        ( span.start - box.left() );
+                dest = std::copy( src, src + ( span.end - span.start ), dest );
+            }
+        }
+    }
+
+    bool operator==( const RegionSpans& other ) const;
+    bool operator!=( const RegionSpans& other ) const;
+
+private:
+
+    //Add the rows covered by one region to the per-row coverage lists.
+    static void _rasterizeBox( const std::vector<std::pair<double,double> >& corners,
+            int width, int height, std::vector<std::vector<std::pair<int,int> > >& rows );
+    static void _rasterizeEllipse( const std::vector<std::pair<double,double> >& corners,
+            int width, int height, std::vector<std::vector<std::pair<int,int> > >& rows );
+    static void _rasterizePolygon( const std::vector<std::pair<double,double> >& corners,
+            int width, int height, std::vector<std::vector<std::pair<int,int> > >& rows );
+
+    std::vector<Span> m_spans;
+    QRect m_bounds;
+    int64_t m_pixelCount;
+};
+}
+}
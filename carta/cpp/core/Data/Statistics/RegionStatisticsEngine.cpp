@@ -0,0 +1,357 @@
+#include "RegionStatisticsEngine.h"
+#include "Data/Region/RegionSpans.h"
+#include "Algorithms/bulkRead.h"
+#include "Algorithms/parallelAlgorithms.h"
+#include "Algorithms/runningStatistics.h"
+#include "CartaLib/IImage.h"
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Carta
+{
+namespace Data
+{
+
+namespace {
+//Fewer pixels than this are not worth handing to another thread.
+const int64_t MIN_PIXELS_PER_THREAD = 16384;
+}
+
+RegionStatisticsEngine::RegionStatisticsEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+        const std::vector<int>& frameIndices,
+        std::shared_ptr<CoordinateFormatterInterface> formatter ):
+    m_image( image ),
+    m_frameIndices( frameIndices ),
+    m_formatter( formatter ),
+    m_axisX( 0 ),
+    m_axisY( 1 ){
+    //Regions are drawn on the direction axes, wherever they are in the image.
+    if ( m_image && m_formatter ){
+        int lonAxis = -1;
+        int latAxis = -1;
+        int axisCount = std::min<int>( m_image->dims().size(), m_formatter->nAxes() );
+        for ( int i = 0; i < axisCount; i++ ){
+            Carta::Lib::AxisInfo::KnownType axisType = m_formatter->axisInfo( i ).knownType();
+            if ( axisType == Carta::Lib::AxisInfo::KnownType::DIRECTION_LON ){
+                lonAxis = i;
+            }
+            else if ( axisType == Carta::Lib::AxisInfo::KnownType::DIRECTION_LAT ){
+                latAxis = i;
+            }
+        }
+        if ( lonAxis >= 0 && latAxis >= 0 ){
+            m_axisX = lonAxis;
+            m_axisY = latAxis;
+        }
+    }
+}
+
+
+std::vector<RegionStatisticsEngine::RegionStatistics> RegionStatisticsEngine::compute(
+        const std::vector<Carta::Lib::RegionInfo>& regions ) const {
+    using namespace Carta::Core::Algorithms;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    int regionCount = regions.size();
+    std::vector<RegionStatistics> results( regionCount );
+    for ( RegionStatistics& stats : results ){
+        stats.count = 0;
+        stats.sum = 0;
+        stats.sumSquares = 0;
+        stats.mean = nan;
+        stats.sigma = nan;
+        stats.rms = nan;
+        stats.min = nan;
+        stats.max = nan;
+        stats.quantiles.assign( m_quantiles.size(), nan );
+    }
+    if ( !isSupported() ){
+        return results;
+    }
+
+    //Rasterize every region and read the plane once for all of them.
+    std::vector<int> dims = m_image->dims();
+    std::vector<std::unique_ptr<RegionSpans> > spans( regionCount );
+    QRect box;
+    for ( int i = 0; i < regionCount; i++ ){
+        spans[i].reset( new RegionSpans( { regions[i] }, dims[m_axisX], dims[m_axisY] ) );
+        if ( !spans[i]->isEmpty() ){
+            box = box.united( spans[i]->getBounds() );
+        }
+    }
+    if ( box.isEmpty() ){
+        return results;
+    }
+    std::vector<float> plane;
+    _readPlane( box.left(), box.top(), box.right(), box.bottom(), plane );
+    int64_t boxWidth = box.width();
+    int64_t imageWidth = dims[m_axisX];
+    if ( static_cast<int64_t>( plane.size() ) != boxWidth * box.height() ){
+        return results;
+    }
+
+    int maxParts = std::max( 1, QThread::idealThreadCount() );
+    for ( int i = 0; i < regionCount; i++ ){
+        const std::vector<RegionSpans::Span>& regionSpans = spans[i]->getSpans();
+        int64_t spanCount = regionSpans.size();
+        if ( spanCount == 0 ){
+            continue;
+        }
+        RegionStatistics& stats = results[i];
+        QRect bounds = spans[i]->getBounds();
+        stats.blc = m_frameIndices;
+        stats.blc[m_axisX] = bounds.left();
+        stats.blc[m_axisY] = bounds.top();
+        stats.trc = m_frameIndices;
+        stats.trc[m_axisX] = bounds.right();
+        stats.trc[m_axisY] = bounds.bottom();
+        stats.blcWorld = _formatWorld( m_formatter.get(), stats.blc );
+        stats.trcWorld = _formatWorld( m_formatter.get(), stats.trc );
+
+        //Each thread accumulates a run of rows; the partial results are merged in order.
+        int64_t pixelCount = spans[i]->getPixelCount();
+        int64_t minSpans = std::max<int64_t>( 1, MIN_PIXELS_PER_THREAD * spanCount / pixelCount );
+        std::vector<RunningStatistics> partials( maxParts );
+        auto accumulate = [&regionSpans, &plane, &partials, &box, boxWidth, imageWidth]
+                           ( int64_t begin, int64_t end, int part ){
+            RunningStatistics& partial = partials[part];
+            for ( int64_t s = begin; s < end; s++ ){
+                const RegionSpans::Span& span = regionSpans[s];
+                const float* src = plane.data() + ( span.row - box.top() ) * boxWidth +
+                        ( span.start - box.left() );
+                int64_t index = int64_t( span.row ) * imageWidth + span.start;
+                for ( int x = span.start; x < span.end; x++ ){
+                    partial.add( *src++, index++ );
+                }
+            }
+        };
+        int partCount = parallelRanges( spanCount, minSpans, accumulate );
+        RunningStatistics total;
+        for ( int part = 0; part < partCount; part++ ){
+            total.merge( partials[part] );
+        }
+        if ( total.count == 0 ){
+            continue;
+        }
+        stats.count = total.count;
+        stats.sum = total.sum;
+        stats.sumSquares = total.sumSquares;
+        stats.mean = total.mean;
+        stats.sigma = total.sigma();
+        stats.rms = total.rms();
+        stats.min = total.min;
+        stats.max = total.max;
+        stats.minPos = m_frameIndices;
+        stats.minPos[m_axisX] = total.minIndex % imageWidth;
+        stats.minPos[m_axisY] = total.minIndex / imageWidth;
+        stats.maxPos = m_frameIndices;
+        stats.maxPos[m_axisX] = total.maxIndex % imageWidth;
+        stats.maxPos[m_axisY] = total.maxIndex / imageWidth;
+        stats.minPosWorld = _formatWorld( m_formatter.get(), stats.minPos );
+        stats.maxPosWorld = _formatWorld( m_formatter.get(), stats.maxPos );
+
+        if ( !m_quantiles.empty() ){
+            std::vector<float> values;
+            spans[i]->gather( plane.data(), box, 1, values );
+            values.erase( std::remove_if( values.begin(), values.end(),
+                    [] ( float value ){ return std::isnan( value ); } ), values.end() );
+            for ( size_t q = 0; q < m_quantiles.size(); q++ ){
+                size_t index = Carta::Lib::clamp<size_t>( values.size() * m_quantiles[q], 0, values.size() - 1 );
+                std::nth_element( values.begin(), values.begin() + index, values.end() );
+                stats.quantiles[q] = values[index];
+            }
+        }
+    }
+    return results;
+}
+
+
+QString RegionStatisticsEngine::_formatWorld( CoordinateFormatterInterface* formatter,
+        const std::vector<int>& pixel ){
+    QString world;
+    if ( formatter ){
+        CoordinateFormatterInterface::VD pixelCoords( pixel.begin(), pixel.end() );
+        world = formatter->formatFromPixelCoordinate( pixelCoords ).join( ", " );
+    }
+    return world;
+}
+
+
+int RegionStatisticsEngine::getAxisX() const {
+    return m_axisX;
+}
+
+
+int RegionStatisticsEngine::getAxisY() const {
+    return m_axisY;
+}
+
+
+QString RegionStatisticsEngine::_getRegionName( const Carta::Lib::RegionInfo& regionInfo ){
+    //Match the names given by the casacore statistics plugin.
+    QString name = "Polygon";
+    int cornerCount = regionInfo.getCorners().size();
+    if ( regionInfo.getRegionType() == Carta::Lib::RegionInfo::RegionType::Ellipse ){
+        name = "Ellipse";
+    }
+    else if ( cornerCount == 4 ){
+        name = "Rectangle";
+    }
+    else if ( cornerCount == 1 ){
+        name = "Point";
+    }
+    return name;
+}
+
+
+bool RegionStatisticsEngine::isSupported() const {
+    if ( !m_image ){
+        return false;
+    }
+    std::vector<int> dims = m_image->dims();
+    int axisCount = dims.size();
+    if ( axisCount < 2 || m_frameIndices.size() != dims.size() ||
+            m_axisX >= axisCount || m_axisY >= axisCount ){
+        return false;
+    }
+    for ( int i = 0; i < axisCount; i++ ){
+        if ( i == m_axisX || i == m_axisY ){
+            continue;
+        }
+        if ( m_frameIndices[i] < 0 || m_frameIndices[i] >= dims[i] ){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void RegionStatisticsEngine::_readPlane( int left, int top, int right, int bottom,
+        std::vector<float>& values ) const {
+    values.clear();
+    SliceND planeSlice;
+    int axisCount = m_frameIndices.size();
+    for ( int i = 0; i < axisCount; i++ ){
+        if ( i == m_axisX ){
+            planeSlice.slice( i ).start( left ).end( right + 1 );
+        }
+        else if ( i == m_axisY ){
+            planeSlice.slice( i ).start( top ).end( bottom + 1 );
+        }
+        else {
+            planeSlice.slice( i ).start( m_frameIndices[i] ).end( m_frameIndices[i] + 1 );
+        }
+    }
+    std::unique_ptr<Carta::Lib::NdArray::RawViewInterface> view( m_image->getDataSlice( planeSlice ) );
+    if ( !view ){
+        return;
+    }
+    values = Carta::Core::Algorithms::readAll<float>( view.get() );
+    //A mask that cannot be read is treated as no mask.
+    std::unique_ptr<Carta::Lib::NdArray::Byte> maskView;
+    if ( m_image->hasMask() ){
+        maskView.reset( m_image->getMaskSlice( planeSlice ) );
+    }
+    if ( maskView ){
+        std::vector<uint8_t> mask = Carta::Core::Algorithms::readAll<uint8_t>( maskView->rawView() );
+        for ( size_t i = 0; i < values.size(); i++ ){
+            if ( !mask[i] ){
+                values[i] = std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+    }
+
+    //The lower axis varies fastest in the data, so a plane whose vertical axis
+    //comes first has to be transposed into rows.
+    if ( m_axisY < m_axisX ){
+        int64_t width = right - left + 1;
+        int64_t height = bottom - top + 1;
+        if ( static_cast<int64_t>( values.size() ) == width * height ){
+            std::vector<float> rows( values.size() );
+            for ( int64_t x = 0; x < width; x++ ){
+                for ( int64_t y = 0; y < height; y++ ){
+                    rows[y * width + x] = values[x * height + y];
+                }
+            }
+            values.swap( rows );
+        }
+    }
+}
+
+
+void RegionStatisticsEngine::setQuantiles( const std::vector<double>& quantiles ){
+    m_quantiles = quantiles;
+}
+
+
+QList<Carta::Lib::StatInfo> RegionStatisticsEngine::toStatInfo( const RegionStatistics& stats,
+        const Carta::Lib::RegionInfo& regionInfo, double beamArea ){
+    typedef Carta::Lib::StatInfo::StatType StatType;
+    QList<Carta::Lib::StatInfo> statList;
+    auto insert = [&statList] ( StatType statType, const QString& value ){
+        Carta::Lib::StatInfo info( statType );
+        info.setValue( value );
+        statList.append( info );
+    };
+    insert( StatType::FrameCount, QString::number( stats.count ) );
+    if ( stats.count > 0 ){
+        insert( StatType::Sum, QString::number( stats.sum ) );
+        insert( StatType::SumSq, QString::number( stats.sumSquares ) );
+        insert( StatType::Min, QString::number( stats.min ) );
+        insert( StatType::Max, QString::number( stats.max ) );
+        insert( StatType::Mean, QString::number( stats.mean ) );
+        insert( StatType::Sigma, QString::number( stats.sigma ) );
+        insert( StatType::RMS, QString::number( stats.rms ) );
+        if ( beamArea > 0 ){
+            insert( StatType::FluxDensity, QString::number( stats.sum / beamArea ) );
+        }
+        insert( StatType::MinPos, _vectorToString( stats.minPos ) );
+        insert( StatType::MaxPos, _vectorToString( stats.maxPos ) );
+        if ( !stats.minPosWorld.isEmpty() ){
+            insert( StatType::MinPosf, stats.minPosWorld );
+            insert( StatType::MaxPosf, stats.maxPosWorld );
+        }
+    }
+    if ( !stats.blc.empty() ){
+        QString blcVal = _vectorToString( stats.blc );
+        QString trcVal = _vectorToString( stats.trc );
+        insert( StatType::Blc, blcVal );
+        insert( StatType::Trc, trcVal );
+        if ( !stats.blcWorld.isEmpty() ){
+            insert( StatType::Blcf, stats.blcWorld );
+            insert( StatType::Trcf, stats.trcWorld );
+        }
+
+        //Put in an identifier.
+        QString idVal = _getRegionName( regionInfo ) + ":" + blcVal;
+        if ( blcVal != trcVal ){
+            idVal = idVal + " x " + trcVal;
+        }
+        Carta::Lib::StatInfo info( StatType::Name );
+        info.setValue( idVal );
+        info.setImageStat( false );
+        statList.append( info );
+    }
+    return statList;
+}
+
+
+QString RegionStatisticsEngine::_vectorToString( const std::vector<int>& values ){
+    int elementCount = values.size();
+    QString val("[");
+    for ( int i = 0; i < elementCount; i++ ){
+        val = val + QString::number( values[i] );
+        if ( i < elementCount - 1 ){
+            val = val + ", ";
+        }
+    }
+    val = val + "]";
+    return val;
+}
+
+
+RegionStatisticsEngine::~RegionStatisticsEngine(){
+}
+}
+}
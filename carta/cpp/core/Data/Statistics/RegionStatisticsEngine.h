@@ -0,0 +1,143 @@
+/**
+ * Computes statistics of image regions in the current plane inside the viewer process.
+ **/
+
+#pragma once
+
+#include "CartaLib/RegionInfo.h"
+#include "CartaLib/StatInfo.h"
+#include "CartaLib/ICoordinateFormatter.h"
+#include <QList>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class RegionStatisticsEngine {
+
+public:
+
+    /// Summary of the valid pixels of a region.
+    struct RegionStatistics {
+        int64_t count;
+        double sum;
+        double sumSquares;
+        double mean;
+        double sigma;
+        double rms;
+        double min;
+        double max;
+        //Pixel index along every image axis; empty if the region has no valid pixels.
+        std::vector<int> minPos;
+        std::vector<int> maxPos;
+        //Corners of the bounding box of the region, along every image axis.
+        std::vector<int> blc;
+        std::vector<int> trc;
+        //The corners and the positions of the extremes in world coordinates; empty
+        //if the image has no coordinate system.
+        QString blcWorld;
+        QString trcWorld;
+        QString minPosWorld;
+        QString maxPosWorld;
+        //Requested quantiles, in the order they were set.
+        std::vector<double> quantiles;
+    };
+
+    /**
+     * Constructor.
+     * @param image - the image containing the regions.
+     * @param frameIndices - the index of the current plane along every image axis.
+     * @param formatter - a copy of the image's coordinate formatter, used to find the
+     *      plane axes and to report world positions, or null if the image has no
+     *      coordinate system.  The formatter is not thread safe, so the copy should
+     *      be made on the thread that owns the image and not shared with other engines.
+     */
+    RegionStatisticsEngine( std::shared_ptr<Carta::Lib::Image::ImageInterface> image,
+            const std::vector<int>& frameIndices,
+            std::shared_ptr<CoordinateFormatterInterface> formatter );
+
+    /**
+     * Compute the statistics of regions in the current plane.  The plane is read
+     * once over a rectangle containing all of the regions, and the pixels of each
+     * region are divided between the threads of the global thread pool.  NaN and
+     * masked pixels are ignored.
+     * @param regions - regions with corners in pixel coordinates of the plane axes.
+     * @return - the statistics of each region.
+     */
+    std::vector<RegionStatistics> compute( const std::vector<Carta::Lib::RegionInfo>& regions ) const;
+
+    /**
+     * Returns whether statistics of the current plane can be computed by the engine.
+     * @return - true if the plane axes and the frame indices are inside the image;
+     *      false otherwise.
+     */
+    bool isSupported() const;
+
+    /**
+     * Returns the image axis shown horizontally.
+     * @return - the longitude axis of an image with direction axes, otherwise the first axis.
+     */
+    int getAxisX() const;
+
+    /**
+     * Returns the image axis shown vertically.
+     * @return - the latitude axis of an image with direction axes, otherwise the second axis.
+     */
+    int getAxisY() const;
+
+    /**
+     * Set exact quantiles to compute along with the other statistics.  Quantiles
+     * need a copy of the pixels of each region, so none are computed by default.
+     * @param quantiles - fractions between 0 and 1, for example 0.5 for the median.
+     */
+    void setQuantiles( const std::vector<double>& quantiles );
+
+    /**
+     * Convert statistics to the form reported by the statistics plugins.
+     * @param stats - the statistics of a region.
+     * @param regionInfo - the region.
+     * @param beamArea - the area of the restoring beam in pixels, or 0 if the flux
+     *      density is not known.
+     * @return - a labelled value for each statistic.
+     */
+    static QList<Carta::Lib::StatInfo> toStatInfo( const RegionStatistics& stats,
+            const Carta::Lib::RegionInfo& regionInfo, double beamArea );
+
+    /**
+     * Destructor.
+     */
+    ~RegionStatisticsEngine();
+
+private:
+
+    //Format a pixel position in world coordinates.
+    static QString _formatWorld( CoordinateFormatterInterface* formatter,
+            const std::vector<int>& pixel );
+
+    //Read the current plane inside [left,right]x[top,bottom], row by row, with masked
+    //pixels replaced by NaN.
+    void _readPlane( int left, int top, int right, int bottom, std::vector<float>& values ) const;
+
+    static QString _getRegionName( const Carta::Lib::RegionInfo& regionInfo );
+    static QString _vectorToString( const std::vector<int>& values );
+
+    std::shared_ptr<Carta::Lib::Image::ImageInterface> m_image;
+    std::vector<int> m_frameIndices;
+    std::shared_ptr<CoordinateFormatterInterface> m_formatter;
+    int m_axisX;
+    int m_axisY;
+    std::vector<double> m_quantiles;
+};
+}
+}
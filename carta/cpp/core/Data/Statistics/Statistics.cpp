@@ -1,4 +1,5 @@
 #include "Statistics.h"
+#include "StatisticsRenderService.h"
 #include "Data/Settings.h"
 #include "Data/LinkableImpl.h"
 #include "Data/Image/Controller.h"
@@ -6,7 +7,6 @@
 #include "Data/Error/ErrorManager.h"
 #include "Data/Util.h"
 
-#include "CartaLib/Hooks/ImageStatisticsHook.h"
 #include "CartaLib/RegionInfo.h"
 
 #include "State/UtilState.h"
@@ -48,6 +48,7 @@ using Carta::State::StateInterface;
 Statistics::Statistics( const QString& path, const QString& id):
             CartaObject( CLASS_NAME, path, id ),
             m_linkImpl( new LinkableImpl( path )),
+            m_renderService( new StatisticsRenderService() ),
             //Store region and image selection
             m_stateData( UtilState::getLookup(path, StateInterface::STATE_DATA )){
 
@@ -57,6 +58,12 @@ Statistics::Statistics( const QString& path, const QString& id):
 
     _initializeDefaultState();
     _initializeCallbacks();
+
+    connect( m_renderService.get(),
+            SIGNAL(statisticsResult(const Carta::Lib::Hooks::ImageStatisticsHook::ResultType&)),
+            this, SLOT(_statisticsRendered(const Carta::Lib::Hooks::ImageStatisticsHook::ResultType&)));
+    connect( m_renderService.get(), SIGNAL(statisticsError(const QString&)),
+            this, SLOT(_statisticsError(const QString&)));
 }
 
 
@@ -354,6 +361,7 @@ QString Statistics::removeLink( CartaObject* cartaObject){
         removed = m_linkImpl->removeLink( controller );
         if ( removed ){
             controller->disconnect(this);
+            m_renderService->cancel();
             m_controllerLinked = false;
             m_stateData.resizeArray( STATS, 0 );
         }
@@ -428,6 +436,37 @@ QString Statistics::setStatVisible( bool showStat, const QString& statName,
 }
 
 
+void Statistics::_statisticsError( const QString& error ){
+    ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
+    hr->registerError( error );
+}
+
+
+void Statistics::_statisticsRendered( const Carta::Lib::Hooks::ImageStatisticsHook::ResultType& data ){
+    //An array for each image
+    int dataCount = data.size();
+    m_stateData.resizeArray( STATS, dataCount );
+    for ( int i = 0; i < dataCount; i++ ){
+        //Each element of the image array contains an array of statistics.
+        QString arrayLookup = UtilState::getLookup( STATS, i );
+        int statCount = data[i].size();
+        m_stateData.setArray( arrayLookup, statCount );
+
+        //Go through each set of statistics for the image.
+        for ( int k = 0; k < statCount; k++ ){
+            QString objLookup = UtilState::getLookup( arrayLookup, k );
+            int keyCount = data[i][k].size();
+            for ( int j = 0; j < keyCount; j++ ){
+                QString label = data[i][k][j].getLabel();
+                QString lookup = UtilState::getLookup( objLookup, label );
+                m_stateData.insertValue<QString>( lookup, data[i][k][j].getValue() );
+            }
+        }
+    }
+    m_stateData.flushState();
+}
+
+
 void Statistics::_updateStatistics( Controller* controller, Carta::Lib::AxisInfo::KnownType /*type*/  ){
     if ( controller != nullptr ){
 
@@ -437,51 +476,18 @@ void Statistics::_updateStatistics( Controller* controller, Carta::Lib::AxisInfo
         std::vector< std::shared_ptr<Carta::Lib::Image::ImageInterface> > dataSources =
                 controller->getImages();
 
-
-
         std::vector<Carta::Lib::RegionInfo> regions = controller->getRegions();
 
         std::vector<int> frameIndices = controller->getImageSlice();
 
         int sourceCount = dataSources.size();
         if ( sourceCount > 0 ){
-            auto result = Globals::instance()-> pluginManager()
-                         -> prepare <Carta::Lib::Hooks::ImageStatisticsHook>(dataSources, regions, frameIndices);
-            auto lam = [=] ( const Carta::Lib::Hooks::ImageStatisticsHook::ResultType &data ) {
-
-                //An array for each image
-                int dataCount = data.size();
-                m_stateData.resizeArray( STATS, dataCount );
-                for ( int i = 0; i < dataCount; i++ ){
-                    //Each element of the image array contains an array of statistics.
-                    QString arrayLookup = UtilState::getLookup( STATS, i );
-                    int statCount = data[i].size();
-                    m_stateData.setArray( arrayLookup, statCount );
-
-                    //Go through each set of statistics for the image.
-                    for ( int k = 0; k < statCount; k++ ){
-                        QString objLookup = UtilState::getLookup( arrayLookup, k );
-                        QList<QString> existingKeys = m_stateData.getMemberNames( objLookup );
-                        int keyCount = data[i][k].size();
-                        for ( int j = 0; j < keyCount; j++ ){
-                            QString label = data[i][k][j].getLabel();
-                            QString lookup = UtilState::getLookup( objLookup, label );
-                            m_stateData.insertValue<QString>( lookup, data[i][k][j].getValue() );
-                        }
-                    }
-                }
-            };
-            try {
-                result.forEach( lam );
-            }
-            catch( char*& error ){
-                QString errorStr( error );
-                ErrorManager* hr = Util::findSingletonObject<ErrorManager>();
-                hr->registerError( errorStr );
-            }
+            //Statistics of large cubes take a while; the state is updated when they arrive.
+            m_renderService->renderStatistics( dataSources, regions, frameIndices );
         }
         //No statistics
         else {
+            m_renderService->cancel();
             m_stateData.resizeArray( STATS, 0 );
         }
         m_stateData.flushState();
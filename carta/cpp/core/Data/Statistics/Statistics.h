@@ -9,6 +9,7 @@
 #include "State/StateInterface.h"
 #include "Data/ILinkable.h"
 #include "CartaLib/AxisInfo.h"
+#include "CartaLib/Hooks/ImageStatisticsHook.h"
 
 #include <QObject>
 
@@ -21,6 +22,7 @@ namespace Data {
 class Controller;
 class LinkableImpl;
 class Settings;
+class StatisticsRenderService;
 
 class Statistics : public QObject, public Carta::State::CartaObject, public ILinkable {
 
@@ -87,8 +89,11 @@ public:
 
 
 private slots:
+    void _statisticsError( const QString& error );
+    void _statisticsRendered( const Carta::Lib::Hooks::ImageStatisticsHook::ResultType& stats );
+
     /**
-     * Recompute the statistics.
+     * Recompute the statistics in the background.
      * @param controller - the controller to use for statistics generation.
      */
     void _updateStatistics( Controller* controller, Carta::Lib::AxisInfo::KnownType type = Carta::Lib::AxisInfo::KnownType::SPECTRAL );
@@ -129,6 +134,9 @@ private:
     //Preference settings
     std::unique_ptr<Settings> m_settings;
 
+    //Compute the statistics in a thread
+    std::unique_ptr<StatisticsRenderService> m_renderService;
+
 
     Carta::State::StateInterface m_stateData;
 
@@ -0,0 +1,153 @@
+#include "StatisticsRenderService.h"
+#include "Globals.h"
+#include "PluginManager.h"
+#include "CartaLib/IImage.h"
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace Carta {
+namespace Data {
+
+const int StatisticsRenderService::DEBOUNCE_INTERVAL = 100;
+
+StatisticsRenderService::StatisticsRenderService( QObject * parent ) :
+        QObject( parent ){
+    m_debounceTimer.setSingleShot( true );
+    m_debounceTimer.setInterval( DEBOUNCE_INTERVAL );
+    connect( &m_debounceTimer, SIGNAL(timeout()), this, SLOT(_startJob()));
+    connect( &m_watcher, SIGNAL(finished()), this, SLOT(_jobFinished()));
+}
+
+
+void StatisticsRenderService::cancel(){
+    m_debounceTimer.stop();
+    m_waitingJob.reset();
+    if ( m_runningJob ){
+        m_runningJob->m_cancelled->store( true );
+    }
+}
+
+
+std::shared_ptr<StatisticsRenderService::RenderJob> StatisticsRenderService::_compute(
+        std::shared_ptr<RenderJob> job ){
+    int imageCount = job->m_images.size();
+    for ( int i = 0; i < imageCount; i++ ){
+        if ( job->m_cancelled->load() ){
+            break;
+        }
+        //Region statistics are computed natively when possible, so the plugin is only
+        //asked for the image statistics.
+        const RegionStatisticsEngine& engine = *job->m_engines[i];
+        bool native = engine.isSupported();
+        std::vector<Carta::Lib::RegionInfo> pluginRegions;
+        if ( !native ){
+            pluginRegions = job->m_regions;
+        }
+        std::vector< std::shared_ptr<Carta::Lib::Image::ImageInterface> > images( 1, job->m_images[i] );
+        auto result = Globals::instance()-> pluginManager()
+                -> prepare <Carta::Lib::Hooks::ImageStatisticsHook>( images, pluginRegions, job->m_frameIndices );
+        Carta::Lib::Hooks::ImageStatisticsHook::ResultType imageResult;
+        auto lam = [&imageResult] ( const Carta::Lib::Hooks::ImageStatisticsHook::ResultType &data ) {
+            imageResult = data;
+        };
+        try {
+            result.forEach( lam );
+        }
+        catch( char*& error ){
+            job->m_error = QString( error );
+            break;
+        }
+        if ( native ){
+            //Without the plugin the image statistics are left empty.
+            if ( imageResult.isEmpty() ){
+                imageResult.append( QList< QList<Carta::Lib::StatInfo> >() );
+            }
+            if ( imageResult[0].isEmpty() ){
+                imageResult[0].append( QList<Carta::Lib::StatInfo>() );
+            }
+            //The flux density needs the beam area, which comes with the image statistics.
+            double beamArea = 0;
+            for ( const Carta::Lib::StatInfo& info : imageResult[0][0] ){
+                if ( info.getType() == Carta::Lib::StatInfo::StatType::BeamArea ){
+                    beamArea = info.getValue().toDouble();
+                }
+            }
+            std::vector<RegionStatisticsEngine::RegionStatistics> regionStats =
+                    engine.compute( job->m_regions );
+            for ( size_t j = 0; j < regionStats.size(); j++ ){
+                imageResult[0].append( RegionStatisticsEngine::toStatInfo(
+                        regionStats[j], job->m_regions[j], beamArea ) );
+            }
+        }
+        job->m_result.append( imageResult );
+    }
+    return job;
+}
+
+
+void StatisticsRenderService::_jobFinished(){
+    std::shared_ptr<RenderJob> job = m_runningJob;
+    m_runningJob.reset();
+    //A request that arrived while this job was running is started straight away,
+    //since it has already waited.
+    if ( m_waitingJob && !m_debounceTimer.isActive() ){
+        _startJob();
+    }
+    if ( job && !job->m_cancelled->load() ){
+        if ( job->m_error.isEmpty() ){
+            emit statisticsResult( job->m_result );
+        }
+        else {
+            emit statisticsError( job->m_error );
+        }
+    }
+}
+
+
+void StatisticsRenderService::renderStatistics(
+        const std::vector< std::shared_ptr<Carta::Lib::Image::ImageInterface> >& images,
+        const std::vector<Carta::Lib::RegionInfo>& regions, const std::vector<int>& frameIndices ){
+    std::shared_ptr<RenderJob> job( new RenderJob() );
+    job->m_images = images;
+    job->m_regions = regions;
+    job->m_frameIndices = frameIndices;
+    for ( std::shared_ptr<Carta::Lib::Image::ImageInterface> image : images ){
+        //The formatter shares state with the image, so the computation gets its own
+        //copy, taken here rather than on the thread pool.
+        std::shared_ptr<CoordinateFormatterInterface> formatter;
+        if ( image && image->metaData() && image->metaData()->coordinateFormatter() ){
+            formatter.reset( image->metaData()->coordinateFormatter()->clone() );
+        }
+        job->m_engines.push_back( std::make_shared<RegionStatisticsEngine>(
+                image, frameIndices, formatter ) );
+    }
+    job->m_cancelled.reset( new std::atomic<bool>( false ) );
+    m_waitingJob = job;
+    //The running job is out of date.
+    if ( m_runningJob ){
+        m_runningJob->m_cancelled->store( true );
+    }
+    m_debounceTimer.start();
+}
+
+
+void StatisticsRenderService::_startJob(){
+    //Only one job runs at a time; the waiting one starts when it finishes.
+    if ( !m_waitingJob || m_runningJob ){
+        return;
+    }
+    m_runningJob = m_waitingJob;
+    m_waitingJob.reset();
+    std::shared_ptr<RenderJob> job = m_runningJob;
+    m_watcher.setFuture( QtConcurrent::run( [job](){
+        return _compute( job );
+    }));
+}
+
+
+StatisticsRenderService::~StatisticsRenderService(){
+    cancel();
+    m_watcher.disconnect( this );
+    m_watcher.waitForFinished();
+}
+}
+}
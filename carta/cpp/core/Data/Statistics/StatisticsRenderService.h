@@ -0,0 +1,113 @@
+/**
+ * Computes image and region statistics off the main thread.
+ **/
+
+#pragma once
+
+#include "RegionStatisticsEngine.h"
+#include "CartaLib/Hooks/ImageStatisticsHook.h"
+#include "CartaLib/RegionInfo.h"
+#include <QObject>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Carta {
+namespace Lib {
+
+namespace Image {
+class ImageInterface;
+}
+}
+}
+
+namespace Carta{
+namespace Data{
+
+class StatisticsRenderService : public QObject {
+    Q_OBJECT
+
+public:
+
+    /**
+     * Constructor.
+     */
+    explicit StatisticsRenderService( QObject * parent = 0 );
+
+    /**
+     * Cancel the statistics that are waiting or being computed; no result will be
+     * delivered for them.
+     */
+    void cancel();
+
+    /**
+     * Ask for the statistics of images and their regions.  The computation starts once
+     * requests stop arriving for a short time, and a new request replaces any earlier
+     * one that has not been delivered yet.
+     * @param images - the images whose statistics should be computed.
+     * @param regions - the regions whose statistics should be computed in each image.
+     * @param frameIndices - the current frame along each image axis.
+     */
+    void renderStatistics( const std::vector< std::shared_ptr<Carta::Lib::Image::ImageInterface> >& images,
+            const std::vector<Carta::Lib::RegionInfo>& regions, const std::vector<int>& frameIndices );
+
+    /**
+     * Destructor.
+     */
+    ~StatisticsRenderService();
+
+    //Time, in milliseconds, that requests must stop arriving before statistics are computed.
+    static const int DEBOUNCE_INTERVAL;
+
+signals:
+
+    /**
+     * Notification that the statistics of the latest request have been computed.
+     * @param stats - the statistics of each image followed by those of its regions.
+     */
+    void statisticsResult( const Carta::Lib::Hooks::ImageStatisticsHook::ResultType& stats );
+
+    /**
+     * Notification that the statistics of the latest request could not be computed.
+     * @param error - a description of the problem.
+     */
+    void statisticsError( const QString& error );
+
+private slots:
+
+    void _jobFinished();
+    void _startJob();
+
+private:
+
+    struct RenderJob {
+        std::vector< std::shared_ptr<Carta::Lib::Image::ImageInterface> > m_images;
+        std::vector<Carta::Lib::RegionInfo> m_regions;
+        std::vector<int> m_frameIndices;
+        //One engine per image, made on the main thread because it needs the
+        //image's coordinate formatter.
+        std::vector< std::shared_ptr<RegionStatisticsEngine> > m_engines;
+        //Set when a newer request supersedes this one.
+        std::shared_ptr<std::atomic<bool> > m_cancelled;
+        Carta::Lib::Hooks::ImageStatisticsHook::ResultType m_result;
+        QString m_error;
+    };
+
+    //Runs on the thread pool.  Images are computed one at a time so that a
+    //superseded job stops between them.
+    static std::shared_ptr<RenderJob> _compute( std::shared_ptr<RenderJob> job );
+
+    //The latest request, if it has not been started yet.
+    std::shared_ptr<RenderJob> m_waitingJob;
+    //The job being computed, if any.
+    std::shared_ptr<RenderJob> m_runningJob;
+    QTimer m_debounceTimer;
+    QFutureWatcher<std::shared_ptr<RenderJob> > m_watcher;
+
+    StatisticsRenderService( const StatisticsRenderService& other);
+    StatisticsRenderService& operator=( const StatisticsRenderService& other );
+};
+}
+}
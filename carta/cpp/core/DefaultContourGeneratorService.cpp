@@ -4,18 +4,44 @@
 
 #include "DefaultContourGeneratorService.h"
 #include "CartaLib/Algorithms/ContourConrec.h"
+#include "CartaLib/Algorithms/SimplifyPolyline.h"
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
 namespace Carta
 {
 namespace Core
 {
+namespace
+{
+/// how far, in screen pixels, a simplified contour may stray from the original
+const double SIMPLIFY_TOLERANCE = 0.25;
+
+/// most vertices kept in the cache
+const int CACHE_VERTICES = 10 * 1000 * 1000;
+
+/// most vertices prefetched for one request, leaving the rest of the cache for
+/// the planes that were actually drawn
+const int PREFETCH_VERTICES = CACHE_VERTICES / 2;
+
+int
+vertexCount( const std::vector < QPolygonF > & polylines )
+{
+    int count = 0;
+    for ( const QPolygonF & poly : polylines ) {
+        count += poly.size();
+    }
+    return count;
+}
+}
+
 DefaultContourGeneratorService::DefaultContourGeneratorService( QObject * parent )
     : Lib::IContourGeneratorService( parent )
 {
-    m_timer.setInterval( 1 );
-    m_timer.setSingleShot( true );
-    connect( & m_timer, & QTimer::timeout, this, & Me::timerCB );
+    m_cache.setMaxCost( CACHE_VERTICES );
 }
 
 void
@@ -30,6 +56,91 @@ DefaultContourGeneratorService::setInput( Carta::Lib::NdArray::RawViewInterface:
     m_rawView = rawView;
 }
 
+void
+DefaultContourGeneratorService::setInputId( const QString & inputId )
+{
+    m_inputId = inputId;
+}
+
+void
+DefaultContourGeneratorService::setZoom( double zoom )
+{
+    if ( zoom > 0 && std::isfinite( zoom ) ) {
+        m_zoom = zoom;
+    }
+}
+
+QString
+DefaultContourGeneratorService::_cacheKey( const QString & inputId, int sampling, double level )
+{
+    return inputId + "//s" + QString::number( sampling ) + "//l" + QString::number( level, 'g', 17 );
+}
+
+void
+DefaultContourGeneratorService::prefetch( const QStringList & inputIds,
+                                          std::function < Carta::Lib::NdArray::RawViewInterface::SharedPtr ( int ) > makeInput )
+{
+    m_prefetchIds = inputIds;
+    m_prefetchInput = makeInput;
+    m_prefetchNext = 0;
+    m_prefetchVertices = 0;
+    if ( ! m_prefetchJob ) {
+        _prefetchNext();
+    }
+}
+
+int
+DefaultContourGeneratorService::_sampling() const
+{
+    // when zoomed out, contour blocks of pixels no larger than a screen pixel;
+    // zooming back in asks for the finer contours on the next render
+    int sampling = 1;
+    while ( sampling * 2 * m_zoom <= 1 ) {
+        sampling *= 2;
+    }
+    return sampling;
+}
+
+std::shared_ptr < DefaultContourGeneratorService::Job >
+DefaultContourGeneratorService::_makeJob( const QString & inputId,
+                                          Carta::Lib::NdArray::RawViewInterface::SharedPtr rawView )
+{
+    int sampling = _sampling();
+    std::shared_ptr < Job > job( new Job() );
+    job-> rawView = rawView;
+    job-> inputId = inputId;
+    job-> sampling = sampling;
+    job-> tolerance = SIMPLIFY_TOLERANCE / m_zoom;
+    job-> levels = m_levels;
+    job-> cancelled.reset( new std::atomic < bool > ( false ) );
+
+    // only levels that are not cached for this plane are computed
+    int levelCount = m_levels.size();
+    job-> polylines.resize( levelCount );
+    job-> computed.resize( levelCount, true );
+    if ( ! inputId.isEmpty() ) {
+        for ( int i = 0 ; i < levelCount ; ++i ) {
+            std::vector < QPolygonF > * cached = m_cache.object( _cacheKey( inputId, sampling, m_levels[i] ) );
+            if ( cached ) {
+                job-> polylines[i] = * cached;
+                job-> computed[i] = false;
+            }
+        }
+    }
+    return job;
+} // _makeJob
+
+void
+DefaultContourGeneratorService::_runJob( std::shared_ptr < Job > job, const char * finishedSlot )
+{
+    QFutureWatcher < std::shared_ptr < Job > > * watcher =
+        new QFutureWatcher < std::shared_ptr < Job > > ( this );
+    connect( watcher, SIGNAL( finished() ), this, finishedSlot );
+    watcher-> setFuture( QtConcurrent::run( [job] () {
+        return _compute( job );
+    }));
+}
+
 Lib::IContourGeneratorService::JobId
 DefaultContourGeneratorService::start( Lib::IContourGeneratorService::JobId jobId )
 {
@@ -40,27 +151,173 @@ DefaultContourGeneratorService::start( Lib::IContourGeneratorService::JobId jobI
         m_lastJobId = jobId;
     }
 
-    m_timer.start();
+    // the previous job has been superseded
+    if ( m_currentJob ) {
+        m_currentJob-> cancelled-> store( true );
+    }
+
+    std::shared_ptr < Job > job = _makeJob( m_inputId, m_rawView );
+    job-> jobId = m_lastJobId;
+    m_currentJob = job;
+
+    // the plane is wanted now, so a background job on it would only compete
+    if ( m_prefetchJob && m_prefetchJob-> inputId == m_inputId ) {
+        m_prefetchJob-> cancelled-> store( true );
+    }
 
+    // the result is always delivered asynchronously, after the caller has the job id
+    _runJob( job, SLOT( _jobFinished() ) );
     return m_lastJobId;
 }
 
-void
-DefaultContourGeneratorService::timerCB()
+std::shared_ptr < DefaultContourGeneratorService::Job >
+DefaultContourGeneratorService::_compute( std::shared_ptr < Job > job )
 {
+    std::vector < double > levels;
+    for ( size_t i = 0 ; i < job-> levels.size() ; ++i ) {
+        if ( job-> computed[i] ) {
+            levels.push_back( job-> levels[i] );
+        }
+    }
+
     // run the contour algorithm
-    Carta::Lib::Algorithms::ContourConrec cc;
-    cc.setLevels( m_levels);
-    auto rawContours = cc.compute( m_rawView.get() );
+    if ( ! levels.empty() && job-> rawView ) {
+        Carta::Lib::Algorithms::ContourConrec cc;
+        cc.setLevels( levels );
+        cc.setSampling( job-> sampling );
+        cc.setParallel( ! job-> background );
+        std::shared_ptr < std::atomic < bool > > cancelled = job-> cancelled;
+        cc.setMonitor( [cancelled] () {
+            return cancelled-> load();
+        });
+        auto rawContours = cc.compute( job-> rawView.get() );
+        if ( job-> cancelled-> load() ) {
+            return job;
+        }
+        int computedIndex = 0;
+        for ( size_t i = 0 ; i < job-> levels.size() ; ++i ) {
+            if ( job-> computed[i] ) {
+                job-> polylines[i].swap( rawContours[computedIndex] );
+                computedIndex++;
+            }
+        }
+    }
+
+    if ( job-> background ) {
+        return job;
+    }
+
+    // build the result, dropping vertices that would not show on screen
+    for ( size_t i = 0 ; i < job-> levels.size() ; ++i ) {
+        std::vector < QPolygonF > simplified;
+        simplified.reserve( job-> polylines[i].size() );
+        for ( const QPolygonF & poly : job-> polylines[i] ) {
+            simplified.push_back( Carta::Lib::Algorithms::simplifyPolyline( poly, job-> tolerance ) );
+        }
+        Carta::Lib::Contour contour( job-> levels[i], simplified );
+        job-> result.add( contour );
+    }
+    return job;
+} // _compute
+
+void
+DefaultContourGeneratorService::_cacheJob( std::shared_ptr < Job > job )
+{
+    if ( job-> inputId.isEmpty() || ! job-> rawView ) {
+        return;
+    }
+    for ( size_t i = 0 ; i < job-> levels.size() ; ++i ) {
+        if ( job-> computed[i] ) {
+            m_cache.insert( _cacheKey( job-> inputId, job-> sampling, job-> levels[i] ),
+                            new std::vector < QPolygonF > ( job-> polylines[i] ),
+                            std::max( vertexCount( job-> polylines[i] ), 1 ) );
+        }
+    }
+}
+
+void
+DefaultContourGeneratorService::_jobFinished()
+{
+    QFutureWatcher < std::shared_ptr < Job > > * watcher =
+        static_cast < QFutureWatcher < std::shared_ptr < Job > > * > ( sender() );
+    std::shared_ptr < Job > job = watcher-> result();
+    watcher-> deleteLater();
+    if ( job == m_currentJob ) {
+        m_currentJob.reset();
+    }
+
+    // a superseded job may have stopped part way, so none of it is kept
+    if ( job-> cancelled-> load() ) {
+        return;
+    }
+    _cacheJob( job );
+    emit done( job-> result, job-> jobId );
+}
+
+void
+DefaultContourGeneratorService::_prefetchNext()
+{
+    while ( m_prefetchNext < m_prefetchIds.size() ) {
+        if ( m_prefetchVertices >= PREFETCH_VERTICES ) {
+            m_prefetchIds.clear();
+            break;
+        }
+        int index = m_prefetchNext;
+        m_prefetchNext++;
+        QString inputId = m_prefetchIds[index];
+        if ( inputId == m_inputId ) {
+            continue;
+        }
+        int sampling = _sampling();
+        bool complete = true;
+        for ( double level : m_levels ) {
+            std::vector < QPolygonF > * cached = m_cache.object( _cacheKey( inputId, sampling, level ) );
+            if ( cached ) {
+                m_prefetchVertices += vertexCount( * cached );
+            }
+            else {
+                complete = false;
+            }
+        }
+        if ( complete ) {
+            continue;
+        }
+        std::shared_ptr < Job > job = _makeJob( inputId, nullptr );
+        job-> rawView = m_prefetchInput( index );
+        job-> background = true;
+        m_prefetchJob = job;
+        _runJob( job, SLOT( _prefetchFinished() ) );
+        break;
+    }
+} // _prefetchNext
 
-    // build the result
-    Result result;
-    for( size_t i = 0 ; i < m_levels.size() ; ++ i) {
-        Carta::Lib::Contour contour( m_levels[i], rawContours[i]);
-        result.add( contour);
+void
+DefaultContourGeneratorService::_prefetchFinished()
+{
+    QFutureWatcher < std::shared_ptr < Job > > * watcher =
+        static_cast < QFutureWatcher < std::shared_ptr < Job > > * > ( sender() );
+    std::shared_ptr < Job > job = watcher-> result();
+    watcher-> deleteLater();
+    m_prefetchJob.reset();
+    if ( ! job-> cancelled-> load() ) {
+        _cacheJob( job );
+        for ( size_t i = 0 ; i < job-> levels.size() ; ++i ) {
+            if ( job-> computed[i] ) {
+                m_prefetchVertices += vertexCount( job-> polylines[i] );
+            }
+        }
     }
+    _prefetchNext();
+}
 
-    emit done( result, m_lastJobId );
+DefaultContourGeneratorService::~DefaultContourGeneratorService()
+{
+    if ( m_currentJob ) {
+        m_currentJob-> cancelled-> store( true );
+    }
+    if ( m_prefetchJob ) {
+        m_prefetchJob-> cancelled-> store( true );
+    }
 }
 }
 }
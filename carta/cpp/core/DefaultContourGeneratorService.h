@@ -5,14 +5,23 @@
 #pragma once
 #include "CartaLib/IContourGeneratorService.h"
 
+#include <QCache>
 #include <QObject>
-#include <QTimer>
+#include <atomic>
+#include <memory>
 
 namespace Carta
 {
 namespace Core
 {
 /// Default implementation of IC
+///
+/// Contours are computed on the global thread pool. Polylines are cached per input,
+/// level of detail and contour level, so only levels that have not been seen before
+/// for the current plane are computed. Starting a new job cancels the previous one.
+///
+/// Prefetched inputs are contoured one at a time on a single thread, until their
+/// contours take up half of the cache.
 class DefaultContourGeneratorService : public Lib::IContourGeneratorService
 {
     Q_OBJECT
@@ -29,22 +38,109 @@ public:
     virtual void
     setInput( Carta::Lib::NdArray::RawViewInterface::SharedPtr rawView ) override;
 
+    /// contours for the same input id, level of detail and level are reused; an
+    /// empty id turns off reuse
+    virtual void
+    setInputId( const QString & inputId ) override;
+
+    /// below a zoom of one, contours are generated on a plane reduced by averaging,
+    /// and all contours are simplified to within a fraction of a screen pixel
+    virtual void
+    setZoom( double zoom ) override;
+
+    virtual void
+    prefetch( const QStringList & inputIds,
+              std::function < Carta::Lib::NdArray::RawViewInterface::SharedPtr ( int ) > makeInput ) override;
+
     virtual JobId
     start( JobId jobId ) override;
 
+    virtual
+    ~DefaultContourGeneratorService();
+
 signals:
 
 private slots:
 
-    void timerCB();
+    void _jobFinished();
+    void _prefetchFinished();
 
 private:
 
+    /// everything a worker needs, so that the service can change while it runs
+    struct Job {
+        JobId jobId = - 1;
+        Carta::Lib::NdArray::RawViewInterface::SharedPtr rawView;
+        QString inputId;
+        int sampling = 1;
+        double tolerance = 0;
+        std::vector < double > levels;
+
+        /// polylines of each level, filled in from the cache or by the worker
+        std::vector < std::vector < QPolygonF > > polylines;
+
+        /// which levels the worker has to compute
+        std::vector < bool > computed;
+
+        /// background jobs run on one thread and only fill the cache
+        bool background = false;
+
+        /// the polylines simplified for the zoom of the job
+        Result result;
+        std::shared_ptr < std::atomic < bool > > cancelled;
+    };
+
+    /// compute the missing levels of a job and simplify all of them
+    static std::shared_ptr < Job >
+    _compute( std::shared_ptr < Job > job );
+
+    /// the width of the blocks of pixels contoured at the current zoom
+    int
+    _sampling() const;
+
+    /// make a job for the current levels and level of detail, taking whatever is
+    /// cached for the input
+    std::shared_ptr < Job >
+    _makeJob( const QString & inputId, Carta::Lib::NdArray::RawViewInterface::SharedPtr rawView );
+
+    /// run a job on the thread pool, calling the slot when it is done
+    void
+    _runJob( std::shared_ptr < Job > job, const char * finishedSlot );
+
+    /// start on the next prefetched input that is not cached yet
+    void
+    _prefetchNext();
+
+    /// add the polylines of the levels a job computed to the cache
+    void
+    _cacheJob( std::shared_ptr < Job > job );
+
+    /// key of the cache entry for a level of an input
+    static QString
+    _cacheKey( const QString & inputId, int sampling, double level );
+
     std::vector < double > m_levels;
+    double m_zoom = 1.0;
     JobId m_lastJobId = - 1;
     Carta::Lib::NdArray::RawViewInterface::SharedPtr m_rawView = nullptr;
-    QTimer m_timer;
+    QString m_inputId;
+
+    /// the job whose result is still wanted
+    std::shared_ptr < Job > m_currentJob;
+
+    /// inputs still to be prefetched
+    QStringList m_prefetchIds;
+    std::function < Carta::Lib::NdArray::RawViewInterface::SharedPtr ( int ) > m_prefetchInput;
+    int m_prefetchNext = 0;
+
+    /// vertices of the contours of the inputs prefetched so far
+    int m_prefetchVertices = 0;
+
+    /// the background job, if one is running
+    std::shared_ptr < Job > m_prefetchJob;
 
+    /// polylines keyed by input, level of detail and level, costed by vertex count
+    QCache < QString, std::vector < QPolygonF > > m_cache;
 };
 }
 }
@@ -9,8 +9,10 @@ Profiles::getBestProfileExtractor( Carta::Lib::NdArray::RawViewInterface * rv,
                                    Profiles::ProfilePathType pt )
 {
     Q_UNUSED( rv );
-    Q_UNUSED( pt );
-    return new DefaultPrincipalProfileExtractor;
+    if ( pt == ProfilePathType::Line || pt == ProfilePathType::Polyline ) {
+        return new DefaultLineProfileExtractor;
+    }
+    return nullptr;
 }
 
 const std::vector<double> Profiles::ProfileExtractor::getDataD()
@@ -26,7 +28,7 @@ const std::vector<double> Profiles::ProfileExtractor::getDataD()
     const char * src = m_resultBuffer.constData();
     double * dst = & result[0];
     const double & ( * cvt)(const char *);
-    cvt = Carta::Lib::getConverter < double > ( m_rawView->pixelType() );
+    cvt = Carta::Lib::getConverter < double > ( m_resultType );
     for( qint64 i = 0 ; i < avail ; i ++ ) {
 
         * dst = cvt( src);
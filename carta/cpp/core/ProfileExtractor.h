@@ -6,9 +6,14 @@
 #pragma once
 
 #include "CartaLib/IImage.h"
+#include "Algorithms/bulkRead.h"
+#include "Algorithms/parallelAlgorithms.h"
+#include "Algorithms/pathSampling.h"
 
-#include <QTime>
-#include <QTimer>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+#include <atomic>
+#include <memory>
 
 namespace Profiles
 {
@@ -17,8 +22,9 @@ typedef std::vector < qint64 > VI64;
 typedef std::vector < double > VD;
 
 /// list of profile types we'll support...
-/// At the moment only the Principal will be supported for sure, the others are up for
-/// discussion.
+/// Line and Polyline paths have built-in extractors; Principal paths are described
+/// here but their spectra are read by Carta::Data::HoverSpectrumExtractor; the others
+/// are up for discussion.
 enum class ProfilePathType
 {
     Principal = 0,
@@ -52,10 +58,9 @@ private:
 
 /// describes a profile path that is a straight line through the n-dimensional data cube
 ///
-/// this is not implemented anywhere yet, it may even be removed
-///
-/// the sole purpose of this class is to make sure the APIs for profile extraction will work
-/// on multiple different profile path types...
+/// the line runs in the plane of the first two axes; the coordinates of p1 along the
+/// remaining axes select the plane. Values are averaged across the line over a
+/// distance of radius on each side.
 class LineProfilePath
 {
 public:
@@ -81,6 +86,31 @@ private:
     double m_radius;
 };
 
+/// describes a profile path through a sequence of points in the plane of the first
+/// two axes; the coordinates of the first point along the remaining axes select
+/// the plane. Values are averaged across the path over a distance of radius on
+/// each side.
+class PolylineProfilePath
+{
+public:
+
+    PolylineProfilePath( const std::vector < VD > & points, double radius )
+        : m_points( points )
+          , m_radius( radius )
+    { }
+
+    const std::vector < VD > &
+    points() const { return m_points; }
+
+    double
+    radius() const { return m_radius; }
+
+private:
+
+    std::vector < VD > m_points;
+    double m_radius;
+};
+
 /// Container for one of the supported profile path types. It should essentially act as
 /// a type-safe union of the profile paths, but since std::variant<> is not yet in the
 /// standard, we'll have to hack it ourselves...
@@ -111,6 +141,13 @@ public:
         return ProfilePath( LineProfilePath( p1, p2, radius ) );
     }
 
+    /// named constructor for Polyline
+    static ProfilePath
+    polyline( const std::vector < VD > & points, double radius )
+    {
+        return ProfilePath( PolylineProfilePath( points, radius ) );
+    }
+
     ProfilePath()
     {
         m_type = ProfilePathType::Other;
@@ -128,6 +165,12 @@ public:
         m_line = profile;
     }
 
+    ProfilePath( const PolylineProfilePath & profile )
+    {
+        m_type = ProfilePathType::Polyline;
+        m_polyline = profile;
+    }
+
     ProfilePathType
     type() const { return m_type; }
 
@@ -145,6 +188,20 @@ public:
         return m_line;
     }
 
+    const LineProfilePath &
+    getLineProfile() const
+    {
+        CARTA_ASSERT( m_type == ProfilePathType::Line );
+        return m_line;
+    }
+
+    const PolylineProfilePath &
+    getPolylineProfile() const
+    {
+        CARTA_ASSERT( m_type == ProfilePathType::Polyline );
+        return m_polyline;
+    }
+
 private:
 
     ProfilePathType m_type;
@@ -152,6 +209,7 @@ private:
     /// \todo these should be std::variant<> ....
     PrincipalAxisProfilePath m_principal = PrincipalAxisProfilePath( 0, { } );
     LineProfilePath m_line = LineProfilePath( { }, { }, 0 );
+    PolylineProfilePath m_polyline = PolylineProfilePath( { }, 0 );
 };
 
 /// this is the API that a plugin must implement to provide its own profile extraction
@@ -190,31 +248,33 @@ signals:
     progress( qint64 id, qint64 totalLength, QByteArray data );
 };
 
-/// the default implemenation of a principal axis profile extractor
-/// this is slow, but it'll work for any image
+/// the default implementation of line and polyline profile extractors
 ///
-/// \todo work is done using timers, in the same thread. A better solution would be to
-/// move this into its own thread, but that will require thread support from RawViewInterface
-/// and ImageInterface as well...
+/// the path is sampled at one pixel spacing with bilinear interpolation, averaging
+/// across the path over the radius of the path. The rectangle of the plane that the
+/// path passes through is read with the bulk accessor on the thread pool, and the
+/// samples are divided between the threads of the pool. The result is delivered in
+/// one piece, as doubles (Real64 pixels).
 ///
-class DefaultPrincipalProfileExtractor : public IProfileExtractor
+/// \warning the raw view passed to start() must stay valid until the extraction
+/// finishes or is superseded
+class DefaultLineProfileExtractor : public IProfileExtractor
 {
     Q_OBJECT
-    CLASS_BOILERPLATE( DefaultPrincipalProfileExtractor );
+    CLASS_BOILERPLATE( DefaultLineProfileExtractor );
 
 public:
 
-    DefaultPrincipalProfileExtractor( QObject * parent = nullptr )
+    DefaultLineProfileExtractor( QObject * parent = nullptr )
         : IProfileExtractor( parent )
     {
-        // when we emit internal delayedProgress, the real progress will be emitted
-        // little later (this essentially allows us to emit progress directly from
-        // the start method, but these signals will be delivered asynchronously)
         connect( this, & Me::_delayedProgress, this, & Me::progress, Qt::QueuedConnection );
+    }
 
-        // setup work timer (to simulate extraction)
-        m_workTimer.setInterval( 100 );
-        connect( & m_workTimer, & QTimer::timeout, this, & Me::workTimerCB );
+    virtual
+    ~DefaultLineProfileExtractor()
+    {
+        _cancel();
     }
 
 public slots:
@@ -223,70 +283,87 @@ public slots:
     start( Carta::Lib::NdArray::RawViewInterface * rv, const ProfilePath & profilePath,
            qint64 id ) override
     {
+        _cancel();
         m_id = id;
 
         CARTA_ASSERT( rv );
-        if ( profilePath.type() != ProfilePathType::Principal ) {
-            qCritical() << "DefaultPrincipalProfileExtractor can only handle Principal paths";
-
-            // report the error but delayed, to make it async
+        std::vector < VD > points;
+        double radius = 0;
+        if ( profilePath.type() == ProfilePathType::Line ) {
+            const LineProfilePath & line = profilePath.getLineProfile();
+            points = { line.p1(), line.p2() };
+            radius = line.radius();
+        }
+        else if ( profilePath.type() == ProfilePathType::Polyline ) {
+            const PolylineProfilePath & polyline = profilePath.getPolylineProfile();
+            points = polyline.points();
+            radius = polyline.radius();
+        }
+        const VI & dims = rv->dims();
+        if ( points.empty() || dims.size() < 2 || points[0].size() != dims.size() ) {
+            qCritical() << "DefaultLineProfileExtractor needs a Line or Polyline path with"
+                        << "a coordinate for every axis";
             emit _delayedProgress( m_id, - 2, QByteArray() );
             return;
         }
 
-        const PrincipalAxisProfilePath & pa = profilePath.getPrincipalProfile();
-
-        // let's make sure the dimensions match up
-        CARTA_ASSERT( rv->dims().size() == pa.pos().size() );
-        CARTA_ASSERT( pa.axis() >= 0 && size_t( pa.axis() ) < rv->dims().size() );
-
-        // remember the raw view
-        m_rv = rv;
-
-        // save profile path information
-        m_currPos = pa.pos();
-        m_axis = pa.axis();
-        m_currPos[m_axis] = 0;
-
-        // figure out pixel size
-        m_pixelSize = Carta::Lib::Image::pixelType2size( m_rv-> pixelType() );
-
-//        switch ( m_rv->pixelType() )
-//        {
-//        case Carta::Lib::Image::PixelType::Byte :
-//            m_pixelSize =
-//                Carta::Lib::Image::PixelType2CType < Carta::Lib::Image::PixelType::Byte >::size;
-//            break;
-//        case Carta::Lib::Image::PixelType::Int16 :
-//            m_pixelSize =
-//                Carta::Lib::Image::PixelType2CType < Carta::Lib::Image::PixelType::Int16 >::size;
-//            break;
-//        case Carta::Lib::Image::PixelType::Int32 :
-//            m_pixelSize =
-//                Carta::Lib::Image::PixelType2CType < Carta::Lib::Image::PixelType::Int32 >::size;
-//            break;
-//        case Carta::Lib::Image::PixelType::Int64 :
-//            m_pixelSize =
-//                Carta::Lib::Image::PixelType2CType < Carta::Lib::Image::PixelType::Int64 >::size;
-//            break;
-//        case Carta::Lib::Image::PixelType::Real32 :
-//            m_pixelSize =
-//                Carta::Lib::Image::PixelType2CType < Carta::Lib::Image::PixelType::Real32 >::size;
-//            break;
-//        case Carta::Lib::Image::PixelType::Real64 :
-//            m_pixelSize =
-//                Carta::Lib::Image::PixelType2CType < Carta::Lib::Image::PixelType::Real64 >::size;
-//            break;
-//        case Carta::Lib::Image::PixelType::Other :
-//            break;
-//        } // switch
-        CARTA_ASSERT( m_pixelSize > 0 );
-
-        // immediately report delayed progress (to establish total length of the result)
-        emit _delayedProgress( m_id, m_rv->dims()[m_axis], QByteArray() );
-
-        // and start the extraction
-        m_workTimer.start();
+        std::vector < std::pair < double, double > > vertices;
+        for ( const VD & point : points ) {
+            vertices.push_back( std::make_pair( point[0], point[1] ) );
+        }
+        std::shared_ptr < std::vector < Carta::Core::Algorithms::PathSample > > samples(
+            new std::vector < Carta::Core::Algorithms::PathSample > (
+                Carta::Core::Algorithms::samplePolyline( vertices ) ) );
+        qint64 totalLength = samples->size();
+        emit _delayedProgress( m_id, totalLength, QByteArray() );
+
+        // read only the part of the plane that the path passes through
+        int64_t box[4] = { 0, 0, 0, 0 };
+        bool touches = Carta::Core::Algorithms::pathBounds( * samples, radius, dims[0], dims[1], box );
+        SliceND slice;
+        slice.slice( 0 ).start( box[0] ).end( box[2] + 1 );
+        slice.slice( 1 ).start( box[1] ).end( box[3] + 1 );
+        for ( size_t i = 2 ; i < dims.size() ; i++ ) {
+            int pos = Carta::Lib::clamp < int > ( int ( std::round( points[0][i] ) ), 0, dims[i] - 1 );
+            slice.slice( i ).start( pos ).end( pos + 1 );
+        }
+
+        double left = box[0];
+        double top = box[1];
+
+        std::shared_ptr < std::atomic < bool > > cancelled( new std::atomic < bool > ( false ) );
+        m_cancelled = cancelled;
+        qint64 jobId = m_id;
+        m_future = QtConcurrent::run( [this, rv, slice, samples, radius, touches, left, top,
+                                       totalLength, jobId, cancelled] () {
+            std::vector < double > result( totalLength, std::numeric_limits < double >::quiet_NaN() );
+            if ( touches ) {
+                std::unique_ptr < Carta::Lib::NdArray::RawViewInterface > view( rv->getView( slice ) );
+                if ( ! view ) {
+                    emit _delayedProgress( jobId, - 2, QByteArray() );
+                    return;
+                }
+                std::vector < float > plane = Carta::Core::Algorithms::readAll < float > ( view.get() );
+                int64_t width = view->dims()[0];
+                int64_t height = view->dims()[1];
+                Carta::Core::Algorithms::parallelRanges( totalLength, 1024,
+                    [&] ( int64_t begin, int64_t end, int ) {
+                    for ( int64_t i = begin ; i < end && ! * cancelled ; i++ ) {
+                        Carta::Core::Algorithms::PathSample sample = ( * samples )[i];
+                        sample.x -= left;
+                        sample.y -= top;
+                        result[i] = Carta::Core::Algorithms::sampleAcross(
+                            plane.data(), width, height, sample, radius );
+                    }
+                });
+            }
+            if ( * cancelled ) {
+                return;
+            }
+            QByteArray buffer( reinterpret_cast < const char * > ( result.data() ),
+                               result.size() * sizeof( double ) );
+            emit _delayedProgress( jobId, totalLength, buffer );
+        });
     } // start
 
 signals:
@@ -295,60 +372,29 @@ signals:
     void
     _delayedProgress( qint64 id, qint64 totalLength, QByteArray data );
 
-private slots:
+private:
 
+    /// stop the running extraction and wait for it to finish
     void
-    workTimerCB()
+    _cancel()
     {
-        //qDebug() << "profile workTimerCB()";
-
-        // note that from here we ca safely emit directly, since this is executed
-        // as a callback of the work timer...
-        QTime t;
-        t.restart();
-
-//        while ( t.elapsed() < 100 ) {
-        while ( true ) {
-            // if we are done, stop timer, report result
-            //qDebug() << "profile cmp" << m_currPos[m_axis] << "to" << m_rv->dims()[m_axis];
-            if ( m_currPos[m_axis] >= m_rv-> dims()[m_axis] ) {
-                //qDebug() << "profile stop timer";
-                m_workTimer.stop();
-                break;
-            }
-
-            //qDebug() << "profile pos" << m_currPos;
-
-            // get the element at the current position
-            const char * data = m_rv->get( m_currPos );
-            m_buffer.append( data, m_pixelSize );
-
-            m_currPos[m_axis]++;
-
-            // only do little bit of work
-            if ( t.elapsed() >= 10 ) {
-                break;
-            }
+        if ( m_cancelled ) {
+            * m_cancelled = true;
         }
+        m_future.waitForFinished();
+    }
 
-        // report result
-        emit progress( m_id, m_rv->dims()[m_axis], m_buffer );
-    } // workTimerCB
-
-private:
-
-    VI m_currPos;
-    int m_axis = - 1;
-    QTimer m_workTimer;
-    Carta::Lib::NdArray::RawViewInterface * m_rv = nullptr;
-    QByteArray m_buffer;
+    QFuture < void > m_future;
+    std::shared_ptr < std::atomic < bool > > m_cancelled;
     qint64 m_id = - 1;
-    size_t m_pixelSize = 0;
 };
 
 /// this will somehow return the best algorithm available by combining built-in extractors
 /// and those provided by plugins
 ///
+/// \return the extractor, or null if none handles the path type; spectra along a
+/// principal axis are read by Carta::Data::HoverSpectrumExtractor instead
+///
 /// \todo implement hook for obtaining best extractors from plugins
 IProfileExtractor *
 getBestProfileExtractor( Carta::Lib::NdArray::RawViewInterface * rv, ProfilePathType pt );
@@ -384,8 +430,10 @@ public:
         // create a new algorithm based on raw view & profile type and connect it
         if ( ! m_algorithm ) {
             m_algorithm = getBestProfileExtractor( m_rawView, profilePath.type() );
-            connect( m_algorithm, & IProfileExtractor::progress,
-                     this, & ProfileExtractor::progressCB );
+            if ( m_algorithm ) {
+                connect( m_algorithm, & IProfileExtractor::progress,
+                         this, & ProfileExtractor::progressCB );
+            }
         }
 
         if ( jobId == - 1 ) {
@@ -393,9 +441,19 @@ public:
         }
         m_jobId = jobId;
 
-        m_pixelSize = Carta::Lib::Image::pixelType2size( m_rawView->pixelType() );
+        // the extractors interpolate along the path and deliver doubles; the results
+        // of the previous job are dropped so they are never read with the wrong size
+        m_resultType = Carta::Lib::Image::PixelType::Real64;
+        m_pixelSize = Carta::Lib::Image::pixelType2size( m_resultType );
+        m_resultBuffer.clear();
+        m_totalLength = - 1;
         m_jobId++;
         m_profilePath = profilePath;
+        if ( ! m_algorithm ) {
+            m_totalLength = - 2;
+            emit progress();
+            return m_jobId;
+        }
         m_algorithm->start( m_rawView, m_profilePath, m_jobId );
         return m_jobId;
     } // start
@@ -427,7 +485,7 @@ public:
 
     // raw data accessors
     Carta::Lib::Image::PixelType
-    dataRawDataType();
+    dataRawDataType() const { return m_resultType; }
 
     /// get the raw data
     const QByteArray &
@@ -480,6 +538,7 @@ private:
 
     qint64 m_jobId = 0;
     size_t m_pixelSize = 0;
+    Carta::Lib::Image::PixelType m_resultType = Carta::Lib::Image::PixelType::Other;
 
     QByteArray m_resultBuffer;
     qint64 m_totalLength = - 1;
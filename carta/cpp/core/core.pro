@@ -5,7 +5,7 @@
 TEMPLATE = lib
 
 ###CONFIG += staticlib
-QT += widgets network
+QT += widgets network concurrent
 QT += xml
 
 HEADERS += \
@@ -41,12 +41,15 @@ HEADERS += \
     Data/Histogram/ChannelUnits.h \
     Data/Histogram/PlotStyles.h \
     Data/Histogram/HistogramRenderService.h \
-    Data/Histogram/HistogramRenderThread.h \
+    Data/Histogram/HistogramBase.h \
+    Data/Histogram/HistogramChannelCache.h \
+    Data/Histogram/HistogramEngine.h \
     Data/Histogram/HistogramRenderWorker.h \
     Data/ILinkable.h \
     Data/Settings.h \
     Data/Image/Controller.h \
     Data/Image/DataFactory.h \
+    Data/Image/CollapseEngine.h \
     Data/Image/LayerGroup.h \
     Data/Image/Stack.h \
     Data/Image/Layer.h \
@@ -71,6 +74,7 @@ HEADERS += \
     Data/Image/Grid/LabelFormats.h \
     Data/Image/IPercentIntensityMap.h \
     Data/Image/LayerCompositionModes.h \
+    Data/Image/MemoryImage.h \
     Data/Image/RenderRequest.h \
     Data/Image/RenderResponse.h \
     Data/Image/Save/SaveService.h \
@@ -89,20 +93,26 @@ HEADERS += \
     Data/Preferences/Preferences.h \
     Data/Preferences/PreferencesSave.h \
     Data/Profile/CurveData.h \
+    Data/Profile/HoverSpectrumExtractor.h \
     Data/Profile/Profiler.h \
+    Data/Profile/PVSliceGenerator.h \
+    Data/Profile/ProfileCache.h \
+    Data/Profile/ProfileEngine.h \
     Data/Profile/ProfilePlotStyles.h \
     Data/Profile/ProfileRenderService.h \
-    Data/Profile/ProfileRenderThread.h \
     Data/Profile/ProfileRenderWorker.h \
     Data/Profile/ProfileStatistics.h \
     Data/Profile/GenerateModes.h \
     Data/Region/Region.h \
     Data/Region/RegionFactory.h \
+    Data/Region/RegionSpans.h \
     Data/Snapshot/ISnapshotsImplementation.h \
     Data/Snapshot/Snapshots.h \
     Data/Snapshot/Snapshot.h \
     Data/Snapshot/SnapshotsFile.h \
+    Data/Statistics/RegionStatisticsEngine.h \
     Data/Statistics/Statistics.h \
+    Data/Statistics/StatisticsRenderService.h \
     Data/Units/UnitsFrequency.h \
     Data/Units/UnitsIntensity.h \
     Data/Units/UnitsSpectral.h \
@@ -124,6 +134,11 @@ HEADERS += \
     ScriptedClient/ScriptedCommandListener.h \
     ScriptedClient/ScriptFacade.h \
     Algorithms/quantileAlgorithms.h \
+    Algorithms/bulkRead.h \
+    Algorithms/histogramAlgorithms.h \
+    Algorithms/parallelAlgorithms.h \
+    Algorithms/pathSampling.h \
+    Algorithms/runningStatistics.h \
     ScriptedClient/Listener.h \
     ScriptedClient/ScriptedCommandInterpreter.h \
     ScriptedClient/VarLengthMessage.h \
@@ -168,6 +183,7 @@ SOURCES += \
     Data/Colormap/TransformsData.cpp \
     Data/Colormap/TransformsImage.cpp \
     Data/Image/Controller.cpp \
+    Data/Image/CollapseEngine.cpp \
     Data/Image/DataFactory.cpp \
     Data/Image/LayerData.cpp \
     Data/Image/Layer.cpp \
@@ -192,6 +208,7 @@ SOURCES += \
     Data/Image/Draw/DrawSynchronizer.cpp \
     Data/Image/Draw/DrawStackSynchronizer.cpp \
     Data/Image/LayerCompositionModes.cpp \
+    Data/Image/MemoryImage.cpp \
     Data/Image/RenderRequest.cpp \
     Data/Image/RenderResponse.cpp \
     Data/Image/Save/SaveService.cpp \
@@ -203,7 +220,9 @@ SOURCES += \
     Data/Histogram/Histogram.cpp \
     Data/Histogram/ChannelUnits.cpp \
     Data/Histogram/HistogramRenderService.cpp \
-    Data/Histogram/HistogramRenderThread.cpp \
+    Data/Histogram/HistogramBase.cpp \
+    Data/Histogram/HistogramChannelCache.cpp \
+    Data/Histogram/HistogramEngine.cpp \
     Data/Histogram/HistogramRenderWorker.cpp \
     Data/Histogram/PlotStyles.cpp \
     Data/LinkableImpl.cpp \
@@ -219,19 +238,25 @@ SOURCES += \
     Data/Preferences/Preferences.cpp \
     Data/Preferences/PreferencesSave.cpp \
     Data/Profile/CurveData.cpp \
+    Data/Profile/HoverSpectrumExtractor.cpp \
     Data/Profile/Profiler.cpp \
+    Data/Profile/PVSliceGenerator.cpp \
+    Data/Profile/ProfileCache.cpp \
+    Data/Profile/ProfileEngine.cpp \
     Data/Profile/ProfilePlotStyles.cpp \
     Data/Profile/ProfileRenderService.cpp \
-    Data/Profile/ProfileRenderThread.cpp \
     Data/Profile/ProfileRenderWorker.cpp \
     Data/Profile/ProfileStatistics.cpp \
     Data/Profile/GenerateModes.cpp \
     Data/Region/Region.cpp \
     Data/Region/RegionFactory.cpp \
+    Data/Region/RegionSpans.cpp \
     Data/Snapshot/Snapshots.cpp \
     Data/Snapshot/Snapshot.cpp \
     Data/Snapshot/SnapshotsFile.cpp \
+    Data/Statistics/RegionStatisticsEngine.cpp \
     Data/Statistics/Statistics.cpp \
+    Data/Statistics/StatisticsRenderService.cpp \
     Data/Units/UnitsFrequency.cpp \
     Data/Units/UnitsIntensity.cpp \
     Data/Units/UnitsSpectral.cpp \
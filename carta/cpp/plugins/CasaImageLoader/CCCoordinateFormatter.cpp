@@ -5,6 +5,7 @@
 #include "CCCoordinateFormatter.h"
 #include <casacore/coordinates/Coordinates.h>
 #include <casacore/measures/Measures/Stokes.h>
+#include <algorithm>
 #include <QDebug>
 
 #ifdef DONT_COMPILE
@@ -191,10 +192,11 @@ bool
 CCCoordinateFormatter::toWorld( const CoordinateFormatterInterface::VD & pixel,
                                 CoordinateFormatterInterface::VD & world ) const
 {
-    Q_UNUSED( pixel );
-    Q_UNUSED( world );
-
-    qFatal( "not implemented" );
+    casa::Vector < casa::Double > pixelD = pixel;
+    casa::Vector < casa::Double > worldD;
+    bool valid = m_casaCS->toWorld( worldD, pixelD );
+    world = worldD.tovector();
+    return valid;
 }
 
 bool
@@ -208,6 +210,69 @@ CCCoordinateFormatter::toPixel( const CoordinateFormatterInterface::VD & world,
     return valid;
 }
 
+namespace
+{
+/// convert packed points with one of casacore's many-point conversions, which take
+/// a matrix with one column per point; columns are contiguous, so the packed
+/// points are copied in and out as they are
+template < typename Convert >
+bool
+convertMany( const CoordinateFormatterInterface::VD & input, int inputAxes,
+             CoordinateFormatterInterface::VD & output,
+             std::vector < bool > * valid,
+             Convert convert )
+{
+    size_t count = inputAxes > 0 ? input.size() / inputAxes : 0;
+    output.clear();
+    if ( valid ) {
+        valid-> assign( count, false );
+    }
+    if ( count == 0 ) {
+        return true;
+    }
+    casa::Matrix < casa::Double > inputM( inputAxes, count );
+    std::copy( input.begin(), input.begin() + inputAxes * count, inputM.data() );
+    casa::Matrix < casa::Double > outputM;
+    casa::Vector < casa::Bool > failures;
+    bool allValid = convert( outputM, inputM, failures );
+    output.assign( outputM.data(), outputM.data() + outputM.nelements() );
+    if ( valid ) {
+        for ( size_t i = 0 ; i < count && i < failures.nelements() ; ++i ) {
+            ( * valid )[i] = ! failures[i];
+        }
+    }
+    return allValid;
+}
+}
+
+bool
+CCCoordinateFormatter::toWorldMany( const CoordinateFormatterInterface::VD & pixels,
+                                    CoordinateFormatterInterface::VD & worlds,
+                                    std::vector < bool > * valid ) const
+{
+    const casa::CoordinateSystem & cs = * m_casaCS;
+    return convertMany( pixels, cs.nPixelAxes(), worlds, valid,
+                        [&cs] ( casa::Matrix < casa::Double > & world,
+                                const casa::Matrix < casa::Double > & pixel,
+                                casa::Vector < casa::Bool > & failures ) {
+        return cs.toWorldMany( world, pixel, failures );
+    });
+}
+
+bool
+CCCoordinateFormatter::toPixelMany( const CoordinateFormatterInterface::VD & worlds,
+                                    CoordinateFormatterInterface::VD & pixels,
+                                    std::vector < bool > * valid ) const
+{
+    const casa::CoordinateSystem & cs = * m_casaCS;
+    return convertMany( worlds, cs.nWorldAxes(), pixels, valid,
+                        [&cs] ( casa::Matrix < casa::Double > & pixel,
+                                const casa::Matrix < casa::Double > & world,
+                                casa::Vector < casa::Bool > & failures ) {
+        return cs.toPixelMany( pixel, world, failures );
+    });
+}
+
 void
 CCCoordinateFormatter::setTextOutputFormat( CoordinateFormatterInterface::TextFormat fmt )
 {
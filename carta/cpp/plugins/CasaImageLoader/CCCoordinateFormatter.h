@@ -44,6 +44,14 @@ public:
     virtual bool
     toPixel( const VD & world, VD & pixel ) const override;
 
+    /// converts all points with one call to casacore
+    virtual bool
+    toWorldMany( const VD & pixels, VD & worlds, std::vector < bool > * valid = nullptr ) const override;
+
+    /// converts all points with one call to casacore
+    virtual bool
+    toPixelMany( const VD & worlds, VD & pixels, std::vector < bool > * valid = nullptr ) const override;
+
     virtual void
     setTextOutputFormat( TextFormat fmt ) override;
 
@@ -48,3 +48,19 @@ QStringList CCMetaDataInterface::otherInfo(TextFormat format)
     Q_UNUSED( format);
     qFatal( "not implemented");
 }
+
+Carta::Lib::Image::MetaDataInterface::SharedPtr CCMetaDataInterface::permuted( const std::vector < int > & indices )
+{
+    // same reordering as CCImage::getPermuted(), applied to the coordinates only
+    int indexCount = indices.size();
+    if ( ! m_casaCS || indexCount != int( m_casaCS-> nPixelAxes() ) ) {
+        return nullptr;
+    }
+    casa::Vector < casa::Int > newOrder( indexCount );
+    for ( int i = 0 ; i < indexCount ; i++ ) {
+        newOrder[i] = indices[i];
+    }
+    auto casaCS = std::make_shared < casa::CoordinateSystem > ( * m_casaCS );
+    casaCS-> transpose( newOrder, newOrder );
+    return std::make_shared < CCMetaDataInterface > ( m_title.html(), casaCS );
+}
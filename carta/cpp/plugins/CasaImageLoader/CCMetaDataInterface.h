@@ -35,6 +35,9 @@ public:
     virtual QStringList
     otherInfo( TextFormat format ) override;
 
+    virtual Carta::Lib::Image::MetaDataInterface::SharedPtr
+    permuted( const std::vector < int > & indices ) override;
+
     //Return the casacore coordinate system.
     //Needed to parse CASA regions of an image.
     std::shared_ptr<casa::CoordinateSystem> getCoordinateSystem() const;
@@ -8,10 +8,22 @@
 #include <casacore/lattices/Lattices/LatticeStepper.h>
 #include <casacore/lattices/Lattices/LatticeIterator.h>
 #include <casacore/casa/Arrays/IPosition.h>
+#include <QMutex>
+#include <algorithm>
+#include <limits>
 
 template < typename PType >
 class CCImage;
 
+/// casacore lattices cannot be read from several threads at the same time, so all
+/// reads done through the raw views are serialized with this lock
+inline QMutex &
+casaReadMutex()
+{
+    static QMutex mutex( QMutex::Recursive );
+    return mutex;
+}
+
 /// CasaImageLoader plugin's implementation of the raw view
 ///
 /// \warning We are not handling negative step
@@ -99,19 +111,15 @@ public:
     /// yet another high performance accessor... similar to forEach above,
     /// but this time the supplied function gets called with whatever number
     /// elements that fit into the buffer
+    ///
+    /// The pixels are delivered in the same order as the per-pixel forEach(), and
+    /// masked pixels of floating point images are reported as NaN.
     virtual void
     forEach(
         int64_t buffSize,
         std::function < void (const char *, int64_t count) > func,
         char * buff = nullptr,
-        Traversal traversal = Traversal::Sequential ) override
-    {
-        Q_UNUSED( buffSize );
-        Q_UNUSED( func );
-        Q_UNUSED( buff );
-        Q_UNUSED( traversal );
-        qFatal( "not implemented" );
-    }
+        Traversal traversal = Traversal::Sequential ) override;
 
 protected:
 
@@ -198,6 +206,7 @@ CCRawView < PType >::get( const Carta::Lib::NdArray::RawViewInterface::VI & pos
     // casa::ImageInterface::operator() returns the result by value
     // so in order to return reference (to satisfy our API) we need to store this
     // in a buffer first...
+    QMutexLocker locker( & casaReadMutex() );
     m_buff = m_ccimage-> m_casaII->
                  operator() ( m_destPos );
 
@@ -236,6 +245,7 @@ CCRawView < PType >::forEach(
         inc( i ) = slice1d.step;
     }
     stepper.subSection( blc, trc, inc );
+    QMutexLocker locker( & casaReadMutex() );
     casa::RO_LatticeIterator < PType > iterator( * casaII, stepper );
 
     bool first = true;
@@ -253,6 +263,88 @@ CCRawView < PType >::forEach(
     }
 } // forEach
 
+template < typename PType >
+void
+CCRawView < PType >::forEach(
+    int64_t buffSize,
+    std::function < void (const char *, int64_t) > func,
+    char * buff,
+    Carta::Lib::NdArray::RawViewInterface::Traversal traversal )
+{
+    if ( traversal != Carta::Lib::NdArray::RawViewInterface::Traversal::Sequential ) {
+        qFatal( "sorry, not implemented yet" );
+    }
+    auto casaII     = m_ccimage-> m_casaII;
+    int imgDims     = casaII-> ndim();
+    auto imageShape = casaII-> shape();
+
+    // the largest number of pixels we can hand out at once
+    int64_t maxCount = std::max < int64_t > ( 1, buffSize / int64_t( sizeof( PType ) ) );
+    std::vector < PType > ownBuffer;
+    PType * dest = reinterpret_cast < PType * > ( buff );
+    if ( ! dest ) {
+        ownBuffer.resize( maxCount );
+        dest = ownBuffer.data();
+    }
+
+    // the cursor spans whole leading axes of the subsection for as long as they fit
+    // into the buffer, so that concatenating the cursors gives sequential order
+    casa::IPosition blc( imgDims, 0 );
+    auto trc = blc;
+    auto inc = blc;
+    casa::IPosition cursorShape( imgDims, 1 );
+    int64_t remaining = maxCount;
+    for ( int i = 0 ; i < imgDims ; i++ ) {
+        const auto & slice1d = m_appliedSlice.dims()[i];
+        blc( i ) = slice1d.start;
+        trc( i ) = slice1d.end();
+        inc( i ) = slice1d.step;
+        if ( remaining > 0 ) {
+            int64_t count = slice1d.count;
+            if ( count <= remaining ) {
+                cursorShape( i ) = count;
+                remaining = remaining / std::max < int64_t > ( count, 1 );
+            }
+            else {
+                cursorShape( i ) = remaining;
+                remaining = 0;
+            }
+        }
+    }
+
+    // casacore is only read under the lock; the callback runs on the copy in dest
+    // with the lock released, so other readers are not held up by slow callbacks
+    QMutexLocker locker( & casaReadMutex() );
+    casa::LatticeStepper stepper( imageShape, cursorShape, casa::LatticeStepper::RESIZE );
+    stepper.subSection( blc, trc, inc );
+    casa::RO_LatticeIterator < PType > iterator( * casaII, stepper );
+    bool masked = casaII-> isMasked() && std::numeric_limits < PType >::has_quiet_NaN;
+    for ( iterator.reset() ; ! iterator.atEnd() ; iterator++ ) {
+        const casa::Array < PType > & cursor = iterator.cursor();
+        int64_t count = cursor.nelements();
+        CARTA_ASSERT( count <= maxCount );
+        bool deleteIt = false;
+        const PType * data = cursor.getStorage( deleteIt );
+        std::copy( data, data + count, dest );
+        cursor.freeStorage( data, deleteIt );
+        if ( masked ) {
+            casa::Array < casa::Bool > mask = casaII-> getMaskSlice(
+                iterator.position(), cursor.shape(), stepper.increment() );
+            bool deleteMask = false;
+            const casa::Bool * maskData = mask.getStorage( deleteMask );
+            for ( int64_t k = 0 ; k < count ; k++ ) {
+                if ( ! maskData[k] ) {
+                    dest[k] = std::numeric_limits < PType >::quiet_NaN();
+                }
+            }
+            mask.freeStorage( maskData, deleteMask );
+        }
+        locker.unlock();
+        func( reinterpret_cast < const char * > ( dest ), count );
+        locker.relock();
+    }
+} // forEach
+
 template < typename PType >
 const Carta::Lib::NdArray::RawViewInterface::VI &
 CCRawView < PType >::currentPos()
@@ -142,9 +142,10 @@ void ImageHistogram<T>::_filterByChannels( const casa::ImageInterface<T>* image
                 endPos[spectralIndex] = endIndex;
 
                 casa::Slicer channelSlicer( startPos, endPos, stride, casa::Slicer::endIsLast );
-                casa::ImageInterface<T>* img = new casa::SubImage<T>( *(image), channelSlicer );
+                //The histogram maker keeps its own copy of the sub image.
+                casa::SubImage<T> img( *(image), channelSlicer );
                 delete m_histogramMaker;
-                m_histogramMaker = new casa::LatticeHistograms<casa::Float>( *img );
+                m_histogramMaker = new casa::LatticeHistograms<casa::Float>( img );
 			}
 		}
 	}
@@ -158,9 +159,13 @@ template <class T>
 void ImageHistogram<T>::setImage( const casa::ImageInterface<T>*  val ){
     if ( val != nullptr ){
         if ( m_image == nullptr || m_image->name(true) != val->name(true) ){
+            delete m_image;
             m_image = val;
             _reset();
         }
+        else {
+            delete val;
+        }
 	}
 }
 
@@ -373,6 +378,8 @@ void ImageHistogram<T>::toAscii( QTextStream& out ) const {
 
 template <class T>
 ImageHistogram<T>::~ImageHistogram() {
+    delete m_histogramMaker;
+    delete m_image;
 }
 
 template class ImageHistogram<float>;
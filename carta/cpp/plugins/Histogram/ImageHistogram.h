@@ -53,6 +53,7 @@ public:
 
 	void setIntensityRange( double minimumIntensity, double maximumIntensity )  Q_DECL_OVERRIDE;
 
+	//Takes ownership of the image.
 	void setImage(const casa::ImageInterface<T>*  val);
 	static double computeYValue( double value, bool useLog );
 	virtual ~ImageHistogram();
@@ -70,7 +71,7 @@ private:
 	casa::ImageRegion* m_region;
 	const int ALL_CHANNELS;
 	const int ALL_INTENSITIES;
-    const casa::ImageInterface<T>*  m_image; //Use
+    const casa::ImageInterface<T>*  m_image; //Owned
 	int m_channelMin;
 	int m_channelMax;
 	double m_intensityMin;
@@ -8,6 +8,7 @@
 #include "StatisticsCASARegion.h"
 
 #include <QDebug>
+#include <QMutexLocker>
 
 
 StatisticsCASA::StatisticsCASA( QObject * parent ) :
@@ -31,6 +32,8 @@ StatisticsCASA::handleHook( BaseHook & hookData ){
         }
 
         QList< QList< QList<Carta::Lib::StatInfo> > > imageResults;
+        //Statistics are computed on the thread pool; casacore reads must not overlap.
+        QMutexLocker locker( & casaReadMutex() );
         for ( int i = 0; i < imageCount; i++ ){
             std::shared_ptr<Carta::Lib::Image::ImageInterface> image = images[i];
             if ( !image.get() ){
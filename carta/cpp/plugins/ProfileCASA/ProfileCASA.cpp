@@ -18,6 +18,7 @@ using namespace std;
 
 
 #include <QDebug>
+#include <QMutexLocker>
 
 
 ProfileCASA::ProfileCASA(QObject *parent) :
@@ -342,6 +343,8 @@ bool ProfileCASA::handleHook(BaseHook & hookData){
 
         Carta::Lib::RegionInfo regionInfo = hook.paramsPtr->m_regionInfo;
         Carta::Lib::ProfileInfo profileInfo = hook.paramsPtr->m_profileInfo;
+        //Profiles are computed on the thread pool; casacore reads must not overlap.
+        QMutexLocker locker( & casaReadMutex() );
         hook.result = _generateProfile( casaImage, regionInfo, profileInfo );
         return true;
     }
@@ -5,6 +5,7 @@
 #include "CartaLib/Hooks/LoadRegion.h"
 #include "CartaLib/RegionInfo.h"
 #include "CartaLib/IImage.h"
+#include "CartaLib/CoordinateMesh.h"
 #include "casacore/coordinates/Coordinates/DirectionCoordinate.h"
 #include "casacore/measures/Measures/MCDirection.h"
 #include "imageanalysis/Annotations/RegionTextList.h"
@@ -13,6 +14,12 @@
 #include <QDebug>
 #include <QFile>
 
+namespace {
+//Regions with at least this many vertices are converted on an interpolating mesh
+//rather than exactly.
+const int MESH_MIN_VERTICES = 1000;
+}
+
 
 RegionCASA::RegionCASA(QObject *parent) :
     QObject(parent){
@@ -66,22 +73,50 @@ std::vector<HookId> RegionCASA::getInitialHookList(){
 
 std::vector<std::pair<double,double> >
 RegionCASA::_getPixelVertices( const casa::AnnotationBase::Direction& corners,
-        const casa::CoordinateSystem& csys, const casa::Vector<casa::MDirection>& directions ) const {
+        const casa::CoordinateSystem& csys, const casa::Vector<casa::MDirection>& directions,
+        const CoordinateFormatterInterface& cf, const Carta::Lib::CoordinateMesh* mesh ) const {
     std::vector<casa::Quantity> xx, xy;
     _getWorldVertices(xx, xy, csys, directions );
-    casa::Vector<casa::Double> world = csys.referenceValue();
     const casa::IPosition dirAxes = csys.directionAxesNumbers();
     casa::String xUnit = csys.worldAxisUnits()[dirAxes[0]];
     casa::String yUnit = csys.worldAxisUnits()[dirAxes[1]];
     int cornerCount = corners.size();
-
     std::vector<std::pair<double,double> > pixelVertices( cornerCount );
+
+    //The mesh only needs the direction axes.
+    CoordinateFormatterInterface::VD worlds;
+    CoordinateFormatterInterface::VD pixels;
+    if ( mesh ){
+        worlds.resize( 2 * cornerCount );
+        for (int i=0; i<cornerCount; i++) {
+            worlds[2 * i] = xx[i].getValue(xUnit);
+            worlds[2 * i + 1] = xy[i].getValue(yUnit);
+        }
+        mesh->toPixelMany( worlds, pixels );
+        for (int i=0; i<cornerCount; i++) {
+            pixelVertices[i]= std::pair<double,double>( pixels[2 * i], pixels[2 * i + 1] );
+        }
+        return pixelVertices;
+    }
+
+    //Otherwise convert all the vertices with one call, the other axes at their
+    //reference values.
+    CoordinateFormatterInterface::VD world = csys.referenceValue().tovector();
+    int worldAxisCount = world.size();
+    worlds.reserve( worldAxisCount * cornerCount );
     for (int i=0; i<cornerCount; i++) {
         world[dirAxes[0]] = xx[i].getValue(xUnit);
         world[dirAxes[1]] = xy[i].getValue(yUnit);
-        casa::Vector<casa::Double> pixel;
-        csys.toPixel(pixel, world);
-        pixelVertices[i]= std::pair<double,double>( pixel[dirAxes[0]], pixel[dirAxes[1]] );
+        worlds.insert( worlds.end(), world.begin(), world.end() );
+    }
+    cf.toPixelMany( worlds, pixels );
+    int pixelAxisCount = csys.nPixelAxes();
+    if ( static_cast<int>( pixels.size() ) != pixelAxisCount * cornerCount ){
+        return pixelVertices;
+    }
+    for (int i=0; i<cornerCount; i++) {
+        pixelVertices[i]= std::pair<double,double>( pixels[i * pixelAxisCount + dirAxes[0]],
+                pixels[i * pixelAxisCount + dirAxes[1]] );
     }
     return pixelVertices;
 }
@@ -111,6 +146,9 @@ RegionCASA::_loadRegion( const QString & fname, std::shared_ptr<Carta::Lib::Imag
         CCMetaDataInterface* metaData = dynamic_cast<CCMetaDataInterface*>(metaPtr.get());
         if ( metaData ){
             std::shared_ptr<casa::CoordinateSystem> cs = metaData->getCoordinateSystem();
+            CoordinateFormatterInterface::SharedPtr cf = metaData->coordinateFormatter();
+            //Made the first time a region has enough vertices to be worth it.
+            std::unique_ptr<Carta::Lib::CoordinateMesh> mesh;
             std::vector < int > dimensions = imagePtr->dims();
             int dimCount = dimensions.size();
             casa::IPosition shape(dimCount);
@@ -129,8 +167,15 @@ RegionCASA::_loadRegion( const QString & fname, std::shared_ptr<Carta::Lib::Imag
 
                 casa::Vector<casa::MDirection> directions = ann->getConvertedDirections();
                 casa::AnnotationBase::Direction points = ann->getDirections();
+                bool useMesh = static_cast<int>( points.size() ) >= MESH_MIN_VERTICES;
+                if ( useMesh && !mesh ){
+                    const casa::IPosition dirAxes = cs->directionAxesNumbers();
+                    mesh.reset( new Carta::Lib::CoordinateMesh( *cf, cs->referencePixel().tovector(),
+                            dirAxes[0], dirAxes[1], dimensions[dirAxes[0]], dimensions[dirAxes[1]] ) );
+                }
                 std::vector<std::pair<double,double> > corners =
-                            _getPixelVertices( points, *cs.get(), directions );
+                            _getPixelVertices( points, *cs.get(), directions, *cf,
+                                    useMesh ? mesh.get() : nullptr );
                 int annType = ann->getType();
                 switch( annType ){
                 case casa::AnnotationBase::RECT_BOX : {
@@ -12,9 +12,12 @@
 namespace Carta {
     namespace Lib {
         class RegionInfo;
+        class CoordinateMesh;
     }
 }
 
+class CoordinateFormatterInterface;
+
 class RegionCASA : public QObject, public IPlugin
 {
     Q_OBJECT
@@ -46,11 +49,14 @@ private:
      * @param corners - a list of corner points in world units.
      * @param csys - the coordinate system of the containing image.
      * @param directions - a list of MDirections for the image.
+     * @param cf - converts the vertices, in one call for all of them.
+     * @param mesh - converts the vertices approximately instead, if not null.
      * @return - a list of corner points of a region in pixels.
      */
     std::vector<std::pair<double,double> >
         _getPixelVertices( const casa::AnnotationBase::Direction& corners,
-            const casa::CoordinateSystem& csys, const casa::Vector<casa::MDirection>& directions ) const;
+            const casa::CoordinateSystem& csys, const casa::Vector<casa::MDirection>& directions,
+            const CoordinateFormatterInterface& cf, const Carta::Lib::CoordinateMesh* mesh ) const;
 
     /**
      * Get a lists of x- and y- coordinates of the corner points of a region based on world
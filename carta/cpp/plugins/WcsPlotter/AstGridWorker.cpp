@@ -0,0 +1,57 @@
+/**
+ *
+ **/
+
+#include "AstGridWorker.h"
+#include <QThread>
+
+namespace WcsPlotterPluginNS
+{
+AstGridWorker::AstGridWorker()
+    : QObject()
+{
+    qRegisterMetaType < std::shared_ptr < AstGridJob > > ();
+    connect( this, & Me::_renderRequested, this, & Me::_render, Qt::QueuedConnection );
+}
+
+AstGridWorker::SharedPtr
+AstGridWorker::shared()
+{
+    // only ever called from the main thread
+    static std::weak_ptr < AstGridWorker > current;
+    SharedPtr worker = current.lock();
+    if ( ! worker ) {
+        QThread * thread = new QThread();
+        AstGridWorker * raw = new AstGridWorker();
+        raw-> moveToThread( thread );
+        thread-> start();
+
+        // let the job in progress finish before the thread goes away
+        worker.reset( raw, [thread] ( AstGridWorker * w ) {
+            thread-> quit();
+            thread-> wait();
+            delete w;
+            delete thread;
+        });
+        current = worker;
+    }
+    return worker;
+} // shared
+
+void
+AstGridWorker::render( std::shared_ptr < AstGridJob > job )
+{
+    emit _renderRequested( job );
+}
+
+void
+AstGridWorker::_render( std::shared_ptr < AstGridJob > job )
+{
+    job-> plotter.setOutputVGComposer( & job-> vgc );
+    job-> success = job-> plotter.plot();
+    if ( ! job-> success ) {
+        job-> error = job-> plotter.getError();
+    }
+    emit done( job );
+}
+}
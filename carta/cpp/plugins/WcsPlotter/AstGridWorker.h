@@ -0,0 +1,72 @@
+/**
+ * Renders WCS grids with AST on a thread of their own.
+ **/
+
+#pragma once
+
+#include "AstGridPlotter.h"
+#include "CartaLib/CartaLib.h"
+#include <QObject>
+#include <memory>
+
+namespace WcsPlotterPluginNS
+{
+/// everything needed to render one grid, so that the service can change while
+/// the worker renders it
+struct AstGridJob
+{
+    /// the plotter with all of its options set
+    AstGridPlotter plotter;
+
+    /// receives the grid, after the entries that were added before rendering
+    Carta::Lib::VectorGraphics::VGComposer vgc;
+
+    /// key of the grid cache for the settings of the job
+    QString cacheKey;
+
+    /// filled in by the worker
+    bool success = false;
+    QString error;
+};
+
+/// Renders grids one at a time on a dedicated thread.
+///
+/// AST plotting and the grf driver keep their state in globals, so all AST calls
+/// of the process are made on this one thread, which is shared by every grid
+/// render service. The thread stops when the last service lets go of it.
+class AstGridWorker : public QObject
+{
+    Q_OBJECT
+    CLASS_BOILERPLATE( AstGridWorker );
+
+public:
+
+    /// the worker shared by all grid render services, started on first use
+    static SharedPtr
+    shared();
+
+    /// queue a job; done() is emitted from the worker thread once it is rendered
+    void
+    render( std::shared_ptr < AstGridJob > job );
+
+signals:
+
+    void
+    done( std::shared_ptr < WcsPlotterPluginNS::AstGridJob > job );
+
+    /// hands a job over to the worker thread
+    void
+    _renderRequested( std::shared_ptr < WcsPlotterPluginNS::AstGridJob > job );
+
+private slots:
+
+    void
+    _render( std::shared_ptr < WcsPlotterPluginNS::AstGridJob > job );
+
+private:
+
+    AstGridWorker();
+};
+}
+
+Q_DECLARE_METATYPE( std::shared_ptr < WcsPlotterPluginNS::AstGridJob > )
@@ -3,11 +3,13 @@
  **/
 
 #include "AstGridPlotter.h"
+#include "AstGridWorker.h"
 #include "AstWcsGridRenderService.h"
 #include "FitsHeaderExtractor.h"
 #include "CartaLib/LinearMap.h"
+#include <QCache>
+#include <QCryptographicHash>
 #include <QPainter>
-#include <QTime>
 #include <set>
 
 
@@ -17,6 +19,11 @@ namespace VGE = VG::Entries;
 
 namespace WcsPlotterPluginNS
 {
+namespace
+{
+/// how many grids are kept for reuse
+const int GRID_CACHE_SIZE = 16;
+}
 
 
 struct AstWcsGridRenderService::Pimpl
@@ -27,6 +34,13 @@ struct AstWcsGridRenderService::Pimpl
     // fits header from the input image
     QStringList fitsHeader;
 
+    // digest of the fits header, so that grid cache keys stay short
+    QByteArray fitsHeaderDigest;
+
+    // grids already rendered, keyed by everything that goes into astPlot/astGrid
+    // except the pens, which are stored into the list afterwards
+    QCache < QString, VG::VGList > gridCache;
+
     // current sky CS
     Carta::Lib::KnownSkyCS knownSkyCS = Carta::Lib::KnownSkyCS::J2000;
 
@@ -44,6 +58,15 @@ struct AstWcsGridRenderService::Pimpl
 
     // last submitted job id
     IWcsGridRenderService::JobId lastSubmittedJobId = 0;
+
+    // the thread that does the AST plotting
+    AstGridWorker::SharedPtr worker;
+
+    // the grid being rendered by the worker, if any
+    std::shared_ptr < AstGridJob > runningJob;
+
+    // whether another render was asked for while the worker was busy
+    bool renderQueued = false;
 };
 
 AstWcsGridRenderService::AstWcsGridRenderService()
@@ -58,10 +81,15 @@ AstWcsGridRenderService::AstWcsGridRenderService()
     m().fonts.resize( static_cast < int > ( Element::__count ), tuple );
     // make default pen entries indicating we have not set them yet
     m().penEntries.resize( static_cast < int > ( Element::__count ), - 1 );
+    m().gridCache.setMaxCost( GRID_CACHE_SIZE );
 
     // setup render timer & hook it up
     m_renderTimer.setSingleShot( true );
     connect( & m_renderTimer, & QTimer::timeout, this, & Me::renderNow );
+
+    // grids are rendered off the main thread
+    m().worker = AstGridWorker::shared();
+    connect( m().worker.get(), & AstGridWorker::done, this, & Me::_gridDone );
 }
 
 AstWcsGridRenderService::~AstWcsGridRenderService()
@@ -72,6 +100,11 @@ AstWcsGridRenderService::setInputImage( Carta::Lib::Image::ImageInterface::Share
 {
     CARTA_ASSERT( image );
 
+    // the header of an image does not change, and extracting it can mean reading
+    // the file, which would otherwise happen on every channel change
+    if ( image == m_iimage ) {
+        return;
+    }
     m_iimage = image;
 
     // get the fits header from this image
@@ -88,6 +121,8 @@ AstWcsGridRenderService::setInputImage( Carta::Lib::Image::ImageInterface::Share
     if ( header != m().fitsHeader ) {
         m_vgValid = false;
         m().fitsHeader = header;
+        m().fitsHeaderDigest = QCryptographicHash::hash( header.join( "" ).toUtf8(),
+                                                         QCryptographicHash::Sha1 );
     }
 } // setInputImage
 
@@ -135,6 +170,8 @@ Carta::Lib::IWcsGridRenderService::JobId AstWcsGridRenderService::startRendering
 void
 AstWcsGridRenderService::renderNow()
 {
+    m().renderQueued = false;
+
     // if the VGList is still valid, we are done
     if ( m_vgValid ) {
         //qDebug() << "vgValid saved us a grid redraw xyz";
@@ -142,9 +179,6 @@ AstWcsGridRenderService::renderNow()
         return;
     }
 
-    QTime t;
-    t.start();
-
     // clear the current vector graphics in case something goes wrong later
 //    m_vgList = VGList();
     m_vgc.clear();
@@ -155,7 +189,26 @@ AstWcsGridRenderService::renderNow()
         return;
     }
 
-    m_vgValid = true;
+    // animating through channels asks for the same grid over and over
+    QString cacheKey = _getCacheKey();
+    VG::VGList * cached = m().gridCache.object( cacheKey );
+    if ( cached ) {
+        m_vgValid = true;
+        m_vgc = VG::VGComposer( * cached );
+        _applyPens();
+        emit done( m_vgc.vgList(), m().lastSubmittedJobId );
+        return;
+    }
+
+    // AST cannot be interrupted, so a new grid is started once the current one
+    // is finished
+    if ( m().runningJob ) {
+        m().renderQueued = true;
+        return;
+    }
+    std::shared_ptr < AstGridJob > job( new AstGridJob() );
+    job-> cacheKey = cacheKey;
+    VG::VGComposer & vgc = job-> vgc;
 
     // local helper - element to integer
     auto si = [&] ( Element e ) {
@@ -186,16 +239,16 @@ AstWcsGridRenderService::renderNow()
         double y1 = m_outRect.top();
         double y2 = m_outRect.bottom();
         double y3 = m_outSize.height();
-        m_vgc.append < VGE::Save > ();
-        m_vgc.append < VGE::SetPen > ( Qt::NoPen );
+        vgc.append < VGE::Save > ();
+        vgc.append < VGE::SetPen > ( Qt::NoPen );
         m().dimBrushIndex =
-            m_vgc.append < VGE::StoreIndexedBrush > ( 0, QBrush( pi( Element::MarginDim ).brush() ) );
-        m_vgc.append < VGE::SetIndexedBrush > ( 0 );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x0, y0 ), QPointF( x1, y3 ) ) );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x2, y0 ), QPointF( x3, y3 ) ) );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y0 ), QPointF( x2, y1 ) ) );
-        m_vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y2 ), QPointF( x2, y3 ) ) );
-        m_vgc.append < VGE::Restore > ();
+            vgc.append < VGE::StoreIndexedBrush > ( 0, QBrush( pi( Element::MarginDim ).brush() ) );
+        vgc.append < VGE::SetIndexedBrush > ( 0 );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x0, y0 ), QPointF( x1, y3 ) ) );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x2, y0 ), QPointF( x3, y3 ) ) );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y0 ), QPointF( x2, y1 ) ) );
+        vgc.append < VGE::DrawRect > ( QRectF( QPointF( x1, y2 ), QPointF( x2, y3 ) ) );
+        vgc.append < VGE::Restore > ();
     }
 
     auto elements {
@@ -217,7 +270,7 @@ AstWcsGridRenderService::renderNow()
     // setup indexed pens
     for ( auto & e : elements ) {
         m().penEntries[si( e )] =
-            m_vgc.append < VGE::StoreIndexedPen > ( si( e ), pi( e ) );
+            vgc.append < VGE::StoreIndexedPen > ( si( e ), pi( e ) );
     }
 
 //    LinMap tx( m_imgRect.left(), m_imgRect.right(), m_outRect.left(), m_outRect.right() );
@@ -225,7 +278,7 @@ AstWcsGridRenderService::renderNow()
 
     // draw the grid
     // =============================
-    AstGridPlotter sgp;
+    AstGridPlotter & sgp = job-> plotter;
 
 //    for ( const QPen & pen : m().pens ) {
 //        sgp.pens().push_back( pen );
@@ -236,7 +289,6 @@ AstWcsGridRenderService::renderNow()
     sgp.setOutputRect( m_outRect );
     sgp.setFitsHeader( m().fitsHeader.join( "" ) );
     sgp.setAxisDisplayInfo( m_axisDisplayInfos );
-    sgp.setOutputVGComposer( & m_vgc );
 
 //    sgp.setPlotOption( "tol=0.001" ); // this can slow down the grid rendering!!!
     sgp.setPlotOption( "DrawTitle=0" );
@@ -375,19 +427,46 @@ AstWcsGridRenderService::renderNow()
 
 
 
-    // do the actual plot
-    bool plotSuccess = sgp.plot();
-//    qDebug() << "plotSuccess=" << plotSuccess;
-//    qDebug() << "plotError=" << sgp.getError();
-    if( ! plotSuccess) {
-        qWarning() << "Grid rendering error:" << sgp.getError();
+    // do the actual plot on the worker thread, the result arrives in _gridDone()
+    m().runningJob = job;
+    m().worker-> render( job );
+} // renderNow
+
+void
+AstWcsGridRenderService::_gridDone( std::shared_ptr < AstGridJob > job )
+{
+    // the worker is shared with the services of other layers
+    if ( job != m().runningJob ) {
+        return;
+    }
+    m().runningJob.reset();
+    if ( ! job-> success ) {
+        qWarning() << "Grid rendering error:" << job-> error;
+    }
+    else {
+        m().gridCache.insert( job-> cacheKey, new VG::VGList( job-> vgc.vgList() ) );
     }
 
-    //qDebug() << "Grid rendered in " << t.elapsed() / 1000.0 << "s";
+    // a newer request waited for this grid, and may be able to use it
+    if ( m().renderQueued ) {
+        renderNow();
+        return;
+    }
+
+    // the settings changed while rendering, so the grid is of no use until asked for
+    if ( m_emptyGridFlag || job-> cacheKey != _getCacheKey() ) {
+        return;
+    }
+    m_vgValid = true;
+    m_vgc = job-> vgc;
+
+    // the pens may have changed while rendering
+    _applyPens();
 
     // Report the result.
     emit done( m_vgc.vgList(), m().lastSubmittedJobId );
-} // startRendering
+} // _gridDone
+
 
 void AstWcsGridRenderService::setAxisDisplayInfo( std::vector<Carta::Lib::AxisDisplayInfo> displayInfos ){
     if ( displayInfos.size() != m_axisDisplayInfos.size()){
@@ -459,22 +538,75 @@ AstWcsGridRenderService::setPen( Carta::Lib::IWcsGridRenderService::Element e, c
     CARTA_ASSERT( ind >= 0 && ind < int ( m().pens.size() ) );
     m().pens[ind] = pen;
 
-    auto si = [&] ( Element e ) {
-        return static_cast < int > ( e );
-    };
-    auto pi = [&] ( Element e ) -> QPen & {
-        return m().pens[si( e )];
-    };
-
     // if the list is valid, just change the entry directly
     if ( m_vgValid ) {
-        m_vgc.set < VGE::StoreIndexedPen > ( m().penEntries[si( e )], si( e ), pi( e ) );
-        if ( e == Element::MarginDim ) {
-            m_vgc.set < VGE::StoreIndexedBrush > ( m().dimBrushIndex, 0, pi( e ).brush() );
-        }
+        _applyPen( e );
     }
 } // setPen
 
+void
+AstWcsGridRenderService::_applyPen( Element e )
+{
+    int ind = static_cast < int > ( e );
+    if ( m().penEntries[ind] < 0 ) {
+        return;
+    }
+    const QPen & pen = m().pens[ind];
+    m_vgc.set < VGE::StoreIndexedPen > ( m().penEntries[ind], ind, pen );
+    if ( e == Element::MarginDim ) {
+        m_vgc.set < VGE::StoreIndexedBrush > ( m().dimBrushIndex, 0, pen.brush() );
+    }
+}
+
+void
+AstWcsGridRenderService::_applyPens()
+{
+    // every grid starts with the same entries, so the pen entries recorded when
+    // rendering any of them are valid for all
+    for ( int ind = 0 ; ind < static_cast < int > ( Element::__count ) ; ++ind ) {
+        _applyPen( static_cast < Element > ( ind ) );
+    }
+}
+
+QString
+AstWcsGridRenderService::_getCacheKey() const
+{
+    QStringList parts;
+    auto rectString = [] ( const QRectF & rect ) {
+        return QString( "%1,%2,%3,%4" ).arg( rect.x(), 0, 'g', 17 ).arg( rect.y(), 0, 'g', 17 )
+               .arg( rect.width(), 0, 'g', 17 ).arg( rect.height(), 0, 'g', 17 );
+    };
+    parts << QString( m_pimpl-> fitsHeaderDigest.toHex() )
+          << rectString( m_imgRect ) << rectString( m_outRect )
+          << QString( "%1x%2" ).arg( m_outSize.width() ).arg( m_outSize.height() );
+
+    // only the spatial part of the wcs goes into the grid: the channel of an axis
+    // that is not displayed matters only when a plane is cut out of the cube
+    bool permuted = Carta::Lib::AxisDisplayInfo::isPermuted( m_axisDisplayInfos );
+    for ( const Carta::Lib::AxisDisplayInfo & info : m_axisDisplayInfos ) {
+        int frame = info.getFrame();
+        parts << QString( "a%1/%2/%3/%4" ).arg( static_cast < int > ( info.getAxisType() ) )
+              .arg( info.getFrameCount() ).arg( info.getPermuteIndex() )
+              .arg( permuted || frame < 0 ? frame : 0 );
+    }
+
+    for ( int i = 0 ; i < m_labels.size() ; ++i ) {
+        const Carta::Lib::AxisLabelInfo & labelInfo = m_labelInfos[i];
+        parts << m_labels[i]
+              << QString( "f%1/%2/%3" ).arg( static_cast < int > ( labelInfo.getFormat() ) )
+              .arg( labelInfo.getPrecision() ).arg( static_cast < int > ( labelInfo.getLocation() ) );
+    }
+    for ( const Pimpl::FontInfo & font : m_pimpl-> fonts ) {
+        parts << QString( "%1/%2" ).arg( font.first ).arg( font.second, 0, 'g', 17 );
+    }
+    parts << QString::number( static_cast < int > ( m_pimpl-> knownSkyCS ) )
+          << QString::number( m_gridDensity, 'g', 17 )
+          << QString::number( m_tickLength, 'g', 17 )
+          << QString( "%1%2%3%4" ).arg( m_gridLines ).arg( m_axes ).arg( m_ticks )
+          .arg( m_internalLabels );
+    return parts.join( "|" );
+} // _getCacheKey
+
 
 void AstWcsGridRenderService::setAxisLabelInfo( int axisIndex, const Carta::Lib::AxisLabelInfo& labelInfo ){
     CARTA_ASSERT( axisIndex == 0 || axisIndex == 1 );
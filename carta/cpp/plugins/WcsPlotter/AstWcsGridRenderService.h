@@ -17,6 +17,7 @@ namespace WcsPlotterPluginNS
 {
 
 class AstGridPlotter;
+struct AstGridJob;
 
 /// implementation of Carta::Lib::IWcsGridRenderService APIs
 class AstWcsGridRenderService : public Carta::Lib::IWcsGridRenderService
@@ -91,6 +92,9 @@ private slots:
     // internal slot - does the actual rendering
     void renderNow();
 
+    // a grid has been rendered by the worker thread
+    void _gridDone( std::shared_ptr < WcsPlotterPluginNS::AstGridJob > job );
+
     // part of a hack to simulate delayed signal
 //    void
 //    reportResult();
@@ -111,6 +115,14 @@ private:
     //Don't label a particular axis
     void _turnOffLabels( WcsPlotterPluginNS::AstGridPlotter* sgp, int index );
 
+    //Store the current pen of an element into the vector graphics list.
+    void _applyPen( Element e );
+    //Store the current pens of all elements into the vector graphics list.
+    void _applyPens();
+    //Key of the grid cache: the spatial part of the WCS, the rectangles and the
+    //grid and label options.
+    QString _getCacheKey() const;
+
     Carta::Lib::VectorGraphics::VGComposer m_vgc;
 //    VGList m_vgList;
 
@@ -13,6 +13,7 @@ SOURCES += \
     SimpleFitsParser.cpp \
     WcsPlotterPlugin.cpp \
     AstGridPlotter.cpp \
+    AstGridWorker.cpp \
     AstWcsGridRenderService.cpp
 
 HEADERS += \
@@ -21,6 +22,7 @@ HEADERS += \
     SimpleFitsParser.h \
     WcsPlotterPlugin.h \
     AstGridPlotter.h \
+    AstGridWorker.h \
     AstWcsGridRenderService.h
 
 astlibLIBS += $${ASTLIBDIR}/lib/libast.a